@@ -55,11 +55,16 @@ SOURCES += \
         connectionmanager.cpp \
         conndialog.cpp \
         contentwidget.cpp \
+        cursorbrowser.cpp \
         datasyncdialog.cpp \
+        explainplanview.cpp \
         tabledesignerdialog.cpp \
         importdialog.cpp \
         exportdialog.cpp \
+        fanoutrunner.cpp \
         flowlayout.cpp \
+        jobscheduler.cpp \
+        jobsdialog.cpp \
         languagemanager.cpp \
         leftwidgetform.cpp \
         main.cpp \
@@ -67,7 +72,16 @@ SOURCES += \
         myedit.cpp \
         mytreewidget.cpp \
         queryform.cpp \
+        queryhistory.cpp \
+        queryhistorydialog.cpp \
+        queryprofiler.cpp \
         resultform.cpp \
+        resultfile.cpp \
+        resultspill.cpp \
+        runsqldialog.cpp \
+        sessionpool.cpp \
+        sqlsplitter.cpp \
+        sshtunnel.cpp \
         $$PWD/plugins/sqldrivers/mysql/mysql_plugin_main.cpp \
         $$PWD/plugins/sqldrivers/mysql/qsql_mysql.cpp
 
@@ -75,18 +89,32 @@ HEADERS += \
         connectionmanager.h \
         conndialog.h \
         contentwidget.h \
+        cursorbrowser.h \
         datasyncdialog.h \
+        explainplanview.h \
         tabledesignerdialog.h \
         importdialog.h \
         exportdialog.h \
+        fanoutrunner.h \
         flowlayout.h \
+        jobscheduler.h \
+        jobsdialog.h \
         languagemanager.h \
         leftwidgetform.h \
         mainwindow.h \
         myedit.h \
         mytreewidget.h \
         queryform.h \
+        queryhistory.h \
+        queryhistorydialog.h \
+        queryprofiler.h \
         resultform.h \
+        resultfile.h \
+        resultspill.h \
+        runsqldialog.h \
+        sessionpool.h \
+        sqlsplitter.h \
+        sshtunnel.h \
         $$PWD/plugins/sqldrivers/mysql/qsql_mysql_p.h
 
 RESOURCES = resources.qrc
@@ -161,6 +161,16 @@ QWidget *ConnDialog::createAdvancedTab()
     autoSubmitCheck->setChecked(true);
     layout->addRow(QString(), autoSubmitCheck);
 
+    compressCheck = new QCheckBox(tr("压缩客户端/服务器协议"), tab);
+    compressCheck->setToolTip(tr("跨地域等带宽受限的连接上可减少传输量，但会增加双方的 CPU 开销"));
+    layout->addRow(QString(), compressCheck);
+
+    warmSessionsSpin = new QSpinBox(tab);
+    warmSessionsSpin->setRange(0, 16);
+    warmSessionsSpin->setSpecialValueText(tr("不预热"));
+    warmSessionsSpin->setToolTip(tr("启动时在后台预先建立并初始化的会话数，首次查询无需等待连接"));
+    layout->addRow(tr("预热会话:"), warmSessionsSpin);
+
     charsetCombo = new QComboBox(tab);
     charsetCombo->addItems(commonCharsets());
     layout->addRow(tr("编码:"), charsetCombo);
@@ -359,6 +369,8 @@ void ConnDialog::fillFromInfo(const ConnectionInfo &info)
     serverTimezoneEdit->setText(info.serverTimeZone);
     localClientEdit->setText(info.localClient);
     autoSubmitCheck->setChecked(info.autoSubmit);
+    compressCheck->setChecked(info.compress);
+    warmSessionsSpin->setValue(info.warmSessions);
     sshEnableCheck->setChecked(info.ssh.enabled);
     sshHostEdit->setText(info.ssh.host);
     sshPortSpin->setValue(info.ssh.port);
@@ -399,6 +411,8 @@ ConnectionInfo ConnDialog::gatherInfo() const
     info.serverTimeZone = serverTimezoneEdit->text().trimmed();
     info.localClient = localClientEdit->text().trimmed();
     info.autoSubmit = autoSubmitCheck->isChecked();
+    info.compress = compressCheck->isChecked();
+    info.warmSessions = warmSessionsSpin->value();
     info.ssh.enabled = sshEnableCheck->isChecked();
     info.ssh.host = sshHostEdit->text().trimmed();
     info.ssh.port = quint16(sshPortSpin->value());
@@ -74,6 +74,8 @@ private:
     QLineEdit *serverTimezoneEdit;
     QLineEdit *localClientEdit;
     QCheckBox *autoSubmitCheck;
+    QCheckBox *compressCheck;
+    QSpinBox *warmSessionsSpin;
     QCheckBox *sshEnableCheck;
     QLineEdit *sshHostEdit;
     QSpinBox *sshPortSpin;
@@ -1,4 +1,5 @@
 #include "connectionmanager.h"
+#include "sshtunnel.h"
 
 #include <QCoreApplication>
 #include <QDateTime>
@@ -111,6 +112,8 @@ QJsonObject toJson(const ConnectionInfo &info)
     obj["serverTimeZone"] = info.serverTimeZone;
     obj["localClient"] = info.localClient;
     obj["autoSubmit"] = info.autoSubmit;
+    obj["compress"] = info.compress;
+    obj["warmSessions"] = info.warmSessions;
     obj["ssh"] = sshToJson(info.ssh);
     obj["properties"] = propertiesToJson(info.properties);
     obj["startupScript"] = info.startupScript;
@@ -139,6 +142,8 @@ ConnectionInfo fromJson(const QJsonObject &obj)
     info.serverTimeZone = obj.value("serverTimeZone").toString();
     info.localClient = obj.value("localClient").toString();
     info.autoSubmit = obj.value("autoSubmit").toBool(true);
+    info.compress = obj.value("compress").toBool(false);
+    info.warmSessions = obj.value("warmSessions").toInt(0);
     info.ssh = sshFromJson(obj.value("ssh").toObject());
     info.properties = propertiesFromJson(obj.value("properties").toArray());
     info.startupScript = obj.value("startupScript").toString();
@@ -221,10 +226,13 @@ bool ConnectionManager::testConnection(const ConnectionInfo &info, QString *erro
 {
     QString connName = uniqueConnectionName(QStringLiteral("test"));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connName);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        QSqlDatabase::removeDatabase(connName);
+        return false;
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     if(!info.defaultDb.isEmpty()){
         db.setDatabaseName(info.defaultDb);
     }
@@ -240,10 +248,13 @@ QStringList ConnectionManager::fetchDatabases(const ConnectionInfo &info, QStrin
 {
     QString connName = uniqueConnectionName(QStringLiteral("listdb"));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connName);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        QSqlDatabase::removeDatabase(connName);
+        return {};
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     QStringList dbs;
     if(!db.open()){
         if(errorMessage){
@@ -281,10 +292,13 @@ QStringList ConnectionManager::fetchTables(const ConnectionInfo &info,
 
     QString connName = uniqueConnectionName(QStringLiteral("listtbl"));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connName);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        QSqlDatabase::removeDatabase(connName);
+        return {};
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(targetDb);
 
     QStringList tables;
@@ -371,6 +385,29 @@ void ConnectionManager::ensureDefaultConnection()
     persist();
 }
 
+QString ConnectionManager::connectOptions(const ConnectionInfo &info)
+{
+    QStringList options;
+    if(info.compress){
+        options << QStringLiteral("CLIENT_COMPRESS");
+    }
+    return options.join(QLatin1Char(';'));
+}
+
+bool ConnectionManager::applyEndpoint(QSqlDatabase &db, const ConnectionInfo &info, QString *errorMessage)
+{
+    QString host;
+    int port = 0;
+    if(!SshTunnelManager::instance()->endpoint(info, &host, &port, errorMessage)){
+        // Without a tunnel leave the address unset so nothing connects to info.host past
+        // the bastion; callers must abort
+        return false;
+    }
+    db.setHostName(host);
+    db.setPort(port);
+    return true;
+}
+
 QList<ConnectionProperty> ConnectionManager::defaultMysqlProperties()
 {
     QList<ConnectionProperty> props;
@@ -5,6 +5,8 @@
 #include <QList>
 #include <QString>
 
+class QSqlDatabase;
+
 struct ConnectionProperty
 {
     QString name;
@@ -45,6 +47,8 @@ struct ConnectionInfo
     QString serverTimeZone;
     QString localClient;
     bool autoSubmit = true;
+    bool compress = false;
+    int warmSessions = 0;   // above 0 marks a frequently used connection: sessions opened at startup
     SshSettings ssh;
     QList<ConnectionProperty> properties;
     QString startupScript;
@@ -70,6 +74,10 @@ public:
                             const QString &database,
                             QString *errorMessage = nullptr) const;
     static QList<ConnectionProperty> defaultMysqlProperties();
+    static QString connectOptions(const ConnectionInfo &info);
+    // Sets the address to connect to (the local tunnel port with SSH); on false db has no
+    // address and must not be opened
+    [[nodiscard]] static bool applyEndpoint(QSqlDatabase &db, const ConnectionInfo &info, QString *errorMessage = nullptr);
 
 signals:
     void connectionsChanged();
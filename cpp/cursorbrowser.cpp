@@ -0,0 +1,122 @@
+#include "cursorbrowser.h"
+
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QUuid>
+
+CursorBrowser::CursorBrowser() = default;
+
+CursorBrowser::~CursorBrowser()
+{
+    close();
+}
+
+bool CursorBrowser::open(const ConnectionInfo &info,
+                         const QString &dbName,
+                         const QString &sql,
+                         int windowRows,
+                         QString *errorMessage)
+{
+    close();
+    m_headers.clear();
+    m_fetched = 0;
+    m_windowRows = qMax(1, windowRows);
+    m_handle = QStringLiteral("browse_%1_%2").arg(info.name, QUuid::createUuid().toString(QUuid::Id128));
+
+    QString error;
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), m_handle);
+        QString endpointError;
+        const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
+        db.setUserName(info.user);
+        db.setPassword(info.password);
+        db.setConnectOptions(ConnectionManager::connectOptions(info));
+        const QString targetDb = dbName.isEmpty() ? info.defaultDb : dbName;
+        if(!targetDb.isEmpty()){
+            db.setDatabaseName(targetDb);
+        }
+        if(!endpointOk || !db.open()){
+            error = endpointOk ? db.lastError().text() : endpointError;
+        }else{
+            // Makes the driver open a forward-only prepared SELECT as a read-only server
+            // cursor, one window per round trip
+            db.driver()->setProperty("cursorPrefetchRows", m_windowRows);
+            m_query.reset(new QSqlQuery(db));
+            m_query->setForwardOnly(true);
+            if(!m_query->prepare(sql) || !m_query->exec()){
+                error = m_query->lastError().text();
+            }else if(!m_query->isSelect()){
+                error = QObject::tr("The statement does not return rows.");
+            }else{
+                ok = true;
+            }
+        }
+    }
+    if(!ok){
+        if(errorMessage){
+            *errorMessage = error;
+        }
+        close();
+        return false;
+    }
+    // Without server-side prepare the driver falls back to a plain query; the whole
+    // result is fetched and size() is known
+    m_serverCursor = m_query->size() < 0;
+    const QSqlRecord record = m_query->record();
+    for(int col = 0; col < record.count(); ++col){
+        m_headers << record.fieldName(col);
+    }
+    m_atEnd = false;
+    return true;
+}
+
+QList<QVariantList> CursorBrowser::fetchWindow(QString *errorMessage)
+{
+    QList<QVariantList> rows;
+    if(!m_query || m_atEnd){
+        return rows;
+    }
+    const int columns = m_headers.size();
+    rows.reserve(m_windowRows);
+    while(rows.size() < m_windowRows){
+        if(!m_query->next()){
+            m_atEnd = true;
+            if(m_query->lastError().isValid() && errorMessage){
+                *errorMessage = m_query->lastError().text();
+            }
+            break;
+        }
+        QVariantList row;
+        row.reserve(columns);
+        for(int col = 0; col < columns; ++col){
+            row << m_query->value(col);
+        }
+        rows << row;
+    }
+    m_fetched += rows.size();
+    if(m_atEnd){
+        // Release the session once the cursor is drained; the headers stay for the last batch
+        close();
+    }
+    return rows;
+}
+
+void CursorBrowser::close()
+{
+    m_query.reset();
+    m_atEnd = true;
+    m_serverCursor = false;
+    if(!m_handle.isEmpty()){
+        {
+            QSqlDatabase db = QSqlDatabase::database(m_handle, false);
+            if(db.isValid()){
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(m_handle);
+        m_handle.clear();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef CURSORBROWSER_H
+#define CURSORBROWSER_H
+
+#include "connectionmanager.h"
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVariant>
+#include <memory>
+
+class QSqlQuery;
+
+// Keeps one SELECT open as a read-only server-side cursor on a dedicated
+// session and hands its rows out window by window, so a large result is
+// browsed with one execution and without storing it on the client.
+class CursorBrowser
+{
+public:
+    CursorBrowser();
+    ~CursorBrowser();
+
+    bool open(const ConnectionInfo &info,
+              const QString &dbName,
+              const QString &sql,
+              int windowRows,
+              QString *errorMessage);
+    QList<QVariantList> fetchWindow(QString *errorMessage = nullptr);
+    void close();
+
+    bool isOpen() const { return m_query != nullptr; }
+    bool atEnd() const { return m_atEnd; }
+    bool usesServerCursor() const { return m_serverCursor; }
+    QStringList headers() const { return m_headers; }
+    qint64 fetchedRows() const { return m_fetched; }
+
+private:
+    QString m_handle;
+    std::unique_ptr<QSqlQuery> m_query;
+    QStringList m_headers;
+    int m_windowRows = 500;
+    qint64 m_fetched = 0;
+    bool m_atEnd = true;
+    bool m_serverCursor = false;
+};
+
+#endif // CURSORBROWSER_H
@@ -1,4 +1,5 @@
 #include "datasyncdialog.h"
+#include "jobscheduler.h"
 #include "languagemanager.h"
 
 #include <QCheckBox>
@@ -56,10 +57,12 @@ bool configureDatabase(QSqlDatabase &db,
                        const QString &dbName,
                        QString *error)
 {
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, error)){
+        return false;
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     const QString finalDb = dbName.isEmpty() ? info.defaultDb : dbName;
     if(finalDb.isEmpty()){
         if(error){
@@ -99,6 +102,8 @@ DataSyncDialog::DataSyncDialog(QWidget *parent)
 DataSyncDialog::~DataSyncDialog()
 {
     if(syncThread){
+        // A sync job still queued has to be cancelled first or the worker never returns
+        JobScheduler::instance()->cancel(syncJobId);
         syncThread->quit();
         syncThread->wait();
     }
@@ -597,7 +602,13 @@ void DataSyncDialog::startSync()
         syncThread = nullptr;
     }
 
-    auto *worker = new DataSyncWorker(this, tasks, options);
+    syncJobId = JobScheduler::instance()->enqueue(QStringLiteral("data sync"),
+                                                  QStringLiteral("%1.%2 -> %3.%4")
+                                                  .arg(sourceConnName, sourceDbName, targetConnName, targetDbName),
+                                                  {sourceInfo.name, targetInfo.name},
+                                                  JobScheduler::Background);
+    const quint64 jobId = syncJobId;
+    auto *worker = new DataSyncWorker(this, tasks, options, jobId);
     QThread *workerThread = new QThread(this);
     syncThread = workerThread;
     worker->moveToThread(workerThread);
@@ -610,6 +621,9 @@ void DataSyncDialog::startSync()
         }
     });
     connect(worker, &DataSyncWorker::finished, this, &DataSyncDialog::handleSyncFinished);
+    connect(worker, &DataSyncWorker::finished, worker, [jobId](bool aborted, const QString &message) {
+        JobScheduler::instance()->finish(jobId, !aborted, aborted ? message : QString());
+    }, Qt::DirectConnection);
     connect(worker, &DataSyncWorker::finished, worker, &QObject::deleteLater);
     connect(worker, &DataSyncWorker::finished, workerThread, &QThread::quit);
     connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
@@ -1134,44 +1148,101 @@ bool DataSyncDialog::copyTableData(const TableMappingEntry &entry,
     }
 
     qint64 totalRows = 0;
-    int pending = 0;
+    qint64 rowNumber = 0;
     bool hadError = false;
     QString firstError;
 
-    while(selectQuery.next()){
-        for(int i = 0; i < columnCount; ++i){
-            insertQuery.bindValue(i, selectQuery.value(i));
+    // Rows are buffered per column and handed to execBatch as a batch, which the driver
+    // turns into a multi-row INSERT
+    QVector<QVariantList> pendingColumns(columnCount);
+    QVector<qint64> pendingRows;
+    auto clearPending = [&pendingColumns, &pendingRows]() {
+        for(QVariantList &column : pendingColumns){
+            column.clear();
         }
-        if(!insertQuery.exec()){
-            hadError = true;
-            const QString detail = insertQuery.lastError().text();
-            if(firstError.isEmpty()){
-                firstError = trLang(QStringLiteral("写入第 %1 行失败：%2"),
-                                    QStringLiteral("Failed to insert row %1: %2"))
-                        .arg(totalRows + 1)
-                        .arg(detail);
-            }
-            if(logCallback){
-                logCallback(trLang(QStringLiteral("  [WARN] 第 %1 行写入失败：%2"),
-                                   QStringLiteral("  [WARN] Row %1 failed to insert: %2"))
-                            .arg(totalRows + 1)
-                            .arg(detail));
+        pendingRows.clear();
+    };
+    // false means an error occurred and continuing is not allowed
+    auto insertRowByRow = [&]() -> bool {
+        for(int row = 0; row < pendingRows.size(); ++row){
+            for(int i = 0; i < columnCount; ++i){
+                insertQuery.bindValue(i, pendingColumns.at(i).at(row));
             }
-            if(!continueOnError){
-                if(inTransaction){
-                    targetDb.rollback();
+            if(!insertQuery.exec()){
+                hadError = true;
+                const QString detail = insertQuery.lastError().text();
+                if(firstError.isEmpty()){
+                    firstError = trLang(QStringLiteral("写入第 %1 行失败：%2"),
+                                        QStringLiteral("Failed to insert row %1: %2"))
+                            .arg(pendingRows.at(row))
+                            .arg(detail);
                 }
-                if(errorMessage){
-                    *errorMessage = firstError;
+                if(logCallback){
+                    logCallback(trLang(QStringLiteral("  [WARN] 第 %1 行写入失败：%2"),
+                                       QStringLiteral("  [WARN] Row %1 failed to insert: %2"))
+                                .arg(pendingRows.at(row))
+                                .arg(detail));
                 }
-                return false;
+                if(!continueOnError){
+                    return false;
+                }
+                continue;
             }
-            continue;
+            ++totalRows;
         }
+        return true;
+    };
+    // When a batch fails, roll back to the savepoint and replay it row by row to find the
+    // bad row; without a transaction there is nothing to roll back, so rows are written
+    // one at a time
+    auto flushPending = [&]() -> bool {
+        if(pendingRows.isEmpty()){
+            return true;
+        }
+        bool ok = true;
+        QSqlQuery savepoint(targetDb);
+        if(!inTransaction || !savepoint.exec(QStringLiteral("SAVEPOINT sync_batch"))){
+            ok = insertRowByRow();
+        }else{
+            for(int i = 0; i < columnCount; ++i){
+                insertQuery.bindValue(i, pendingColumns.at(i));
+            }
+            if(insertQuery.execBatch()){
+                totalRows += pendingRows.size();
+            }else if(savepoint.exec(QStringLiteral("ROLLBACK TO SAVEPOINT sync_batch"))){
+                ok = insertRowByRow();
+            }else{
+                hadError = true;
+                firstError = trLang(QStringLiteral("批量写入失败：%1"),
+                                    QStringLiteral("Batch insert failed: %1"))
+                        .arg(insertQuery.lastError().text());
+                ok = false;
+            }
+        }
+        clearPending();
+        return ok;
+    };
 
-        ++totalRows;
-        ++pending;
-        if(inTransaction && pending >= batchSize){
+    while(selectQuery.next()){
+        ++rowNumber;
+        for(int i = 0; i < columnCount; ++i){
+            pendingColumns[i] << selectQuery.value(i);
+        }
+        pendingRows << rowNumber;
+        // Without a transaction each batch is one row, so a failing row takes no others with it
+        if(pendingRows.size() < (inTransaction ? batchSize : 1)){
+            continue;
+        }
+        if(!flushPending()){
+            if(inTransaction){
+                targetDb.rollback();
+            }
+            if(errorMessage){
+                *errorMessage = firstError;
+            }
+            return false;
+        }
+        if(inTransaction){
             if(!targetDb.commit()){
                 if(errorMessage){
                     *errorMessage = trLang(QStringLiteral("提交批次失败：%1"),
@@ -1187,9 +1258,17 @@ bool DataSyncDialog::copyTableData(const TableMappingEntry &entry,
                 }
                 inTransaction = false;
             }
-            pending = 0;
         }
     }
+    if(!flushPending()){
+        if(inTransaction){
+            targetDb.rollback();
+        }
+        if(errorMessage){
+            *errorMessage = firstError;
+        }
+        return false;
+    }
 
     if(inTransaction){
         if(!targetDb.commit()){
@@ -1224,11 +1303,13 @@ void DataSyncDialog::appendLogMessage(const QString &message)
 }
 DataSyncWorker::DataSyncWorker(DataSyncDialog *dialog,
                                QVector<DataSyncDialog::TableMappingEntry> tasks,
-                               const DataSyncOptions &options)
+                               const DataSyncOptions &options,
+                               quint64 jobId)
     : QObject(nullptr)
     , m_dialog(dialog)
     , m_tasks(std::move(tasks))
     , m_options(options)
+    , m_jobId(jobId)
 {
 }
 
@@ -1245,6 +1326,13 @@ void DataSyncWorker::process()
         emit finished(true, summary, 0, 0, 0);
         return;
     }
+    if(!JobScheduler::instance()->waitForStart(m_jobId)){
+        const QString summary = trLang(QStringLiteral("同步任务已取消。"),
+                                       QStringLiteral("Synchronization job cancelled."));
+        log(summary);
+        emit finished(true, summary, 0, 0, 0);
+        return;
+    }
 
     int successTables = 0;
     int failedTables = 0;
@@ -1281,6 +1369,14 @@ void DataSyncWorker::process()
             const int totalTasks = m_tasks.size();
             int currentTask = 0;
             for(const auto &entry : std::as_const(m_tasks)){
+                // Between tables, yield to interactive queries on the same connection and
+                // honour cancels from the jobs panel
+                if(!JobScheduler::instance()->checkpoint(m_jobId)){
+                    aborted = true;
+                    abortMessage = trLang(QStringLiteral("同步任务已取消。"),
+                                          QStringLiteral("Synchronization job cancelled."));
+                    break;
+                }
                 emit progressChanged(currentTask, totalTasks);
                 ++currentTask;
                 const QString targetTable = entry.targetTable.isEmpty() ? entry.sourceTable : entry.targetTable;
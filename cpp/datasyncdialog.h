@@ -158,6 +158,7 @@ private:
     QVector<TableMappingEntry> mappings;
     QString sourceHintTable;
     QThread *syncThread = nullptr;
+    quint64 syncJobId = 0;
     bool syncInProgress = false;
 
     friend class DataSyncWorker;
@@ -169,7 +170,8 @@ class DataSyncWorker : public QObject
 public:
     DataSyncWorker(DataSyncDialog *dialog,
                    QVector<DataSyncDialog::TableMappingEntry> tasks,
-                   const DataSyncOptions &options);
+                   const DataSyncOptions &options,
+                   quint64 jobId = 0);
 
 public slots:
     void process();
@@ -187,6 +189,7 @@ private:
     DataSyncDialog *m_dialog = nullptr;
     QVector<DataSyncDialog::TableMappingEntry> m_tasks;
     DataSyncOptions m_options;
+    quint64 m_jobId = 0;
 };
 
 #endif // DATASYNCDIALOG_H
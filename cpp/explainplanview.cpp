@@ -0,0 +1,637 @@
+#include "explainplanview.h"
+
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QLabel>
+#include <QPair>
+#include <QPlainTextEdit>
+#include <QRegularExpression>
+#include <QSplitter>
+#include <QTreeWidget>
+#include <QTreeWidgetItemIterator>
+#include <QVBoxLayout>
+#include <QVector>
+#include <cmath>
+
+namespace {
+
+enum PlanColumn {
+    OperationColumn = 0,
+    TableColumn,
+    AccessColumn,
+    KeyColumn,
+    EstRowsColumn,
+    ActualRowsColumn,
+    CostColumn,
+    TimeColumn,
+    LoopsColumn,
+    WarningColumn,
+    ColumnCount
+};
+
+const int DetailRole = Qt::UserRole + 1;
+const int HotspotRole = Qt::UserRole + 2;
+// Actual rows off from the estimate by more than this factor hint at stale statistics
+const double kMisestimateRatio = 10.0;
+
+double jsonNumber(const QJsonValue &value)
+{
+    if(value.isDouble()){
+        return value.toDouble();
+    }
+    if(value.isString()){
+        bool ok = false;
+        const double number = value.toString().toDouble(&ok);
+        return ok ? number : -1;
+    }
+    return -1;
+}
+
+QString formatNumber(double value)
+{
+    if(value < 0){
+        return QString();
+    }
+    if(value >= 1000000){
+        return QStringLiteral("%1M").arg(value / 1000000.0, 0, 'f', 2);
+    }
+    if(std::floor(value) == value){
+        return QString::number(static_cast<qint64>(value));
+    }
+    return QString::number(value, 'f', 2);
+}
+
+QString joinJsonStrings(const QJsonValue &value)
+{
+    QStringList parts;
+    const QJsonArray array = value.toArray();
+    for(const QJsonValue &item : array){
+        parts << item.toString();
+    }
+    return parts.join(QStringLiteral(", "));
+}
+
+QString operationForAccessType(const QString &accessType)
+{
+    static const QHash<QString, QString> names = {
+        {QStringLiteral("ALL"), QStringLiteral("Table scan")},
+        {QStringLiteral("index"), QStringLiteral("Index scan")},
+        {QStringLiteral("range"), QStringLiteral("Index range scan")},
+        {QStringLiteral("ref"), QStringLiteral("Index lookup")},
+        {QStringLiteral("ref_or_null"), QStringLiteral("Index lookup (or null)")},
+        {QStringLiteral("eq_ref"), QStringLiteral("Single-row index lookup")},
+        {QStringLiteral("const"), QStringLiteral("Constant row")},
+        {QStringLiteral("system"), QStringLiteral("Constant row")},
+        {QStringLiteral("fulltext"), QStringLiteral("Fulltext lookup")},
+        {QStringLiteral("index_merge"), QStringLiteral("Index merge")},
+        {QStringLiteral("unique_subquery"), QStringLiteral("Unique subquery")},
+        {QStringLiteral("index_subquery"), QStringLiteral("Index subquery")}
+    };
+    return names.value(accessType, accessType.isEmpty() ? QStringLiteral("Table") : accessType);
+}
+
+void appendJsonChildren(const QJsonObject &obj, ExplainPlanNode &parent);
+
+ExplainPlanNode jsonQueryBlock(const QJsonObject &block, const QString &label = QString())
+{
+    ExplainPlanNode node;
+    const int selectId = block.value(QStringLiteral("select_id")).toInt();
+    node.operation = label.isEmpty() ? QStringLiteral("Query block") : label;
+    if(selectId > 0){
+        node.operation += QStringLiteral(" #%1").arg(selectId);
+    }
+    const QJsonObject costInfo = block.value(QStringLiteral("cost_info")).toObject();
+    node.cost = jsonNumber(costInfo.value(QStringLiteral("query_cost")));
+    const QString message = block.value(QStringLiteral("message")).toString();
+    if(!message.isEmpty()){
+        node.notes << message;
+    }
+    appendJsonChildren(block, node);
+    return node;
+}
+
+ExplainPlanNode jsonTableNode(const QJsonObject &table)
+{
+    ExplainPlanNode node;
+    node.accessType = table.value(QStringLiteral("access_type")).toString();
+    node.operation = operationForAccessType(node.accessType);
+    node.tableName = table.value(QStringLiteral("table_name")).toString();
+    node.key = table.value(QStringLiteral("key")).toString();
+    node.possibleKeys = joinJsonStrings(table.value(QStringLiteral("possible_keys")));
+    node.estimatedRows = jsonNumber(table.value(QStringLiteral("rows_examined_per_scan")));
+    node.filtered = jsonNumber(table.value(QStringLiteral("filtered")));
+    node.condition = table.value(QStringLiteral("attached_condition")).toString();
+
+    const QJsonObject costInfo = table.value(QStringLiteral("cost_info")).toObject();
+    node.cost = jsonNumber(costInfo.value(QStringLiteral("prefix_cost")));
+    const double readCost = jsonNumber(costInfo.value(QStringLiteral("read_cost")));
+    const double evalCost = jsonNumber(costInfo.value(QStringLiteral("eval_cost")));
+    if(readCost >= 0 || evalCost >= 0){
+        node.selfCost = qMax(0.0, readCost) + qMax(0.0, evalCost);
+    }
+
+    const double produced = jsonNumber(table.value(QStringLiteral("rows_produced_per_join")));
+    if(produced >= 0){
+        node.notes << QStringLiteral("Rows produced per join: %1").arg(formatNumber(produced));
+    }
+    const QString usedParts = joinJsonStrings(table.value(QStringLiteral("used_key_parts")));
+    if(!usedParts.isEmpty()){
+        node.notes << QStringLiteral("Used key parts: %1").arg(usedParts);
+    }
+    const QString dataRead = costInfo.value(QStringLiteral("data_read_per_join")).toString();
+    if(!dataRead.isEmpty()){
+        node.notes << QStringLiteral("Data read per join: %1").arg(dataRead);
+    }
+    if(table.value(QStringLiteral("using_index")).toBool()){
+        node.notes << QStringLiteral("Covering index");
+    }
+
+    if(node.accessType == QLatin1String("ALL")){
+        node.warnings << QStringLiteral("Full table scan");
+    }else if(node.accessType == QLatin1String("index")){
+        node.warnings << QStringLiteral("Full index scan");
+    }
+    if(table.value(QStringLiteral("using_filesort")).toBool()){
+        node.warnings << QStringLiteral("Filesort");
+    }
+    if(table.value(QStringLiteral("using_temporary_table")).toBool()){
+        node.warnings << QStringLiteral("Temporary table");
+    }
+    const QString joinBuffer = table.value(QStringLiteral("using_join_buffer")).toString();
+    if(!joinBuffer.isEmpty()){
+        node.warnings << QStringLiteral("Join buffer (%1)").arg(joinBuffer);
+    }
+    appendJsonChildren(table, node);
+    return node;
+}
+
+void appendJsonChildren(const QJsonObject &obj, ExplainPlanNode &parent)
+{
+    if(obj.contains(QStringLiteral("table"))){
+        parent.children << jsonTableNode(obj.value(QStringLiteral("table")).toObject());
+    }
+    if(obj.contains(QStringLiteral("nested_loop"))){
+        const QJsonArray loop = obj.value(QStringLiteral("nested_loop")).toArray();
+        ExplainPlanNode join;
+        join.operation = QStringLiteral("Nested loop join");
+        for(const QJsonValue &item : loop){
+            appendJsonChildren(item.toObject(), join);
+        }
+        if(!join.children.isEmpty()){
+            join.cost = join.children.last().cost;
+        }
+        parent.children << join;
+    }
+
+    static const QList<QPair<QString, QString>> operations = {
+        {QStringLiteral("ordering_operation"), QStringLiteral("Order by")},
+        {QStringLiteral("grouping_operation"), QStringLiteral("Group")},
+        {QStringLiteral("duplicates_removal"), QStringLiteral("Remove duplicates")},
+        {QStringLiteral("windowing"), QStringLiteral("Window")},
+        {QStringLiteral("buffer_result"), QStringLiteral("Buffer result")}
+    };
+    for(const auto &op : operations){
+        if(!obj.contains(op.first)){
+            continue;
+        }
+        const QJsonObject opObj = obj.value(op.first).toObject();
+        ExplainPlanNode node;
+        node.operation = op.second;
+        const QJsonObject costInfo = opObj.value(QStringLiteral("cost_info")).toObject();
+        node.selfCost = jsonNumber(costInfo.value(QStringLiteral("sort_cost")));
+        if(opObj.value(QStringLiteral("using_filesort")).toBool()){
+            node.warnings << QStringLiteral("Filesort");
+        }
+        if(opObj.value(QStringLiteral("using_temporary_table")).toBool()){
+            node.warnings << QStringLiteral("Temporary table");
+        }
+        appendJsonChildren(opObj, node);
+        parent.children << node;
+    }
+
+    if(obj.contains(QStringLiteral("union_result"))){
+        const QJsonObject unionObj = obj.value(QStringLiteral("union_result")).toObject();
+        ExplainPlanNode node;
+        node.operation = QStringLiteral("Union");
+        if(unionObj.value(QStringLiteral("using_temporary_table")).toBool()){
+            node.warnings << QStringLiteral("Temporary table");
+        }
+        const QJsonArray specs = unionObj.value(QStringLiteral("query_specifications")).toArray();
+        for(const QJsonValue &spec : specs){
+            node.children << jsonQueryBlock(spec.toObject().value(QStringLiteral("query_block")).toObject());
+        }
+        parent.children << node;
+    }
+
+    if(obj.contains(QStringLiteral("materialized_from_subquery"))){
+        const QJsonObject sub = obj.value(QStringLiteral("materialized_from_subquery")).toObject();
+        ExplainPlanNode node;
+        node.operation = QStringLiteral("Materialize");
+        if(sub.value(QStringLiteral("using_temporary_table")).toBool()){
+            node.warnings << QStringLiteral("Temporary table");
+        }
+        if(sub.value(QStringLiteral("dependent")).toBool()){
+            node.warnings << QStringLiteral("Dependent subquery");
+        }
+        node.children << jsonQueryBlock(sub.value(QStringLiteral("query_block")).toObject());
+        parent.children << node;
+    }
+
+    static const QStringList subqueryKeys = {
+        QStringLiteral("attached_subqueries"),
+        QStringLiteral("optimized_away_subqueries"),
+        QStringLiteral("select_list_subqueries"),
+        QStringLiteral("order_by_subqueries"),
+        QStringLiteral("group_by_subqueries"),
+        QStringLiteral("having_subqueries"),
+        QStringLiteral("update_value_subqueries")
+    };
+    for(const QString &key : subqueryKeys){
+        const QJsonArray subs = obj.value(key).toArray();
+        for(const QJsonValue &value : subs){
+            const QJsonObject sub = value.toObject();
+            const bool dependent = sub.value(QStringLiteral("dependent")).toBool();
+            ExplainPlanNode node = jsonQueryBlock(sub.value(QStringLiteral("query_block")).toObject(),
+                                                  dependent ? QStringLiteral("Dependent subquery")
+                                                            : QStringLiteral("Subquery"));
+            if(dependent){
+                node.warnings << QStringLiteral("Re-executed per outer row");
+            }
+            parent.children << node;
+        }
+    }
+
+    if(obj.contains(QStringLiteral("query_block"))){
+        parent.children << jsonQueryBlock(obj.value(QStringLiteral("query_block")).toObject());
+    }
+}
+
+QList<ExplainPlanNode> buildAnalyzeTree(const QVector<QPair<int, ExplainPlanNode>> &flat, int &index, int depth)
+{
+    QList<ExplainPlanNode> nodes;
+    while(index < flat.size() && flat.at(index).first >= depth){
+        if(flat.at(index).first > depth){
+            // An indent that skips a level nests under the previous node
+            if(nodes.isEmpty()){
+                nodes << ExplainPlanNode();
+            }
+            nodes.last().children += buildAnalyzeTree(flat, index, flat.at(index).first);
+            continue;
+        }
+        ExplainPlanNode node = flat.at(index).second;
+        ++index;
+        if(index < flat.size() && flat.at(index).first > depth){
+            node.children = buildAnalyzeTree(flat, index, flat.at(index).first);
+        }
+        nodes << node;
+    }
+    return nodes;
+}
+
+void computeSelfTime(ExplainPlanNode &node)
+{
+    double childTotal = 0;
+    for(ExplainPlanNode &child : node.children){
+        computeSelfTime(child);
+        if(child.actualTimeMs >= 0){
+            childTotal += child.actualTimeMs * qMax<qint64>(1, child.loops);
+        }
+    }
+    if(node.actualTimeMs >= 0){
+        const double total = node.actualTimeMs * qMax<qint64>(1, node.loops);
+        node.selfTimeMs = qMax(0.0, total - childTotal);
+    }
+}
+
+double maxSelfMetric(const ExplainPlanNode &node, bool analyzed)
+{
+    double value = analyzed ? node.selfTimeMs : node.selfCost;
+    for(const ExplainPlanNode &child : node.children){
+        value = qMax(value, maxSelfMetric(child, analyzed));
+    }
+    return value;
+}
+
+QString nodeDetails(const ExplainPlanNode &node)
+{
+    QStringList lines;
+    lines << node.operation;
+    if(!node.tableName.isEmpty()){
+        lines << QStringLiteral("Table: %1").arg(node.tableName);
+    }
+    if(!node.accessType.isEmpty()){
+        lines << QStringLiteral("Access type: %1").arg(node.accessType);
+    }
+    if(!node.possibleKeys.isEmpty()){
+        lines << QStringLiteral("Possible keys: %1").arg(node.possibleKeys);
+    }
+    if(!node.key.isEmpty()){
+        lines << QStringLiteral("Key: %1").arg(node.key);
+    }
+    if(node.filtered >= 0){
+        lines << QStringLiteral("Filtered: %1%").arg(formatNumber(node.filtered));
+    }
+    if(node.selfCost >= 0){
+        lines << QStringLiteral("Own cost: %1").arg(formatNumber(node.selfCost));
+    }
+    if(node.selfTimeMs >= 0){
+        lines << QStringLiteral("Own time: %1 ms").arg(formatNumber(node.selfTimeMs));
+    }
+    lines += node.notes;
+    if(!node.condition.isEmpty()){
+        lines << QString() << QStringLiteral("Condition:") << node.condition;
+    }
+    if(!node.warnings.isEmpty()){
+        lines << QString() << QStringLiteral("Warnings: %1").arg(node.warnings.join(QStringLiteral(", ")));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+}
+
+ExplainPlanView::ExplainPlanView(QWidget *parent) : QWidget(parent)
+{
+    auto *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(4);
+
+    summaryLabel = new QLabel(this);
+    summaryLabel->setContentsMargins(6, 4, 6, 0);
+    summaryLabel->setWordWrap(true);
+    layout->addWidget(summaryLabel);
+
+    auto *splitter = new QSplitter(Qt::Vertical, this);
+    tree = new QTreeWidget(splitter);
+    tree->setColumnCount(ColumnCount);
+    tree->setHeaderLabels({tr("Operation"), tr("Table"), tr("Access"), tr("Key"),
+                           tr("Est. Rows"), tr("Actual Rows"), tr("Cost"), tr("Time (ms)"),
+                           tr("Loops"), tr("Warnings")});
+    tree->setUniformRowHeights(true);
+    tree->setAlternatingRowColors(true);
+    tree->header()->setStretchLastSection(true);
+    detailEdit = new QPlainTextEdit(splitter);
+    detailEdit->setReadOnly(true);
+    detailEdit->setLineWrapMode(QPlainTextEdit::WidgetWidth);
+    splitter->addWidget(tree);
+    splitter->addWidget(detailEdit);
+    splitter->setStretchFactor(0, 3);
+    splitter->setStretchFactor(1, 1);
+    layout->addWidget(splitter, 1);
+
+    connect(tree, &QTreeWidget::currentItemChanged, this, [this](QTreeWidgetItem *current) {
+        showDetails(current);
+    });
+}
+
+void ExplainPlanView::clear()
+{
+    tree->clear();
+    detailEdit->clear();
+    summaryLabel->clear();
+    rawPlan.clear();
+}
+
+bool ExplainPlanView::showJsonPlan(const QString &json, QString *errorMessage)
+{
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(json.toUtf8(), &parseError);
+    if(parseError.error != QJsonParseError::NoError || !doc.isObject()){
+        if(errorMessage){
+            *errorMessage = parseError.errorString();
+        }
+        return false;
+    }
+    showPlan(parseJsonPlan(doc.object()), false, json);
+    return true;
+}
+
+void ExplainPlanView::showAnalyzePlan(const QString &text)
+{
+    showPlan(parseAnalyzePlan(text), true, text);
+}
+
+ExplainPlanNode ExplainPlanView::parseJsonPlan(const QJsonObject &root)
+{
+    if(root.contains(QStringLiteral("query_block"))){
+        return jsonQueryBlock(root.value(QStringLiteral("query_block")).toObject());
+    }
+    ExplainPlanNode node;
+    node.operation = QStringLiteral("Plan");
+    appendJsonChildren(root, node);
+    return node;
+}
+
+ExplainPlanNode ExplainPlanView::parseAnalyzePlan(const QString &text)
+{
+    static const QRegularExpression costRe(
+        QStringLiteral("\\(cost=(?:[\\d.e+]+\\.\\.)?([\\d.e+]+) rows=([\\d.e+]+)\\)"));
+    static const QRegularExpression actualRe(
+        QStringLiteral("\\(actual time=([\\d.]+)\\.\\.([\\d.]+) rows=([\\d.e+]+) loops=(\\d+)\\)"));
+    static const QRegularExpression neverRe(QStringLiteral("\\(never executed\\)"));
+    static const QRegularExpression tableRe(QStringLiteral("\\bon (`?[\\w$.]+`?)"));
+    static const QRegularExpression keyRe(QStringLiteral("\\busing (`?[\\w$]+`?)"));
+
+    QVector<QPair<int, ExplainPlanNode>> flat;
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    for(const QString &line : lines){
+        const int arrow = line.indexOf(QStringLiteral("-> "));
+        if(arrow < 0){
+            // Continuation lines belong to the previous node's condition
+            if(!flat.isEmpty() && !line.trimmed().isEmpty()){
+                flat.last().second.condition += QLatin1Char(' ') + line.trimmed();
+            }
+            continue;
+        }
+        ExplainPlanNode node;
+        QString body = line.mid(arrow + 3);
+        const auto cost = costRe.match(body);
+        if(cost.hasMatch()){
+            node.cost = cost.captured(1).toDouble();
+            node.estimatedRows = cost.captured(2).toDouble();
+        }
+        const auto actual = actualRe.match(body);
+        if(actual.hasMatch()){
+            node.actualTimeMs = actual.captured(2).toDouble();
+            node.actualRows = actual.captured(3).toDouble();
+            node.loops = actual.captured(4).toLongLong();
+        }else if(neverRe.match(body).hasMatch()){
+            node.actualRows = 0;
+            node.loops = 0;
+            node.notes << QStringLiteral("Never executed");
+        }
+        body.remove(costRe);
+        body.remove(actualRe);
+        body.remove(neverRe);
+        body = body.trimmed();
+
+        // Nodes like "Filter: (cond)" take the part after the colon as their condition
+        const int colon = body.indexOf(QStringLiteral(": "));
+        if(colon > 0 && !body.startsWith(QLatin1String("Table scan"))
+                && !body.contains(QLatin1String(" on "))){
+            node.operation = body.left(colon);
+            node.condition = body.mid(colon + 2);
+        }else{
+            node.operation = body;
+        }
+        const auto table = tableRe.match(body);
+        if(table.hasMatch()){
+            node.tableName = table.captured(1);
+        }
+        const auto key = keyRe.match(body);
+        if(key.hasMatch() && !body.contains(QLatin1String("using temporary"))){
+            node.key = key.captured(1);
+        }
+
+        if(body.startsWith(QLatin1String("Table scan"))){
+            node.accessType = QStringLiteral("ALL");
+            node.warnings << QStringLiteral("Full table scan");
+        }else if(body.startsWith(QLatin1String("Index scan"))){
+            node.accessType = QStringLiteral("index");
+            node.warnings << QStringLiteral("Full index scan");
+        }else if(body.startsWith(QLatin1String("Index range scan"))){
+            node.accessType = QStringLiteral("range");
+        }else if(body.contains(QLatin1String("Single-row index lookup"), Qt::CaseInsensitive)){
+            node.accessType = QStringLiteral("eq_ref");
+        }else if(body.contains(QLatin1String("index lookup"), Qt::CaseInsensitive)){
+            node.accessType = QStringLiteral("ref");
+        }else if(body.startsWith(QLatin1String("Sort"))){
+            node.warnings << QStringLiteral("Filesort");
+        }
+        if(body.contains(QLatin1String("temporary"), Qt::CaseInsensitive)){
+            node.warnings << QStringLiteral("Temporary table");
+        }
+        if(node.estimatedRows > 0 && node.actualRows >= 0 && node.loops > 0){
+            const double ratio = node.actualRows > node.estimatedRows
+                    ? node.actualRows / node.estimatedRows
+                    : node.estimatedRows / qMax(1.0, node.actualRows);
+            if(ratio >= kMisestimateRatio){
+                node.warnings << QStringLiteral("Row estimate off by %1x").arg(qRound(ratio));
+            }
+        }
+
+        int indent = 0;
+        while(indent < arrow && line.at(indent) == QLatin1Char(' ')){
+            ++indent;
+        }
+        flat.append(qMakePair(indent / 4, node));
+    }
+
+    ExplainPlanNode root;
+    int index = 0;
+    const QList<ExplainPlanNode> top = flat.isEmpty() ? QList<ExplainPlanNode>()
+                                                      : buildAnalyzeTree(flat, index, flat.first().first);
+    if(top.size() == 1){
+        root = top.first();
+    }else{
+        root.operation = QStringLiteral("Plan");
+        root.children = top;
+    }
+    computeSelfTime(root);
+    return root;
+}
+
+void ExplainPlanView::showPlan(const ExplainPlanNode &root, bool analyzed, const QString &raw)
+{
+    tree->clear();
+    rawPlan = raw;
+    const double maxSelf = maxSelfMetric(root, analyzed);
+    addItems(root, nullptr, maxSelf, analyzed);
+    tree->expandAll();
+    for(int col = 0; col < ColumnCount - 1; ++col){
+        tree->resizeColumnToContents(col);
+    }
+
+    QString summary;
+    if(analyzed){
+        summary = tr("EXPLAIN ANALYZE  Total time: %1 ms").arg(formatNumber(root.actualTimeMs));
+    }else{
+        summary = tr("EXPLAIN  Query cost: %1").arg(formatNumber(root.cost));
+    }
+    QTreeWidgetItem *hot = nullptr;
+    for(QTreeWidgetItemIterator it(tree); *it; ++it){
+        if((*it)->data(OperationColumn, HotspotRole).toBool()){
+            hot = *it;
+            break;
+        }
+    }
+    if(hot){
+        summary += tr("  Hotspot: %1").arg(hot->text(OperationColumn)
+                                           + (hot->text(TableColumn).isEmpty()
+                                              ? QString()
+                                              : QStringLiteral(" (%1)").arg(hot->text(TableColumn))));
+        tree->setCurrentItem(hot);
+        tree->scrollToItem(hot);
+    }else{
+        detailEdit->setPlainText(rawPlan);
+    }
+    summaryLabel->setText(summary);
+}
+
+void ExplainPlanView::addItems(const ExplainPlanNode &node, QTreeWidgetItem *parent, double maxSelf, bool analyzed)
+{
+    auto *item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(tree);
+    item->setText(OperationColumn, node.operation);
+    item->setText(TableColumn, node.tableName);
+    item->setText(AccessColumn, node.accessType);
+    item->setText(KeyColumn, node.key);
+    item->setText(EstRowsColumn, formatNumber(node.estimatedRows));
+    item->setText(ActualRowsColumn, formatNumber(node.actualRows));
+    item->setText(CostColumn, formatNumber(node.cost));
+    item->setText(TimeColumn, formatNumber(node.actualTimeMs));
+    item->setText(LoopsColumn, node.loops >= 0 ? QString::number(node.loops) : QString());
+    item->setText(WarningColumn, node.warnings.join(QStringLiteral(", ")));
+    item->setData(OperationColumn, DetailRole, nodeDetails(node));
+    for(int col = EstRowsColumn; col <= LoopsColumn; ++col){
+        item->setTextAlignment(col, Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if(!node.warnings.isEmpty()){
+        item->setForeground(WarningColumn, QColor(200, 40, 40));
+        if(node.warnings.contains(QStringLiteral("Full table scan"))){
+            item->setForeground(AccessColumn, QColor(200, 40, 40));
+        }
+    }
+    if(node.actualRows >= 0 && node.estimatedRows >= 0
+            && node.warnings.filter(QStringLiteral("estimate")).size() > 0){
+        item->setForeground(ActualRowsColumn, QColor(200, 120, 0));
+    }
+
+    // Shade by self cost relative to the largest; the largest is bold
+    const double self = analyzed ? node.selfTimeMs : node.selfCost;
+    if(maxSelf > 0 && self > 0){
+        const double ratio = self / maxSelf;
+        QColor background;
+        if(ratio >= 0.999){
+            background = QColor(255, 205, 205);
+            QFont font = item->font(OperationColumn);
+            font.setBold(true);
+            item->setFont(OperationColumn, font);
+            item->setData(OperationColumn, HotspotRole, true);
+        }else if(ratio >= 0.3){
+            background = QColor(255, 232, 205);
+        }else if(ratio >= 0.1){
+            background = QColor(255, 246, 225);
+        }
+        if(background.isValid()){
+            for(int col = 0; col < ColumnCount; ++col){
+                item->setBackground(col, background);
+            }
+        }
+    }
+    for(const ExplainPlanNode &child : node.children){
+        addItems(child, item, maxSelf, analyzed);
+    }
+}
+
+void ExplainPlanView::showDetails(QTreeWidgetItem *item)
+{
+    if(!item){
+        detailEdit->setPlainText(rawPlan);
+        return;
+    }
+    detailEdit->setPlainText(item->data(OperationColumn, DetailRole).toString());
+}
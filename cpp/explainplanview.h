@@ -0,0 +1,60 @@
+#ifndef EXPLAINPLANVIEW_H
+#define EXPLAINPLANVIEW_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QStringList>
+#include <QWidget>
+
+class QLabel;
+class QPlainTextEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+struct ExplainPlanNode {
+    QString operation;
+    QString tableName;
+    QString accessType;
+    QString key;
+    QString possibleKeys;
+    QString condition;
+    QStringList notes;
+    QStringList warnings;
+    double estimatedRows = -1;
+    double actualRows = -1;
+    double filtered = -1;
+    double cost = -1;
+    double selfCost = -1;     // cost of this node alone, to find hot spots
+    double actualTimeMs = -1;
+    double selfTimeMs = -1;
+    qint64 loops = -1;
+    QList<ExplainPlanNode> children;
+};
+
+// Tree view for EXPLAIN FORMAT=JSON and EXPLAIN ANALYZE output. The node
+// with the highest own cost (or own time for ANALYZE) is highlighted.
+class ExplainPlanView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ExplainPlanView(QWidget *parent = nullptr);
+
+    bool showJsonPlan(const QString &json, QString *errorMessage = nullptr);
+    void showAnalyzePlan(const QString &text);
+    void clear();
+
+    static ExplainPlanNode parseJsonPlan(const QJsonObject &root);
+    static ExplainPlanNode parseAnalyzePlan(const QString &text);
+
+private:
+    void showPlan(const ExplainPlanNode &root, bool analyzed, const QString &raw);
+    void addItems(const ExplainPlanNode &node, QTreeWidgetItem *parent, double maxSelf, bool analyzed);
+    void showDetails(QTreeWidgetItem *item);
+
+    QLabel *summaryLabel = nullptr;
+    QTreeWidget *tree = nullptr;
+    QPlainTextEdit *detailEdit = nullptr;
+    QString rawPlan;
+};
+
+#endif // EXPLAINPLANVIEW_H
@@ -0,0 +1,299 @@
+#include "fanoutrunner.h"
+#include "jobscheduler.h"
+#include "languagemanager.h"
+#include "sessionpool.h"
+
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QIcon>
+#include <QLabel>
+#include <QListWidget>
+#include <QMessageBox>
+#include <QPointer>
+#include <QPushButton>
+#include <QSet>
+#include <QSettings>
+#include <QSpinBox>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVBoxLayout>
+#include <functional>
+
+namespace {
+
+constexpr auto kSettingsFanOutConnections = "fanOut/connections";
+constexpr auto kSettingsFanOutConcurrency = "fanOut/concurrency";
+
+void runShard(const ConnectionInfo &info,
+              const QString &dbName,
+              const QString &sql,
+              int rowLimit,
+              const std::function<bool()> &cancelled,
+              FanOutShardResult &result)
+{
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase db = SessionPool::instance()->acquire(info, dbName, &error);
+    if(!db.isValid()){
+        result.error = error.isEmpty() ? QStringLiteral("Unable to connect") : error;
+        result.elapsedMs = timer.elapsed();
+        return;
+    }
+    {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if(!query.exec(sql)){
+            result.error = query.lastError().text();
+        }else if(query.isSelect()){
+            result.isSelect = true;
+            const auto record = query.record();
+            for(int col = 0; col < record.count(); ++col){
+                result.headers << record.fieldName(col);
+            }
+            while(query.next()){
+                if(rowLimit > 0 && result.rows.size() >= rowLimit){
+                    result.truncated = true;
+                    break;
+                }
+                if(cancelled()){
+                    result.truncated = true;
+                    break;
+                }
+                QVariantList row;
+                row.reserve(record.count());
+                for(int col = 0; col < record.count(); ++col){
+                    row << query.value(col);
+                }
+                result.rows << row;
+            }
+        }else{
+            result.affectedRows = query.numRowsAffected();
+        }
+        // Stored procedures and the like may have more result sets; drain them before the
+        // session goes back to the pool
+        while(query.nextResult()){
+        }
+    }
+    result.elapsedMs = timer.elapsed();
+    if(!result.error.isEmpty() && !db.isOpen()){
+        SessionPool::instance()->discard(db);
+    }else{
+        SessionPool::instance()->release(db);
+    }
+}
+
+}
+
+FanOutRunner::FanOutRunner(QObject *parent)
+    : QObject(parent),
+      m_cancelled(std::make_shared<std::atomic_bool>(false))
+{
+}
+
+FanOutRunner::~FanOutRunner()
+{
+    // Results are delivered through a QPointer; shard results arriving after destruction
+    // are dropped
+    cancel();
+}
+
+void FanOutRunner::start(const QList<ConnectionInfo> &targets,
+                         const QString &dbName,
+                         const QString &sql,
+                         int concurrency,
+                         int rowLimit)
+{
+    if(isRunning() || targets.isEmpty()){
+        return;
+    }
+    m_cancelled = std::make_shared<std::atomic_bool>(false);
+    m_waiting = targets;
+    m_jobIds.clear();
+    m_dbName = dbName;
+    m_sql = sql;
+    m_rowLimit = rowLimit;
+    m_concurrency = qBound(1, concurrency, 64);
+    m_inFlight = 0;
+    m_pending = targets.size();
+    m_succeeded = 0;
+    m_failed = 0;
+    m_timer.start();
+
+    while(!m_waiting.isEmpty() && m_inFlight < m_concurrency){
+        submitNext();
+    }
+}
+
+void FanOutRunner::cancel()
+{
+    // Queued shards end as cancelled without running, so every shard still reports back
+    m_cancelled->store(true);
+    for(quint64 id : qAsConst(m_jobIds)){
+        JobScheduler::instance()->cancel(id);
+    }
+}
+
+void FanOutRunner::submitNext()
+{
+    const ConnectionInfo info = m_waiting.takeFirst();
+    const QString dbName = m_dbName;
+    const QString sql = m_sql;
+    const int rowLimit = m_rowLimit;
+    const auto cancelled = m_cancelled;
+    const auto shardCancelled = std::make_shared<std::atomic_bool>(false);
+    const QPointer<FanOutRunner> guard(this);
+    // The scheduler lives on the GUI thread and carries the result back; guard is null
+    // once the runner is gone
+    const auto deliver = [guard](const FanOutShardResult &result) {
+        QMetaObject::invokeMethod(JobScheduler::instance(), [guard, result]() {
+            if(guard){
+                guard->handleShard(result);
+            }
+        }, Qt::QueuedConnection);
+    };
+    auto work = [deliver, info, dbName, sql, rowLimit, cancelled, shardCancelled](quint64 jobId) {
+        FanOutShardResult result;
+        result.connName = info.name;
+        const auto isCancelled = [cancelled, shardCancelled]() {
+            return cancelled->load() || shardCancelled->load();
+        };
+        if(isCancelled()){
+            result.error = tr("Cancelled");
+        }else{
+            runShard(info, dbName, sql, rowLimit, isCancelled, result);
+        }
+        if(!result.error.isEmpty()){
+            JobScheduler::instance()->finish(jobId, false, result.error);
+        }
+        deliver(result);
+    };
+    // A shard cancelled before it started still reports back
+    auto skipped = [deliver, info](quint64) {
+        FanOutShardResult result;
+        result.connName = info.name;
+        result.error = tr("Cancelled");
+        deliver(result);
+    };
+    ++m_inFlight;
+    const quint64 id = JobScheduler::instance()->submit(QStringLiteral("fan-out"),
+                                                        sql.simplified().left(200),
+                                                        {info.name},
+                                                        JobScheduler::Normal,
+                                                        work,
+                                                        [shardCancelled]() { shardCancelled->store(true); },
+                                                        skipped);
+    m_jobIds << id;
+}
+
+void FanOutRunner::handleShard(const FanOutShardResult &result)
+{
+    if(m_pending <= 0){
+        return;
+    }
+    if(result.error.isEmpty()){
+        ++m_succeeded;
+    }else{
+        ++m_failed;
+    }
+    --m_inFlight;
+    while(!m_waiting.isEmpty() && m_inFlight < m_concurrency){
+        submitNext();
+    }
+    emit shardFinished(result);
+    if(--m_pending == 0){
+        emit finished(m_succeeded, m_failed, m_timer.elapsed());
+    }
+}
+
+FanOutConnectionsDialog::FanOutConnectionsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(trLang(QStringLiteral("在多个连接上执行"), QStringLiteral("Run on Connections")));
+    resize(420, 480);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(new QLabel(trLang(QStringLiteral("选择要执行的连接："),
+                                        QStringLiteral("Select the connections to run on:")), this));
+
+    QSettings settings;
+    const QStringList lastNames = settings.value(QLatin1String(kSettingsFanOutConnections)).toStringList();
+    const QSet<QString> lastSelected(lastNames.cbegin(), lastNames.cend());
+    connList = new QListWidget(this);
+    const auto connections = ConnectionManager::instance()->connections();
+    for(const auto &info : connections){
+        auto *item = new QListWidgetItem(QIcon(QStringLiteral(":/images/connection.svg")), info.name, connList);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(lastSelected.contains(info.name) ? Qt::Checked : Qt::Unchecked);
+        item->setToolTip(QStringLiteral("%1@%2:%3").arg(info.user, info.host).arg(info.port));
+    }
+    layout->addWidget(connList, 1);
+
+    auto *selectLayout = new QHBoxLayout;
+    auto *allButton = new QPushButton(trLang(QStringLiteral("全选"), QStringLiteral("Select All")), this);
+    auto *noneButton = new QPushButton(trLang(QStringLiteral("全不选"), QStringLiteral("Select None")), this);
+    selectLayout->addWidget(allButton);
+    selectLayout->addWidget(noneButton);
+    selectLayout->addStretch();
+    layout->addLayout(selectLayout);
+    auto setAll = [this](Qt::CheckState state) {
+        for(int i = 0; i < connList->count(); ++i){
+            connList->item(i)->setCheckState(state);
+        }
+    };
+    connect(allButton, &QPushButton::clicked, this, [setAll]() { setAll(Qt::Checked); });
+    connect(noneButton, &QPushButton::clicked, this, [setAll]() { setAll(Qt::Unchecked); });
+
+    auto *form = new QFormLayout;
+    concurrencySpin = new QSpinBox(this);
+    concurrencySpin->setRange(1, 32);
+    concurrencySpin->setValue(settings.value(QLatin1String(kSettingsFanOutConcurrency), 8).toInt());
+    concurrencySpin->setToolTip(trLang(QStringLiteral("同时执行的连接数上限"),
+                                       QStringLiteral("Maximum number of connections queried at the same time")));
+    form->addRow(trLang(QStringLiteral("并发数："), QStringLiteral("Concurrency:")), concurrencySpin);
+    layout->addLayout(form);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
+
+QList<ConnectionInfo> FanOutConnectionsDialog::selectedConnections() const
+{
+    QList<ConnectionInfo> result;
+    for(int i = 0; i < connList->count(); ++i){
+        const QListWidgetItem *item = connList->item(i);
+        if(item->checkState() == Qt::Checked){
+            result << ConnectionManager::instance()->connection(item->text());
+        }
+    }
+    return result;
+}
+
+int FanOutConnectionsDialog::concurrency() const
+{
+    return concurrencySpin->value();
+}
+
+void FanOutConnectionsDialog::accept()
+{
+    QStringList names;
+    for(int i = 0; i < connList->count(); ++i){
+        if(connList->item(i)->checkState() == Qt::Checked){
+            names << connList->item(i)->text();
+        }
+    }
+    if(names.isEmpty()){
+        QMessageBox::warning(this, windowTitle(),
+                             trLang(QStringLiteral("请至少选择一个连接。"),
+                                    QStringLiteral("Select at least one connection.")));
+        return;
+    }
+    QSettings settings;
+    settings.setValue(QLatin1String(kSettingsFanOutConnections), names);
+    settings.setValue(QLatin1String(kSettingsFanOutConcurrency), concurrencySpin->value());
+    QDialog::accept();
+}
@@ -0,0 +1,86 @@
+#ifndef FANOUTRUNNER_H
+#define FANOUTRUNNER_H
+
+#include "connectionmanager.h"
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+#include <atomic>
+#include <memory>
+
+class QListWidget;
+class QSpinBox;
+
+struct FanOutShardResult {
+    QString connName;
+    QStringList headers;
+    QList<QVariantList> rows;
+    bool isSelect = false;
+    bool truncated = false;
+    qint64 affectedRows = -1;
+    qint64 elapsedMs = 0;
+    QString error;
+};
+
+// Runs one statement on several connections at once. Shards are submitted
+// to JobScheduler at most `concurrency` at a time and use sessions from
+// SessionPool; results are handed back on the owner's thread as each shard
+// completes.
+class FanOutRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FanOutRunner(QObject *parent = nullptr);
+    ~FanOutRunner() override;
+
+    void start(const QList<ConnectionInfo> &targets,
+               const QString &dbName,
+               const QString &sql,
+               int concurrency,
+               int rowLimit);
+    void cancel();
+    bool isRunning() const { return m_pending > 0; }
+
+signals:
+    void shardFinished(const FanOutShardResult &result);
+    void finished(int succeeded, int failed, qint64 elapsedMs);
+
+private:
+    void submitNext();
+    void handleShard(const FanOutShardResult &result);
+
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    QList<ConnectionInfo> m_waiting;
+    QList<quint64> m_jobIds;
+    QString m_dbName;
+    QString m_sql;
+    int m_rowLimit = 0;
+    int m_concurrency = 1;
+    int m_inFlight = 0;
+    int m_pending = 0;
+    int m_succeeded = 0;
+    int m_failed = 0;
+    QElapsedTimer m_timer;
+};
+
+class FanOutConnectionsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit FanOutConnectionsDialog(QWidget *parent = nullptr);
+
+    QList<ConnectionInfo> selectedConnections() const;
+    int concurrency() const;
+
+    void accept() override;
+
+private:
+    QListWidget *connList = nullptr;
+    QSpinBox *concurrencySpin = nullptr;
+};
+
+#endif // FANOUTRUNNER_H
@@ -1,10 +1,12 @@
 #include "importdialog.h"
+#include "jobscheduler.h"
 
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDateTime>
 #include <QDialogButtonBox>
 #include <QDir>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFormLayout>
@@ -40,10 +42,12 @@ bool configureDatabase(QSqlDatabase &db,
                        const QString &database,
                        QString *errorMessage)
 {
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        return false;
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     if(!database.isEmpty()){
         db.setDatabaseName(database);
     }
@@ -533,8 +537,35 @@ void ImportDialog::startImport()
         return;
     }
     setRunning(true);
-    if(runImport(options)){
+    JobScheduler *scheduler = JobScheduler::instance();
+    const quint64 jobId = scheduler->enqueue(QStringLiteral("import"),
+                                             QStringLiteral("%1 -> %2.%3").arg(info.fileName(), m_databaseName, m_tableName),
+                                             {m_connection.name}, JobScheduler::Normal);
+    if(scheduler->state(jobId) == JobScheduler::Queued){
+        // Waits in the queue while the connection is at its limit, with the UI still
+        // responsive; closing the dialog or cancelling in the jobs panel abandons the
+        // import
+        appendLog(tr("Waiting for a free session on %1...").arg(m_connection.name));
+        QEventLoop loop;
+        connect(scheduler, &JobScheduler::jobsChanged, &loop, [&loop, scheduler, jobId]() {
+            if(scheduler->state(jobId) != JobScheduler::Queued){
+                loop.quit();
+            }
+        });
+        connect(this, &QDialog::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+        if(!isVisible()){
+            scheduler->cancel(jobId);
+        }
+    }
+    if(!scheduler->waitForStart(jobId)){
+        appendLog(tr("Import cancelled."));
+        scheduler->finish(jobId, false);
+    }else if(runImport(options)){
         appendLog(tr("Import finished."));
+        scheduler->finish(jobId, true);
+    }else{
+        scheduler->finish(jobId, false, tr("Import failed."));
     }
     setRunning(false);
 }
@@ -611,9 +642,63 @@ bool ImportDialog::runImport(const ImportOptions &options)
 
     int lineNumber = 0;
     int importedRows = 0;
-    int batchCount = 0;
     const int startRow = qMax(1, options.startRow);
 
+    // Rows are buffered per column and written with one execBatch per batch, which the
+    // driver turns into a multi-row INSERT
+    QVector<QVariantList> pendingColumns(sourceIndexes.size());
+    QVector<int> pendingLines;
+    const int batchSize = qMax(1, options.batchSize);
+    for(QVariantList &column : pendingColumns){
+        column.reserve(batchSize);
+    }
+    pendingLines.reserve(batchSize);
+    auto clearPending = [&pendingColumns, &pendingLines]() {
+        for(QVariantList &column : pendingColumns){
+            column.clear();
+        }
+        pendingLines.clear();
+    };
+    // When a batch fails, roll back to the savepoint and replay it row by row; the bad
+    // rows are reported and the rest written
+    auto flushPending = [&]() -> bool {
+        if(pendingLines.isEmpty()){
+            return true;
+        }
+        QSqlQuery savepoint(db);
+        const bool hasSavepoint = savepoint.exec(QStringLiteral("SAVEPOINT import_batch"));
+        for(int col = 0; col < pendingColumns.size(); ++col){
+            query.bindValue(col, pendingColumns.at(col));
+        }
+        if(query.execBatch()){
+            importedRows += pendingLines.size();
+            clearPending();
+            return true;
+        }
+        if(!hasSavepoint || !savepoint.exec(QStringLiteral("ROLLBACK TO SAVEPOINT import_batch"))){
+            appendLog(tr("Batch ending at line %1 failed: %2")
+                      .arg(pendingLines.last()).arg(query.lastError().text()));
+            clearPending();
+            return false;
+        }
+        for(int row = 0; row < pendingLines.size(); ++row){
+            for(int col = 0; col < pendingColumns.size(); ++col){
+                query.bindValue(col, pendingColumns.at(col).at(row));
+            }
+            if(!query.exec()){
+                appendLog(tr("Line %1 failed: %2").arg(pendingLines.at(row)).arg(query.lastError().text()));
+                if(!options.ignoreErrors){
+                    clearPending();
+                    return false;
+                }
+                continue;
+            }
+            ++importedRows;
+        }
+        clearPending();
+        return true;
+    };
+
     if(!db.transaction()){
         appendLog(tr("Unable to start transaction: %1").arg(db.lastError().text()));
         file.close();
@@ -634,26 +719,17 @@ bool ImportDialog::runImport(const ImportOptions &options)
         for(int col = 0; col < sourceIndexes.size(); ++col){
             const int srcIdx = sourceIndexes.at(col);
             const QString value = (srcIdx >= 0 && srcIdx < cells.size()) ? cells.at(srcIdx) : QString();
-            if(value.isEmpty()){
-                query.bindValue(col, QVariant());
-            }else{
-                query.bindValue(col, value);
-            }
+            pendingColumns[col] << (value.isEmpty() ? QVariant() : QVariant(value));
         }
-        if(!query.exec()){
-            appendLog(tr("Line %1 failed: %2").arg(lineNumber).arg(query.lastError().text()));
-            if(!options.ignoreErrors){
+        pendingLines << lineNumber;
+        if(pendingLines.size() >= batchSize){
+            if(!flushPending()){
                 db.rollback();
                 file.close();
                 db.close();
                 QSqlDatabase::removeDatabase(handle);
                 return false;
             }
-            continue;
-        }
-        ++importedRows;
-        ++batchCount;
-        if(batchCount >= options.batchSize){
             if(!db.commit()){
                 appendLog(tr("Failed to commit batch: %1").arg(db.lastError().text()));
                 file.close();
@@ -668,9 +744,15 @@ bool ImportDialog::runImport(const ImportOptions &options)
                 QSqlDatabase::removeDatabase(handle);
                 return false;
             }
-            batchCount = 0;
         }
     }
+    if(!flushPending()){
+        db.rollback();
+        file.close();
+        db.close();
+        QSqlDatabase::removeDatabase(handle);
+        return false;
+    }
     if(!db.commit()){
         appendLog(tr("Failed to commit transaction: %1").arg(db.lastError().text()));
         file.close();
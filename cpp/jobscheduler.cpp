@@ -0,0 +1,525 @@
+#include "jobscheduler.h"
+#include "languagemanager.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSet>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+constexpr auto kSettingsMaxPerConnection = "scheduler/maxPerConnection";
+// Finished jobs kept for the jobs panel
+constexpr int kRecentJobs = 50;
+// How often a yielding background job checks again
+constexpr int kYieldPollMs = 250;
+
+qint64 nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+bool sharesConnection(const QStringList &a, const QStringList &b)
+{
+    for(const QString &name : a){
+        if(b.contains(name)){
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+JobScheduler *JobScheduler::instance()
+{
+    static JobScheduler *ins = new JobScheduler;
+    return ins;
+}
+
+JobScheduler::JobScheduler(QObject *parent) : QObject(parent)
+{
+    QSettings settings;
+    m_maxPerConnection = qBound(1, settings.value(QLatin1String(kSettingsMaxPerConnection), 4).toInt(), 64);
+    // Jobs mostly wait on network I/O; the thread count is only a ceiling and per-
+    // connection slots govern real concurrency
+    m_pool.setMaxThreadCount(32);
+    m_pool.setExpiryTimeout(30 * 1000);
+}
+
+quint64 JobScheduler::addJob(const QString &kind,
+                             const QString &title,
+                             const QStringList &connections,
+                             Priority priority,
+                             State state)
+{
+    Job job;
+    job.info.id = m_nextId++;
+    job.info.kind = kind;
+    job.info.title = title;
+    job.info.connections = connections;
+    job.info.connections.removeAll(QString());
+    job.info.connections.removeDuplicates();
+    job.info.priority = priority;
+    job.info.state = state;
+    job.info.queuedAt = nowMs();
+    if(state == Running){
+        job.info.startedAt = job.info.queuedAt;
+        job.holdsSlots = true;
+        for(const QString &name : qAsConst(job.info.connections)){
+            ++m_running[name];
+        }
+    }else{
+        // The queue is ordered by priority, first in first out within one
+        int pos = m_queue.size();
+        while(pos > 0 && m_jobs.constFind(m_queue.at(pos - 1))->info.priority > priority){
+            --pos;
+        }
+        m_queue.insert(pos, job.info.id);
+    }
+    const quint64 id = job.info.id;
+    m_jobs.insert(id, job);
+    return id;
+}
+
+quint64 JobScheduler::enqueue(const QString &kind,
+                              const QString &title,
+                              const QStringList &connections,
+                              Priority priority,
+                              std::function<void()> cancelHandler)
+{
+    quint64 id = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        id = addJob(kind, title, connections, priority, Queued);
+        Job &job = m_jobs[id];
+        job.cancelHandler = std::move(cancelHandler);
+        job.info.cancellable = true;
+        dispatchLocked();
+    }
+    notifyChanged();
+    return id;
+}
+
+bool JobScheduler::waitForStart(quint64 id)
+{
+    if(id == 0){
+        return true;
+    }
+    QMutexLocker locker(&m_mutex);
+    while(true){
+        auto it = m_jobs.find(id);
+        if(it == m_jobs.end() || it->info.cancelRequested){
+            return false;
+        }
+        if(it->info.state != Queued){
+            return true;
+        }
+        m_changed.wait(&m_mutex);
+    }
+}
+
+quint64 JobScheduler::begin(const QString &kind,
+                            const QString &title,
+                            const QStringList &connections,
+                            Priority priority)
+{
+    quint64 id = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        // A job nested inside one this thread already runs on the same
+        // connection shares that session; waiting for a slot would deadlock
+        const bool nested = ownsConnection(connections);
+        id = addJob(kind, title, connections, priority, nested ? Running : Queued);
+        m_jobs[id].owner = QThread::currentThreadId();
+        dispatchLocked();
+    }
+    notifyChanged();
+
+    bool waited = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        while(true){
+            auto it = m_jobs.find(id);
+            if(it == m_jobs.end() || it->info.state != Queued){
+                break;
+            }
+            waited = true;
+            m_changed.wait(&m_mutex);
+        }
+    }
+    if(waited){
+        notifyChanged();
+    }
+    return id;
+}
+
+bool JobScheduler::checkpoint(quint64 id)
+{
+    bool paused = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_jobs.find(id);
+        if(it == m_jobs.end()){
+            return true;
+        }
+        if(it->info.cancelRequested){
+            return false;
+        }
+        if(it->info.priority == Interactive || !interactiveWaiting(*it)){
+            return true;
+        }
+        // Running SQL cannot be suspended; background jobs give up their session only at
+        // checkpoints
+        it->info.state = Paused;
+        paused = true;
+        // The paused job's slot can now be lent to the interactive job
+        dispatchLocked();
+    }
+    notifyChanged();
+
+    bool cancelled = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        while(true){
+            auto it = m_jobs.find(id);
+            if(it == m_jobs.end()){
+                break;
+            }
+            if(it->info.cancelRequested){
+                cancelled = true;
+            }
+            if(cancelled || !interactiveWaiting(*it)){
+                it->info.state = Running;
+                break;
+            }
+            m_changed.wait(&m_mutex, kYieldPollMs);
+        }
+    }
+    if(paused){
+        notifyChanged();
+    }
+    return !cancelled;
+}
+
+void JobScheduler::finish(quint64 id, bool ok, const QString &error)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_jobs.find(id);
+        if(it == m_jobs.end()){
+            return;
+        }
+        if(it->holdsSlots){
+            for(const QString &name : qAsConst(it->info.connections)){
+                if(--m_running[name] <= 0){
+                    m_running.remove(name);
+                }
+            }
+            it->holdsSlots = false;
+        }
+        if(it->info.cancelRequested){
+            it->info.state = Cancelled;
+        }else{
+            it->info.state = ok ? Finished : Failed;
+        }
+        it->info.error = error;
+        it->info.finishedAt = nowMs();
+        retireLocked(id);
+        dispatchLocked();
+        m_changed.wakeAll();
+    }
+    notifyChanged();
+}
+
+quint64 JobScheduler::submit(const QString &kind,
+                             const QString &title,
+                             const QStringList &connections,
+                             Priority priority,
+                             std::function<void(quint64)> work,
+                             std::function<void()> cancelHandler,
+                             std::function<void(quint64)> skipped)
+{
+    quint64 id = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        id = addJob(kind, title, connections, priority, Queued);
+        Job &job = m_jobs[id];
+        job.work = std::move(work);
+        job.cancelHandler = std::move(cancelHandler);
+        job.skipped = std::move(skipped);
+        job.info.cancellable = true;
+        dispatchLocked();
+    }
+    notifyChanged();
+    return id;
+}
+
+void JobScheduler::cancel(quint64 id)
+{
+    std::function<void()> handler;
+    std::function<void(quint64)> skipped;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_jobs.find(id);
+        if(it == m_jobs.end() || it->info.cancelRequested){
+            return;
+        }
+        it->info.cancelRequested = true;
+        handler = it->cancelHandler;
+        if(it->info.state == Queued){
+            it->info.state = Cancelled;
+            if(it->work){
+                // Never started: the submitter hears about it through skipped instead of work
+                skipped = it->skipped;
+                it->info.finishedAt = nowMs();
+                retireLocked(id);
+            }else{
+                m_queue.removeAll(id);
+            }
+        }
+        dispatchLocked();
+        m_changed.wakeAll();
+    }
+    if(handler){
+        handler();
+    }
+    if(skipped){
+        skipped(id);
+    }
+    notifyChanged();
+}
+
+bool JobScheduler::isCancelled(quint64 id) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_jobs.constFind(id);
+    return it != m_jobs.constEnd() && it->info.cancelRequested;
+}
+
+JobScheduler::State JobScheduler::state(quint64 id) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_jobs.constFind(id);
+    return it != m_jobs.constEnd() ? it->info.state : Finished;
+}
+
+QList<JobScheduler::JobInfo> JobScheduler::jobs() const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<JobInfo> active;
+    active.reserve(m_jobs.size());
+    for(const Job &job : m_jobs){
+        active << job.info;
+    }
+    std::sort(active.begin(), active.end(), [](const JobInfo &a, const JobInfo &b) {
+        return a.id < b.id;
+    });
+    return active + m_recent;
+}
+
+int JobScheduler::runningCount(const QString &connName) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_running.value(connName);
+}
+
+int JobScheduler::maxPerConnection() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxPerConnection;
+}
+
+void JobScheduler::setMaxPerConnection(int count)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxPerConnection = qBound(1, count, 64);
+        QSettings settings;
+        settings.setValue(QLatin1String(kSettingsMaxPerConnection), m_maxPerConnection);
+        dispatchLocked();
+    }
+    notifyChanged();
+}
+
+QString JobScheduler::priorityName(Priority priority)
+{
+    switch(priority){
+    case Interactive:
+        return trLang(QStringLiteral("交互"), QStringLiteral("Interactive"));
+    case Normal:
+        return trLang(QStringLiteral("普通"), QStringLiteral("Normal"));
+    case Background:
+        return trLang(QStringLiteral("后台"), QStringLiteral("Background"));
+    }
+    return QString();
+}
+
+QString JobScheduler::stateName(State state)
+{
+    switch(state){
+    case Queued:
+        return trLang(QStringLiteral("排队中"), QStringLiteral("Queued"));
+    case Running:
+        return trLang(QStringLiteral("运行中"), QStringLiteral("Running"));
+    case Paused:
+        return trLang(QStringLiteral("已让出"), QStringLiteral("Yielding"));
+    case Finished:
+        return trLang(QStringLiteral("已完成"), QStringLiteral("Finished"));
+    case Failed:
+        return trLang(QStringLiteral("失败"), QStringLiteral("Failed"));
+    case Cancelled:
+        return trLang(QStringLiteral("已取消"), QStringLiteral("Cancelled"));
+    }
+    return QString();
+}
+
+bool JobScheduler::canStart(const Job &job, bool borrowPaused) const
+{
+    int limit = m_maxPerConnection;
+    // Background jobs leave one session for interactive work
+    if(job.info.priority == Background && limit > 1){
+        --limit;
+    }
+    for(const QString &name : job.info.connections){
+        int used = m_running.value(name);
+        if(borrowPaused){
+            for(const Job &other : m_jobs){
+                if(other.info.state == Paused && other.info.connections.contains(name)){
+                    --used;
+                }
+            }
+        }
+        if(used >= limit){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JobScheduler::interactiveWaiting(const Job &job) const
+{
+    for(const Job &other : m_jobs){
+        if(other.info.id == job.info.id || other.info.priority != Interactive){
+            continue;
+        }
+        // Background jobs stay out of the way of any interactive work; normal
+        // jobs only of work that is queued or runs on a slot lent by a paused job
+        const bool blocks = other.info.state == Queued
+                || (other.info.state == Running && (job.info.priority == Background || other.borrowed));
+        if(blocks && sharesConnection(other.info.connections, job.info.connections)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobScheduler::ownsConnection(const QStringList &connections) const
+{
+    const Qt::HANDLE thread = QThread::currentThreadId();
+    for(const Job &job : m_jobs){
+        if(job.owner == thread && job.holdsSlots && sharesConnection(job.info.connections, connections)){
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::dispatchLocked()
+{
+    // A job ahead in the queue that cannot get its slots holds back lower priority jobs
+    // on the same connection so it is not starved
+    QSet<QString> blocked;
+    for(int i = 0; i < m_queue.size();){
+        const quint64 id = m_queue.at(i);
+        Job &job = m_jobs[id];
+        bool waiting = false;
+        for(const QString &name : qAsConst(job.info.connections)){
+            if(blocked.contains(name)){
+                waiting = true;
+                break;
+            }
+        }
+        // Interactive jobs may take the slot of a job paused at a checkpoint
+        const bool borrow = job.info.priority == Interactive && !canStart(job, false);
+        if(waiting || !canStart(job, borrow)){
+            for(const QString &name : qAsConst(job.info.connections)){
+                blocked.insert(name);
+            }
+            ++i;
+            continue;
+        }
+        m_queue.removeAt(i);
+        job.info.state = Running;
+        job.info.startedAt = nowMs();
+        job.holdsSlots = true;
+        job.borrowed = borrow;
+        for(const QString &name : qAsConst(job.info.connections)){
+            ++m_running[name];
+        }
+        if(job.work){
+            startWork(id, job.work);
+        }
+    }
+    m_changed.wakeAll();
+}
+
+void JobScheduler::startWork(quint64 id, std::function<void(quint64)> work)
+{
+    m_pool.start(QRunnable::create([this, id, work]() {
+        work(id);
+        // Finish as successful when work reported nothing itself
+        finish(id, true);
+    }));
+}
+
+void JobScheduler::retireLocked(quint64 id)
+{
+    m_queue.removeAll(id);
+    const Job job = m_jobs.take(id);
+    m_recent.prepend(job.info);
+    while(m_recent.size() > kRecentJobs){
+        m_recent.removeLast();
+    }
+}
+
+void JobScheduler::notifyChanged()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if(m_notifyPending){
+            return;
+        }
+        m_notifyPending = true;
+    }
+    // Coalesce changes into one notification, always emitted on the scheduler's thread
+    QMetaObject::invokeMethod(this, [this]() {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_notifyPending = false;
+        }
+        emit jobsChanged();
+    }, Qt::QueuedConnection);
+}
+
+ScopedJob::ScopedJob(const QString &kind,
+                     const QString &title,
+                     const QStringList &connections,
+                     JobScheduler::Priority priority)
+    : m_id(JobScheduler::instance()->begin(kind, title, connections, priority))
+{
+}
+
+ScopedJob::~ScopedJob()
+{
+    JobScheduler::instance()->finish(m_id, m_ok, m_error);
+}
+
+void ScopedJob::fail(const QString &error)
+{
+    m_ok = false;
+    m_error = error;
+}
@@ -0,0 +1,163 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <functional>
+
+// Central queue for database work. Every job names the connections it
+// touches and a priority; a job only starts when each of its connections
+// has a free slot, interactive jobs are admitted ahead of queued background
+// ones, and running background jobs yield at checkpoint() while interactive
+// work is waiting on or using the same connection. Normal jobs yield at
+// checkpoint() too while an interactive job is waiting for their slot. All
+// methods are thread-safe.
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Interactive = 0,
+        Normal = 1,
+        Background = 2
+    };
+
+    enum State {
+        Queued,
+        Running,
+        Paused,
+        Finished,
+        Failed,
+        Cancelled
+    };
+
+    struct JobInfo {
+        quint64 id = 0;
+        QString kind;
+        QString title;
+        QStringList connections;
+        Priority priority = Normal;
+        State state = Queued;
+        qint64 queuedAt = 0;
+        qint64 startedAt = 0;
+        qint64 finishedAt = 0;
+        bool cancelRequested = false;
+        bool cancellable = false;
+        QString error;
+    };
+
+    static JobScheduler *instance();
+
+    // For jobs run on the caller's own thread: enqueue(), then waitForStart() on the
+    // worker and finish() at the end
+    quint64 enqueue(const QString &kind,
+                    const QString &title,
+                    const QStringList &connections,
+                    Priority priority,
+                    std::function<void()> cancelHandler = {});
+    bool waitForStart(quint64 id);
+    // Queues the job and blocks the calling thread until it holds a slot on
+    // every connection. Interactive jobs jump the queue and may take the slot
+    // of a job paused at checkpoint(); a job nested in one the same thread
+    // already runs on the connection starts at once. Meant for short
+    // synchronous operations; long ones such as imports go through enqueue()
+    quint64 begin(const QString &kind,
+                  const QString &title,
+                  const QStringList &connections,
+                  Priority priority = Interactive);
+    bool checkpoint(quint64 id);
+    void finish(quint64 id, bool ok = true, const QString &error = QString());
+
+    // Runs work on the scheduler's thread pool. A job cancelled while still
+    // queued never runs work; skipped is called instead, on the thread that
+    // cancelled it, so the submitter can still deliver a cancelled result
+    quint64 submit(const QString &kind,
+                   const QString &title,
+                   const QStringList &connections,
+                   Priority priority,
+                   std::function<void(quint64 id)> work,
+                   std::function<void()> cancelHandler = {},
+                   std::function<void(quint64 id)> skipped = {});
+
+    void cancel(quint64 id);
+    bool isCancelled(quint64 id) const;
+    // Finished for jobs that ended or never existed
+    State state(quint64 id) const;
+
+    QList<JobInfo> jobs() const;
+    int runningCount(const QString &connName) const;
+    int maxPerConnection() const;
+    void setMaxPerConnection(int count);
+
+    static QString priorityName(Priority priority);
+    static QString stateName(State state);
+
+signals:
+    void jobsChanged();
+
+private:
+    explicit JobScheduler(QObject *parent = nullptr);
+
+    struct Job {
+        JobInfo info;
+        std::function<void(quint64)> work;
+        std::function<void()> cancelHandler;
+        std::function<void(quint64)> skipped;
+        Qt::HANDLE owner = nullptr;     // thread that called begin()
+        bool holdsSlots = false;
+        bool borrowed = false;          // started on a slot lent by a paused job
+    };
+
+    quint64 addJob(const QString &kind,
+                   const QString &title,
+                   const QStringList &connections,
+                   Priority priority,
+                   State state);
+    bool canStart(const Job &job, bool borrowPaused) const;
+    bool interactiveWaiting(const Job &job) const;
+    bool ownsConnection(const QStringList &connections) const;
+    void dispatchLocked();
+    void startWork(quint64 id, std::function<void(quint64)> work);
+    void retireLocked(quint64 id);
+    void notifyChanged();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_changed;
+    QHash<quint64, Job> m_jobs;
+    QList<quint64> m_queue;
+    QHash<QString, int> m_running;
+    QList<JobInfo> m_recent;
+    QThreadPool m_pool;
+    quint64 m_nextId = 1;
+    int m_maxPerConnection = 4;
+    bool m_notifyPending = false;
+};
+
+// Runs a short synchronous database operation in the current scope as an
+// interactive job (see JobScheduler::begin)
+class ScopedJob
+{
+public:
+    ScopedJob(const QString &kind,
+              const QString &title,
+              const QStringList &connections,
+              JobScheduler::Priority priority = JobScheduler::Interactive);
+    ~ScopedJob();
+
+    quint64 id() const { return m_id; }
+    void fail(const QString &error);
+
+private:
+    Q_DISABLE_COPY(ScopedJob)
+
+    quint64 m_id = 0;
+    bool m_ok = true;
+    QString m_error;
+};
+
+#endif // JOBSCHEDULER_H
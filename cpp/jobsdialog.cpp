@@ -0,0 +1,212 @@
+#include "jobsdialog.h"
+#include "jobscheduler.h"
+#include "languagemanager.h"
+
+#include <QColor>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QIcon>
+#include <QLabel>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+namespace {
+
+const int JobIdRole = Qt::UserRole + 1;
+const int CancellableRole = Qt::UserRole + 2;
+
+QString formatElapsed(qint64 ms)
+{
+    if(ms < 0){
+        return QString();
+    }
+    if(ms < 60 * 1000){
+        return QStringLiteral("%1 s").arg(ms / 1000.0, 0, 'f', 1);
+    }
+    const qint64 seconds = ms / 1000;
+    return QStringLiteral("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QLatin1Char('0'));
+}
+
+}
+
+JobsDialog::JobsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(trLang(QStringLiteral("任务"), QStringLiteral("Jobs")));
+    setWindowIcon(QIcon(QStringLiteral(":/images/run.svg")));
+    resize(900, 420);
+
+    auto *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(12, 12, 12, 12);
+    mainLayout->setSpacing(8);
+
+    const QStringList headers = {
+        trLang(QStringLiteral("状态"), QStringLiteral("State")),
+        trLang(QStringLiteral("类型"), QStringLiteral("Kind")),
+        trLang(QStringLiteral("连接"), QStringLiteral("Connection")),
+        trLang(QStringLiteral("优先级"), QStringLiteral("Priority")),
+        trLang(QStringLiteral("等待"), QStringLiteral("Waited")),
+        trLang(QStringLiteral("耗时"), QStringLiteral("Elapsed")),
+        trLang(QStringLiteral("内容"), QStringLiteral("Job"))
+    };
+    table = new QTableWidget(this);
+    table->setColumnCount(headers.size());
+    table->setHorizontalHeaderLabels(headers);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->setWordWrap(false);
+    table->verticalHeader()->setVisible(false);
+    table->verticalHeader()->setDefaultSectionSize(24);
+    table->horizontalHeader()->setStretchLastSection(true);
+    mainLayout->addWidget(table, 1);
+
+    auto *buttonLayout = new QHBoxLayout;
+    statusLabel = new QLabel(this);
+    buttonLayout->addWidget(statusLabel, 1);
+    buttonLayout->addWidget(new QLabel(trLang(QStringLiteral("每个连接最多会话数："),
+                                              QStringLiteral("Max sessions per connection:")), this));
+    limitSpin = new QSpinBox(this);
+    limitSpin->setRange(1, 64);
+    limitSpin->setValue(JobScheduler::instance()->maxPerConnection());
+    limitSpin->setToolTip(trLang(QStringLiteral("后台任务最多占用其中 N-1 个，留一个给交互查询"),
+                                 QStringLiteral("Background jobs use at most N-1 of them, leaving one for interactive queries")));
+    buttonLayout->addWidget(limitSpin);
+    cancelButton = new QPushButton(QIcon(QStringLiteral(":/images/stop.svg")),
+                                   trLang(QStringLiteral("取消任务"), QStringLiteral("Cancel Job")), this);
+    auto *closeButton = new QPushButton(trLang(QStringLiteral("关闭"), QStringLiteral("Close")), this);
+    buttonLayout->addWidget(cancelButton);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    // Refresh durations only while the window is visible
+    elapsedTimer = new QTimer(this);
+    elapsedTimer->setInterval(500);
+    connect(elapsedTimer, &QTimer::timeout, this, &JobsDialog::refresh);
+
+    connect(JobScheduler::instance(), &JobScheduler::jobsChanged, this, [this]() {
+        if(isVisible()){
+            refresh();
+        }
+    });
+    connect(limitSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int value) {
+        JobScheduler::instance()->setMaxPerConnection(value);
+    });
+    connect(table, &QTableWidget::itemSelectionChanged, this, &JobsDialog::updateButtons);
+    connect(cancelButton, &QPushButton::clicked, this, &JobsDialog::cancelSelected);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+
+    refresh();
+}
+
+void JobsDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    refresh();
+    elapsedTimer->start();
+}
+
+void JobsDialog::hideEvent(QHideEvent *event)
+{
+    elapsedTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void JobsDialog::refresh()
+{
+    const quint64 selectedId = selectedJobId();
+    const auto jobs = JobScheduler::instance()->jobs();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QSignalBlocker blocker(table);
+    table->setRowCount(jobs.size());
+    int running = 0;
+    int queued = 0;
+    int selectRow = -1;
+    for(int row = 0; row < jobs.size(); ++row){
+        const auto &job = jobs.at(row);
+        const bool active = job.state == JobScheduler::Queued
+                || job.state == JobScheduler::Running
+                || job.state == JobScheduler::Paused;
+        if(job.state == JobScheduler::Queued){
+            ++queued;
+        }else if(active){
+            ++running;
+        }
+
+        const qint64 waitedMs = (job.startedAt > 0 ? job.startedAt : (active ? now : job.finishedAt)) - job.queuedAt;
+        qint64 elapsedMs = -1;
+        if(job.startedAt > 0){
+            elapsedMs = (active ? now : job.finishedAt) - job.startedAt;
+        }
+        QString stateText = JobScheduler::stateName(job.state);
+        if(active && job.cancelRequested){
+            stateText = trLang(QStringLiteral("正在取消"), QStringLiteral("Cancelling"));
+        }
+        const QStringList values = {
+            stateText,
+            job.kind,
+            job.connections.join(QStringLiteral(", ")),
+            JobScheduler::priorityName(job.priority),
+            formatElapsed(waitedMs),
+            formatElapsed(elapsedMs),
+            job.error.isEmpty() ? job.title : QStringLiteral("%1 — %2").arg(job.title, job.error)
+        };
+        for(int col = 0; col < values.size(); ++col){
+            QTableWidgetItem *item = table->item(row, col);
+            if(!item){
+                item = new QTableWidgetItem;
+                table->setItem(row, col, item);
+            }
+            item->setText(values.at(col));
+            item->setToolTip(col == values.size() - 1 ? values.at(col) : QString());
+            item->setForeground(active ? QColor() : QColor(Qt::gray));
+            if(col == 0 && job.state == JobScheduler::Failed){
+                item->setForeground(QColor(200, 40, 40));
+            }
+        }
+        table->item(row, 0)->setData(JobIdRole, job.id);
+        table->item(row, 0)->setData(CancellableRole, active && job.cancellable && !job.cancelRequested);
+        if(job.id == selectedId){
+            selectRow = row;
+        }
+    }
+    if(selectRow >= 0){
+        table->selectRow(selectRow);
+    }else{
+        table->clearSelection();
+    }
+    statusLabel->setText(trLang(QStringLiteral("运行中 %1，排队 %2"), QStringLiteral("%1 running, %2 queued"))
+                         .arg(running).arg(queued));
+    updateButtons();
+}
+
+void JobsDialog::cancelSelected()
+{
+    const quint64 id = selectedJobId();
+    if(id != 0){
+        JobScheduler::instance()->cancel(id);
+    }
+}
+
+void JobsDialog::updateButtons()
+{
+    const auto items = table->selectedItems();
+    const QTableWidgetItem *item = items.isEmpty() ? nullptr : table->item(items.first()->row(), 0);
+    cancelButton->setEnabled(item && item->data(CancellableRole).toBool());
+}
+
+quint64 JobsDialog::selectedJobId() const
+{
+    const auto items = table->selectedItems();
+    if(items.isEmpty()){
+        return 0;
+    }
+    const QTableWidgetItem *item = table->item(items.first()->row(), 0);
+    return item ? item->data(JobIdRole).toULongLong() : 0;
+}
@@ -0,0 +1,38 @@
+#ifndef JOBSDIALOG_H
+#define JOBSDIALOG_H
+
+#include <QDialog>
+
+class QLabel;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+class QTimer;
+
+// Lists running, queued and recently finished jobs from JobScheduler.
+class JobsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit JobsDialog(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+    void cancelSelected();
+    void updateButtons();
+
+private:
+    quint64 selectedJobId() const;
+
+    QTableWidget *table = nullptr;
+    QLabel *statusLabel = nullptr;
+    QSpinBox *limitSpin = nullptr;
+    QPushButton *cancelButton = nullptr;
+    QTimer *elapsedTimer = nullptr;
+};
+
+#endif // JOBSDIALOG_H
@@ -3,6 +3,7 @@
 #include "connectionmanager.h"
 #include "datasyncdialog.h"
 #include "importdialog.h"
+#include "runsqldialog.h"
 
 #include <QHBoxLayout>
 #include <QIcon>
@@ -50,6 +51,7 @@ LeftWidgetForm::LeftWidgetForm(QWidget *parent) : QWidget(parent)
     connect(treeWidget, &MyTreeWidget::connectionTestRequested, this, &LeftWidgetForm::testConnection);
     connect(treeWidget, &MyTreeWidget::dataSyncRequested, this, &LeftWidgetForm::openDataSync);
     connect(treeWidget, &MyTreeWidget::dataImportRequested, this, &LeftWidgetForm::openImportDialog);
+    connect(treeWidget, &MyTreeWidget::runSqlFileRequested, this, &LeftWidgetForm::openRunSqlFile);
     connect(newButton, &QPushButton::clicked, this, &LeftWidgetForm::onNewConnectionClicked);
     connect(refreshButton, &QPushButton::clicked, this, &LeftWidgetForm::onRefreshClicked);
     connect(LanguageManager::instance(), &LanguageManager::languageChanged, this, [this]() {
@@ -212,3 +214,9 @@ void LeftWidgetForm::openImportDialog(const QString &connName,
     ImportDialog dlg(info, dbName, tableName, this);
     dlg.exec();
 }
+
+void LeftWidgetForm::openRunSqlFile(const QString &connName, const QString &dbName)
+{
+    RunSqlDialog dlg(connName, dbName, this);
+    dlg.exec();
+}
@@ -39,6 +39,7 @@ private slots:
     void openImportDialog(const QString &connName,
                           const QString &dbName,
                           const QString &tableName);
+    void openRunSqlFile(const QString &connName, const QString &dbName);
 
 private:
     bool filterItem(QTreeWidgetItem *item, const QString &text);
@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "sshtunnel.h"
 
 #include <QApplication>
 #include <QCommandLineOption>
@@ -9,6 +10,10 @@ Q_IMPORT_PLUGIN(QMYSQLDriverPlugin)
 
 int main(int argc, char *argv[])
 {
+    // When ssh starts this program as its askpass helper, only print the password
+    if(SshTunnelManager::runAskPass()){
+        return 0;
+    }
 
     Q_INIT_RESOURCE(resources);
 
@@ -2,8 +2,14 @@
 #include "contentwidget.h"
 #include "conndialog.h"
 #include "datasyncdialog.h"
+#include "jobsdialog.h"
 #include "myedit.h"
 #include "queryform.h"
+#include "queryhistory.h"
+#include "queryhistorydialog.h"
+#include "runsqldialog.h"
+#include "sessionpool.h"
+#include "sshtunnel.h"
 
 #include <QActionGroup>
 #include <QApplication>
@@ -66,6 +72,18 @@ MainWindow::MainWindow()
         }
     });
 
+    SshTunnelManager::instance()->setHostKeyPrompt([this](const QString &bastion, const QString &fingerprints) {
+        const QString text = trLang(QStringLiteral("跳板机 %1 的主机密钥未知，请核对指纹后再继续：\n\n%2\n\n信任该主机密钥并写入 known_hosts？"),
+                                    QStringLiteral("The host key of bastion %1 is unknown. Verify its fingerprint before continuing:\n\n%2\n\nTrust this host key and add it to known_hosts?"))
+                .arg(bastion, fingerprints);
+        return QMessageBox::question(this, trLang(QStringLiteral("SSH 主机密钥"), QStringLiteral("SSH Host Key")), text,
+                                     QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::Yes;
+    });
+
+    // Open sessions for frequently used connections in the background so the first query
+    // skips the handshake
+    SessionPool::instance()->prewarmFavorites();
+
     emit inited();
 }
 
@@ -163,12 +181,41 @@ void MainWindow::closeEvent(QCloseEvent *event)
 {
     if(maybeSave()){
         writeSettings();
+        QueryHistory::instance()->shutdown();
+        SshTunnelManager::instance()->shutdown();
         event->accept();
     }else{
         event->ignore();
     }
 }
 
+void MainWindow::showQueryHistory()
+{
+    if(!historyDialog){
+        historyDialog = new QueryHistoryDialog(this);
+        connect(historyDialog, &QueryHistoryDialog::openSqlRequested, this,
+                [this](const QString &sql, const QString &connName, const QString &dbName) {
+            QueryForm *form = content->addQueryTab(connName, dbName);
+            if(form){
+                form->editor()->setPlainText(sql);
+            }
+        });
+    }
+    historyDialog->show();
+    historyDialog->raise();
+    historyDialog->activateWindow();
+}
+
+void MainWindow::showJobs()
+{
+    if(!jobsDialog){
+        jobsDialog = new JobsDialog(this);
+    }
+    jobsDialog->show();
+    jobsDialog->raise();
+    jobsDialog->activateWindow();
+}
+
 void MainWindow::newFile()
 {
     content->addQueryTab();
@@ -309,6 +356,16 @@ void MainWindow::createActions()
     connect(fontAct, &QAction::triggered, this, &MainWindow::adjustInterfaceFont);
     viewMenu->addAction(fontAct);
 
+    historyAct = new QAction(QIcon(QStringLiteral(":/images/history.svg")), QString(), this);
+    historyAct->setShortcut(QKeySequence(QStringLiteral("Ctrl+H")));
+    connect(historyAct, &QAction::triggered, this, &MainWindow::showQueryHistory);
+    viewMenu->addAction(historyAct);
+    fileToolBar->addAction(historyAct);
+
+    jobsAct = new QAction(QIcon(QStringLiteral(":/images/run.svg")), QString(), this);
+    connect(jobsAct, &QAction::triggered, this, &MainWindow::showJobs);
+    viewMenu->addAction(jobsAct);
+
     setupLanguageMenu();
 
     dataSyncAct = new QAction(this);
@@ -318,6 +375,13 @@ void MainWindow::createActions()
     });
     toolsMenu->addAction(dataSyncAct);
 
+    runSqlFileAct = new QAction(QIcon(QStringLiteral(":/images/import.svg")), QString(), this);
+    connect(runSqlFileAct, &QAction::triggered, this, [this]() {
+        RunSqlDialog dlg(QString(), QString(), this);
+        dlg.exec();
+    });
+    toolsMenu->addAction(runSqlFileAct);
+
     aboutAct = new QAction(this);
     connect(aboutAct, &QAction::triggered, this, &MainWindow::about);
     helpMenu->addAction(aboutAct);
@@ -415,6 +479,16 @@ void MainWindow::updateActionTexts()
     if(dataSyncAct){
         dataSyncAct->setText(trLang(QStringLiteral("数据同步..."), QStringLiteral("Data Synchronization...")));
     }
+    if(historyAct){
+        historyAct->setText(trLang(QStringLiteral("查询历史..."), QStringLiteral("Query History...")));
+        historyAct->setToolTip(trLang(QStringLiteral("查询历史 (Ctrl+H)"), QStringLiteral("Query History (Ctrl+H)")));
+    }
+    if(jobsAct){
+        jobsAct->setText(trLang(QStringLiteral("任务..."), QStringLiteral("Jobs...")));
+    }
+    if(runSqlFileAct){
+        runSqlFileAct->setText(trLang(QStringLiteral("运行 SQL 文件..."), QStringLiteral("Run SQL File...")));
+    }
     if(syncToolAct){
         syncToolAct->setText(trLang(QStringLiteral("数据同步"), QStringLiteral("Data Sync")));
         syncToolAct->setToolTip(trLang(QStringLiteral("数据同步工具"), QStringLiteral("Data Synchronization Tool")));
@@ -11,6 +11,9 @@
 #include <QSessionManager>
 #include <QToolBar>
 
+class JobsDialog;
+class QueryHistoryDialog;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -59,6 +62,8 @@ private slots:
     bool saveAs();
     void about();
     void adjustInterfaceFont();
+    void showQueryHistory();
+    void showJobs();
 #ifndef QT_NO_SESSIONMANAGER
     void commitData(QSessionManager &);
 #endif
@@ -88,6 +93,8 @@ private:
     QMenu *toolsMenu = nullptr;
     QMenu *languageMenu = nullptr;
     QMenu *helpMenu = nullptr;
+    QueryHistoryDialog *historyDialog = nullptr;
+    JobsDialog *jobsDialog = nullptr;
 
     QAction *newAct = nullptr;
     QAction *openAct = nullptr;
@@ -96,6 +103,9 @@ private:
     QAction *newConnAct = nullptr;
     QAction *fontAct = nullptr;
     QAction *dataSyncAct = nullptr;
+    QAction *runSqlFileAct = nullptr;
+    QAction *historyAct = nullptr;
+    QAction *jobsAct = nullptr;
     QAction *syncToolAct = nullptr;
     QAction *aboutAct = nullptr;
     QAction *languageChineseAct = nullptr;
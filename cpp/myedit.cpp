@@ -6,8 +6,10 @@
 #include <QKeyEvent>
 #include <QScrollBar>
 #include <QStandardItemModel>
+#include <QTextBlock>
 #include <QTextCodec>
 #include <QTextStream>
+#include <algorithm>
 
 MyEdit::MyEdit(QWidget *parent) : QPlainTextEdit(parent)
 {
@@ -27,6 +29,8 @@ MyEdit::MyEdit(QWidget *parent) : QPlainTextEdit(parent)
     m_completer->popup()->setMinimumWidth(400);
     connect(m_completer, QOverload<const QModelIndex &>::of(&QCompleter::activated),
             this, &MyEdit::insertCompletion);
+    connect(document(), &QTextDocument::contentsChange, this, &MyEdit::updateStatementIndex);
+    connect(this, &QPlainTextEdit::cursorPositionChanged, this, &MyEdit::highlightCurrentStatement);
 }
 
 bool MyEdit::loadFromFile(const QString &filePath, const QByteArray &codecName)
@@ -109,6 +113,176 @@ void MyEdit::setCompletionItems(const QList<CompletionItem> &items)
     rebuildCompletionModel();
 }
 
+int MyEdit::statementCount() const
+{
+    return m_statements.size();
+}
+
+SqlStatement MyEdit::statementAt(int position) const
+{
+    SqlStatement statement;
+    const int index = statementIndexAt(position);
+    if(index < 0){
+        return statement;
+    }
+    const StatementSpan &span = m_statements.at(index);
+    QTextCursor cursor(document());
+    cursor.setPosition(span.start);
+    cursor.setPosition(span.end - span.delimiter.size(), QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    text.replace(QChar::LineSeparator, QLatin1Char('\n'));
+    statement.text = text.trimmed();
+    statement.delimiter = span.delimiter;
+    statement.start = span.start;
+    statement.end = span.end;
+    statement.line = document()->findBlock(span.start).blockNumber() + 1;
+    return statement;
+}
+
+SqlStatement MyEdit::currentStatement() const
+{
+    return statementAt(textCursor().position());
+}
+
+bool MyEdit::statementHighlightEnabled() const
+{
+    return m_highlightStatement;
+}
+
+void MyEdit::setStatementHighlightEnabled(bool enabled)
+{
+    if(m_highlightStatement == enabled){
+        return;
+    }
+    m_highlightStatement = enabled;
+    highlightCurrentStatement();
+}
+
+int MyEdit::statementIndexAt(int position) const
+{
+    if(m_statements.isEmpty()){
+        return -1;
+    }
+    const auto it = std::upper_bound(m_statements.cbegin(), m_statements.cend(), position,
+                                     [](int pos, const StatementSpan &span) { return pos < span.end; });
+    const int index = int(it - m_statements.cbegin());
+    if(index < m_statements.size() && m_statements.at(index).start <= position){
+        return index;
+    }
+    // Cursor between two statements: it belongs to the previous one when on the line that
+    // statement ends on
+    if(index > 0){
+        const StatementSpan &prev = m_statements.at(index - 1);
+        if(index == m_statements.size()
+                || document()->findBlock(prev.end - 1).blockNumber() == document()->findBlock(position).blockNumber()){
+            return index - 1;
+        }
+    }
+    return index < m_statements.size() ? index : -1;
+}
+
+void MyEdit::updateStatementIndex(int position, int charsRemoved, int charsAdded)
+{
+    const int delta = charsAdded - charsRemoved;
+    const int editEnd = position + charsAdded;
+    const int oldEditEnd = position + charsRemoved;
+
+    // Re-split from the end of the statement before the edited one, where the delimiter
+    // state is known
+    const auto it = std::lower_bound(m_statements.cbegin(), m_statements.cend(), position,
+                                     [](const StatementSpan &span, int pos) { return span.end < pos; });
+    const int first = int(it - m_statements.cbegin());
+    int restart = 0;
+    QString delimiter = QStringLiteral(";");
+    if(first > 0){
+        restart = m_statements.at(first - 1).end;
+        delimiter = m_statements.at(first - 1).delimiter;
+    }
+
+    SqlSplitter splitter(delimiter);
+    splitter.setOrigin(restart, 1);
+    QVector<StatementSpan> fresh;
+    int tail = first;
+    // Stop at the first statement past the edit that matches the old index; the rest only shift
+    auto collect = [&]() -> bool {
+        while(splitter.hasStatement()){
+            const SqlStatement statement = splitter.takeStatement();
+            if(statement.start >= editEnd){
+                while(tail < m_statements.size()
+                      && (m_statements.at(tail).start < oldEditEnd
+                          || m_statements.at(tail).start + delta < statement.start)){
+                    ++tail;
+                }
+                if(tail < m_statements.size()){
+                    const StatementSpan &old = m_statements.at(tail);
+                    if(old.start + delta == statement.start
+                            && old.end + delta == statement.end
+                            && old.delimiter == statement.delimiter){
+                        return true;
+                    }
+                }
+            }
+            fresh.append({int(statement.start), int(statement.end), statement.delimiter});
+        }
+        return false;
+    };
+
+    bool synced = false;
+    QTextBlock block = document()->findBlock(restart);
+    int offsetInBlock = restart - block.position();
+    while(block.isValid() && !synced){
+        QString text = block.text().mid(offsetInBlock);
+        offsetInBlock = 0;
+        block = block.next();
+        if(block.isValid()){
+            text += QLatin1Char('\n');
+        }
+        splitter.feed(text);
+        synced = collect();
+    }
+    if(!synced){
+        splitter.finish();
+        synced = collect();
+    }
+
+    QVector<StatementSpan> updated;
+    updated.reserve(first + fresh.size() + (synced ? m_statements.size() - tail : 0));
+    for(int i = 0; i < first; ++i){
+        updated.append(m_statements.at(i));
+    }
+    updated += fresh;
+    if(synced){
+        for(int i = tail; i < m_statements.size(); ++i){
+            StatementSpan span = m_statements.at(i);
+            span.start += delta;
+            span.end += delta;
+            updated.append(span);
+        }
+    }
+    m_statements.swap(updated);
+    highlightCurrentStatement();
+}
+
+void MyEdit::highlightCurrentStatement()
+{
+    QList<QTextEdit::ExtraSelection> selections;
+    if(m_highlightStatement && m_statements.size() > 1){
+        const int index = statementIndexAt(textCursor().position());
+        if(index >= 0){
+            const StatementSpan &span = m_statements.at(index);
+            QTextEdit::ExtraSelection selection;
+            selection.format.setBackground(QColor(242, 247, 255));
+            selection.format.setProperty(QTextFormat::FullWidthSelection, true);
+            selection.cursor = QTextCursor(document());
+            selection.cursor.setPosition(span.start);
+            selection.cursor.setPosition(span.end, QTextCursor::KeepAnchor);
+            selections << selection;
+        }
+    }
+    setExtraSelections(selections);
+}
+
 MyEdit::ContextType MyEdit::detectContext() const
 {
     static const QStringList tableKeywords = {
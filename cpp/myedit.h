@@ -1,8 +1,11 @@
 #ifndef MYEDIT_H
 #define MYEDIT_H
 
+#include "sqlsplitter.h"
+
 #include <QPlainTextEdit>
 #include <QStringList>
+#include <QVector>
 
 class QCompleter;
 class QStandardItemModel;
@@ -37,6 +40,12 @@ public:
 
     void setCompletionItems(const QList<CompletionItem> &items);
 
+    int statementCount() const;
+    SqlStatement statementAt(int position) const;
+    SqlStatement currentStatement() const;
+    bool statementHighlightEnabled() const;
+    void setStatementHighlightEnabled(bool enabled);
+
 signals:
     void searchTriggered();
 
@@ -45,8 +54,18 @@ protected:
 
 private slots:
     void insertCompletion(const QModelIndex &index);
+    void updateStatementIndex(int position, int charsRemoved, int charsAdded);
+    void highlightCurrentStatement();
 
 private:
+    // Range of a statement in the document; end is just past its delimiter
+    struct StatementSpan {
+        int start = 0;
+        int end = 0;
+        QString delimiter;
+    };
+
+    int statementIndexAt(int position) const;
     QString textUnderCursor() const;
     ContextType detectContext() const;
     void rebuildCompletionModel();
@@ -58,6 +77,8 @@ private:
     QStandardItemModel *m_completionModel = nullptr;
     QList<CompletionItem> m_allItems;
     ContextType m_lastContext = UnknownContext;
+    QVector<StatementSpan> m_statements;
+    bool m_highlightStatement = false;
 };
 
 #endif // MYEDIT_H
@@ -1,5 +1,7 @@
 ﻿#include "mytreewidget.h"
+#include "jobscheduler.h"
 #include "languagemanager.h"
+#include "sessionpool.h"
 
 #include <QDialog>
 #include <QDialogButtonBox>
@@ -29,6 +31,14 @@ MyTreeWidget::MyTreeWidget(QWidget *parent) : QTreeWidget(parent)
         handleDoubleClick(item);
     });
     connect(this, &QTreeWidget::itemExpanded, this, [this](QTreeWidgetItem *item) {
+        if(item && item->data(0, TypeRole).toInt() == ConnectionNode){
+            // Expanding a connection means a query is coming; warm at least one session
+            const QString connName = item->data(0, ConnectionRole).toString();
+            const ConnectionInfo info = ConnectionManager::instance()->connection(connName);
+            if(!info.name.isEmpty()){
+                SessionPool::instance()->prewarm(info, qMax(1, info.warmSessions));
+            }
+        }
         ensureTablesLoaded(item);
     });
     connect(this, &QTreeWidget::currentItemChanged, this, [this](QTreeWidgetItem *current) {
@@ -69,6 +79,7 @@ void MyTreeWidget::populateDatabases(QTreeWidgetItem *connItem, const Connection
 {
     connItem->takeChildren();
     const QIcon dbIcon(QStringLiteral(":/images/database.svg"));
+    ScopedJob job(QStringLiteral("metadata"), QStringLiteral("SHOW DATABASES"), {info.name});
     QStringList dbs = ConnectionManager::instance()->fetchDatabases(info, nullptr);
     if(dbs.isEmpty() && !info.defaultDb.isEmpty()){
         dbs << info.defaultDb;
@@ -177,7 +188,11 @@ void MyTreeWidget::ensureTablesLoaded(QTreeWidgetItem *dbItem)
 
     const QIcon tableIcon(QStringLiteral(":/images/table.svg"));
     QString errorMessage;
+    ScopedJob job(QStringLiteral("metadata"), QStringLiteral("SHOW TABLES FROM %1").arg(dbName), {connName});
     const QStringList tables = ConnectionManager::instance()->fetchTables(info, dbName, &errorMessage);
+    if(!errorMessage.isEmpty()){
+        job.fail(errorMessage);
+    }
     dbItem->takeChildren();
     if(!tables.isEmpty()){
         for(const auto &table : tables){
@@ -304,12 +319,13 @@ void MyTreeWidget::showContextMenu(const QPoint &pos)
             QString errorText;
             {
                 QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), handle);
-                db.setHostName(info.host);
-                db.setPort(info.port);
+                QString endpointError;
+                const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
                 db.setUserName(info.user);
                 db.setPassword(info.password);
-                if(!db.open()){
-                    errorText = db.lastError().text();
+                db.setConnectOptions(ConnectionManager::connectOptions(info));
+                if(!endpointOk || !db.open()){
+                    errorText = endpointOk ? db.lastError().text() : endpointError;
                 }else{
                     QSqlQuery query(db);
                     const QString sql = QStringLiteral("CREATE DATABASE `%1`").arg(newDbName.trimmed());
@@ -355,12 +371,13 @@ void MyTreeWidget::showContextMenu(const QPoint &pos)
                          QUuid::createUuid().toString(QUuid::Id128));
             {
                 QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), handle);
-                db.setHostName(info.host);
-                db.setPort(info.port);
+                QString endpointError;
+                const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
                 db.setUserName(info.user);
                 db.setPassword(info.password);
-                if(!db.open()){
-                    err = db.lastError().text();
+                db.setConnectOptions(ConnectionManager::connectOptions(info));
+                if(!endpointOk || !db.open()){
+                    err = endpointOk ? db.lastError().text() : endpointError;
                 }else{
                     QSqlQuery query(db);
                     if(query.exec(sql)){
@@ -397,6 +414,8 @@ void MyTreeWidget::showContextMenu(const QPoint &pos)
                                                       QStringLiteral("Import...")));
         QAction *exportAction = menu.addAction(trLang(QStringLiteral("导出..."),
                                                       QStringLiteral("Export...")));
+        QAction *runSqlFileAction = menu.addAction(trLang(QStringLiteral("运行 SQL 文件..."),
+                                                          QStringLiteral("Run SQL File...")));
         menu.addSeparator();
         QAction *syncDataAction = menu.addAction(trLang(QStringLiteral("数据同步..."),
                                                         QStringLiteral("Data Synchronization...")));
@@ -432,6 +451,10 @@ void MyTreeWidget::showContextMenu(const QPoint &pos)
             emit dataSyncRequested(connName, dbName, QString());
             return;
         }
+        if(selected == runSqlFileAction){
+            emit runSqlFileRequested(connName, dbName);
+            return;
+        }
         if(selected == closeDbAction){
             item->setExpanded(false);
             item->takeChildren();
@@ -523,12 +546,13 @@ void MyTreeWidget::showContextMenu(const QPoint &pos)
             QString dropError;
             {
                 QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), handle);
-                db.setHostName(info.host);
-                db.setPort(info.port);
+                QString endpointError;
+                const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
                 db.setUserName(info.user);
                 db.setPassword(info.password);
-                if(!db.open()){
-                    dropError = db.lastError().text();
+                db.setConnectOptions(ConnectionManager::connectOptions(info));
+                if(!endpointOk || !db.open()){
+                    dropError = endpointOk ? db.lastError().text() : endpointError;
                 }else{
                     QString escapedName = dbName;
                     escapedName.replace(QLatin1Char('`'), QStringLiteral("``"));
@@ -32,6 +32,7 @@ signals:
     void dataImportRequested(const QString &connName,
                              const QString &dbName,
                              const QString &tableName);
+    void runSqlFileRequested(const QString &connName, const QString &dbName);
 
 public slots:
     void refreshConnections();
@@ -42,6 +42,8 @@
 #include <qcoreapplication.h>
 #include <qvariant.h>
 #include <qdatetime.h>
+#include <qlocale.h>
+#include <qnumeric.h>
 #include <qsqlerror.h>
 #include <qsqlfield.h>
 #include <qsqlindex.h>
@@ -52,8 +54,11 @@
 #include <qtextcodec.h>
 #endif
 #include <qvector.h>
+#include <qhash.h>
 #include <qfile.h>
 #include <qdebug.h>
+#include <errmsg.h>
+#include <mysqld_error.h>
 #include <QtSql/private/qsqldriver_p.h>
 #include <QtSql/private/qsqlresult_p.h>
 
@@ -91,6 +96,35 @@ public:
     MYSQL *mysql = nullptr;
     QTextCodec *tc = nullptr;
     bool preparedQuerysEnabled = false;
+    // server max_allowed_packet, queried by the first batch
+    qint64 maxAllowedPacket = 0;
+    // commands sent to the server that wait for a reply
+    qint64 roundTrips = 0;
+
+    // Idle server-side prepared statements of this session, keyed by the
+    // default database and the statement text. A result checks a statement
+    // out in prepare() and hands it back in cleanup() unless it failed.
+    // Unqualified names were resolved when a statement was prepared, so the
+    // whole cache is dropped whenever a query may change the default
+    // database. Result metadata is not cached: it is read again after every
+    // execute, since the tables behind a statement can change between
+    // executions.
+    struct CachedStmt
+    {
+        MYSQL_STMT *stmt = nullptr;
+        quint64 lastUse = 0;
+    };
+    QHash<QByteArray, CachedStmt> stmtCache;
+    quint64 stmtCacheClock = 0;
+    int stmtCacheSize = 32;
+    qint64 stmtCacheHits = 0;
+    qint64 stmtCacheMisses = 0;
+
+    QByteArray stmtCacheKey(const QByteArray &query) const;
+    MYSQL_STMT *takeCachedStmt(const QByteArray &key);
+    void cacheStmt(const QByteArray &key, MYSQL_STMT *stmt);
+    void dropCachedStmt(const QByteArray &key);
+    bool evictCachedStmts();
 };
 
 static inline QString toUnicode(QTextCodec *tc, const char *str)
@@ -164,6 +198,60 @@ static inline QVariant qDateTimeFromString(QString &val)
 }
 
 // check if this client and server version of MySQL/MariaDB support prepared statements
+// True if any statement in query is a USE. Works on the raw bytes: it
+// skips quoted text and comments and looks at the first word of every
+// statement.
+static bool qChangesDefaultDatabase(const QByteArray &query)
+{
+    const char *p = query.constData();
+    const char *end = p + query.size();
+    bool statementStart = true;
+    while (p < end) {
+        const char c = *p;
+        if (c == '-' && p + 2 < end && p[1] == '-' && (p[2] == ' ' || p[2] == '\t' || p[2] == '\n')) {
+            while (p < end && *p != '\n')
+                ++p;
+            continue;
+        }
+        if (c == '#') {
+            while (p < end && *p != '\n')
+                ++p;
+            continue;
+        }
+        if (c == '/' && p + 1 < end && p[1] == '*') {
+            p += 2;
+            while (p + 1 < end && !(p[0] == '*' && p[1] == '/'))
+                ++p;
+            p = qMin(p + 2, end);
+            continue;
+        }
+        if (c == ';') {
+            statementStart = true;
+            ++p;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++p;
+            continue;
+        }
+        if (statementStart && end - p >= 4 && qstrnicmp(p, "use", 3) == 0
+            && (p[3] == ' ' || p[3] == '\t' || p[3] == '\r' || p[3] == '\n' || p[3] == '`')) {
+            return true;
+        }
+        statementStart = false;
+        if (c == '\'' || c == '"' || c == '`') {
+            ++p;
+            while (p < end && *p != c) {
+                if (*p == '\\' && c != '`')
+                    ++p;
+                ++p;
+            }
+        }
+        ++p;
+    }
+    return false;
+}
+
 static inline bool checkPreparedQueries(MYSQL *mysql)
 {
     std::unique_ptr<MYSQL_STMT, decltype(&mysql_stmt_close)> stmt(mysql_stmt_init(mysql), &mysql_stmt_close);
@@ -177,6 +265,69 @@ static inline bool checkPreparedQueries(MYSQL *mysql)
     return mysql_stmt_param_count(stmt.get()) == 2;
 }
 
+QByteArray QMYSQLDriverPrivate::stmtCacheKey(const QByteArray &query) const
+{
+    // mysql->db follows USE only where the server tracks the schema; the
+    // cache is flushed on USE anyway (see qChangesDefaultDatabase)
+    QByteArray key(mysql && mysql->db ? mysql->db : "");
+    key += '\0';
+    key += query;
+    return key;
+}
+
+MYSQL_STMT *QMYSQLDriverPrivate::takeCachedStmt(const QByteArray &key)
+{
+    const auto it = stmtCache.find(key);
+    if (it == stmtCache.end()) {
+        ++stmtCacheMisses;
+        return nullptr;
+    }
+    ++stmtCacheHits;
+    MYSQL_STMT *stmt = it->stmt;
+    stmtCache.erase(it);
+    return stmt;
+}
+
+void QMYSQLDriverPrivate::cacheStmt(const QByteArray &key, MYSQL_STMT *stmt)
+{
+    if (stmtCacheSize <= 0 || stmtCache.contains(key)) {
+        mysql_stmt_close(stmt);
+        return;
+    }
+    while (stmtCache.size() >= stmtCacheSize) {
+        auto oldest = stmtCache.begin();
+        for (auto it = stmtCache.begin(); it != stmtCache.end(); ++it) {
+            if (it->lastUse < oldest->lastUse)
+                oldest = it;
+        }
+        mysql_stmt_close(oldest->stmt);
+        stmtCache.erase(oldest);
+    }
+    CachedStmt cached;
+    cached.stmt = stmt;
+    cached.lastUse = ++stmtCacheClock;
+    stmtCache.insert(key, cached);
+}
+
+void QMYSQLDriverPrivate::dropCachedStmt(const QByteArray &key)
+{
+    const auto it = stmtCache.find(key);
+    if (it == stmtCache.end())
+        return;
+    mysql_stmt_close(it->stmt);
+    stmtCache.erase(it);
+}
+
+bool QMYSQLDriverPrivate::evictCachedStmts()
+{
+    if (stmtCache.isEmpty())
+        return false;
+    for (const CachedStmt &cached : qAsConst(stmtCache))
+        mysql_stmt_close(cached.stmt);
+    stmtCache.clear();
+    return true;
+}
+
 class QMYSQLResultPrivate;
 
 class QMYSQLResult : public QSqlResult
@@ -208,6 +359,7 @@ protected:
 
     bool prepare(const QString &stmt) override;
     bool exec() override;
+    bool execBatch(bool arrayBind = false) override;
 };
 
 class QMYSQLResultPrivate: public QSqlResultPrivate
@@ -220,7 +372,11 @@ public:
     using QSqlResultPrivate::QSqlResultPrivate;
 
     bool bindInValues();
-    void bindBlobs();
+    void releaseInBinds();
+    void bindBlobs(ulong fixedLength = 0);
+    bool fetchTruncatedColumns();
+    const char *fieldData(const QMyField &f) const
+    { return f.overflow.isNull() ? f.outField : f.overflow.constData(); }
 
     MYSQL_RES *result = nullptr;
     MYSQL_ROW row;
@@ -232,6 +388,8 @@ public:
         QMetaType::Type type = QMetaType::UnknownType;
         my_bool nullIndicator = false;
         ulong bufLength = 0ul;
+        // value of a column that did not fit outField (cursor mode only)
+        QByteArray overflow;
     };
 
     QVector<QMyField> fields;
@@ -245,8 +403,15 @@ public:
     int rowsAffected = 0;
     bool hasBlobs = false;
     bool preparedQuery = false;
+    bool cursorOpen = false;
+    bool batchExecuted = false;
+    // cache key of stmt, empty when stmt is not cacheable
+    QByteArray stmtKey;
 };
 
+// cursor mode binds BLOB/TEXT columns to fixed buffers and fetches longer values per column
+static const ulong qCursorBlobBufferSize = 64 * 1024;
+
 #if QT_CONFIG(textcodec)
 static QTextCodec* codec(MYSQL* mysql)
 {
@@ -357,6 +522,15 @@ static bool qIsBlob(int t)
            || t == MYSQL_TYPE_JSON;
 }
 
+// Temporal columns bound to a MYSQL_TIME buffer instead of text. TIME is
+// left out: its range does not fit QTime, so it is returned as a string.
+static bool qIsNativeTemporal(int t)
+{
+    return t == MYSQL_TYPE_DATE
+           || t == MYSQL_TYPE_DATETIME
+           || t == MYSQL_TYPE_TIMESTAMP;
+}
+
 static bool qIsInteger(int t)
 {
     return t == QMetaType::Char || t == QMetaType::UChar
@@ -365,21 +539,44 @@ static bool qIsInteger(int t)
         || t == QMetaType::LongLong || t == QMetaType::ULongLong;
 }
 
-void QMYSQLResultPrivate::bindBlobs()
+void QMYSQLResultPrivate::bindBlobs(ulong fixedLength)
 {
     MYSQL_BIND *bind;
     for (int i = 0; i < fields.count(); ++i) {
         const MYSQL_FIELD *fieldInfo = fields.at(i).myField;
         if (qIsBlob(inBinds[i].buffer_type) && meta && fieldInfo) {
+            // without a stored result max_length is unknown; use a fixed buffer
+            const ulong length = fixedLength ? fixedLength : fieldInfo->max_length;
             bind = &inBinds[i];
-            bind->buffer_length = fieldInfo->max_length;
+            bind->buffer_length = length;
             delete[] static_cast<char*>(bind->buffer);
-            bind->buffer = new char[fieldInfo->max_length];
+            bind->buffer = new char[length];
             fields[i].outField = static_cast<char*>(bind->buffer);
         }
     }
 }
 
+bool QMYSQLResultPrivate::fetchTruncatedColumns()
+{
+    for (int i = 0; i < fields.count(); ++i) {
+        QMyField &f = fields[i];
+        f.overflow = QByteArray();
+        if (f.nullIndicator || f.bufLength <= inBinds[i].buffer_length)
+            continue;
+        f.overflow.resize(int(f.bufLength));
+        MYSQL_BIND bind;
+        memset(&bind, 0, sizeof(MYSQL_BIND));
+        ulong length = 0;
+        bind.buffer_type = inBinds[i].buffer_type;
+        bind.buffer = f.overflow.data();
+        bind.buffer_length = f.bufLength;
+        bind.length = &length;
+        if (mysql_stmt_fetch_column(stmt, &bind, i, 0))
+            return false;
+    }
+    return true;
+}
+
 bool QMYSQLResultPrivate::bindInValues()
 {
     int i = 0;
@@ -412,6 +609,11 @@ bool QMYSQLResultPrivate::bindInValues()
             hasBlobs = true;
         } else if (qIsInteger(f.type)) {
             bind->buffer_length = f.bufLength = 8;
+        } else if (fieldInfo->type == MYSQL_TYPE_DOUBLE) {
+            // decoded straight from the binary row, no text round trip
+            bind->buffer_length = f.bufLength = sizeof(double);
+        } else if (qIsNativeTemporal(fieldInfo->type)) {
+            bind->buffer_length = f.bufLength = sizeof(MYSQL_TIME);
         } else {
             bind->buffer_type = MYSQL_TYPE_STRING;
         }
@@ -428,6 +630,20 @@ bool QMYSQLResultPrivate::bindInValues()
     return true;
 }
 
+void QMYSQLResultPrivate::releaseInBinds()
+{
+    if (meta) {
+        mysql_free_result(meta);
+        meta = 0;
+    }
+    for (int i = 0; i < fields.count(); ++i)
+        delete[] fields[i].outField;
+    fields.clear();
+    delete[] inBinds;
+    inBinds = 0;
+    hasBlobs = false;
+}
+
 QMYSQLResult::QMYSQLResult(const QMYSQLDriver* db)
     : QSqlResult(*new QMYSQLResultPrivate(this, db))
 {
@@ -462,32 +678,28 @@ void QMYSQLResult::cleanup()
     }
 
     if (d->stmt) {
-        if (mysql_stmt_close(d->stmt))
-            qWarning("QMYSQLResult::cleanup: unable to free statement handle");
-        d->stmt = 0;
-    }
-
-    if (d->meta) {
-        mysql_free_result(d->meta);
-        d->meta = 0;
+        QMYSQLDriverPrivate *drv = d->drv_d_func();
+        if (!d->stmtKey.isEmpty() && drv && drv->mysql) {
+            mysql_stmt_free_result(d->stmt);
+            drv->cacheStmt(d->stmtKey, d->stmt);
+            d->stmt = 0;
+        } else {
+            if (mysql_stmt_close(d->stmt))
+                qWarning("QMYSQLResult::cleanup: unable to free statement handle");
+            d->stmt = 0;
+        }
+        d->stmtKey.clear();
     }
 
-    int i;
-    for (i = 0; i < d->fields.count(); ++i)
-        delete[] d->fields[i].outField;
+    d->releaseInBinds();
 
     if (d->outBinds) {
         delete[] d->outBinds;
         d->outBinds = 0;
     }
 
-    if (d->inBinds) {
-        delete[] d->inBinds;
-        d->inBinds = 0;
-    }
-
-    d->hasBlobs = false;
-    d->fields.clear();
+    d->cursorOpen = false;
+    d->batchExecuted = false;
     d->result = NULL;
     d->row = NULL;
     setAt(-1);
@@ -542,6 +754,17 @@ bool QMYSQLResult::fetchNext()
         return false;
     if (d->preparedQuery) {
         int nRC = mysql_stmt_fetch(d->stmt);
+        if (d->cursorOpen) {
+            // cursor rows arrive in fixed buffers; pull oversized columns separately
+            if ((nRC == 0 || nRC == MYSQL_DATA_TRUNCATED) && d->fetchTruncatedColumns()) {
+                setAt(at() + 1);
+                return true;
+            }
+            if (nRC != MYSQL_NO_DATA)
+                setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
+                                    "Unable to fetch data"), QSqlError::StatementError, d->stmt));
+            return false;
+        }
         if (nRC) {
 #ifdef MYSQL_DATA_TRUNCATED
             if (nRC == 1 || nRC == MYSQL_DATA_TRUNCATED)
@@ -623,8 +846,33 @@ QVariant QMYSQLResult::data(int field)
             return variant;
         }
 
+        const int boundType = d->inBinds[field].buffer_type;
+        if (boundType == MYSQL_TYPE_DOUBLE) {
+            double dbl;
+            memcpy(&dbl, f.outField, sizeof(double));
+            switch (numericalPrecisionPolicy()) {
+            case QSql::LowPrecisionInt32:
+                return QVariant(dbl).toInt();
+            case QSql::LowPrecisionInt64:
+                return QVariant(dbl).toLongLong();
+            case QSql::LowPrecisionDouble:
+                return QVariant(dbl);
+            case QSql::HighPrecision:
+            default:
+                return QVariant(QString::number(dbl, 'g', QLocale::FloatingPointShortest));
+            }
+        }
+        if (qIsNativeTemporal(boundType)) {
+            const MYSQL_TIME *t = reinterpret_cast<const MYSQL_TIME *>(f.outField);
+            const QDate date(t->year, t->month, t->day);
+            if (f.type == QMetaType::QDate)
+                return QVariant(date);
+            return QVariant(QDateTime(date, QTime(t->hour, t->minute, t->second,
+                                                  int(t->second_part / 1000))));
+        }
+
         if (f.type != QMetaType::QByteArray)
-            val = toUnicode(d->drv_d_func()->tc, f.outField, f.bufLength);
+            val = toUnicode(d->drv_d_func()->tc, d->fieldData(f), f.bufLength);
     } else {
         if (d->row[field] == NULL) {
             // NULL value
@@ -684,7 +932,7 @@ QVariant QMYSQLResult::data(int field)
 
         QByteArray ba;
         if (d->preparedQuery) {
-            ba = QByteArray(f.outField, f.bufLength);
+            ba = QByteArray(d->fieldData(f), f.bufLength);
         } else {
             ba = QByteArray(d->row[field], fieldLength);
         }
@@ -719,6 +967,10 @@ bool QMYSQLResult::reset (const QString& query)
     cleanup();
 
     const QByteArray encQuery(fromUnicode(d->drv_d_func()->tc, query));
+    // cached statements were prepared against the old default database
+    if (qChangesDefaultDatabase(encQuery))
+        d->drv_d_func()->evictCachedStmts();
+    ++d->drv_d_func()->roundTrips;
     if (mysql_real_query(d->drv_d_func()->mysql, encQuery.data(), encQuery.length())) {
         setLastError(qMakeError(QCoreApplication::translate("QMYSQLResult", "Unable to execute query"),
                      QSqlError::StatementError, d->drv_d_func()));
@@ -751,7 +1003,7 @@ int QMYSQLResult::size()
     Q_D(const QMYSQLResult);
     if (driver() && isSelect())
         if (d->preparedQuery)
-            return mysql_stmt_num_rows(d->stmt);
+            return d->cursorOpen ? -1 : mysql_stmt_num_rows(d->stmt);
         else
             return int(mysql_num_rows(d->result));
     else
@@ -779,7 +1031,7 @@ QVariant QMYSQLResult::lastInsertId() const
     if (!isActive() || !driver())
         return QVariant();
 
-    if (d->preparedQuery) {
+    if (d->preparedQuery && !d->batchExecuted) {
         quint64 id = mysql_stmt_insert_id(d->stmt);
         if (id)
             return QVariant(id);
@@ -906,22 +1158,34 @@ bool QMYSQLResult::prepare(const QString& query)
     if (query.isEmpty())
         return false;
 
-    if (!d->stmt)
-        d->stmt = mysql_stmt_init(d->drv_d_func()->mysql);
+    QMYSQLDriverPrivate *drv = d->drv_d_func();
+    const QByteArray encQuery(fromUnicode(drv->tc, query));
+    const QByteArray key = drv->stmtCacheKey(encQuery);
+    d->stmt = drv->takeCachedStmt(key);
     if (!d->stmt) {
-        setLastError(qMakeError(QCoreApplication::translate("QMYSQLResult", "Unable to prepare statement"),
-                     QSqlError::StatementError, d->drv_d_func()));
-        return false;
-    }
+        d->stmt = mysql_stmt_init(drv->mysql);
+        if (!d->stmt) {
+            setLastError(qMakeError(QCoreApplication::translate("QMYSQLResult", "Unable to prepare statement"),
+                         QSqlError::StatementError, drv));
+            return false;
+        }
 
-    const QByteArray encQuery(fromUnicode(d->drv_d_func()->tc, query));
-    r = mysql_stmt_prepare(d->stmt, encQuery.constData(), encQuery.length());
-    if (r != 0) {
-        setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
-                     "Unable to prepare statement"), QSqlError::StatementError, d->stmt));
-        cleanup();
-        return false;
+        ++drv->roundTrips;
+        r = mysql_stmt_prepare(d->stmt, encQuery.constData(), encQuery.length());
+        // the server-wide limit is shared by all sessions; give back our idle ones and retry
+        if (r != 0 && mysql_stmt_errno(d->stmt) == ER_MAX_PREPARED_STMT_COUNT_REACHED
+            && drv->evictCachedStmts()) {
+            ++drv->roundTrips;
+            r = mysql_stmt_prepare(d->stmt, encQuery.constData(), encQuery.length());
+        }
+        if (r != 0) {
+            setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
+                         "Unable to prepare statement"), QSqlError::StatementError, d->stmt));
+            cleanup();
+            return false;
+        }
     }
+    d->stmtKey = key;
 
     const auto paramCount = mysql_stmt_param_count(d->stmt);
     if (paramCount > 0) // allocate memory for outvalues
@@ -941,6 +1205,7 @@ bool QMYSQLResult::exec()
         return QSqlResult::exec();
     if (!d->stmt)
         return false;
+    d->batchExecuted = false;
 
     int r = 0;
     MYSQL_BIND* currBind;
@@ -950,10 +1215,12 @@ bool QMYSQLResult::exec()
 
     const QVector<QVariant> values = boundValues();
 
+    ++d->drv_d_func()->roundTrips;
     r = mysql_stmt_reset(d->stmt);
     if (r != 0) {
         setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                      "Unable to reset statement"), QSqlError::StatementError, d->stmt));
+        d->stmtKey.clear();
         return false;
     }
 
@@ -1046,9 +1313,22 @@ bool QMYSQLResult::exec()
             setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                          "Unable to bind value"), QSqlError::StatementError, d->stmt));
             qDeleteAll(timeVector);
+            d->stmtKey.clear();
             return false;
         }
     }
+    // browse mode: forward-only SELECTs become read-only server-side cursors
+    const int prefetchRows = driver()->property("cursorPrefetchRows").toInt();
+    const bool useCursor = prefetchRows > 0 && isForwardOnly() && d->meta;
+    unsigned long cursorType = useCursor ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+    mysql_stmt_attr_set(d->stmt, STMT_ATTR_CURSOR_TYPE, &cursorType);
+    if (useCursor) {
+        unsigned long prefetch = prefetchRows;
+        mysql_stmt_attr_set(d->stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch);
+    }
+    d->cursorOpen = false;
+
+    ++d->drv_d_func()->roundTrips;
     r = mysql_stmt_execute(d->stmt);
 
     qDeleteAll(timeVector);
@@ -1056,10 +1336,20 @@ bool QMYSQLResult::exec()
     if (r != 0) {
         setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                      "Unable to execute statement"), QSqlError::StatementError, d->stmt));
+        // a statement that failed is closed in cleanup() instead of going back
+        // to the cache; one whose result columns changed is useless everywhere
+#if defined(CR_NEW_STMT_METADATA)
+        if (mysql_stmt_errno(d->stmt) == CR_NEW_STMT_METADATA)
+            d->drv_d_func()->dropCachedStmt(d->stmtKey);
+#endif
+        d->stmtKey.clear();
         return false;
     }
-    //if there is meta-data there is also data
-    setSelect(d->meta);
+    // the tables behind a cached or re-prepared statement may have changed
+    // since prepare(); bind the columns this execution actually returns.
+    // if there is meta-data there is also data
+    d->releaseInBinds();
+    setSelect(d->bindInValues());
 
     d->rowsAffected = mysql_stmt_affected_rows(d->stmt);
 
@@ -1070,8 +1360,27 @@ bool QMYSQLResult::exec()
         if (r != 0) {
             setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                          "Unable to bind outvalues"), QSqlError::StatementError, d->stmt));
+            d->stmtKey.clear();
             return false;
         }
+        if (useCursor) {
+            // rows stay on the server; fetchNext() pulls them prefetchRows at a time
+            if (d->hasBlobs) {
+                d->bindBlobs(qCursorBlobBufferSize);
+                r = mysql_stmt_bind_result(d->stmt, d->inBinds);
+                if (r != 0) {
+                    setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
+                                 "Unable to bind outvalues"), QSqlError::StatementError, d->stmt));
+                    d->stmtKey.clear();
+                    return false;
+                }
+            }
+            d->cursorOpen = true;
+            setAt(QSql::BeforeFirstRow);
+            setActive(true);
+            return true;
+        }
+
         if (d->hasBlobs)
             mysql_stmt_attr_set(d->stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update_max_length);
 
@@ -1079,6 +1388,7 @@ bool QMYSQLResult::exec()
         if (r != 0) {
             setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                          "Unable to store statement results"), QSqlError::StatementError, d->stmt));
+            d->stmtKey.clear();
             return false;
         }
 
@@ -1091,6 +1401,7 @@ bool QMYSQLResult::exec()
             if (r != 0) {
                 setLastError(qMakeStmtError(QCoreApplication::translate("QMYSQLResult",
                              "Unable to bind outvalues"), QSqlError::StatementError, d->stmt));
+                d->stmtKey.clear();
                 return false;
             }
         }
@@ -1100,6 +1411,300 @@ bool QMYSQLResult::exec()
     return true;
 }
 
+// Layout of a prepared statement used by execBatch(): the positions of its
+// '?' placeholders and, for INSERT/REPLACE ... VALUES (...), the single
+// row tuple that can be repeated to insert many rows with one statement.
+struct QMyBatchTemplate
+{
+    QVector<int> placeholders;
+    int tupleBegin = -1;
+    int tupleEnd = -1;
+    bool multiRow = false;
+};
+
+static QMyBatchTemplate qParseBatchTemplate(const QString &sql)
+{
+    QMyBatchTemplate t;
+    QString verb;
+    bool afterValues = false;
+    int depth = 0;
+    const int n = sql.size();
+    int i = 0;
+    while (i < n) {
+        const QChar c = sql.at(i);
+        if (c == QLatin1Char('\'') || c == QLatin1Char('"') || c == QLatin1Char('`')) {
+            ++i;
+            while (i < n) {
+                if (sql.at(i) == QLatin1Char('\\') && c != QLatin1Char('`')) {
+                    i += 2;
+                    continue;
+                }
+                if (sql.at(i) == c) {
+                    if (i + 1 < n && sql.at(i + 1) == c) {
+                        i += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++i;
+            }
+            ++i;
+        } else if (c == QLatin1Char('#')
+                   || (c == QLatin1Char('-') && sql.midRef(i, 3) == QLatin1String("-- "))) {
+            while (i < n && sql.at(i) != QLatin1Char('\n'))
+                ++i;
+        } else if (c == QLatin1Char('/') && i + 1 < n && sql.at(i + 1) == QLatin1Char('*')) {
+            const int end = sql.indexOf(QLatin1String("*/"), i + 2);
+            i = end < 0 ? n : end + 2;
+        } else if (c == QLatin1Char('?')) {
+            t.placeholders.append(i++);
+        } else if (c == QLatin1Char('(')) {
+            if (depth == 0 && afterValues && t.tupleBegin < 0)
+                t.tupleBegin = i;
+            ++depth;
+            ++i;
+        } else if (c == QLatin1Char(')')) {
+            --depth;
+            if (depth == 0 && t.tupleBegin >= 0 && t.tupleEnd < 0)
+                t.tupleEnd = i;
+            ++i;
+        } else if (c.isLetter() || c == QLatin1Char('_')) {
+            const int start = i;
+            while (i < n && (sql.at(i).isLetterOrNumber() || sql.at(i) == QLatin1Char('_')
+                             || sql.at(i) == QLatin1Char('$')))
+                ++i;
+            if (depth == 0) {
+                const QStringRef word = sql.midRef(start, i - start);
+                if (verb.isEmpty())
+                    verb = word.toString().toUpper();
+                else if (!afterValues && (word.compare(QLatin1String("VALUES"), Qt::CaseInsensitive) == 0
+                                          || word.compare(QLatin1String("VALUE"), Qt::CaseInsensitive) == 0))
+                    afterValues = true;
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    if ((verb == QLatin1String("INSERT") || verb == QLatin1String("REPLACE"))
+        && t.tupleBegin >= 0 && t.tupleEnd > t.tupleBegin
+        && !sql.midRef(t.tupleEnd + 1).trimmed().startsWith(QLatin1Char(','))) {
+        t.multiRow = true;
+        for (int pos : qAsConst(t.placeholders)) {
+            if (pos < t.tupleBegin || pos > t.tupleEnd) {
+                t.multiRow = false;
+                break;
+            }
+        }
+    }
+    return t;
+}
+
+// Formats a bound value as an SQL literal with the meaning exec() gives it
+// over the binary protocol; binary data goes out as a hex literal so it
+// never passes through the connection codec.
+static QByteArray qBatchLiteral(const QVariant &val, MYSQL *mysql, QTextCodec *tc)
+{
+    if (val.isNull())
+        return QByteArrayLiteral("NULL");
+    switch (val.userType()) {
+    case QMetaType::Bool:
+        return val.toBool() ? QByteArrayLiteral("1") : QByteArrayLiteral("0");
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::Short:
+    case QMetaType::Int:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        return QByteArray::number(val.toLongLong());
+    case QMetaType::UChar:
+    case QMetaType::UShort:
+    case QMetaType::UInt:
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        return QByteArray::number(val.toULongLong());
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double v = val.toDouble();
+        if (!qIsFinite(v))
+            return QByteArrayLiteral("NULL");
+        return QByteArray::number(v, 'g', val.userType() == QMetaType::Float ? 9 : 17); }
+    case QMetaType::QByteArray:
+        return "X'" + val.toByteArray().toHex() + '\'';
+    case QMetaType::QDate: {
+        const QDate date = val.toDate();
+        if (!date.isValid())
+            return QByteArrayLiteral("NULL");
+        return '\'' + date.toString(QStringLiteral("yyyy-MM-dd")).toLatin1() + '\''; }
+    case QMetaType::QTime: {
+        const QTime time = val.toTime();
+        if (!time.isValid())
+            return QByteArrayLiteral("NULL");
+        return '\'' + time.toString(QStringLiteral("hh:mm:ss.zzz")).toLatin1() + '\''; }
+    case QMetaType::QDateTime: {
+        const QDateTime dateTime = val.toDateTime();
+        if (!dateTime.isValid())
+            return QByteArrayLiteral("NULL");
+        return '\'' + dateTime.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz")).toLatin1() + '\''; }
+    default:
+        break;
+    }
+    const QByteArray raw = fromUnicode(tc, val.toString());
+    // escaped text needs at most length*2+1 bytes, plus the two quotes
+    QByteArray out(raw.size() * 2 + 3, Qt::Uninitialized);
+    out[0] = '\'';
+    // mysql_real_escape_string_quote() exists from MySQL 5.7.6 on; MariaDB's
+    // client library and older ones only have mysql_real_escape_string()
+#if !defined(MARIADB_BASE_VERSION) && !defined(MARIADB_VERSION_ID) && MYSQL_VERSION_ID >= 50706
+    const unsigned long len = mysql_real_escape_string_quote(mysql, out.data() + 1,
+                                                             raw.constData(), raw.size(), '\'');
+#else
+    const unsigned long len = mysql_real_escape_string(mysql, out.data() + 1,
+                                                       raw.constData(), raw.size());
+#endif
+    if (len == static_cast<unsigned long>(-1)) {
+        // refused under NO_BACKSLASH_ESCAPES, where doubling the quotes is enough
+        QByteArray quoted = raw;
+        quoted.replace('\'', "''");
+        return '\'' + quoted + '\'';
+    }
+    out[int(len) + 1] = '\'';
+    out.truncate(int(len) + 2);
+    return out;
+}
+
+static qint64 qMaxAllowedPacket(QMYSQLDriverPrivate *drv)
+{
+    if (drv->maxAllowedPacket > 0)
+        return drv->maxAllowedPacket;
+    qint64 value = 0;
+    static const char query[] = "SELECT @@max_allowed_packet";
+    ++drv->roundTrips;
+    if (mysql_real_query(drv->mysql, query, sizeof(query) - 1) == 0) {
+        if (MYSQL_RES *res = mysql_store_result(drv->mysql)) {
+            MYSQL_ROW row = mysql_fetch_row(res);
+            if (row && row[0])
+                value = QByteArray(row[0]).toLongLong();
+            mysql_free_result(res);
+        }
+    }
+    drv->maxAllowedPacket = value > 0 ? value : 1024 * 1024;
+    return drv->maxAllowedPacket;
+}
+
+// Sends one packet that may hold several statements and sums their
+// affected rows; the server stops at the first failing statement.
+static bool qExecBatchPacket(MYSQL *mysql, const QByteArray &packet, qint64 *affected)
+{
+    if (mysql_real_query(mysql, packet.constData(), packet.size()))
+        return false;
+    for (;;) {
+        if (MYSQL_RES *res = mysql_store_result(mysql))
+            mysql_free_result(res);
+        else if (mysql_field_count(mysql) == 0)
+            *affected += mysql_affected_rows(mysql);
+        const int status = mysql_next_result(mysql);
+        if (status > 0)
+            return false;
+        if (status < 0)
+            return true;
+    }
+}
+
+/*
+    Native batch execution: a bound INSERT/REPLACE ... VALUES (...) is
+    rewritten into multi-row VALUES statements and any other statement is
+    pipelined as a multi-statement packet, each packet sized to the
+    server's max_allowed_packet, so a batch costs one round trip per
+    packet instead of one per row. Statements that return result sets
+    keep the generic row-by-row execution.
+*/
+bool QMYSQLResult::execBatch(bool arrayBind)
+{
+    Q_D(QMYSQLResult);
+    if (!driver() || !d->preparedQuery || !d->stmt || d->meta)
+        return QSqlResult::execBatch(arrayBind);
+
+    const QVector<QVariant> columns = boundValues();
+    QString sql = executedQuery().trimmed();
+    while (sql.endsWith(QLatin1Char(';'))) {
+        sql.chop(1);
+        sql = sql.trimmed();
+    }
+    if (columns.isEmpty() || sql.isEmpty())
+        return QSqlResult::execBatch(arrayBind);
+
+    QVector<QVariantList> lists;
+    lists.reserve(columns.size());
+    for (const QVariant &column : columns)
+        lists.append(column.toList());
+    const int rowCount = lists.first().size();
+    for (const QVariantList &list : qAsConst(lists)) {
+        if (list.size() != rowCount) {
+            setLastError(QSqlError(QCoreApplication::translate("QMYSQLResult", "Unable to execute batch"),
+                                   QCoreApplication::translate("QMYSQLResult", "Parameter lists differ in length"),
+                                   QSqlError::StatementError));
+            return false;
+        }
+    }
+    const QMyBatchTemplate tpl = qParseBatchTemplate(sql);
+    if (rowCount == 0 || tpl.placeholders.size() != lists.size())
+        return QSqlResult::execBatch(arrayBind);
+
+    QMYSQLDriverPrivate *drv = d->drv_d_func();
+    QTextCodec *tc = drv->tc;
+    const int from = tpl.multiRow ? tpl.tupleBegin : 0;
+    const int to = tpl.multiRow ? tpl.tupleEnd + 1 : sql.size();
+    const QByteArray head = fromUnicode(tc, sql.left(from));
+    const QByteArray tail = fromUnicode(tc, sql.mid(to));
+    const char separator = tpl.multiRow ? ',' : ';';
+    QVector<QByteArray> pieces;
+    int last = from;
+    for (int pos : tpl.placeholders) {
+        pieces.append(fromUnicode(tc, sql.mid(last, pos - last)));
+        last = pos + 1;
+    }
+    pieces.append(fromUnicode(tc, sql.mid(last, to - last)));
+
+    const int budget = int(qBound<qint64>(4096, qMaxAllowedPacket(drv), 16 * 1024 * 1024)) - 1024;
+    qint64 affected = 0;
+    QByteArray packet;
+    QByteArray row;
+    for (int r = 0; r <= rowCount; ++r) {
+        if (r < rowCount) {
+            row = pieces.first();
+            for (int col = 0; col < lists.size(); ++col) {
+                row += qBatchLiteral(lists.at(col).at(r), drv->mysql, tc);
+                row += pieces.at(col + 1);
+            }
+            if (packet.isEmpty()) {
+                packet = head + row;
+                continue;
+            }
+            if (packet.size() + 1 + row.size() + tail.size() <= budget) {
+                packet += separator;
+                packet += row;
+                continue;
+            }
+        }
+        // packet is full (or this was the last row): send it
+        packet += tail;
+        ++drv->roundTrips;
+        if (!qExecBatchPacket(drv->mysql, packet, &affected)) {
+            setLastError(qMakeError(QCoreApplication::translate("QMYSQLResult", "Unable to execute batch"),
+                                    QSqlError::StatementError, drv));
+            return false;
+        }
+        packet = head + row;
+    }
+
+    d->rowsAffected = int(affected);
+    d->batchExecuted = true;
+    setSelect(false);
+    setActive(true);
+    return true;
+}
+
 /////////////////////////////////////////////////////////
 
 static int qMySqlConnectionCount = 0;
@@ -1197,7 +1802,6 @@ bool QMYSQLDriver::hasFeature(DriverFeature f) const
 #endif
         return false;
     case NamedPlaceholders:
-    case BatchOperations:
     case SimpleLocking:
     case EventNotifications:
     case FinishQuery:
@@ -1211,6 +1815,7 @@ bool QMYSQLDriver::hasFeature(DriverFeature f) const
         return true;
     case PreparedQueries:
     case PositionalPlaceholders:
+    case BatchOperations:
         return d->preparedQuerysEnabled;
     case MultipleResultSets:
         return true;
@@ -1218,6 +1823,62 @@ bool QMYSQLDriver::hasFeature(DriverFeature f) const
     return false;
 }
 
+int QMYSQLDriver::stmtCacheSize() const
+{
+    Q_D(const QMYSQLDriver);
+    return d->stmtCacheSize;
+}
+
+void QMYSQLDriver::setStmtCacheSize(int size)
+{
+    Q_D(QMYSQLDriver);
+    d->stmtCacheSize = qMax(0, size);
+    d->evictCachedStmts();
+}
+
+qint64 QMYSQLDriver::stmtCacheHits() const
+{
+    Q_D(const QMYSQLDriver);
+    return d->stmtCacheHits;
+}
+
+qint64 QMYSQLDriver::stmtCacheMisses() const
+{
+    Q_D(const QMYSQLDriver);
+    return d->stmtCacheMisses;
+}
+
+qint64 QMYSQLDriver::roundTrips() const
+{
+    Q_D(const QMYSQLDriver);
+    return d->roundTrips;
+}
+
+bool QMYSQLDriver::resetSession()
+{
+    Q_D(QMYSQLDriver);
+    if (!isOpen())
+        return false;
+    // the server frees every prepared statement of the session on reset
+    d->evictCachedStmts();
+#if MYSQL_VERSION_ID >= 50703
+    ++d->roundTrips;
+    if (mysql_reset_connection(d->mysql) != 0) {
+        setLastError(qMakeError(tr("Unable to reset connection"), QSqlError::ConnectionError, d));
+        return false;
+    }
+    // session variables fall back to the server defaults; restore the character set chosen in open()
+    ++d->roundTrips;
+    if (mysql_set_character_set(d->mysql, mysql_character_set_name(d->mysql)) != 0) {
+        setLastError(qMakeError(tr("Unable to reset connection"), QSqlError::ConnectionError, d));
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 static void setOptionFlag(uint &optionFlags, const QString &opt)
 {
     if (opt == QLatin1String("CLIENT_COMPRESS"))
@@ -1334,6 +1995,11 @@ bool QMYSQLDriver::open(const QString& db,
         mysql_options(d->mysql, MYSQL_OPT_READ_TIMEOUT, &readTimeout);
     if (writeTimeout != 0)
         mysql_options(d->mysql, MYSQL_OPT_WRITE_TIMEOUT, &writeTimeout);
+#endif
+#if MYSQL_VERSION_ID >= 50503
+    // negotiate utf8mb4 in the handshake so open() does not need a SET NAMES round trip
+    if (mysql_get_client_version() >= 50503)
+        mysql_options(d->mysql, MYSQL_SET_CHARSET_NAME, "utf8mb4");
 #endif
     MYSQL *mysql = mysql_real_connect(d->mysql,
                                       host.isNull() ? static_cast<const char *>(0)
@@ -1372,7 +2038,8 @@ bool QMYSQLDriver::open(const QString& db,
 #if MYSQL_VERSION_ID >= 50007
     if (mysql_get_client_version() >= 50503 && mysql_get_server_version(d->mysql) >= 50503) {
         // force the communication to be utf8mb4 (only utf8mb4 supports 4-byte characters)
-        mysql_set_character_set(d->mysql, "utf8mb4");
+        if (qstrcmp(mysql_character_set_name(d->mysql), "utf8mb4") != 0)
+            mysql_set_character_set(d->mysql, "utf8mb4");
 #if QT_CONFIG(textcodec)
         d->tc = QTextCodec::codecForName("UTF-8");
 #endif
@@ -1404,8 +2071,10 @@ void QMYSQLDriver::close()
 #if QT_CONFIG(thread)
         mysql_thread_end();
 #endif
+        d->evictCachedStmts();
         mysql_close(d->mysql);
         d->mysql = NULL;
+        d->maxAllowedPacket = 0;
         setOpen(false);
         setOpenError(false);
     }
@@ -1497,6 +2166,7 @@ bool QMYSQLDriver::beginTransaction()
         qWarning("QMYSQLDriver::beginTransaction: Database not open");
         return false;
     }
+    ++d->roundTrips;
     if (mysql_query(d->mysql, "BEGIN WORK")) {
         setLastError(qMakeError(tr("Unable to begin transaction"),
                                 QSqlError::StatementError, d));
@@ -1515,6 +2185,7 @@ bool QMYSQLDriver::commitTransaction()
         qWarning("QMYSQLDriver::commitTransaction: Database not open");
         return false;
     }
+    ++d->roundTrips;
     if (mysql_query(d->mysql, "COMMIT")) {
         setLastError(qMakeError(tr("Unable to commit transaction"),
                                 QSqlError::StatementError, d));
@@ -1533,6 +2204,7 @@ bool QMYSQLDriver::rollbackTransaction()
         qWarning("QMYSQLDriver::rollbackTransaction: Database not open");
         return false;
     }
+    ++d->roundTrips;
     if (mysql_query(d->mysql, "ROLLBACK")) {
         setLastError(qMakeError(tr("Unable to rollback transaction"),
                                 QSqlError::StatementError, d));
@@ -69,11 +69,26 @@ QT_BEGIN_NAMESPACE
 
 class QMYSQLDriverPrivate;
 
+// Setting the dynamic property "cursorPrefetchRows" (int) on the driver
+// makes forward-only prepared SELECTs run as read-only server-side cursors
+// that fetch that many rows per round trip instead of storing the whole
+// result on the client.
+//
+// Prepared statements are kept per session in an LRU cache keyed by the
+// default database and statement text (property "stmtCacheSize", default
+// 32); when the server-wide max_prepared_stmt_count is reached the idle
+// statements are given back and the prepare is retried. "stmtCacheHits" and
+// "stmtCacheMisses" count how prepare() was served. "roundTrips" counts
+// the commands this session sent and waited on a reply for.
 class Q_EXPORT_SQLDRIVER_MYSQL QMYSQLDriver : public QSqlDriver
 {
     friend class QMYSQLResultPrivate;
     Q_DECLARE_PRIVATE(QMYSQLDriver)
     Q_OBJECT
+    Q_PROPERTY(int stmtCacheSize READ stmtCacheSize WRITE setStmtCacheSize)
+    Q_PROPERTY(qint64 stmtCacheHits READ stmtCacheHits)
+    Q_PROPERTY(qint64 stmtCacheMisses READ stmtCacheMisses)
+    Q_PROPERTY(qint64 roundTrips READ roundTrips)
 public:
     explicit QMYSQLDriver(QObject *parent=nullptr);
     explicit QMYSQLDriver(MYSQL *con, QObject * parent=nullptr);
@@ -97,6 +112,16 @@ public:
 
     bool isIdentifierEscaped(const QString &identifier, IdentifierType type) const override;
 
+    int stmtCacheSize() const;
+    void setStmtCacheSize(int size);
+    qint64 stmtCacheHits() const;
+    qint64 stmtCacheMisses() const;
+    qint64 roundTrips() const;
+    // Returns an open session to its just-connected state (rolls back, drops
+    // temporary tables, user variables and server-side statements) while
+    // keeping the connection, its current database and character set.
+    Q_INVOKABLE bool resetSession();
+
 protected:
     bool beginTransaction() override;
     bool commitTransaction() override;
@@ -1,6 +1,14 @@
 #include "queryform.h"
+#include "cursorbrowser.h"
+#include "explainplanview.h"
+#include "fanoutrunner.h"
+#include "jobscheduler.h"
 #include "mainwindow.h"
 #include "flowlayout.h"
+#include "queryhistory.h"
+#include "queryprofiler.h"
+#include "resultspill.h"
+#include "sessionpool.h"
 
 #include <QButtonGroup>
 #include <QCheckBox>
@@ -17,6 +25,7 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QPlainTextEdit>
+#include <QPointer>
 #include <QPushButton>
 #include <QGridLayout>
 #include <QFontDatabase>
@@ -28,9 +37,11 @@
 #include <QTableView>
 #include <QHeaderView>
 #include <QRegularExpression>
+#include <QScopedPointer>
 #include <QScrollArea>
 #include <QMenu>
 #include <QShortcut>
+#include <QSpinBox>
 #include <QClipboard>
 #include <QApplication>
 #include <QItemSelectionModel>
@@ -41,7 +52,6 @@
 #include <QSortFilterProxyModel>
 #include <QStyledItemDelegate>
 #include <QTextStream>
-#include <QUuid>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlField>
@@ -52,6 +62,7 @@
 #include <QTimer>
 #include <QVBoxLayout>
 #include <algorithm>
+#include <numeric>
 
 // Custom delegate to remove frame from editor
 class NoFrameItemDelegate : public QStyledItemDelegate
@@ -160,6 +171,86 @@ QList<QStringList> sampleRows()
     };
 }
 
+QString jobTitle(const QString &sql)
+{
+    return sql.simplified().left(200);
+}
+
+bool serverVersionAtLeast(const QString &version, int major, int minor, int patch)
+{
+    static const QRegularExpression re(QStringLiteral("^(\\d+)\\.(\\d+)\\.(\\d+)"));
+    const auto match = re.match(version);
+    if(!match.hasMatch()){
+        return false;
+    }
+    const int values[3] = {match.captured(1).toInt(), match.captured(2).toInt(), match.captured(3).toInt()};
+    const int wanted[3] = {major, minor, patch};
+    for(int i = 0; i < 3; ++i){
+        if(values[i] != wanted[i]){
+            return values[i] > wanted[i];
+        }
+    }
+    return true;
+}
+
+// Rough result size for the query history statistics, not an exact count
+qint64 estimateValueBytes(const QVariant &value)
+{
+    if(value.isNull()){
+        return 0;
+    }
+    switch(value.type()){
+    case QVariant::ByteArray:
+        return value.toByteArray().size();
+    case QVariant::String:
+        return value.toString().size();
+    default:
+        return 8;
+    }
+}
+
+// Session network traffic from the server's session status; bytes sent by the server are
+// bytes the client received
+struct WireCounters
+{
+    qint64 received = 0;
+    qint64 sent = 0;
+};
+
+bool readWireCounters(const QSqlDatabase &db, WireCounters *counters)
+{
+    QSqlQuery query(db);
+    if(!query.exec(QStringLiteral("SHOW SESSION STATUS WHERE Variable_name IN ('Bytes_received', 'Bytes_sent')"))){
+        return false;
+    }
+    while(query.next()){
+        const QString name = query.value(0).toString();
+        const qint64 value = query.value(1).toLongLong();
+        if(name.compare(QLatin1String("Bytes_sent"), Qt::CaseInsensitive) == 0){
+            counters->received = value;
+        }else{
+            counters->sent = value;
+        }
+    }
+    return true;
+}
+
+qint64 driverRoundTrips(const QSqlDatabase &db)
+{
+    return db.driver() ? db.driver()->property("roundTrips").toLongLong() : 0;
+}
+
+QString formatBytes(qint64 bytes)
+{
+    if(bytes >= 1024 * 1024){
+        return QStringLiteral("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+    if(bytes >= 1024){
+        return QStringLiteral("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    }
+    return QStringLiteral("%1 B").arg(bytes);
+}
+
 QString escapeIdentifier(const QString &name)
 {
     QString value = name;
@@ -167,6 +258,71 @@ QString escapeIdentifier(const QString &name)
     return QStringLiteral("`%1`").arg(value);
 }
 
+// The verb of the statement that actually runs: the first keyword, or for
+// "WITH ..." the keyword after the common table expressions. Quotes and
+// comments are skipped; returns it upper-cased, or empty if there is none.
+QString mainStatementVerb(const QString &sql)
+{
+    int depth = 0;
+    int verbDepth = -1;
+    bool inWith = false;
+    const int n = sql.size();
+    for(int i = 0; i < n;){
+        const QChar c = sql.at(i);
+        if(c == QLatin1Char('\'') || c == QLatin1Char('"') || c == QLatin1Char('`')){
+            for(++i; i < n && sql.at(i) != c; ++i){
+                if(sql.at(i) == QLatin1Char('\\') && c != QLatin1Char('`')){
+                    ++i;
+                }
+            }
+            ++i;
+        }else if(c == QLatin1Char('#') || (c == QLatin1Char('-') && sql.midRef(i, 3).trimmed() == QLatin1String("--"))){
+            while(i < n && sql.at(i) != QLatin1Char('\n')){
+                ++i;
+            }
+        }else if(c == QLatin1Char('/') && i + 1 < n && sql.at(i + 1) == QLatin1Char('*')){
+            const int close = sql.indexOf(QLatin1String("*/"), i + 2);
+            i = close < 0 ? n : close + 2;
+        }else if(c == QLatin1Char('(')){
+            ++depth;
+            ++i;
+        }else if(c == QLatin1Char(')')){
+            --depth;
+            ++i;
+        }else if(c.isLetter()){
+            int end = i;
+            while(end < n && (sql.at(end).isLetterOrNumber() || sql.at(end) == QLatin1Char('_'))){
+                ++end;
+            }
+            const QString word = sql.mid(i, end - i).toUpper();
+            i = end;
+            if(verbDepth < 0){
+                if(word != QLatin1String("WITH")){
+                    return word;
+                }
+                verbDepth = depth;
+                inWith = true;
+            }else if(inWith && depth == verbDepth
+                     && (word == QLatin1String("SELECT") || word == QLatin1String("TABLE")
+                         || word == QLatin1String("VALUES") || word == QLatin1String("UPDATE")
+                         || word == QLatin1String("DELETE") || word == QLatin1String("INSERT")
+                         || word == QLatin1String("REPLACE"))){
+                return word;
+            }
+        }else{
+            ++i;
+        }
+    }
+    return QString();
+}
+
+// Only these run without changing data
+bool isReadOnlyQuery(const QString &sql)
+{
+    const QString verb = mainStatementVerb(sql);
+    return verb == QLatin1String("SELECT") || verb == QLatin1String("TABLE") || verb == QLatin1String("VALUES");
+}
+
 QString qualifiedName(const QString &dbName, const QString &tableName)
 {
     if(dbName.isEmpty()){
@@ -174,6 +330,38 @@ QString qualifiedName(const QString &dbName, const QString &tableName)
     }
     return QStringLiteral("%1.%2").arg(escapeIdentifier(dbName), escapeIdentifier(tableName));
 }
+
+// LIKE literal for a contains match, with quotes, backslashes and wildcards escaped
+QString containsLikeLiteral(const QString &text)
+{
+    QString value = text;
+    value.replace(QLatin1Char('\\'), QStringLiteral("\\\\\\\\"));
+    value.replace(QLatin1Char('\''), QStringLiteral("''"));
+    value.replace(QLatin1Char('%'), QStringLiteral("\\%"));
+    value.replace(QLatin1Char('_'), QStringLiteral("\\_"));
+    return QStringLiteral("'%%1%'").arg(value);
+}
+
+// Delay after typing stops in the data tab search box before querying
+const int kInspectSearchDelayMs = 400;
+// Pages larger than this are not prefetched in the background
+const int kPrefetchMaxRows = 1000;
+// Rows per query when fetching the full values of preview cells
+const int kFullValueBatchRows = 500;
+// Characters fetched for a large column preview
+const int kPreviewChars = 256;
+// Cache limit shared by recently viewed pages (estimated bytes)
+const int kRecentPagesBytes = 64 * 1024 * 1024;
+
+// Most result set tabs one execution shows
+const int kMaxResultTabs = 32;
+// Most rows fetched per connection when running on several connections
+const int kFanOutRowLimit = 10000;
+// Rows per server round trip when browsing with a cursor
+const int kBrowseWindowRows = 500;
+// Windows of a browsed result kept on the client; earlier rows are dropped while
+// scrolling so memory does not grow with rows browsed
+const int kBrowseKeptWindows = 10;
 }
 
 QueryForm::QueryForm(QWidget *parent, Mode mode, TableAction fixedAction) :
@@ -208,6 +396,7 @@ QueryForm::QueryForm(QWidget *parent, Mode mode, TableAction fixedAction) :
 QueryForm::~QueryForm()
 {
     closeAllInspectTabs();
+    delete cursorBrowser;
 }
 
 QString QueryForm::title() const
@@ -315,11 +504,300 @@ void QueryForm::runQuery()
     if(inExecution){
         return;
     }
-    const QString sql = textEdit->toPlainText().trimmed();
+    executeStatements(SqlSplitter::split(textEdit->toPlainText()));
+}
+
+void QueryForm::runCurrentStatement()
+{
+    if(inExecution){
+        return;
+    }
+    const QTextCursor cursor = textEdit->textCursor();
+    if(cursor.hasSelection()){
+        QString selected = cursor.selectedText();
+        selected.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+        executeStatements(SqlSplitter::split(selected));
+        return;
+    }
+    const SqlStatement statement = textEdit->currentStatement();
+    if(statement.text.isEmpty()){
+        resultForm->showMessage(tr("No statement under the cursor."));
+        return;
+    }
+    executeStatements({statement});
+}
+
+void QueryForm::explainCurrentStatement()
+{
+    if(inExecution){
+        return;
+    }
+    const SqlStatement statement = textEdit->currentStatement();
+    if(statement.text.isEmpty()){
+        resultForm->showMessage(tr("No statement under the cursor."));
+        return;
+    }
+    explainStatement(statement, false);
+}
+
+void QueryForm::explainAnalyzeCurrentStatement()
+{
+    if(inExecution){
+        return;
+    }
+    const SqlStatement statement = textEdit->currentStatement();
+    if(statement.text.isEmpty()){
+        resultForm->showMessage(tr("No statement under the cursor."));
+        return;
+    }
+    // EXPLAIN ANALYZE really runs the statement: confirm unless it only reads.
+    // A WITH clause can lead into an UPDATE or DELETE as well
+    if(!isReadOnlyQuery(statement.text)){
+        const auto answer = QMessageBox::question(this, tr("Explain Analyze"),
+                                                  tr("EXPLAIN ANALYZE executes the statement. Continue?"));
+        if(answer != QMessageBox::Yes){
+            return;
+        }
+    }
+    explainStatement(statement, true);
+}
+
+void QueryForm::runOnConnections()
+{
+    if(inExecution){
+        return;
+    }
+    QString sql;
+    const QTextCursor cursor = textEdit->textCursor();
+    if(cursor.hasSelection()){
+        sql = cursor.selectedText();
+        sql.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    }else{
+        sql = textEdit->currentStatement().text;
+    }
+    sql = sql.trimmed();
     if(sql.isEmpty()){
+        resultForm->showMessage(tr("No statement under the cursor."));
+        return;
+    }
+
+    FanOutConnectionsDialog dlg(this);
+    if(dlg.exec() != QDialog::Accepted){
+        return;
+    }
+    const QList<ConnectionInfo> targets = dlg.selectedConnections();
+    if(targets.isEmpty()){
+        return;
+    }
+
+    if(!fanOutRunner){
+        fanOutRunner = new FanOutRunner(this);
+        connect(fanOutRunner, &FanOutRunner::shardFinished, this, &QueryForm::handleFanOutShard);
+        connect(fanOutRunner, &FanOutRunner::finished, this, &QueryForm::handleFanOutFinished);
+    }
+
+    clearResultTabs();
+    inExecution = true;
+    runButton->setEnabled(false);
+    stopButton->setEnabled(true);
+    fanOutSql = sql;
+    fanOutDb = dbCombo->currentText().trimmed();
+    fanOutTotal = targets.size();
+    fanOutDone = 0;
+    resultForm->showMessage(tr("Running on %1 connections...").arg(fanOutTotal));
+    showStatus(tr("Running on %1 connections...").arg(fanOutTotal), 0);
+    fanOutRunner->start(targets, fanOutDb, sql, dlg.concurrency(), kFanOutRowLimit);
+}
+
+void QueryForm::handleFanOutShard(const FanOutShardResult &result)
+{
+    ++fanOutDone;
+    QueryHistoryEntry history;
+    history.sql = fanOutSql;
+    history.connName = result.connName;
+    history.dbName = fanOutDb;
+    history.serverMs = result.elapsedMs;
+    history.rows = result.isSelect ? result.rows.size() : qMax<qint64>(0, result.affectedRows);
+    history.error = result.error;
+    QueryHistory::instance()->record(history);
+
+    if(!result.error.isEmpty()){
+        messageLog->appendPlainText(tr("[%1]  %2 ms  Error: %3")
+                                    .arg(result.connName)
+                                    .arg(result.elapsedMs)
+                                    .arg(result.error));
+    }else if(result.isSelect){
+        // Prefix each row with the connection it came from
+        QStringList headers;
+        headers << tr("Connection") << result.headers;
+        QList<QVariantList> rows;
+        rows.reserve(result.rows.size());
+        for(const QVariantList &row : result.rows){
+            QVariantList tagged;
+            tagged.reserve(row.size() + 1);
+            tagged << result.connName;
+            tagged += row;
+            rows << tagged;
+        }
+        resultForm->appendRows(headers, rows, tr("Connections: %1/%2").arg(fanOutDone).arg(fanOutTotal));
+        messageLog->appendPlainText(tr("[%1]  %2 ms  Rows: %3%4")
+                                    .arg(result.connName)
+                                    .arg(result.elapsedMs)
+                                    .arg(result.rows.size())
+                                    .arg(result.truncated ? tr(" (truncated)") : QString()));
+    }else{
+        messageLog->appendPlainText(tr("[%1]  %2 ms  Affected rows: %3")
+                                    .arg(result.connName)
+                                    .arg(result.elapsedMs)
+                                    .arg(result.affectedRows));
+    }
+    showStatus(tr("Connections finished: %1/%2").arg(fanOutDone).arg(fanOutTotal), 0);
+}
+
+void QueryForm::handleFanOutFinished(int succeeded, int failed, qint64 elapsedMs)
+{
+    const QString summary = tr("Connections: %1, Succeeded: %2, Failed: %3, Time: %4 ms")
+            .arg(succeeded + failed)
+            .arg(succeeded)
+            .arg(failed)
+            .arg(elapsedMs);
+    messageLog->appendPlainText(summary);
+    showStatus(summary, 7000);
+    if(resultForm->headers().isEmpty()){
+        resultForm->showMessage(summary);
+        resultTabs->setCurrentWidget(failed > 0 ? static_cast<QWidget*>(messageLog) : resultForm);
+    }
+    inExecution = false;
+    runButton->setEnabled(true);
+    stopButton->setEnabled(false);
+}
+
+void QueryForm::explainStatement(const SqlStatement &statement, bool analyze)
+{
+    static const QRegularExpression explainPrefix(QStringLiteral("^(EXPLAIN|DESCRIBE|DESC)\\b"),
+                                                  QRegularExpression::CaseInsensitiveOption);
+    if(explainPrefix.match(statement.text).hasMatch()){
+        // The user wrote EXPLAIN themselves; run it as a plain statement
+        executeStatements({statement});
+        return;
+    }
+
+    ConnectionInfo info = currentConnectionInfo();
+    if(info.name.isEmpty()){
+        resultForm->showMessage(tr("Please select or create a connection."));
+        return;
+    }
+    QString dbName = dbCombo->currentText().trimmed();
+    if(dbName.isEmpty()){
+        dbName = info.defaultDb;
+    }
+
+    clearResultTabs();
+    inExecution = true;
+    runButton->setEnabled(false);
+    showStatus(tr("Explaining on %1...").arg(info.name), 0);
+    ScopedJob job(QStringLiteral("explain"), jobTitle(statement.text), {info.name});
+
+    bool fallbackToGrid = false;
+    const QString connId = QStringLiteral("explain_%1_%2")
+            .arg(info.name)
+            .arg(QDateTime::currentMSecsSinceEpoch());
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
+        QString endpointError;
+        const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
+        db.setUserName(info.user);
+        db.setPassword(info.password);
+        db.setConnectOptions(ConnectionManager::connectOptions(info));
+        if(!dbName.isEmpty()){
+            db.setDatabaseName(dbName);
+        }
+
+        if(!endpointOk || !db.open()){
+            resultForm->showMessage(tr("Unable to connect: %1").arg(endpointOk ? db.lastError().text() : endpointError));
+            showStatus(tr("Connection failed."), 5000);
+        }else{
+            QSqlQuery query(db);
+            QString version;
+            if(query.exec(QStringLiteral("SELECT VERSION()")) && query.next()){
+                version = query.value(0).toString();
+            }
+            const bool isMariaDb = version.contains(QLatin1String("MariaDB"), Qt::CaseInsensitive);
+            bool useAnalyze = analyze;
+            if(analyze && (isMariaDb || !serverVersionAtLeast(version, 8, 0, 18))){
+                appendExecutionMessage(0, statement,
+                                       tr("EXPLAIN ANALYZE requires MySQL 8.0.18 or later (server %1), "
+                                          "showing the estimated plan instead.").arg(version), 0);
+                useAnalyze = false;
+            }
+            if(!useAnalyze && !isMariaDb && !serverVersionAtLeast(version, 5, 6, 5)){
+                // FORMAT=JSON needs 5.6.5; older servers fall back to the tabular form
+                fallbackToGrid = true;
+            }else{
+                QElapsedTimer timer;
+                timer.start();
+                const QString sql = (useAnalyze ? QStringLiteral("EXPLAIN ANALYZE ")
+                                                : QStringLiteral("EXPLAIN FORMAT=JSON ")) + statement.text;
+                if(!query.exec(sql) || !query.next()){
+                    const QString error = query.lastError().text();
+                    resultForm->showMessage(tr("Explain failed: %1").arg(error));
+                    appendExecutionMessage(0, statement, tr("Error: %1").arg(error), timer.elapsed());
+                    showStatus(tr("Explain failed."), 5000);
+                }else{
+                    const QString plan = query.value(0).toString();
+                    QString parseError;
+                    bool parsed = true;
+                    if(useAnalyze){
+                        planView->showAnalyzePlan(plan);
+                    }else{
+                        parsed = planView->showJsonPlan(plan, &parseError);
+                    }
+                    if(parsed){
+                        resultTabs->insertTab(0, planView, QIcon(QStringLiteral(":/images/info.svg")), tr("Plan"));
+                        resultTabs->setCurrentWidget(planView);
+                        resultForm->showMessage(tr("See the Plan tab."));
+                        appendExecutionMessage(0, statement,
+                                               useAnalyze ? tr("EXPLAIN ANALYZE finished") : tr("Plan ready"),
+                                               timer.elapsed());
+                        showStatus(tr("Explain finished, Time: %1 ms").arg(timer.elapsed()), 7000);
+                    }else{
+                        resultForm->showMessage(tr("Unable to parse plan: %1").arg(parseError));
+                        showStatus(tr("Explain failed."), 5000);
+                    }
+                }
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connId);
+
+    inExecution = false;
+    runButton->setEnabled(true);
+
+    if(fallbackToGrid){
+        SqlStatement plain = statement;
+        plain.text.prepend(QStringLiteral("EXPLAIN "));
+        executeStatements({plain});
+    }
+}
+
+void QueryForm::executeStatements(const QList<SqlStatement> &statements)
+{
+    if(inExecution){
+        return;
+    }
+    if(statements.isEmpty()){
         resultForm->showMessage(tr("Input SQL statement first."));
         return;
     }
+    static const QRegularExpression browsablePrefix(QStringLiteral("^\\(*\\s*(SELECT|WITH|TABLE)\\b"),
+                                                    QRegularExpression::CaseInsensitiveOption);
+    const bool binaryProtocol = binaryCheck && binaryCheck->isChecked();
+    if(browseCheck && browseCheck->isChecked() && statements.size() == 1
+            && isReadOnlyQuery(statements.first().text)){
+        browseStatement(statements.first());
+        return;
+    }
 
     ConnectionInfo info = currentConnectionInfo();
     if(info.name.isEmpty()){
@@ -332,73 +810,427 @@ void QueryForm::runQuery()
         dbName = info.defaultDb;
     }
 
+    clearResultTabs();
     inExecution = true;
     runButton->setEnabled(false);
     stopButton->setEnabled(false);
     showStatus(tr("Executing on %1...").arg(info.name), 0);
+    ScopedJob job(QStringLiteral("query"), jobTitle(statements.first().text), {info.name});
 
-    const QString connId = QStringLiteral("exec_%1_%2")
-            .arg(info.name)
-            .arg(QDateTime::currentMSecsSinceEpoch());
-    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
-    db.setUserName(info.user);
-    db.setPassword(info.password);
-    if(!dbName.isEmpty()){
-        db.setDatabaseName(dbName);
+    {
+        // Prefer a warmed session, which skips the handshake and setup
+        QString openError;
+        QSqlDatabase db = SessionPool::instance()->acquire(info, dbName, &openError);
+        if(!db.isValid()){
+            resultForm->showMessage(tr("Unable to connect: %1").arg(openError));
+            showStatus(tr("Connection failed."), 5000);
+        }else{
+            const bool continueOnError = continueOnErrorCheck && continueOnErrorCheck->isChecked();
+            const bool single = statements.size() == 1;
+            int resultSets = 0;
+            int executed = 0;
+            int failed = 0;
+            qint64 lastElapsed = 0;
+            int lastAffected = 0;
+            QString lastError;
+            QElapsedTimer total;
+            total.start();
+
+            // In profile mode, collect server metrics on the same session
+            QScopedPointer<QueryProfiler> profiler;
+            QList<StatementProfile> profiles;
+            if(profileCheck && profileCheck->isChecked()){
+                profiler.reset(new QueryProfiler(db));
+                profiler->begin();
+            }
+
+            // Traffic delta of the session, compressed bytes when compression is on.
+            // Reading the status resets FOUND_ROWS() and similar session state, so it is
+            // sampled per statement only for a single statement or in profile mode,
+            // otherwise once per batch
+            WireCounters wireMark;
+            const bool wireStats = readWireCounters(db, &wireMark);
+            const bool wirePerStatement = single || !profiler.isNull();
+            WireCounters wireTotal;
+            qint64 roundTripsTotal = 0;
+            auto takeWireStats = [&](QueryHistoryEntry &entry, qint64 roundTripsBefore) {
+                entry.roundTrips = driverRoundTrips(db) - roundTripsBefore;
+                roundTripsTotal += entry.roundTrips;
+                WireCounters now;
+                if(wireStats && wirePerStatement && readWireCounters(db, &now)){
+                    entry.wireReceived = now.received - wireMark.received;
+                    entry.wireSent = now.sent - wireMark.sent;
+                    wireTotal.received += entry.wireReceived;
+                    wireTotal.sent += entry.wireSent;
+                    wireMark = now;
+                }
+            };
+
+            QSqlQuery query(db);
+            for(int i = 0; i < statements.size(); ++i){
+                const SqlStatement &statement = statements.at(i);
+                if(!single){
+                    showStatus(tr("Executing statement %1/%2...").arg(i + 1).arg(statements.size()), 0);
+                    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+                }
+                QueryHistoryEntry history;
+                history.sql = statement.text;
+                history.connName = info.name;
+                history.dbName = dbName;
+                history.startedAt = QDateTime::currentDateTime();
+                if(profiler){
+                    profiler->beforeStatement();
+                }
+                const qint64 roundTripsBefore = driverRoundTrips(db);
+                QElapsedTimer timer;
+                timer.start();
+                ++executed;
+                bool ok = false;
+                // Binary protocol: prepare, then execute so numbers and dates decode as
+                // native types; statements the server cannot prepare fall back to the
+                // text protocol
+                if(binaryProtocol && browsablePrefix.match(statement.text).hasMatch() && query.prepare(statement.text)){
+                    ok = query.exec();
+                }else{
+                    ok = query.exec(statement.text);
+                }
+                if(!ok){
+                    ++failed;
+                    lastError = query.lastError().text();
+                    history.serverMs = timer.elapsed();
+                    history.error = lastError;
+                    takeWireStats(history, roundTripsBefore);
+                    QueryHistory::instance()->record(history);
+                    if(profiler){
+                        profiles << profiler->afterStatement(i, statement.text, history.serverMs);
+                    }
+                    appendExecutionMessage(i, statement, tr("Error: %1").arg(lastError), timer.elapsed());
+                    if(!continueOnError){
+                        break;
+                    }
+                    continue;
+                }
+                history.serverMs = timer.elapsed();
+                QElapsedTimer fetchTimer;
+                fetchTimer.start();
+                // A statement may return several result sets (stored procedures and the
+                // like); fetch each one
+                do{
+                    if(query.isSelect()){
+                        ResultForm *form = resultFormAt(resultSets++);
+                        int rowCount = 0;
+                        if(form){
+                            QStringList headers;
+                            QVector<int> columnTypes;
+                            const auto record = query.record();
+                            for(int col = 0; col < record.count(); ++col){
+                                headers << record.fieldName(col);
+                                columnTypes << static_cast<int>(record.field(col).type());
+                            }
+                            // Past the memory budget the remaining rows go to a temporary
+                            // file and are read back as the grid scrolls to them
+                            QList<QVariantList> rows;
+                            std::unique_ptr<ResultSpill> spill;
+                            qint64 budget = ResultSpill::memoryBudget();
+                            qint64 resultBytes = 0;
+                            QString spillError;
+                            while(query.next()){
+                                QVariantList row;
+                                row.reserve(record.count());
+                                for(int col = 0; col < record.count(); ++col){
+                                    const QVariant value = query.value(col);
+                                    history.bytes += estimateValueBytes(value);
+                                    row << value;
+                                }
+                                if(spill){
+                                    if(!spill->append(row, &spillError)){
+                                        break;
+                                    }
+                                    continue;
+                                }
+                                rows << row;
+                                resultBytes += ResultSpill::rowFootprint(row);
+                                if(budget > 0 && resultBytes > budget){
+                                    spill.reset(new ResultSpill);
+                                    if(!spill->open(record.count(), &spillError)){
+                                        // Without a temporary file keep everything in memory as before
+                                        spill.reset();
+                                        budget = 0;
+                                    }
+                                }
+                            }
+                            bool truncated = spill && !spillError.isEmpty();
+                            if(spill && !spill->finish(spillError.isEmpty() ? &spillError : nullptr)){
+                                // The temporary file failed; show only the rows kept in memory
+                                spill.reset();
+                                truncated = true;
+                            }
+                            if(!spillError.isEmpty()){
+                                appendExecutionMessage(i, statement,
+                                                       truncated ? tr("Result truncated: %1").arg(spillError)
+                                                                 : tr("Result kept in memory: %1").arg(spillError),
+                                                       timer.elapsed());
+                            }
+                            const QString note = truncated ? tr("Result truncated") : QString();
+                            if(spill && spill->rowCount() > 0){
+                                rowCount = rows.count() + spill->rowCount();
+                                form->showSpilledRows(headers, rows, std::move(spill), timer.elapsed(), note, columnTypes);
+                            }else{
+                                rowCount = rows.count();
+                                form->showRows(headers, rows, timer.elapsed(), note, false, columnTypes);
+                            }
+                        }else{
+                            rowCount = query.size();
+                        }
+                        history.rows += rowCount;
+                        appendExecutionMessage(i, statement,
+                                               form ? tr("Rows: %1").arg(rowCount)
+                                                    : tr("Rows: %1 (result tab limit reached)").arg(rowCount),
+                                               timer.elapsed());
+                    }else{
+                        lastAffected = query.numRowsAffected();
+                        history.rows += qMax(0, lastAffected);
+                        appendExecutionMessage(i, statement, tr("Affected rows: %1").arg(lastAffected), timer.elapsed());
+                    }
+                    lastElapsed = timer.elapsed();
+                    timer.restart();
+                }while(query.nextResult());
+                history.fetchMs = fetchTimer.elapsed();
+                // A later result set can fail (e.g. a procedure erroring midway);
+                // nextResult() then returns false and leaves the error behind
+                const QSqlError fetchError = query.lastError();
+                if(fetchError.isValid()){
+                    ++failed;
+                    lastError = fetchError.text();
+                    history.error = lastError;
+                    appendExecutionMessage(i, statement, tr("Error: %1").arg(lastError), timer.elapsed());
+                }
+                takeWireStats(history, roundTripsBefore);
+                QueryHistory::instance()->record(history);
+                if(profiler){
+                    profiles << profiler->afterStatement(i, statement.text, history.serverMs + history.fetchMs);
+                }
+                if(fetchError.isValid() && !continueOnError){
+                    break;
+                }
+            }
+            if(profiler){
+                profiler->end();
+                profilePanel->showProfiles(profiles, profiler->notes());
+                resultTabs->insertTab(resultTabs->indexOf(messageLog), profilePanel,
+                                      QIcon(QStringLiteral(":/images/info.svg")), tr("Profile"));
+            }
+            const qint64 totalElapsed = total.elapsed();
+            WireCounters wireEnd;
+            if(wireStats && !wirePerStatement && readWireCounters(db, &wireEnd)){
+                wireTotal.received = wireEnd.received - wireMark.received;
+                wireTotal.sent = wireEnd.sent - wireMark.sent;
+            }
+            const QString wireSummary = wireStats
+                    ? tr(", Received: %1, Sent: %2, Round trips: %3")
+                      .arg(formatBytes(wireTotal.received), formatBytes(wireTotal.sent))
+                      .arg(roundTripsTotal)
+                    : QString();
+
+            if(single && failed > 0){
+                resultForm->showMessage(tr("Query failed: %1").arg(lastError));
+                showStatus(tr("Query failed."), 5000);
+            }else if(single && resultSets == 0){
+                resultForm->showAffectRows(lastAffected, lastElapsed);
+                showStatus(tr("Affected rows: %1, Time: %2 ms").arg(lastAffected).arg(lastElapsed) + wireSummary, 7000);
+            }else{
+                const QString summary = tr("Statements: %1/%2, Failed: %3, Time: %4 ms")
+                        .arg(executed)
+                        .arg(statements.size())
+                        .arg(failed)
+                        .arg(totalElapsed);
+                if(resultSets == 0){
+                    resultForm->showMessage(summary);
+                }
+                showStatus(summary + wireSummary, 7000);
+            }
+            if(failed > 0 && !single){
+                resultTabs->setCurrentWidget(messageLog);
+            }else{
+                resultTabs->setCurrentWidget(resultForm);
+            }
+        }
+        // The statements may have changed session variables, temporary tables or the
+        // transaction, so a used session does not go back to the pool
+        SessionPool::instance()->discard(db);
     }
+    SessionPool::instance()->prewarm(info);
 
-    if(!db.open()){
-        resultForm->showMessage(tr("Unable to connect: %1").arg(db.lastError().text()));
-        showStatus(tr("Connection failed."), 5000);
-        inExecution = false;
-        runButton->setEnabled(true);
-        stopButton->setEnabled(false);
-        QSqlDatabase::removeDatabase(connId);
+    inExecution = false;
+    runButton->setEnabled(true);
+    stopButton->setEnabled(false);
+}
+
+void QueryForm::browseStatement(const SqlStatement &statement)
+{
+    ConnectionInfo info = currentConnectionInfo();
+    if(info.name.isEmpty()){
+        resultForm->showMessage(tr("Please select or create a connection."));
         return;
     }
+    QString dbName = dbCombo->currentText().trimmed();
+    if(dbName.isEmpty()){
+        dbName = info.defaultDb;
+    }
+
+    clearResultTabs();
+    inExecution = true;
+    runButton->setEnabled(false);
+    showStatus(tr("Opening cursor on %1...").arg(info.name), 0);
+    if(!cursorBrowser){
+        cursorBrowser = new CursorBrowser;
+    }
 
+    QueryHistoryEntry history;
+    history.sql = statement.text;
+    history.connName = info.name;
+    history.dbName = dbName;
+    history.startedAt = QDateTime::currentDateTime();
     QElapsedTimer timer;
     timer.start();
-    QSqlQuery query(db);
-    if(!query.exec(sql)){
-        resultForm->showMessage(tr("Query failed: %1").arg(query.lastError().text()));
+    QString error;
+    bool opened = false;
+    QList<QVariantList> rows;
+    {
+        ScopedJob job(QStringLiteral("query"), jobTitle(statement.text), {info.name});
+        opened = cursorBrowser->open(info, dbName, statement.text, kBrowseWindowRows, &error);
+        history.serverMs = timer.elapsed();
+        if(opened){
+            timer.restart();
+            rows = cursorBrowser->fetchWindow(&error);
+            history.fetchMs = timer.elapsed();
+        }
+        if(!error.isEmpty()){
+            job.fail(error);
+        }
+    }
+
+    if(!opened){
+        history.error = error;
+        appendExecutionMessage(0, statement, tr("Error: %1").arg(error), history.serverMs);
+        resultForm->showMessage(tr("Query failed: %1").arg(error));
         showStatus(tr("Query failed."), 5000);
     }else{
-        qint64 elapsed = timer.elapsed();
-        if(query.isSelect()){
-            QStringList headers;
-            const auto record = query.record();
-            for(int i = 0; i < record.count(); ++i){
-                headers << record.fieldName(i);
+        history.rows = rows.size();
+        for(const QVariantList &row : qAsConst(rows)){
+            for(const QVariant &value : row){
+                history.bytes += estimateValueBytes(value);
             }
-            QList<QVariantList> rows;
-            while(query.next()){
-                QVariantList row;
-                for(int col = 0; col < record.count(); ++col){
-                    row << query.value(col);
-                }
-                rows << row;
-            }
-            resultForm->showRows(headers, rows, elapsed);
-            showStatus(tr("Rows: %1, Time: %2 ms").arg(rows.count()).arg(elapsed), 7000);
-        }else{
-            const int affected = query.numRowsAffected();
-            resultForm->showAffectRows(affected, elapsed);
-            showStatus(tr("Affected rows: %1, Time: %2 ms").arg(affected).arg(elapsed), 7000);
         }
-    }
-    db.close();
-    QSqlDatabase::removeDatabase(connId);
+        const QString note = cursorBrowser->atEnd()
+                ? QString()
+                : tr("More rows on the server, scroll down to fetch");
+        resultForm->showRows(cursorBrowser->headers(), rows, history.serverMs + history.fetchMs, note);
+        resultForm->setCanFetchMore(!cursorBrowser->atEnd());
+        appendExecutionMessage(0, statement,
+                               cursorBrowser->usesServerCursor()
+                               ? tr("Rows: %1 (server-side cursor)").arg(rows.size())
+                               : tr("Rows: %1 (server-side cursor unavailable, result stored on the client)").arg(rows.size()),
+                               history.serverMs + history.fetchMs);
+        showStatus(tr("Cursor opened, Time: %1 ms").arg(history.serverMs + history.fetchMs), 7000);
+        resultTabs->setCurrentWidget(resultForm);
+    }
+    QueryHistory::instance()->record(history);
 
     inExecution = false;
     runButton->setEnabled(true);
-    stopButton->setEnabled(false);
+}
+
+void QueryForm::fetchBrowseWindow()
+{
+    if(inExecution || !cursorBrowser || !cursorBrowser->isOpen()){
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    const QList<QVariantList> rows = cursorBrowser->fetchWindow(&error);
+    const QString note = cursorBrowser->atEnd()
+            ? tr("All rows fetched")
+            : tr("More rows on the server, scroll down to fetch");
+    resultForm->appendRows(cursorBrowser->headers(), rows, note, kBrowseKeptWindows * kBrowseWindowRows);
+    resultForm->setCanFetchMore(!cursorBrowser->atEnd());
+    if(!error.isEmpty()){
+        showStatus(tr("Fetch failed: %1").arg(error), 5000);
+    }else{
+        showStatus(tr("Fetched %1 rows (%2 total), Time: %3 ms")
+                   .arg(rows.size())
+                   .arg(cursorBrowser->fetchedRows())
+                   .arg(timer.elapsed()), 3000);
+    }
+}
+
+void QueryForm::clearResultTabs()
+{
+    // A new execution closes the cursor session the last browse left open
+    if(cursorBrowser){
+        cursorBrowser->close();
+    }
+    for(ResultForm *form : qAsConst(extraResultForms)){
+        resultTabs->removeTab(resultTabs->indexOf(form));
+        form->deleteLater();
+    }
+    extraResultForms.clear();
+    // Plan and profile tabs are rebuilt by the next execution
+    const QList<QWidget*> optionalPages = {planView, profilePanel};
+    for(QWidget *page : optionalPages){
+        const int index = resultTabs->indexOf(page);
+        if(index >= 0){
+            resultTabs->removeTab(index);
+        }
+    }
+    messageLog->clear();
+    resultForm->reset();
+}
+
+ResultForm *QueryForm::resultFormAt(int index)
+{
+    if(index == 0){
+        return resultForm;
+    }
+    if(index >= kMaxResultTabs){
+        return nullptr;
+    }
+    while(extraResultForms.size() < index){
+        auto *form = new ResultForm(resultTabs);
+        form->setToolbarVisible(false);
+        connect(form, &ResultForm::summaryChanged, this, [this](const QString &text) {
+            emit requestStatusMessage(text, 0);
+        });
+        extraResultForms << form;
+        resultTabs->insertTab(resultTabs->indexOf(messageLog), form,
+                              tr("Result %1").arg(extraResultForms.size() + 1));
+    }
+    return extraResultForms.at(index - 1);
+}
+
+void QueryForm::appendExecutionMessage(int index, const SqlStatement &statement,
+                                       const QString &text, qint64 elapsedMs)
+{
+    QString preview = statement.text.simplified();
+    if(preview.size() > 80){
+        preview = preview.left(77) + QStringLiteral("...");
+    }
+    messageLog->appendPlainText(tr("[%1] Line %2  %3 ms  %4\n    %5")
+                                .arg(index + 1)
+                                .arg(statement.line)
+                                .arg(elapsedMs)
+                                .arg(text, preview));
 }
 
 void QueryForm::stopQuery()
 {
+    if(fanOutRunner && fanOutRunner->isRunning()){
+        fanOutRunner->cancel();
+        showStatus(tr("Cancelling the remaining connections..."), 0);
+        stopButton->setEnabled(false);
+        return;
+    }
     emit requestStatusMessage(tr("Stop is not available for synchronous execution."), 2000);
     runButton->setEnabled(true);
     stopButton->setEnabled(false);
@@ -441,6 +1273,10 @@ void QueryForm::initialiseUi()
     pageStack->setCurrentWidget(queryPage);
 
     connect(runButton, &QToolButton::clicked, this, &QueryForm::runQuery);
+    connect(runCurrentButton, &QToolButton::clicked, this, &QueryForm::runCurrentStatement);
+    connect(explainButton, &QToolButton::clicked, this, &QueryForm::explainCurrentStatement);
+    connect(runOnConnectionsButton, &QToolButton::clicked, this, &QueryForm::runOnConnections);
+    connect(textEdit, &MyEdit::searchTriggered, this, &QueryForm::runCurrentStatement);
     connect(stopButton, &QToolButton::clicked, this, &QueryForm::stopQuery);
     connect(formatButton, &QToolButton::clicked, this, &QueryForm::formatSql);
     connect(textEdit, &QPlainTextEdit::cursorPositionChanged, this, &QueryForm::updateTitleFromEditor);
@@ -473,6 +1309,32 @@ QWidget *QueryForm::buildQueryPage()
     runButton->setMinimumSize(36, 36);
     runButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
 
+    runCurrentButton = new QToolButton(page);
+    runCurrentButton->setToolTip(tr("Execute Current Statement (Ctrl+Enter)"));
+    runCurrentButton->setIcon(QIcon(QStringLiteral(":/images/query.svg")));
+    runCurrentButton->setIconSize(QSize(24, 24));
+    runCurrentButton->setMinimumSize(36, 36);
+    runCurrentButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
+
+    explainButton = new QToolButton(page);
+    explainButton->setToolTip(tr("Explain Current Statement"));
+    explainButton->setIcon(QIcon(QStringLiteral(":/images/info.svg")));
+    explainButton->setIconSize(QSize(24, 24));
+    explainButton->setMinimumSize(36, 36);
+    explainButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
+    explainButton->setPopupMode(QToolButton::MenuButtonPopup);
+    auto *explainMenu = new QMenu(explainButton);
+    explainMenu->addAction(tr("Explain (estimated plan)"), this, &QueryForm::explainCurrentStatement);
+    explainMenu->addAction(tr("Explain Analyze (executes the statement)"), this, &QueryForm::explainAnalyzeCurrentStatement);
+    explainButton->setMenu(explainMenu);
+
+    runOnConnectionsButton = new QToolButton(page);
+    runOnConnectionsButton->setToolTip(tr("Run on Connections..."));
+    runOnConnectionsButton->setIcon(QIcon(QStringLiteral(":/images/connection.svg")));
+    runOnConnectionsButton->setIconSize(QSize(24, 24));
+    runOnConnectionsButton->setMinimumSize(36, 36);
+    runOnConnectionsButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
+
     stopButton = new QToolButton(page);
     stopButton->setToolTip(tr("Stop Query"));
     stopButton->setIcon(QIcon(QStringLiteral(":/images/stop.svg")));
@@ -484,6 +1346,33 @@ QWidget *QueryForm::buildQueryPage()
     autoCommitCheck = new QCheckBox(tr("AutoCommit"), page);
     autoCommitCheck->setChecked(true);
 
+    continueOnErrorCheck = new QCheckBox(tr("Continue on error"), page);
+    continueOnErrorCheck->setToolTip(tr("Keep executing the remaining statements when one fails"));
+
+    profileCheck = new QCheckBox(tr("Profile"), page);
+    profileCheck->setToolTip(tr("Collect server-side statistics for each statement "
+                                "(performance_schema, SHOW PROFILE and session status)"));
+
+    binaryCheck = new QCheckBox(tr("Binary"), page);
+    binaryCheck->setToolTip(tr("Run SELECTs through the binary protocol so numbers and dates "
+                               "arrive in native form instead of as text"));
+
+    browseCheck = new QCheckBox(tr("Browse"), page);
+    browseCheck->setToolTip(tr("Run a single SELECT as a server-side cursor and fetch more rows "
+                               "as you scroll, instead of loading the whole result"));
+
+    memoryBudgetSpin = new QSpinBox(page);
+    memoryBudgetSpin->setRange(0, 1024 * 1024);
+    memoryBudgetSpin->setSingleStep(64);
+    memoryBudgetSpin->setSuffix(tr(" MB"));
+    memoryBudgetSpin->setSpecialValueText(tr("No memory limit"));
+    memoryBudgetSpin->setValue(int(ResultSpill::memoryBudget() / (1024 * 1024)));
+    memoryBudgetSpin->setToolTip(tr("Memory kept for each result set; rows beyond it are written to "
+                                    "a temporary file and read back as you scroll"));
+    connect(memoryBudgetSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int megabytes) {
+        ResultSpill::setMemoryBudget(qint64(megabytes) * 1024 * 1024);
+    });
+
     formatButton = new QToolButton(page);
     formatButton->setToolTip(tr("Format SQL"));
     formatButton->setIcon(QIcon(QStringLiteral(":/images/format.svg")));
@@ -501,10 +1390,18 @@ QWidget *QueryForm::buildQueryPage()
     toolbar->addWidget(dbCombo, 1);
     toolbar->addSpacing(8);
     toolbar->addWidget(runButton);
+    toolbar->addWidget(runCurrentButton);
+    toolbar->addWidget(explainButton);
+    toolbar->addWidget(runOnConnectionsButton);
     toolbar->addWidget(stopButton);
     toolbar->addWidget(formatButton);
     toolbar->addSpacing(8);
     toolbar->addWidget(autoCommitCheck);
+    toolbar->addWidget(continueOnErrorCheck);
+    toolbar->addWidget(profileCheck);
+    toolbar->addWidget(binaryCheck);
+    toolbar->addWidget(browseCheck);
+    toolbar->addWidget(memoryBudgetSpin);
     toolbar->addStretch();
 
     layout->addLayout(toolbar);
@@ -512,14 +1409,28 @@ QWidget *QueryForm::buildQueryPage()
     auto *splitter = new QSplitter(Qt::Vertical, page);
     textEdit = new MyEdit(splitter);
     textEdit->setPlaceholderText(tr("-- Type SQL here"));
+    textEdit->setStatementHighlightEnabled(true);
 
-    resultForm = new ResultForm(splitter);
+    resultTabs = new QTabWidget(splitter);
+    resultTabs->setDocumentMode(true);
+    resultForm = new ResultForm(resultTabs);
     resultForm->setToolbarVisible(false);
     connect(resultForm, &ResultForm::summaryChanged, this, [this](const QString &text) {
         emit requestStatusMessage(text, 0);
     });
+    connect(resultForm, &ResultForm::fetchMoreRequested, this, &QueryForm::fetchBrowseWindow);
+    messageLog = new QPlainTextEdit(resultTabs);
+    messageLog->setReadOnly(true);
+    messageLog->setLineWrapMode(QPlainTextEdit::NoWrap);
+    resultTabs->addTab(resultForm, tr("Result 1"));
+    resultTabs->addTab(messageLog, tr("Messages"));
+    // The plan tab is only inserted for Explain
+    planView = new ExplainPlanView(resultTabs);
+    planView->hide();
+    profilePanel = new QueryProfilePanel(resultTabs);
+    profilePanel->hide();
     splitter->addWidget(textEdit);
-    splitter->addWidget(resultForm);
+    splitter->addWidget(resultTabs);
     splitter->setStretchFactor(0, 3);
     splitter->setStretchFactor(1, 2);
 
@@ -694,7 +1605,17 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     pane->sortDescButton->setIconSize(QSize(28, 28));
     pane->sortDescButton->setMinimumSize(40, 40);
     pane->filterEdit = new QLineEdit(pane->dataPage);
-    pane->filterEdit->setPlaceholderText(tr("搜索当前页"));
+    pane->filterEdit->setPlaceholderText(tr("搜索全表"));
+    pane->filterEdit->setClearButtonEnabled(true);
+    pane->searchColumnsButton = new QToolButton(pane->dataPage);
+    pane->searchColumnsButton->setText(tr("搜索列"));
+    pane->searchColumnsButton->setToolTip(tr("选择参与搜索的列"));
+    pane->searchColumnsButton->setPopupMode(QToolButton::InstantPopup);
+    pane->searchColumnsButton->setMenu(new QMenu(pane->searchColumnsButton));
+    pane->searchColumnsButton->setEnabled(false);
+    pane->searchTimer = new QTimer(pane->dataPage);
+    pane->searchTimer->setSingleShot(true);
+    pane->searchTimer->setInterval(kInspectSearchDelayMs);
     pane->whereSearchButton = new QToolButton(pane->dataPage);
     pane->whereSearchButton->setIcon(QIcon(QStringLiteral(":/images/filter.svg")));
     pane->whereSearchButton->setIconSize(QSize(28, 28));
@@ -721,9 +1642,10 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     dataToolbar->addWidget(pane->sortAscButton);
     dataToolbar->addWidget(pane->sortDescButton);
     dataToolbar->addStretch(1);
-    dataToolbar->addWidget(new QLabel(tr("页内搜索:"), pane->dataPage));
+    dataToolbar->addWidget(new QLabel(tr("搜索:"), pane->dataPage));
     pane->filterEdit->setMinimumWidth(400);
     dataToolbar->addWidget(pane->filterEdit);
+    dataToolbar->addWidget(pane->searchColumnsButton);
     dataLayout->addLayout(dataToolbar);
 
     auto *whereLayout = new QHBoxLayout();
@@ -743,6 +1665,9 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     dataLayout->addWidget(whereContainer);
 
     pane->resultForm = new ResultForm(pane->dataPage);
+    pane->resultForm->setValueLoader([this, pane](int column, const QList<int> &sourceRows) {
+        return loadFullCellValues(pane, column, sourceRows);
+    });
     pane->resultForm->setToolbarVisible(false);
     pane->resultForm->setSelectionBehavior(QAbstractItemView::SelectRows);
     pane->resultForm->setSelectionMode(QAbstractItemView::ExtendedSelection);
@@ -1059,6 +1984,7 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     });
     connect(pane->refreshButton, &QToolButton::clicked, this, [this, pane]() {
         pane->dataOffset = 0; // Reset to first page on refresh
+        invalidateInspectPages(pane);
         refreshInspectData(pane);
     });
     if(pane->addRowButton){
@@ -1083,6 +2009,7 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     }
     if(pane->discardRowsButton){
         connect(pane->discardRowsButton, &QToolButton::clicked, this, [this, pane]() {
+            invalidateInspectPages(pane);
             refreshInspectData(pane);
         });
     }
@@ -1233,10 +2160,13 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
             }
         });
     }
-    connect(pane->filterEdit, &QLineEdit::textChanged, this, [pane](const QString &text) {
-        if(pane->resultForm){
-            pane->resultForm->setFilterText(text);
-        }
+    connect(pane->filterEdit, &QLineEdit::textChanged, pane->searchTimer, qOverload<>(&QTimer::start));
+    connect(pane->filterEdit, &QLineEdit::returnPressed, this, [this, pane]() {
+        pane->searchTimer->stop();
+        applyInspectSearch(pane);
+    });
+    connect(pane->searchTimer, &QTimer::timeout, this, [this, pane]() {
+        applyInspectSearch(pane);
     });
     connect(pane->whereSearchButton, &QToolButton::toggled, this, [this, pane](bool checked) {
         if(auto *container = pane->whereEdit->parentWidget()){
@@ -1272,7 +2202,7 @@ QueryForm::InspectPane *QueryForm::createInspectPane(const QString &connName,
     }
     if(pane->sortCombo){
         connect(pane->sortCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this, pane](int) {
-            applyInspectSort(pane, Qt::AscendingOrder);
+            applyInspectSort(pane, pane->orderDirection);
         });
     }
     if(pane->sortAscButton){
@@ -1530,12 +2460,13 @@ void QueryForm::updateCompletionList()
     QString connHandle = QStringLiteral("completion_%1").arg(quintptr(this), 0, 16);
     {
         QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connHandle);
-        db.setHostName(info.host);
-        db.setPort(info.port);
+        QString endpointError;
+        const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
         db.setUserName(info.user);
         db.setPassword(info.password);
+        db.setConnectOptions(ConnectionManager::connectOptions(info));
         db.setDatabaseName(dbName);
-        if(db.open()){
+        if(endpointOk && db.open()){
             QSqlQuery query(db);
             if(query.exec(QStringLiteral("SHOW TABLES"))){
                 while(query.next()){
@@ -1610,7 +2541,19 @@ void QueryForm::enterInspectMode(const QString &connName,
     pane->subtitleLabel->setText(dbName.isEmpty()
                                  ? tr("数据库未指定")
                                  : tr("数据库: %1").arg(dbName));
+    // Sort, search and index details do not carry over to another table
+    pane->orderColumn.clear();
+    pane->orderDirection = Qt::AscendingOrder;
+    pane->searchText.clear();
+    pane->searchColumns.clear();
+    pane->keyColumns.clear();
+    pane->indexedColumns.clear();
+    pane->tableColumns.clear();
+    pane->largeColumns.clear();
+    pane->keysLoaded = false;
+    invalidateInspectPages(pane);
     pane->filterEdit->clear();
+    pane->searchTimer->stop();
     pane->resultForm->reset();
     if(pane->structureFilterEdit){
         pane->structureFilterEdit->clear();
@@ -1682,7 +2625,9 @@ void QueryForm::enterInspectMode(const QString &connName,
     }
     updateInspectView(pane);
     selectInspectPane(pane);
-    refreshInspectData(pane);
+    if(!showRecentPage(pane)){
+        refreshInspectData(pane);
+    }
     m_title = titleText;
     emit titleChanged(m_title);
 }
@@ -1701,7 +2646,7 @@ void QueryForm::refreshInspectData(InspectPane *pane)
         return;
     }
     auto resetDataState = [this, pane]() {
-        pane->dataRowStates.clear();
+        clearDataEdits(pane);
         pane->dataHeaders.clear();
         pane->dataHeaderIndex.clear();
         pane->dataPrimaryKeys.clear();
@@ -1739,114 +2684,241 @@ void QueryForm::refreshInspectData(InspectPane *pane)
         return;
     }
 
+    // Paging uses a prefetched page when there is one, without reconnecting
+    const QString pageKey = inspectPageKey(pane, dbName);
+    if(pageKey != pane->pageKey){
+        invalidateInspectPages(pane);
+        pane->pageKey = pageKey;
+    }
+    if(const InspectPage *cached = pane->pageCache.object(pane->dataOffset)){
+        const InspectPage page = *cached;
+        showInspectPage(pane, info, dbName, page, tr("，已预取"));
+        prefetchInspectPages(pane, info, dbName);
+        return;
+    }
+
     pane->resultForm->showMessage(tr("正在加载 %1...").arg(pane->tableName));
+    ScopedJob job(QStringLiteral("inspect"), QStringLiteral("%1.%2").arg(dbName, pane->tableName), {info.name});
     const QString connId = QStringLiteral("inspect_%1_%2_%3")
             .arg(info.name,
                  pane->tableName,
                  QString::number(QDateTime::currentMSecsSinceEpoch()));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(dbName);
 
-    if(!db.open()){
-        pane->resultForm->showMessage(tr("连接失败: %1").arg(db.lastError().text()));
+    if(!endpointOk || !db.open()){
+        pane->resultForm->showMessage(tr("连接失败: %1").arg(endpointOk ? db.lastError().text() : endpointError));
         QSqlDatabase::removeDatabase(connId);
         resetDataState();
         return;
     }
 
-    QString sql;
-    if(pane->currentAction == ViewStructure){
-        sql = QStringLiteral("SHOW FULL COLUMNS FROM %1 FROM %2;")
-                .arg(escapeIdentifier(pane->tableName), escapeIdentifier(dbName));
-    }else{
-        // Use LIMIT with +1 to detect if there's more data
-        if(pane->whereClause.isEmpty()){
-            sql = QStringLiteral("SELECT * FROM %1 LIMIT %2 OFFSET %3;")
-                    .arg(qualifiedName(dbName, pane->tableName))
-                    .arg(pane->dataLimit + 1)
-                    .arg(pane->dataOffset);
-        }else{
-            sql = QStringLiteral("SELECT * FROM %1 WHERE %2 LIMIT %3 OFFSET %4;")
-                    .arg(qualifiedName(dbName, pane->tableName))
-                    .arg(pane->whereClause)
-                    .arg(pane->dataLimit + 1)
-                    .arg(pane->dataOffset);
-        }
+    if(pane->dataOffset == 0 || !pane->keysLoaded){
+        loadInspectKeys(pane, db, dbName);
+    }
+    InspectPage page;
+    QString error;
+    const bool ok = fetchInspectPage(db, inspectPageSql(pane, dbName, pane->dataOffset), pane->dataLimit,
+                                     inspectPreviewColumns(pane), &page, &error);
+    db.close();
+    QSqlDatabase::removeDatabase(connId);
+    if(!ok){
+        pane->resultForm->showMessage(tr("查询失败: %1").arg(error));
+        resetDataState();
+        return;
     }
+    pane->pageCache.insert(pane->dataOffset, new InspectPage(page), qMax(1, page.rows.size()));
+    showInspectPage(pane, info, dbName, page);
+    prefetchInspectPages(pane, info, dbName);
+}
 
+bool QueryForm::fetchInspectPage(QSqlDatabase &db,
+                                 const QString &sql,
+                                 int limit,
+                                 const QVector<int> &previewColumns,
+                                 InspectPage *page,
+                                 QString *errorMessage)
+{
     QElapsedTimer timer;
     timer.start();
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     if(!query.exec(sql)){
-        pane->resultForm->showMessage(tr("查询失败: %1").arg(query.lastError().text()));
-        db.close();
-        QSqlDatabase::removeDatabase(connId);
-        resetDataState();
-        return;
+        if(errorMessage){
+            *errorMessage = query.lastError().text();
+        }
+        return false;
     }
-    const qint64 elapsed = timer.elapsed();
-    if(pane->currentAction == ViewStructure){
-        const auto columns = parseTableStructure(query);
-        pane->resultForm->showTableStructure(columns, elapsed);
-    }else{
-        QStringList headers;
-        QVector<int> columnTypes;
-        const auto record = query.record();
-        for(int i = 0; i < record.count(); ++i){
-            headers << record.fieldName(i);
-            columnTypes << static_cast<int>(record.field(i).type());
+    const auto record = query.record();
+    // The trailing columns hold the full byte length of each preview column and are not shown
+    const int columns = record.count() - previewColumns.size();
+    for(int i = 0; i < columns; ++i){
+        page->headers << record.fieldName(i);
+        page->columnTypes << static_cast<int>(record.field(i).type());
+    }
+    while(query.next()){
+        QVariantList row;
+        row.reserve(columns);
+        for(int col = 0; col < columns; ++col){
+            row << query.value(col);
         }
-        QList<QVariantList> rows;
-        while(query.next()){
-            QVariantList row;
-            for(int col = 0; col < record.count(); ++col){
-                row << query.value(col);
+        for(int i = 0; i < previewColumns.size(); ++i){
+            const QVariant size = query.value(columns + i);
+            const int col = previewColumns.at(i);
+            if(size.isNull() || col >= columns){
+                continue;
             }
-            rows << row;
+            const qint64 bytes = size.toLongLong();
+            page->truncated.insert(qMakePair(page->rows.size(), col), bytes);
+            row[col] = QStringLiteral("%1… [%2]").arg(row.at(col).toString(), formatBytes(bytes));
         }
-        // Check if there's more data (we fetched limit+1)
-        pane->hasMoreData = (rows.size() > pane->dataLimit);
+        page->rows << row;
+    }
+    page->elapsedMs = timer.elapsed();
+    page->fetchedAt = QDateTime::currentMSecsSinceEpoch();
+    // Check if there's more data (we fetched limit+1)
+    page->hasMore = page->rows.size() > limit;
+    if(page->hasMore){
+        page->rows.removeLast(); // Remove the extra row
+    }
+    return true;
+}
+
+void QueryForm::showInspectPage(InspectPane *pane,
+                                const ConnectionInfo &info,
+                                const QString &dbName,
+                                const InspectPage &page,
+                                const QString &origin)
+{
+    const QStringList &headers = page.headers;
+    const QList<QVariantList> &rows = page.rows;
+    pane->hasMoreData = page.hasMore;
+    QString note;
+    if(pane->dataOffset == 0 && !pane->hasMoreData){
+        note = tr("共 %1 行").arg(rows.size());
+    } else {
+        note = tr("第 %1-%2 行").arg(pane->dataOffset + 1).arg(pane->dataOffset + rows.size());
         if(pane->hasMoreData){
-            rows.removeLast(); // Remove the extra row
+            note += tr(" (还有更多)");
         }
-        QString note;
-        if(pane->dataOffset == 0 && !pane->hasMoreData){
-            note = tr("共 %1 行").arg(rows.size());
-        } else {
-            note = tr("第 %1-%2 行").arg(pane->dataOffset + 1).arg(pane->dataOffset + rows.size());
-            if(pane->hasMoreData){
-                note += tr(" (还有更多)");
-            }
+    }
+    if(!pane->orderColumn.isEmpty()){
+        note += tr("，按 %1 %2").arg(pane->orderColumn,
+                                    pane->orderDirection == Qt::DescendingOrder ? tr("降序") : tr("升序"));
+        if(!pane->indexedColumns.contains(pane->orderColumn.toLower())){
+            note += tr("（无索引，服务端需对全部匹配行排序）");
         }
-        pane->resultForm->showRows(headers, rows, elapsed, note, true, columnTypes);
-        initialiseDataRows(pane, info, dbName, headers, rows);
-        updateFetchButtons(pane);
-        // Update whereEdit completion with column names only (no table names)
-        if(pane->whereEdit){
-            QList<MyEdit::CompletionItem> items;
-            for(const QString &h : headers){
-                items.append({h, MyEdit::ColumnType, QString(), QString()});
-            }
-            static const QStringList condKeywords = {
-                QStringLiteral("and"), QStringLiteral("or"), QStringLiteral("not"),
-                QStringLiteral("in"), QStringLiteral("like"), QStringLiteral("between"),
-                QStringLiteral("is null"), QStringLiteral("is not null"),
-                QStringLiteral("exists"), QStringLiteral("asc"), QStringLiteral("desc")
-            };
-            for(const QString &kw : condKeywords){
-                items.append({kw, MyEdit::KeywordType, QString(), QString()});
-            }
-            pane->whereEdit->setCompletionItems(items);
+    }
+    note += origin;
+    pane->resultForm->showRows(headers, rows, page.elapsedMs, note, true, page.columnTypes);
+    for(auto it = page.truncated.cbegin(); it != page.truncated.cend(); ++it){
+        pane->resultForm->markTruncated(it.key().first, it.key().second, it.value());
+    }
+    initialiseDataRows(pane, info, dbName, headers, rows);
+    updateFetchButtons(pane);
+    // Update whereEdit completion with column names only (no table names)
+    if(pane->whereEdit){
+        QList<MyEdit::CompletionItem> items;
+        for(const QString &h : headers){
+            items.append({h, MyEdit::ColumnType, QString(), QString()});
         }
+        static const QStringList condKeywords = {
+            QStringLiteral("and"), QStringLiteral("or"), QStringLiteral("not"),
+            QStringLiteral("in"), QStringLiteral("like"), QStringLiteral("between"),
+            QStringLiteral("is null"), QStringLiteral("is not null"),
+            QStringLiteral("exists"), QStringLiteral("asc"), QStringLiteral("desc")
+        };
+        for(const QString &kw : condKeywords){
+            items.append({kw, MyEdit::KeywordType, QString(), QString()});
+        }
+        pane->whereEdit->setCompletionItems(items);
     }
-    db.close();
-    QSqlDatabase::removeDatabase(connId);
     updateInspectSortOptions(pane);
-    applyInspectSort(pane, Qt::AscendingOrder);
+    updateSearchColumnsMenu(pane);
+    rememberRecentPage(pane, dbName, page);
+}
+
+void QueryForm::prefetchInspectPages(InspectPane *pane, const ConnectionInfo &info, const QString &dbName)
+{
+    // Prefetch the next and previous page for regular paging only; large pages such as
+    // Fetch All are not prefetched
+    if(pane->dataLimit > kPrefetchMaxRows){
+        return;
+    }
+    QList<int> offsets;
+    if(pane->hasMoreData){
+        offsets << pane->dataOffset + pane->dataLimit;
+    }
+    if(pane->dataOffset > 0){
+        offsets << qMax(0, pane->dataOffset - pane->dataLimit);
+    }
+    for(int offset : qAsConst(offsets)){
+        if(!pane->pageCache.contains(offset) && !pane->prefetching.contains(offset)){
+            fetchPageInBackground(pane, info, dbName, offset, false);
+        }
+    }
+}
+
+void QueryForm::fetchPageInBackground(InspectPane *pane,
+                                      const ConnectionInfo &info,
+                                      const QString &dbName,
+                                      int offset,
+                                      bool revalidate)
+{
+    pane->prefetching.insert(offset);
+    const QString sql = inspectPageSql(pane, dbName, offset);
+    const int limit = pane->dataLimit;
+    const QVector<int> previews = inspectPreviewColumns(pane);
+    const quint64 generation = pane->pageGeneration;
+    const QPointer<QueryForm> guard(this);
+    auto work = [guard, pane, info, dbName, sql, limit, previews, generation, offset, revalidate](quint64 jobId) {
+        InspectPage page;
+        bool ok = false;
+        QSqlDatabase db = SessionPool::instance()->acquire(info, dbName, &page.error);
+        if(db.isValid()){
+            ok = fetchInspectPage(db, sql, limit, previews, &page, &page.error);
+            if(ok){
+                SessionPool::instance()->release(db);
+            }else{
+                SessionPool::instance()->discard(db);
+            }
+        }
+        if(!ok){
+            JobScheduler::instance()->finish(jobId, false, page.error);
+        }
+        // The scheduler on the GUI thread carries the result back, also on failure so the
+        // in-flight mark is cleared
+        QMetaObject::invokeMethod(JobScheduler::instance(), [guard, pane, generation, offset, page, revalidate]() {
+            if(guard){
+                guard->handleFetchedPage(pane, generation, offset, page, revalidate);
+            }
+        }, Qt::QueuedConnection);
+    };
+    // Cancelled before it ran: still clear the in-flight marker
+    auto skipped = [guard, pane, generation, offset, revalidate](quint64) {
+        InspectPage page;
+        page.error = tr("已取消");
+        QMetaObject::invokeMethod(JobScheduler::instance(), [guard, pane, generation, offset, page, revalidate]() {
+            if(guard){
+                guard->handleFetchedPage(pane, generation, offset, page, revalidate);
+            }
+        }, Qt::QueuedConnection);
+    };
+    const QString title = revalidate
+            ? tr("刷新 %1 第 %2 行起").arg(pane->tableName).arg(offset + 1)
+            : tr("预取 %1 第 %2 行起").arg(pane->tableName).arg(offset + 1);
+    JobScheduler::instance()->submit(revalidate ? QStringLiteral("revalidate") : QStringLiteral("prefetch"),
+                                     title,
+                                     {info.name},
+                                     revalidate ? JobScheduler::Normal : JobScheduler::Background,
+                                     work,
+                                     {},
+                                     skipped);
 }
 
 void QueryForm::refreshInspectStructure(InspectPane *pane)
@@ -1875,19 +2947,21 @@ void QueryForm::refreshInspectStructure(InspectPane *pane)
         pane->structureDatabaseEdit->setText(dbName);
     }
 
+    ScopedJob job(QStringLiteral("metadata"), QStringLiteral("%1.%2").arg(dbName, pane->tableName), {info.name});
     const QString connId = QStringLiteral("inspect_%1_%2_%3")
             .arg(info.name,
                  pane->tableName,
                  QString::number(QDateTime::currentMSecsSinceEpoch()));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(dbName);
 
-    if(!db.open()){
-        QMessageBox::warning(this, tr("提示"), tr("连接失败: %1").arg(db.lastError().text()));
+    if(!endpointOk || !db.open()){
+        QMessageBox::warning(this, tr("提示"), tr("连接失败: %1").arg(endpointOk ? db.lastError().text() : endpointError));
         QSqlDatabase::removeDatabase(connId);
         return;
     }
@@ -1973,6 +3047,9 @@ void QueryForm::changeInspectView(InspectPane *pane, TableAction action)
     }
     pane->currentAction = action;
     updateInspectView(pane);
+    // The structure tab may have changed the table; query again when returning to the data tab
+    invalidateInspectPages(pane);
+    pane->keysLoaded = false;
     refreshInspectData(pane);
 }
 
@@ -2214,31 +3291,51 @@ void QueryForm::showIndexColumnDialog(InspectPane *pane, int row)
         colItem = new QTableWidgetItem();
         pane->indexTable->setItem(row, 1, colItem);
     }
-    colItem->setText(selectedCols.join(QStringLiteral(",")));
+    colItem->setText(selectedCols.join(QStringLiteral(",")));
+}
+
+bool QueryForm::ensureIndexChangesHandled(InspectPane *pane)
+{
+    if(!pane || !pane->indexDirty){
+        return true;
+    }
+    QMessageBox msgBox(this);
+    msgBox.setIcon(QMessageBox::Warning);
+    msgBox.setWindowTitle(QStringLiteral("OpenDBKit"));
+    msgBox.setText(tr("索引已修改.\n是否需要保存?"));
+    auto *saveBtn = msgBox.addButton(tr("保存"), QMessageBox::AcceptRole);
+    auto *discardBtn = msgBox.addButton(tr("不保存"), QMessageBox::DestructiveRole);
+    msgBox.addButton(tr("取消"), QMessageBox::RejectRole);
+    msgBox.setDefaultButton(saveBtn);
+    msgBox.exec();
+    if(msgBox.clickedButton() == saveBtn){
+        saveIndexChanges(pane);
+        return true;
+    }
+    if(msgBox.clickedButton() == discardBtn){
+        return true;
+    }
+    return false;
 }
 
-bool QueryForm::ensureIndexChangesHandled(InspectPane *pane)
+bool QueryForm::ensureDataChangesHandled(InspectPane *pane)
 {
-    if(!pane || !pane->indexDirty){
+    if(!pane || !pane->dataDirty){
         return true;
     }
     QMessageBox msgBox(this);
     msgBox.setIcon(QMessageBox::Warning);
     msgBox.setWindowTitle(QStringLiteral("OpenDBKit"));
-    msgBox.setText(tr("索引已修改.\n是否需要保存?"));
+    msgBox.setText(tr("表数据已修改.\n是否需要保存?"));
     auto *saveBtn = msgBox.addButton(tr("保存"), QMessageBox::AcceptRole);
     auto *discardBtn = msgBox.addButton(tr("不保存"), QMessageBox::DestructiveRole);
     msgBox.addButton(tr("取消"), QMessageBox::RejectRole);
     msgBox.setDefaultButton(saveBtn);
     msgBox.exec();
     if(msgBox.clickedButton() == saveBtn){
-        saveIndexChanges(pane);
-        return true;
-    }
-    if(msgBox.clickedButton() == discardBtn){
-        return true;
+        return saveDataChanges(pane);
     }
-    return false;
+    return msgBox.clickedButton() == discardBtn;
 }
 
 void QueryForm::saveIndexChanges(InspectPane *pane)
@@ -2254,13 +3351,14 @@ void QueryForm::saveIndexChanges(InspectPane *pane)
     const QString connId = QStringLiteral("idx_save_%1").arg(QDateTime::currentMSecsSinceEpoch());
     {
         QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-        db.setHostName(info.host);
-        db.setPort(info.port);
+        QString endpointError;
+        const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
         db.setUserName(info.user);
         db.setPassword(info.password);
+        db.setConnectOptions(ConnectionManager::connectOptions(info));
         db.setDatabaseName(pane->dbName);
-        if(!db.open()){
-            QMessageBox::warning(this, tr("保存索引"), db.lastError().text());
+        if(!endpointOk || !db.open()){
+            QMessageBox::warning(this, tr("保存索引"), endpointOk ? db.lastError().text() : endpointError);
             QSqlDatabase::removeDatabase(connId);
             return;
         }
@@ -2410,12 +3508,13 @@ void QueryForm::populateIndexTable(InspectPane *pane)
     }
     const QString connId = QStringLiteral("idx_refresh_%1").arg(QDateTime::currentMSecsSinceEpoch());
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(pane->dbName);
-    if(!db.open()){
+    if(!endpointOk || !db.open()){
         QSqlDatabase::removeDatabase(connId);
         return;
     }
@@ -2662,10 +3761,13 @@ void QueryForm::initialiseDataRows(InspectPane *pane,
     for(int i = 0; i < headers.size(); ++i){
         pane->dataHeaderIndex.insert(headers.at(i).toLower(), i);
     }
-    pane->dataRowStates.clear();
+    clearDataEdits(pane);
     pane->dataDirty = false;
     QString actualDb = dbName.isEmpty() ? info.defaultDb : dbName;
-    pane->dataPrimaryKeys = fetchPrimaryKeys(info, actualDb, pane->tableName);
+    // The indexes were read with the data, so reuse the primary key instead of connecting
+    // again per page
+    pane->dataPrimaryKeys = pane->keysLoaded ? pane->keyColumns
+                                             : fetchPrimaryKeys(info, actualDb, pane->tableName);
     for(QString &pk : pane->dataPrimaryKeys){
         pk = pk.toLower();
     }
@@ -2674,26 +3776,13 @@ void QueryForm::initialiseDataRows(InspectPane *pane,
         updateDataButtons(pane);
         return;
     }
-    for(int row = 0; row < model->rowCount(); ++row){
-        QStringList rowValues;
-        if(row < rows.size()){
-            const QVariantList &varRow = rows.at(row);
-            for(const QVariant &v : varRow){
-                rowValues << (v.isNull() ? QString() : v.toString());
-            }
-        }else{
-            rowValues = pane->resultForm->rowValues(row);
-        }
-        while(rowValues.size() < headers.size()){
-            rowValues << QString();
-        }
-        RowEditState state;
-        state.rowId = generateRowId();
-        state.originalValues = rowValues;
-        state.currentValues = rowValues;
-        pane->dataRowStates.insert(state.rowId, state);
-        tagRowWithId(pane, row, state.rowId);
-    }
+    // The page data holds the original values, so nothing is copied before a row changes
+    pane->dataLoadedRows = rows;
+    const int rowCount = model->rowCount();
+    pane->dataRowHandles.resize(rowCount);
+    std::iota(pane->dataRowHandles.begin(), pane->dataRowHandles.end(), 0);
+    pane->dataDirtyRows.resize(rowCount);
+    pane->nextRowHandle = rowCount;
     setupDataConnections(pane);
     updateDataButtons(pane);
     // Disable sorting in edit mode to prevent row jumping when editing
@@ -2737,8 +3826,8 @@ void QueryForm::setupDataConnections(InspectPane *pane)
                             item->setData(false, Qt::UserRole + 3);
                         }
                     }
+                    handleDataCellChanged(pane, row, column);
                 }
-                handleDataRowChanged(pane, row);
             }
         }, Qt::UniqueConnection);
     }
@@ -2780,45 +3869,51 @@ void QueryForm::markDataDirty(InspectPane *pane)
     updateDataButtons(pane);
 }
 
-QString QueryForm::generateRowId() const
+void QueryForm::clearDataEdits(InspectPane *pane)
 {
-    return QStringLiteral("row_%1").arg(QUuid::createUuid().toString(QUuid::Id128));
+    pane->dataLoadedRows.clear();
+    pane->dataRowHandles.clear();
+    pane->dataEdits.clear();
+    pane->dataDirtyRows.clear();
+    pane->nextRowHandle = 0;
 }
 
-void QueryForm::tagRowWithId(InspectPane *pane, int row, const QString &rowId)
+QueryForm::RowEditState *QueryForm::rowEditFor(InspectPane *pane, int sourceRow, bool create)
 {
-    if(!pane || !pane->resultForm || row < 0){
-        return;
+    const int handle = pane->dataRowHandles.value(sourceRow, -1);
+    if(handle < 0){
+        return nullptr;
     }
-    auto *model = pane->resultForm->sourceModel();
-    if(!model){
-        return;
+    auto it = pane->dataEdits.find(handle);
+    if(it != pane->dataEdits.end()){
+        return &it.value();
     }
-    QSignalBlocker blocker(model);
-    for(int c = 0; c < model->columnCount(); ++c){
-        if(QStandardItem *item = model->item(row, c)){
-            item->setEditable(true);
-            item->setData(rowId, Qt::UserRole + 2);
-        }
+    if(!create || handle >= pane->dataLoadedRows.size()){
+        return nullptr;
     }
+    // Copy on write: the original values come from the page data when a row first changes
+    RowEditState state;
+    const QVariantList &row = pane->dataLoadedRows.at(handle);
+    state.originalValues.reserve(pane->dataHeaders.size());
+    for(int c = 0; c < pane->dataHeaders.size(); ++c){
+        const QVariant value = row.value(c);
+        state.originalValues << (value.isNull() ? QString() : value.toString());
+        state.originalNullFlags << value.isNull();
+    }
+    state.currentValues = state.originalValues;
+    state.currentNullFlags = state.originalNullFlags;
+    return &pane->dataEdits.insert(handle, state).value();
 }
 
-QString QueryForm::rowIdForSourceRow(InspectPane *pane, int sourceRow) const
+void QueryForm::setRowDirty(InspectPane *pane, int handle, bool dirty)
 {
-    if(!pane || !pane->resultForm){
-        return {};
-    }
-    auto *model = pane->resultForm->sourceModel();
-    if(!model || model->columnCount() == 0){
-        return {};
-    }
-    if(sourceRow < 0 || sourceRow >= model->rowCount()){
-        return {};
+    if(handle < 0){
+        return;
     }
-    if(QStandardItem *item = model->item(sourceRow, 0)){
-        return item->data(Qt::UserRole + 2).toString();
+    if(handle >= pane->dataDirtyRows.size()){
+        pane->dataDirtyRows.resize(handle + 1);
     }
-    return {};
+    pane->dataDirtyRows.setBit(handle, dirty);
 }
 
 QStringList QueryForm::currentRowValues(InspectPane *pane, int sourceRow) const
@@ -2833,27 +3928,28 @@ QStringList QueryForm::currentRowValues(InspectPane *pane, int sourceRow) const
     return values;
 }
 
-void QueryForm::handleDataRowChanged(InspectPane *pane, int sourceRow)
+void QueryForm::handleDataCellChanged(InspectPane *pane, int sourceRow, int column)
 {
-    if(!pane || !pane->resultForm){
-        return;
-    }
-    const QString rowId = rowIdForSourceRow(pane, sourceRow);
-    if(rowId.isEmpty()){
+    if(!pane || !pane->resultForm || column < 0 || column >= pane->dataHeaders.size()){
         return;
     }
-    auto it = pane->dataRowStates.find(rowId);
-    if(it == pane->dataRowStates.end()){
+    QStandardItem *item = pane->resultForm->sourceModel()->item(sourceRow, column);
+    RowEditState *state = rowEditFor(pane, sourceRow, true);
+    if(!item || !state){
         return;
     }
-    RowEditState &state = it.value();
-    state.currentValues = currentRowValues(pane, sourceRow);
-    state.currentNullFlags = pane->resultForm->rowNullFlags(sourceRow);
-    while(state.currentNullFlags.size() < pane->dataHeaders.size()){
-        state.currentNullFlags << false;
-    }
-    if(!state.inserted){
-        state.updated = (state.currentValues != state.originalValues);
+    // Update this cell only and note whether it still differs from the original
+    state->currentValues[column] = item->text();
+    state->currentNullFlags[column] = item->data(Qt::UserRole + 3).toBool();
+    if(!state->inserted){
+        const bool changed = state->currentValues.at(column) != state->originalValues.value(column)
+                || state->currentNullFlags.at(column) != state->originalNullFlags.value(column);
+        if(changed){
+            state->changedColumns.insert(column);
+        }else{
+            state->changedColumns.remove(column);
+        }
+        setRowDirty(pane, pane->dataRowHandles.at(sourceRow), !state->changedColumns.isEmpty() || state->deleted);
     }
     markDataDirty(pane);
 }
@@ -2892,10 +3988,9 @@ void QueryForm::appendDataRow(InspectPane *pane, const QStringList &values, cons
     model->appendRow(items);
     pane->blockDataSignal = false;
     const int newRow = model->rowCount() - 1;
-    const QString rowId = generateRowId();
-    tagRowWithId(pane, newRow, rowId);
+    const int handle = pane->nextRowHandle++;
+    pane->dataRowHandles.append(handle);
     RowEditState state;
-    state.rowId = rowId;
     state.inserted = true;
     state.currentValues = values;
     while(state.currentValues.size() < columnCount){
@@ -2905,7 +4000,8 @@ void QueryForm::appendDataRow(InspectPane *pane, const QStringList &values, cons
     while(state.currentNullFlags.size() < columnCount){
         state.currentNullFlags << false;
     }
-    pane->dataRowStates.insert(rowId, state);
+    pane->dataEdits.insert(handle, state);
+    setRowDirty(pane, handle, true);
     markDataDirty(pane);
     // Scroll to and select the new row
     if(auto *tv = pane->resultForm->tableWidget()){
@@ -2931,11 +4027,155 @@ void QueryForm::duplicateSelectedRow(InspectPane *pane)
         return;
     }
     const int sourceRow = rows.first();
+    // Complete preview cells first so truncated content does not go into the new row
+    if(!pane->resultForm->loadTruncatedValues({sourceRow})){
+        return;
+    }
     const QStringList values = currentRowValues(pane, sourceRow);
     const QVector<bool> nullFlags = pane->resultForm->rowNullFlags(sourceRow);
     appendDataRow(pane, values, nullFlags);
 }
 
+bool QueryForm::loadFullCellValues(InspectPane *pane, int column, const QList<int> &sourceRows)
+{
+    if(!pane || !pane->resultForm || column < 0 || column >= pane->dataHeaders.size() || sourceRows.isEmpty()){
+        return false;
+    }
+    const ConnectionInfo info = ConnectionManager::instance()->connection(pane->connName);
+    const QString dbName = pane->dbName.isEmpty() ? info.defaultDb : pane->dbName;
+    if(info.name.isEmpty()){
+        showStatus(tr("无法载入完整内容。"), 5000);
+        return false;
+    }
+    QVector<int> pkColumns;
+    for(const QString &pk : qAsConst(pane->dataPrimaryKeys)){
+        const int idx = pane->dataHeaderIndex.value(pk.toLower(), -1);
+        if(idx < 0){
+            showStatus(tr("无法定位主键列 %1。").arg(pk), 5000);
+            return false;
+        }
+        pkColumns << idx;
+    }
+    if(pkColumns.isEmpty()){
+        showStatus(tr("表 \"%1\" 缺少主键，无法定位行。").arg(pane->tableName), 5000);
+        return false;
+    }
+
+    // Key values as loaded; an existing journal entry holds them, otherwise
+    // the page data does. Reading them must not create an entry
+    QHash<QString, QList<int>> rowsByKey;
+    QStringList tuples;
+    for(int sourceRow : sourceRows){
+        const RowEditState *edit = rowEditFor(pane, sourceRow, false);
+        const int handle = pane->dataRowHandles.value(sourceRow, -1);
+        if(edit ? edit->inserted : (handle < 0 || handle >= pane->dataLoadedRows.size())){
+            continue;
+        }
+        QStringList keyValues;
+        for(int idx : qAsConst(pkColumns)){
+            keyValues << (edit ? edit->originalValues.value(idx)
+                               : pane->dataLoadedRows.at(handle).value(idx).toString());
+        }
+        const QString key = keyValues.join(QChar(0x1f));
+        if(!rowsByKey.contains(key)){
+            QStringList literals;
+            for(const QString &value : qAsConst(keyValues)){
+                literals << (value.isEmpty() ? QStringLiteral("''") : escapeSqlValue(value));
+            }
+            tuples << (literals.size() == 1 ? literals.first()
+                                            : QStringLiteral("(%1)").arg(literals.join(QStringLiteral(", "))));
+        }
+        rowsByKey[key] << sourceRow;
+    }
+    if(tuples.isEmpty()){
+        return true;
+    }
+    QStringList keyNames;
+    for(int idx : qAsConst(pkColumns)){
+        keyNames << escapeIdentifier(pane->dataHeaders.at(idx));
+    }
+    const QString keyList = keyNames.size() == 1
+            ? keyNames.first()
+            : QStringLiteral("(%1)").arg(keyNames.join(QStringLiteral(", ")));
+
+    ScopedJob job(QStringLiteral("inspect"), QStringLiteral("%1.%2").arg(dbName, pane->tableName), {info.name});
+    QString error;
+    QSqlDatabase db = SessionPool::instance()->acquire(info, dbName, &error);
+    if(!db.isValid()){
+        job.fail(error);
+        showStatus(tr("连接失败: %1").arg(error), 5000);
+        return false;
+    }
+    // One query per batch of rows instead of one per cell
+    QHash<QString, QVariant> values;
+    {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        for(int start = 0; start < tuples.size() && error.isEmpty(); start += kFullValueBatchRows){
+            const QString sql = QStringLiteral("SELECT %1, %2 FROM %3 WHERE %4 IN (%5);")
+                    .arg(keyNames.join(QStringLiteral(", ")),
+                         escapeIdentifier(pane->dataHeaders.at(column)),
+                         qualifiedName(dbName, pane->tableName),
+                         keyList,
+                         tuples.mid(start, kFullValueBatchRows).join(QStringLiteral(", ")));
+            if(!query.exec(sql)){
+                error = query.lastError().text();
+                break;
+            }
+            while(query.next()){
+                QStringList keyValues;
+                for(int i = 0; i < pkColumns.size(); ++i){
+                    keyValues << query.value(i).toString();
+                }
+                values.insert(keyValues.join(QChar(0x1f)), query.value(pkColumns.size()));
+            }
+        }
+    }
+    if(error.isEmpty()){
+        SessionPool::instance()->release(db);
+    }else{
+        SessionPool::instance()->discard(db);
+        job.fail(error);
+        showStatus(error, 5000);
+        return false;
+    }
+    if(values.size() < rowsByKey.size()){
+        error = tr("该行已不存在，请刷新。");
+        job.fail(error);
+        showStatus(error, 5000);
+    }
+
+    // The full value also becomes the original, so saving leaves the column alone unless it changed
+    const bool originalBlock = pane->blockDataSignal;
+    pane->blockDataSignal = true;
+    for(auto it = rowsByKey.cbegin(); it != rowsByKey.cend(); ++it){
+        const auto found = values.constFind(it.key());
+        if(found == values.constEnd()){
+            continue;
+        }
+        const QVariant &value = found.value();
+        const QString text = value.isNull() ? QString() : value.toString();
+        for(int sourceRow : it.value()){
+            pane->resultForm->setFullValue(sourceRow, column, value);
+            const int handle = pane->dataRowHandles.value(sourceRow, -1);
+            if(handle >= 0 && handle < pane->dataLoadedRows.size() && column < pane->dataLoadedRows.at(handle).size()){
+                pane->dataLoadedRows[handle][column] = value;
+            }
+            RowEditState *state = rowEditFor(pane, sourceRow, false);
+            if(state && !state->inserted){
+                state->originalValues[column] = text;
+                state->originalNullFlags[column] = value.isNull();
+                if(!state->changedColumns.contains(column)){
+                    state->currentValues[column] = text;
+                    state->currentNullFlags[column] = value.isNull();
+                }
+            }
+        }
+    }
+    pane->blockDataSignal = originalBlock;
+    return error.isEmpty();
+}
+
 void QueryForm::copyRowsToClipboard(InspectPane *pane)
 {
     if(!pane || !pane->resultForm){
@@ -2945,6 +4185,10 @@ void QueryForm::copyRowsToClipboard(InspectPane *pane)
     if(rows.isEmpty()){
         return;
     }
+    // Load full values of preview cells first; loadFullCellValues has already shown why it failed
+    if(!pane->resultForm->loadTruncatedValues(rows)){
+        return;
+    }
     auto *model = pane->resultForm->sourceModel();
     if(!model){
         return;
@@ -3022,7 +4266,9 @@ void QueryForm::pasteRowsFromClipboard(InspectPane *pane)
                 }
             }
             pane->blockDataSignal = false;
-            handleDataRowChanged(pane, row);
+            for(int c = 0; c < colCount; ++c){
+                handleDataCellChanged(pane, row, c);
+            }
         }else{
             appendDataRow(pane, values, nullFlags);
         }
@@ -3047,18 +4293,16 @@ void QueryForm::deleteSelectedRows(InspectPane *pane)
     QList<int> sortedRows = rows;
     std::sort(sortedRows.begin(), sortedRows.end(), std::greater<int>());
     bool requiresPrimaryKey = false;
+    QVector<int> targetRows;
     QVector<int> existingRows;
     QVector<int> insertedRows;
     for(int row : sortedRows){
-        const QString rowId = rowIdForSourceRow(pane, row);
-        if(rowId.isEmpty()){
+        if(row < 0 || row >= pane->dataRowHandles.size()){
             continue;
         }
-        const auto it = pane->dataRowStates.constFind(rowId);
-        if(it == pane->dataRowStates.cend()){
-            continue;
-        }
-        if(it->inserted){
+        targetRows.append(row);
+        const RowEditState *state = rowEditFor(pane, row, false);
+        if(state && state->inserted){
             insertedRows.append(row);
         }else{
             existingRows.append(row);
@@ -3072,19 +4316,21 @@ void QueryForm::deleteSelectedRows(InspectPane *pane)
         return;
     }
     pane->blockDataSignal = true;
-    for(int row : insertedRows){
-        const QString rowId = rowIdForSourceRow(pane, row);
-        pane->dataRowStates.remove(rowId);
-        model->removeRow(row);
-    }
-    for(int row : existingRows){
-        const QString rowId = rowIdForSourceRow(pane, row);
-        auto it = pane->dataRowStates.find(rowId);
-        if(it == pane->dataRowStates.end()){
-            continue;
+    // Go from the last row up so removing model rows leaves the other pending rows in place
+    for(int row : qAsConst(targetRows)){
+        const int handle = pane->dataRowHandles.at(row);
+        if(insertedRows.contains(row)){
+            pane->dataEdits.remove(handle);
+            setRowDirty(pane, handle, false);
+        }else{
+            RowEditState *state = rowEditFor(pane, row, true);
+            if(!state){
+                continue;
+            }
+            state->deleted = true;
+            setRowDirty(pane, handle, true);
         }
-        it.value().deleted = true;
-        it.value().updated = false;
+        pane->dataRowHandles.remove(row);
         model->removeRow(row);
     }
     pane->blockDataSignal = false;
@@ -3098,12 +4344,16 @@ bool QueryForm::saveDataChanges(InspectPane *pane)
     if(!pane){
         return false;
     }
-    if(pane->dataRowStates.isEmpty()){
-        QMessageBox::information(this, tr("保存数据"), tr("没有需要保存的更改。"));
-        return true;
-    }
     QStringList statements;
-    for(auto it = pane->dataRowStates.cbegin(); it != pane->dataRowStates.cend(); ++it){
+    // Only rows marked in the bitmap, and statements only carry changed cells
+    for(int handle = 0; handle < pane->dataDirtyRows.size(); ++handle){
+        if(!pane->dataDirtyRows.testBit(handle)){
+            continue;
+        }
+        const auto it = pane->dataEdits.constFind(handle);
+        if(it == pane->dataEdits.cend()){
+            continue;
+        }
         const RowEditState &state = it.value();
         if(state.inserted){
             if(state.deleted){
@@ -3127,7 +4377,7 @@ bool QueryForm::saveDataChanges(InspectPane *pane)
             statements << deleteSql;
             continue;
         }
-        if(state.updated){
+        if(!state.changedColumns.isEmpty()){
             QString error;
             const QString updateSql = buildUpdateSql(pane, state, &error);
             if(updateSql.isEmpty()){
@@ -3153,6 +4403,7 @@ bool QueryForm::saveDataChanges(InspectPane *pane)
         }
     }
     showStatus(tr("数据已保存。"), 4000);
+    invalidateInspectPages(pane);
     refreshInspectData(pane);
     return true;
 }
@@ -3238,13 +4489,11 @@ QString QueryForm::buildUpdateSql(InspectPane *pane,
     if(dbName.isEmpty()){
         return {};
     }
+    QList<int> columns = state.changedColumns.values();
+    std::sort(columns.begin(), columns.end());
     QStringList assignments;
-    for(int i = 0; i < pane->dataHeaders.size(); ++i){
+    for(int i : qAsConst(columns)){
         const QString newValue = state.currentValues.value(i);
-        const QString oldValue = state.originalValues.value(i);
-        if(newValue == oldValue){
-            continue;
-        }
         const bool isNull = (i < state.currentNullFlags.size()) && state.currentNullFlags.at(i);
         QString sqlValue;
         if(isNull){
@@ -3316,15 +4565,16 @@ QStringList QueryForm::fetchPrimaryKeys(const ConnectionInfo &info,
             .arg(info.name,
                  QString::number(QDateTime::currentMSecsSinceEpoch()));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(targetDb);
     if(!info.charset.isEmpty()){
-        db.setConnectOptions(QStringLiteral("MYSQL_OPT_CONNECT_CHARSET=%1").arg(info.charset));
+        db.setConnectOptions(QStringLiteral("%1;MYSQL_OPT_CONNECT_CHARSET=%2").arg(db.connectOptions(), info.charset));
     }
-    if(!db.open()){
+    if(!endpointOk || !db.open()){
         QSqlDatabase::removeDatabase(connId);
         return keys;
     }
@@ -3446,7 +4696,7 @@ void QueryForm::showDataContextMenu(InspectPane *pane, const QPoint &pos)
                 item->setText(newValue);
                 item->setData(setNull, Qt::UserRole + 3);
                 pane->blockDataSignal = originalBlock;
-                handleDataRowChanged(pane, row);
+                handleDataCellChanged(pane, row, column);
             }
         }
         pane->blockDataSignal = originalBlock;
@@ -3457,10 +4707,12 @@ void QueryForm::showDataContextMenu(InspectPane *pane, const QPoint &pos)
         return;
     }
     if(selected == discardAction){
+        invalidateInspectPages(pane);
         refreshInspectData(pane);
         return;
     }
     if(selected == refreshAction){
+        invalidateInspectPages(pane);
         refreshInspectData(pane);
     }
 }
@@ -3517,14 +4769,15 @@ bool QueryForm::executeInspectSql(const QString &connName, const QString &dbName
             .arg(info.name,
                  QString::number(QDateTime::currentMSecsSinceEpoch()));
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(targetDb);
-    if(!db.open()){
+    if(!endpointOk || !db.open()){
         if(errorMessage){
-            *errorMessage = db.lastError().text();
+            *errorMessage = endpointOk ? db.lastError().text() : endpointError;
         }
         QSqlDatabase::removeDatabase(connId);
         return false;
@@ -3896,22 +5149,18 @@ void QueryForm::updateInspectSortOptions(InspectPane *pane)
     if(!pane || !pane->sortCombo || !pane->resultForm){
         return;
     }
-    const QString previous = pane->sortCombo->currentText();
     const auto headers = pane->resultForm->headers();
     const bool hasHeaders = !headers.isEmpty();
-    pane->sortCombo->blockSignals(true);
+    QSignalBlocker blocker(pane->sortCombo);
     pane->sortCombo->clear();
-    for(int i = 0; i < headers.size(); ++i){
-        pane->sortCombo->addItem(headers.at(i), i);
-    }
-    pane->sortCombo->blockSignals(false);
-    if(hasHeaders){
-        int idx = previous.isEmpty() ? 0 : pane->sortCombo->findText(previous);
-        if(idx < 0){
-            idx = 0;
-        }
-        pane->sortCombo->setCurrentIndex(idx);
-    }
+    pane->sortCombo->addItem(tr("(不排序)"), QString());
+    for(const QString &header : headers){
+        // Mark the columns an index can serve
+        const bool indexed = pane->indexedColumns.contains(header.toLower());
+        pane->sortCombo->addItem(indexed ? tr("%1 (索引)").arg(header) : header, header);
+    }
+    const int idx = pane->orderColumn.isEmpty() ? 0 : pane->sortCombo->findData(pane->orderColumn);
+    pane->sortCombo->setCurrentIndex(qMax(0, idx));
     pane->sortCombo->setEnabled(hasHeaders);
     pane->sortAscButton->setEnabled(hasHeaders);
     pane->sortDescButton->setEnabled(hasHeaders);
@@ -3919,18 +5168,395 @@ void QueryForm::updateInspectSortOptions(InspectPane *pane)
 
 void QueryForm::applyInspectSort(InspectPane *pane, Qt::SortOrder order)
 {
-    if(!pane || !pane->resultForm || !pane->sortCombo){
+    if(!pane || !pane->sortCombo){
+        return;
+    }
+    // Sorting runs on the server over the whole table (with WHERE and search) and goes
+    // back to the first page
+    const QString column = pane->sortCombo->currentData().toString();
+    if(column == pane->orderColumn && (column.isEmpty() || order == pane->orderDirection)){
+        return;
+    }
+    // Re-querying drops the loaded rows, so unsaved edits must be dealt with first
+    if(!ensureDataChangesHandled(pane)){
+        QSignalBlocker blocker(pane->sortCombo);
+        const int index = pane->orderColumn.isEmpty() ? 0 : pane->sortCombo->findData(pane->orderColumn);
+        pane->sortCombo->setCurrentIndex(qMax(0, index));
+        return;
+    }
+    pane->orderColumn = column;
+    pane->orderDirection = order;
+    pane->dataOffset = 0;
+    refreshInspectData(pane);
+}
+
+void QueryForm::applyInspectSearch(InspectPane *pane)
+{
+    if(!pane || !pane->filterEdit){
+        return;
+    }
+    const QString text = pane->filterEdit->text().trimmed();
+    if(text == pane->searchText){
+        return;
+    }
+    if(!ensureDataChangesHandled(pane)){
+        QSignalBlocker blocker(pane->filterEdit);
+        pane->filterEdit->setText(pane->searchText);
+        return;
+    }
+    pane->searchText = text;
+    pane->dataOffset = 0;
+    refreshInspectData(pane);
+}
+
+void QueryForm::updateSearchColumnsMenu(InspectPane *pane)
+{
+    if(!pane || !pane->searchColumnsButton){
+        return;
+    }
+    QStringList kept;
+    for(const QString &column : qAsConst(pane->searchColumns)){
+        if(pane->dataHeaders.contains(column)){
+            kept << column;
+        }
+    }
+    pane->searchColumns = kept;
+
+    // The menu may be rebuilt from one of its own actions' signals, so old actions are
+    // deleted later
+    QMenu *menu = pane->searchColumnsButton->menu();
+    for(QAction *action : menu->actions()){
+        menu->removeAction(action);
+        action->deleteLater();
+    }
+    // With an active search the new column set re-queries, which drops unsaved edits
+    auto columnsChanged = [this, pane](const QStringList &columns) {
+        if(!pane->searchText.isEmpty() && !ensureDataChangesHandled(pane)){
+            updateSearchColumnsMenu(pane);
+            return;
+        }
+        pane->searchColumns = columns;
+        if(pane->searchText.isEmpty()){
+            updateSearchColumnsMenu(pane);
+            return;
+        }
+        pane->dataOffset = 0;
+        refreshInspectData(pane);
+    };
+    QAction *allAction = menu->addAction(tr("全部列"));
+    allAction->setCheckable(true);
+    allAction->setChecked(pane->searchColumns.isEmpty());
+    connect(allAction, &QAction::triggered, this, [columnsChanged]() {
+        columnsChanged({});
+    });
+    menu->addSeparator();
+    for(const QString &column : qAsConst(pane->dataHeaders)){
+        QAction *action = menu->addAction(column);
+        action->setCheckable(true);
+        action->setChecked(pane->searchColumns.contains(column));
+        connect(action, &QAction::triggered, this, [pane, column, columnsChanged](bool checked) {
+            QStringList columns = pane->searchColumns;
+            if(checked){
+                columns << column;
+            }else{
+                columns.removeAll(column);
+            }
+            columnsChanged(columns);
+        });
+    }
+    pane->searchColumnsButton->setEnabled(!pane->dataHeaders.isEmpty());
+}
+
+void QueryForm::loadInspectKeys(InspectPane *pane, QSqlDatabase &db, const QString &dbName)
+{
+    pane->keyColumns.clear();
+    pane->indexedColumns.clear();
+    QSqlQuery query(db);
+    if(!query.exec(QStringLiteral("SHOW KEYS FROM %1;").arg(qualifiedName(dbName, pane->tableName)))){
+        pane->keysLoaded = false;
+        return;
+    }
+    pane->keysLoaded = true;
+    while(query.next()){
+        const QString column = query.value(QStringLiteral("Column_name")).toString();
+        if(column.isEmpty()){
+            continue; // functional index parts have no column name
+        }
+        if(query.value(QStringLiteral("Key_name")).toString() == QLatin1String("PRIMARY")){
+            pane->keyColumns << column;
+        }
+        if(query.value(QStringLiteral("Seq_in_index")).toInt() == 1){
+            pane->indexedColumns.insert(column.toLower());
+        }
+    }
+
+    // The column types decide which columns are fetched as prefix previews
+    static const QSet<QString> largeTypes = {
+        QStringLiteral("text"), QStringLiteral("mediumtext"), QStringLiteral("longtext"),
+        QStringLiteral("blob"), QStringLiteral("mediumblob"), QStringLiteral("longblob"),
+        QStringLiteral("json")
+    };
+    pane->tableColumns.clear();
+    pane->largeColumns.clear();
+    if(!query.exec(QStringLiteral("SHOW FULL COLUMNS FROM %1;").arg(qualifiedName(dbName, pane->tableName)))){
+        return;
+    }
+    while(query.next()){
+        const QString column = query.value(QStringLiteral("Field")).toString();
+        const QString type = query.value(QStringLiteral("Type")).toString().section(QLatin1Char('('), 0, 0).trimmed().toLower();
+        pane->tableColumns << column;
+        if(largeTypes.contains(type)){
+            pane->largeColumns.insert(column);
+        }
+    }
+}
+
+QString QueryForm::inspectFilterSql(const InspectPane *pane) const
+{
+    QStringList conditions;
+    if(!pane->searchText.isEmpty()){
+        const QString pattern = containsLikeLiteral(pane->searchText);
+        QStringList matches;
+        for(const QString &column : pane->dataHeaders){
+            if(pane->searchColumns.isEmpty() || pane->searchColumns.contains(column)){
+                matches << QStringLiteral("%1 LIKE %2").arg(escapeIdentifier(column), pattern);
+            }
+        }
+        if(!matches.isEmpty()){
+            conditions << QStringLiteral("(%1)").arg(matches.join(QStringLiteral(" OR ")));
+        }
+    }
+    if(conditions.isEmpty()){
+        // A hand-written condition on its own is used as is, so existing habits keep working
+        return pane->whereClause.isEmpty() ? QString() : QStringLiteral(" WHERE ") + pane->whereClause;
+    }
+    if(!pane->whereClause.isEmpty()){
+        // The line break keeps a trailing -- comment in the hand-written condition from
+        // swallowing the rest
+        conditions.prepend(QStringLiteral("(%1\n)").arg(pane->whereClause));
+    }
+    return QStringLiteral(" WHERE ") + conditions.join(QStringLiteral(" AND "));
+}
+
+QString QueryForm::inspectOrderSql(const InspectPane *pane) const
+{
+    if(pane->orderColumn.isEmpty()){
+        return QString();
+    }
+    const QString direction = pane->orderDirection == Qt::DescendingOrder
+            ? QStringLiteral(" DESC") : QStringLiteral(" ASC");
+    QStringList terms{escapeIdentifier(pane->orderColumn) + direction};
+    // Add the primary key in the same direction so duplicate sort values still page
+    // without gaps or repeats; InnoDB secondary indexes carry the primary key, so the
+    // index still serves the order
+    for(const QString &key : pane->keyColumns){
+        if(key.compare(pane->orderColumn, Qt::CaseInsensitive) != 0){
+            terms << escapeIdentifier(key) + direction;
+        }
+    }
+    return QStringLiteral(" ORDER BY ") + terms.join(QStringLiteral(", "));
+}
+
+QString QueryForm::inspectPageKey(const InspectPane *pane, const QString &dbName) const
+{
+    return QStringList{pane->connName, dbName, pane->tableName, pane->whereClause,
+                       pane->searchText, pane->searchColumns.join(QLatin1Char(',')),
+                       pane->orderColumn, QString::number(pane->orderDirection),
+                       QString::number(pane->dataLimit)}.join(QChar(0x1F));
+}
+
+QVector<int> QueryForm::inspectPreviewColumns(const InspectPane *pane) const
+{
+    // Without a primary key full values cannot be fetched per row, so fetch everything as before
+    QVector<int> columns;
+    if(pane->keyColumns.isEmpty()){
+        return columns;
+    }
+    for(int i = 0; i < pane->tableColumns.size(); ++i){
+        if(pane->largeColumns.contains(pane->tableColumns.at(i))){
+            columns << i;
+        }
+    }
+    return columns;
+}
+
+QString QueryForm::inspectPageSql(const InspectPane *pane, const QString &dbName, int offset) const
+{
+    QString select = QStringLiteral("*");
+    const QVector<int> previews = inspectPreviewColumns(pane);
+    if(!previews.isEmpty()){
+        // Large columns fetch a prefix only, followed by the byte length of cut values
+        // (NULL when not cut), which is split off after fetching
+        QStringList items;
+        for(const QString &column : pane->tableColumns){
+            const QString name = escapeIdentifier(column);
+            items << (pane->largeColumns.contains(column)
+                      ? QStringLiteral("LEFT(%1, %2) AS %1").arg(name, QString::number(kPreviewChars))
+                      : name);
+        }
+        for(int index : previews){
+            items << QStringLiteral("IF(CHAR_LENGTH(%1) > %2, LENGTH(%1), NULL)")
+                     .arg(escapeIdentifier(pane->tableColumns.at(index)), QString::number(kPreviewChars));
+        }
+        select = items.join(QStringLiteral(", "));
+    }
+    // Use LIMIT with +1 to detect if there's more data
+    return QStringLiteral("SELECT ") + select + QStringLiteral(" FROM ") + qualifiedName(dbName, pane->tableName)
+            + inspectFilterSql(pane) + inspectOrderSql(pane)
+            + QStringLiteral(" LIMIT %1 OFFSET %2;").arg(pane->dataLimit + 1).arg(offset);
+}
+
+void QueryForm::handleFetchedPage(InspectPane *pane,
+                                  quint64 generation,
+                                  int offset,
+                                  const InspectPage &page,
+                                  bool revalidate)
+{
+    // The pane closed, or the conditions or data changed meanwhile; the result is stale
+    if(!inspectPanes.contains(pane) || generation != pane->pageGeneration){
+        return;
+    }
+    pane->prefetching.remove(offset);
+    if(page.headers.isEmpty()){
+        if(revalidate){
+            showStatus(tr("后台刷新失败，当前显示的是缓存数据: %1").arg(page.error), 5000);
+        }
+        return;
+    }
+    pane->pageCache.insert(offset, new InspectPage(page), qMax(1, page.rows.size()));
+    if(!revalidate || pane->dataOffset != offset || pane->currentAction != ViewData){
+        return;
+    }
+    if(pane->dataDirty){
+        // Keep unsaved edits; fresh data shows on the next page change or refresh
+        showStatus(tr("表数据已在后台刷新，保存或放弃修改后可见"), 5000);
         return;
     }
-    // Disable sorting in data edit mode to prevent row jumping
-    if(pane->currentAction == ViewData){
+    const ConnectionInfo info = ConnectionManager::instance()->connection(pane->connName);
+    if(info.name.isEmpty()){
         return;
     }
-    const int column = pane->sortCombo->currentData().toInt();
-    if(column < 0){
+
+    // Find rows that differ from the cache, matched by primary key when there is one, by
+    // position otherwise
+    QVector<int> keyIndexes;
+    for(const QString &key : qAsConst(pane->keyColumns)){
+        const int index = page.headers.indexOf(key);
+        if(index < 0){
+            keyIndexes.clear();
+            break;
+        }
+        keyIndexes << index;
+    }
+    const bool sameHeaders = page.headers == pane->dataHeaders;
+    auto rowKey = [&keyIndexes](const QStringList &values, int row) {
+        if(keyIndexes.isEmpty()){
+            return QString::number(row);
+        }
+        QStringList parts;
+        for(int index : keyIndexes){
+            parts << values.value(index);
+        }
+        return parts.join(QChar(0x1F));
+    };
+    QHash<QString, QStringList> shown;
+    if(sameHeaders){
+        for(int row = 0; row < pane->resultForm->sourceModel()->rowCount(); ++row){
+            const QStringList values = pane->resultForm->rowValues(row);
+            shown.insert(rowKey(values, row), values);
+        }
+    }
+    QList<int> changed;
+    for(int row = 0; row < page.rows.size(); ++row){
+        QStringList values;
+        for(const QVariant &value : page.rows.at(row)){
+            values << (value.isNull() ? QString() : value.toString());
+        }
+        const auto it = shown.constFind(rowKey(values, row));
+        if(!sameHeaders || it == shown.constEnd() || it.value() != values){
+            changed << row;
+        }
+    }
+
+    const QString dbName = pane->dbName.isEmpty() ? info.defaultDb : pane->dbName;
+    showInspectPage(pane, info, dbName, page,
+                    changed.isEmpty() ? tr("，已刷新") : tr("，已刷新，%1 行有变化").arg(changed.size()));
+    if(!changed.isEmpty() && sameHeaders){
+        pane->blockDataSignal = true;
+        pane->resultForm->highlightRows(changed);
+        pane->blockDataSignal = false;
+    }
+    prefetchInspectPages(pane, info, dbName);
+}
+
+void QueryForm::invalidateInspectPages(InspectPane *pane)
+{
+    pane->pageCache.clear();
+    pane->prefetching.clear();
+    ++pane->pageGeneration;
+}
+
+QCache<QString, QueryForm::RecentPage> &QueryForm::recentPages()
+{
+    // Shared by all query windows, cost in estimated bytes
+    static QCache<QString, RecentPage> cache(kRecentPagesBytes);
+    return cache;
+}
+
+bool QueryForm::showRecentPage(InspectPane *pane)
+{
+    if(!pane || !pane->resultForm || pane->currentAction != ViewData){
+        return false;
+    }
+    const ConnectionInfo info = ConnectionManager::instance()->connection(pane->connName);
+    if(info.name.isEmpty()){
+        return false;
+    }
+    const QString dbName = pane->dbName.isEmpty() ? info.defaultDb : pane->dbName;
+    const QString key = inspectPageKey(pane, dbName);
+    const RecentPage *cached = recentPages().object(key);
+    if(dbName.isEmpty() || !cached){
+        return false;
+    }
+    // Show the data seen last time while querying again in the background
+    const RecentPage recent = *cached;
+    invalidateInspectPages(pane);
+    pane->pageKey = key;
+    pane->dataOffset = recent.offset;
+    pane->keyColumns = recent.keyColumns;
+    pane->indexedColumns = recent.indexedColumns;
+    pane->tableColumns = recent.tableColumns;
+    pane->largeColumns = recent.largeColumns;
+    pane->keysLoaded = true;
+    const qint64 ageSecs = qMax<qint64>(0, (QDateTime::currentMSecsSinceEpoch() - recent.page.fetchedAt) / 1000);
+    const QString age = ageSecs < 60 ? tr("%1 秒前").arg(ageSecs) : tr("%1 分钟前").arg(ageSecs / 60);
+    showInspectPage(pane, info, dbName, recent.page, tr("，%1的缓存，正在刷新").arg(age));
+    fetchPageInBackground(pane, info, dbName, recent.offset, true);
+    return true;
+}
+
+void QueryForm::rememberRecentPage(InspectPane *pane, const QString &dbName, const InspectPage &page)
+{
+    qint64 bytes = 256;
+    for(const QString &header : page.headers){
+        bytes += header.size() * 2 + 32;
+    }
+    for(const QVariantList &row : page.rows){
+        for(const QVariant &value : row){
+            bytes += estimateValueBytes(value) * 2 + 32;
+        }
+    }
+    if(bytes > kRecentPagesBytes){
         return;
     }
-    pane->resultForm->sortByColumnIndex(column, order);
+    auto *recent = new RecentPage;
+    recent->page = page;
+    recent->offset = pane->dataOffset;
+    recent->keyColumns = pane->keyColumns;
+    recent->indexedColumns = pane->indexedColumns;
+    recent->tableColumns = pane->tableColumns;
+    recent->largeColumns = pane->largeColumns;
+    recentPages().insert(inspectPageKey(pane, dbName), recent, int(bytes));
 }
 
 void QueryForm::fetchFirst(InspectPane *pane)
@@ -3975,17 +5601,19 @@ void QueryForm::fetchLast(InspectPane *pane)
     QString dbName = pane->dbName.isEmpty() ? info.defaultDb : pane->dbName;
     const QString connId = QStringLiteral("count_%1").arg(QDateTime::currentMSecsSinceEpoch());
     QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), connId);
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    QString endpointError;
+    const bool endpointOk = ConnectionManager::applyEndpoint(db, info, &endpointError);
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     db.setDatabaseName(dbName);
-    if(!db.open()){
+    if(!endpointOk || !db.open()){
         QSqlDatabase::removeDatabase(connId);
         return;
     }
     QSqlQuery query(db);
-    QString sql = QStringLiteral("SELECT COUNT(*) FROM %1;").arg(qualifiedName(dbName, pane->tableName));
+    const QString sql = QStringLiteral("SELECT COUNT(*) FROM ") + qualifiedName(dbName, pane->tableName)
+            + inspectFilterSql(pane) + QStringLiteral(";");
     if(!query.exec(sql) || !query.next()){
         db.close();
         QSqlDatabase::removeDatabase(connId);
@@ -4,6 +4,7 @@
 #include "connectionmanager.h"
 #include "myedit.h"
 #include "resultform.h"
+#include "sqlsplitter.h"
 
 #include <QCheckBox>
 #include <QComboBox>
@@ -12,7 +13,9 @@
 #include <QPushButton>
 #include <QSplitter>
 #include <QStackedWidget>
+#include <QBitArray>
 #include <QButtonGroup>
+#include <QCache>
 #include <QToolButton>
 #include <QTabWidget>
 #include <QWidget>
@@ -20,11 +23,19 @@
 #include <QTableWidget>
 #include <QPushButton>
 #include <QHash>
+#include <QSet>
 
+class CursorBrowser;
+class ExplainPlanView;
+class FanOutRunner;
+struct FanOutShardResult;
 class FlowLayout;
+class QueryProfilePanel;
 class QSqlQuery;
 class QPlainTextEdit;
 class QSqlDatabase;
+class QSpinBox;
+class QTimer;
 
 class QueryForm : public QWidget
 {
@@ -73,19 +84,49 @@ signals:
 
 private slots:
     void runQuery();
+    void runCurrentStatement();
+    void explainCurrentStatement();
+    void explainAnalyzeCurrentStatement();
+    void runOnConnections();
     void stopQuery();
+    void fetchBrowseWindow();
     void formatSql();
     void updateTitleFromEditor();
 
 private:
+    // A row of the edit journal: exists only for changed rows, with originals copied from
+    // the loaded page on the first change
     struct RowEditState {
-        QString rowId;
         QStringList originalValues;
+        QVector<bool> originalNullFlags;
         QStringList currentValues;
         QVector<bool> currentNullFlags;
+        QSet<int> changedColumns;
         bool inserted = false;
         bool deleted = false;
-        bool updated = false;
+    };
+
+    // One decoded page of table data; can be fetched on a background thread
+    struct InspectPage {
+        QStringList headers;
+        QVector<int> columnTypes;
+        QList<QVariantList> rows;
+        bool hasMore = false;
+        qint64 elapsedMs = 0;
+        qint64 fetchedAt = 0;
+        QString error;
+        QHash<QPair<int, int>, qint64> truncated;  // (row, column) -> full byte length
+    };
+
+    // A recently viewed page, shown first when the table is reopened and then refreshed
+    // in the background
+    struct RecentPage {
+        InspectPage page;
+        int offset = 0;
+        QStringList keyColumns;
+        QSet<QString> indexedColumns;
+        QStringList tableColumns;
+        QSet<QString> largeColumns;
     };
 
     struct InspectPane {
@@ -102,6 +143,8 @@ private:
         QToolButton *viewDataButton = nullptr;
         QToolButton *viewStructureButton = nullptr;
         QLineEdit *filterEdit = nullptr;
+        QToolButton *searchColumnsButton = nullptr;
+        QTimer *searchTimer = nullptr;
         QToolButton *whereSearchButton = nullptr;
         MyEdit *whereEdit = nullptr;
         QPushButton *whereApplyButton = nullptr;
@@ -178,11 +221,33 @@ private:
         QStringList dataHeaders;
         QHash<QString, int> dataHeaderIndex;
         QStringList dataPrimaryKeys;
-        QHash<QString, RowEditState> dataRowStates;
+        // Rows are identified by integer handles: a loaded row's handle is its index in
+        // the page, new rows continue the numbering
+        QList<QVariantList> dataLoadedRows;
+        QVector<int> dataRowHandles;            // model row -> handle
+        QHash<int, RowEditState> dataEdits;     // handle -> edit journal
+        QBitArray dataDirtyRows;                // rows waiting to be saved, by handle
+        int nextRowHandle = 0;
         int dataOffset = 0;
         int dataLimit = 100;
         bool hasMoreData = false;
         QString whereClause;
+        // Sort and search run on the server, built into the query with whereClause and paging
+        QString orderColumn;
+        Qt::SortOrder orderDirection = Qt::AscendingOrder;
+        QString searchText;
+        QStringList searchColumns;      // empty searches every column
+        QStringList keyColumns;         // primary key, appended to the order for stable paging
+        QSet<QString> indexedColumns;   // columns leading some index (lower case)
+        QStringList tableColumns;       // column order of the table definition
+        QSet<QString> largeColumns;     // TEXT/BLOB/JSON columns, fetched as prefix previews
+        bool keysLoaded = false;
+        // Pages cached by offset (LRU, cost in rows) for paging; dropped when the
+        // conditions or data change
+        QCache<int, InspectPage> pageCache{2000};
+        QString pageKey;
+        quint64 pageGeneration = 0;
+        QSet<int> prefetching;
     };
 
     void initialiseUi();
@@ -200,6 +265,15 @@ private:
     void updateDatabaseList();
     void updateCompletionList();
     void showSampleResult();
+    void executeStatements(const QList<SqlStatement> &statements);
+    void browseStatement(const SqlStatement &statement);
+    void clearResultTabs();
+    void explainStatement(const SqlStatement &statement, bool analyze);
+    void handleFanOutShard(const FanOutShardResult &result);
+    void handleFanOutFinished(int succeeded, int failed, qint64 elapsedMs);
+    ResultForm *resultFormAt(int index);
+    void appendExecutionMessage(int index, const SqlStatement &statement,
+                                const QString &text, qint64 elapsedMs);
     ConnectionInfo currentConnectionInfo() const;
     void showStatus(const QString &text, int timeout = 3000);
     QList<ResultForm::ColumnInfo> parseTableStructure(QSqlQuery &query) const;
@@ -217,6 +291,41 @@ private:
     void changeInspectView(InspectPane *pane, TableAction action);
     void updateInspectSortOptions(InspectPane *pane);
     void applyInspectSort(InspectPane *pane, Qt::SortOrder order);
+    void applyInspectSearch(InspectPane *pane);
+    void updateSearchColumnsMenu(InspectPane *pane);
+    void loadInspectKeys(InspectPane *pane, QSqlDatabase &db, const QString &dbName);
+    QString inspectPageKey(const InspectPane *pane, const QString &dbName) const;
+    QString inspectPageSql(const InspectPane *pane, const QString &dbName, int offset) const;
+    QVector<int> inspectPreviewColumns(const InspectPane *pane) const;
+    bool loadFullCellValues(InspectPane *pane, int column, const QList<int> &sourceRows);
+    void showInspectPage(InspectPane *pane,
+                         const ConnectionInfo &info,
+                         const QString &dbName,
+                         const InspectPage &page,
+                         const QString &origin = QString());
+    static bool fetchInspectPage(QSqlDatabase &db,
+                                 const QString &sql,
+                                 int limit,
+                                 const QVector<int> &previewColumns,
+                                 InspectPage *page,
+                                 QString *errorMessage);
+    void prefetchInspectPages(InspectPane *pane, const ConnectionInfo &info, const QString &dbName);
+    void fetchPageInBackground(InspectPane *pane,
+                               const ConnectionInfo &info,
+                               const QString &dbName,
+                               int offset,
+                               bool revalidate);
+    void handleFetchedPage(InspectPane *pane,
+                           quint64 generation,
+                           int offset,
+                           const InspectPage &page,
+                           bool revalidate);
+    void invalidateInspectPages(InspectPane *pane);
+    bool showRecentPage(InspectPane *pane);
+    void rememberRecentPage(InspectPane *pane, const QString &dbName, const InspectPage &page);
+    static QCache<QString, RecentPage> &recentPages();
+    QString inspectFilterSql(const InspectPane *pane) const;
+    QString inspectOrderSql(const InspectPane *pane) const;
     void removeInspectPane(InspectPane *pane);
     void showInspectTabContextMenu(InspectPane *pane, const QPoint &globalPos);
     void closeInspectPane(InspectPane *pane);
@@ -253,6 +362,7 @@ private:
     void updateStructureDirtyState(InspectPane *pane);
     bool ensureStructureChangesHandled(InspectPane *pane, bool allowCancel = true);
     bool ensureIndexChangesHandled(InspectPane *pane);
+    bool ensureDataChangesHandled(InspectPane *pane);
     bool saveStructureChanges(InspectPane *pane);
     void initialiseDataRows(InspectPane *pane,
                             const ConnectionInfo &info,
@@ -262,11 +372,11 @@ private:
     void setupDataConnections(InspectPane *pane);
     void updateDataButtons(InspectPane *pane);
     void markDataDirty(InspectPane *pane);
-    QString generateRowId() const;
-    void tagRowWithId(InspectPane *pane, int row, const QString &rowId);
-    QString rowIdForSourceRow(InspectPane *pane, int sourceRow) const;
+    void clearDataEdits(InspectPane *pane);
+    RowEditState *rowEditFor(InspectPane *pane, int sourceRow, bool create);
+    void setRowDirty(InspectPane *pane, int handle, bool dirty);
     QStringList currentRowValues(InspectPane *pane, int sourceRow) const;
-    void handleDataRowChanged(InspectPane *pane, int sourceRow);
+    void handleDataCellChanged(InspectPane *pane, int sourceRow, int column);
     void addEmptyDataRow(InspectPane *pane);
     void duplicateSelectedRow(InspectPane *pane);
     void appendDataRow(InspectPane *pane, const QStringList &values, const QVector<bool> &nullFlags = {});
@@ -290,12 +400,25 @@ private:
     QComboBox *connCombo = nullptr;
     QComboBox *dbCombo = nullptr;
     QCheckBox *autoCommitCheck = nullptr;
+    QCheckBox *continueOnErrorCheck = nullptr;
+    QCheckBox *profileCheck = nullptr;
+    QCheckBox *binaryCheck = nullptr;
+    QCheckBox *browseCheck = nullptr;
+    QSpinBox *memoryBudgetSpin = nullptr;
     QToolButton *runButton = nullptr;
+    QToolButton *runCurrentButton = nullptr;
+    QToolButton *explainButton = nullptr;
+    QToolButton *runOnConnectionsButton = nullptr;
     QToolButton *stopButton = nullptr;
     QToolButton *formatButton = nullptr;
 
     MyEdit *textEdit = nullptr;
     ResultForm *resultForm = nullptr;
+    QTabWidget *resultTabs = nullptr;
+    QPlainTextEdit *messageLog = nullptr;
+    QList<ResultForm*> extraResultForms;
+    ExplainPlanView *planView = nullptr;
+    QueryProfilePanel *profilePanel = nullptr;
     QStackedWidget *pageStack = nullptr;
     QWidget *queryPage = nullptr;
     QWidget *inspectPage = nullptr;
@@ -307,6 +430,12 @@ private:
     QPushButton *inspectCloseButton = nullptr;
     QList<InspectPane*> inspectPanes;
     bool inExecution = false;
+    CursorBrowser *cursorBrowser = nullptr;
+    FanOutRunner *fanOutRunner = nullptr;
+    QString fanOutSql;
+    QString fanOutDb;
+    int fanOutTotal = 0;
+    int fanOutDone = 0;
 
     QString inspectConn;
     QString inspectDb;
@@ -0,0 +1,578 @@
+#include "queryhistory.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char kReaderConnection[] = "query_history_reader";
+const char kWriterConnection[] = "query_history_writer";
+
+// Writer thread commit interval, and the backlog that triggers an immediate commit
+const int kFlushIntervalMs = 1000;
+const int kFlushThreshold = 64;
+// Most entries the history table keeps; older ids are deleted first
+const qint64 kMaxEntries = 100000;
+const int kPruneEvery = 1000;
+
+QString escapeLike(const QString &text)
+{
+    QString value = text;
+    value.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+    value.replace(QLatin1Char('%'), QStringLiteral("\\%"));
+    value.replace(QLatin1Char('_'), QStringLiteral("\\_"));
+    return value;
+}
+
+qint64 percentile(const QVector<qint64> &sorted, double p)
+{
+    if(sorted.isEmpty()){
+        return 0;
+    }
+    // nearest-rank
+    int rank = static_cast<int>(std::ceil(p * sorted.size())) - 1;
+    rank = qBound(0, rank, sorted.size() - 1);
+    return sorted.at(rank);
+}
+
+bool isIdentChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_') || ch == QLatin1Char('$');
+}
+
+}
+
+QueryHistory *QueryHistory::instance()
+{
+    static QueryHistory *ins = new QueryHistory;
+    return ins;
+}
+
+QueryHistory::QueryHistory(QObject *parent) : QObject(parent)
+{
+    m_thread = new QThread(this);
+    m_writer = new QueryHistoryWriter(storagePath());
+    m_writer->moveToThread(m_thread);
+    connect(m_thread, &QThread::started, m_writer, &QueryHistoryWriter::start);
+    connect(m_thread, &QThread::finished, m_writer, &QObject::deleteLater);
+    connect(m_writer, &QueryHistoryWriter::entriesWritten, this, &QueryHistory::entriesWritten);
+    m_thread->start(QThread::LowPriority);
+}
+
+QString QueryHistory::storagePath() const
+{
+    QDir dir(QCoreApplication::applicationDirPath());
+    return dir.filePath(QStringLiteral("query_history.db"));
+}
+
+void QueryHistory::record(const QueryHistoryEntry &entry)
+{
+    if(!m_writer || entry.sql.trimmed().isEmpty()){
+        return;
+    }
+    QueryHistoryEntry copy = entry;
+    if(copy.digest.isEmpty()){
+        copy.digest = normalizeDigest(copy.sql);
+    }
+    if(!copy.startedAt.isValid()){
+        copy.startedAt = QDateTime::currentDateTime();
+    }
+    m_writer->enqueue(copy);
+    if(m_writer->pendingCount() >= kFlushThreshold){
+        QMetaObject::invokeMethod(m_writer, "flush", Qt::QueuedConnection);
+    }
+}
+
+void QueryHistory::flush()
+{
+    if(!m_writer || !m_thread->isRunning()){
+        return;
+    }
+    QMetaObject::invokeMethod(m_writer, "flush", Qt::BlockingQueuedConnection);
+}
+
+void QueryHistory::shutdown()
+{
+    if(!m_writer || !m_thread->isRunning()){
+        return;
+    }
+    QMetaObject::invokeMethod(m_writer, "stop", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    m_writer = nullptr;
+    if(m_readerOpen){
+        QSqlDatabase::database(QLatin1String(kReaderConnection), false).close();
+        QSqlDatabase::removeDatabase(QLatin1String(kReaderConnection));
+        m_readerOpen = false;
+    }
+}
+
+bool QueryHistory::openReader(QString *errorMessage)
+{
+    // Does not wait for the writer: under WAL the read-only connection sees the committed
+    // snapshot. Queued entries follow, and entriesWritten tells the UI to refresh once
+    // they are on disk
+    if(m_writer && m_thread->isRunning()){
+        QMetaObject::invokeMethod(m_writer, "flush", Qt::QueuedConnection);
+    }
+    if(m_readerOpen){
+        return true;
+    }
+    // No entries yet while the writer thread has not created the database
+    if(!QFileInfo::exists(storagePath())){
+        return false;
+    }
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QLatin1String(kReaderConnection));
+    db.setDatabaseName(storagePath());
+    db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+    if(!db.open()){
+        if(errorMessage){
+            *errorMessage = db.lastError().text();
+        }
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(QLatin1String(kReaderConnection));
+        return false;
+    }
+    m_readerOpen = true;
+    return true;
+}
+
+QList<QueryHistoryEntry> QueryHistory::search(const QString &text,
+                                              const QString &connName,
+                                              int limit,
+                                              QString *errorMessage)
+{
+    QList<QueryHistoryEntry> entries;
+    if(!openReader(errorMessage)){
+        return entries;
+    }
+    QSqlDatabase db = QSqlDatabase::database(QLatin1String(kReaderConnection), false);
+    QString sql = QStringLiteral("SELECT id, started_at, conn_name, db_name, sql_text, digest, "
+                                 "server_ms, fetch_ms, row_count, byte_count, error, "
+                                 "wire_received, wire_sent, round_trips "
+                                 "FROM query_history WHERE 1=1");
+    const QString needle = text.trimmed();
+    if(!needle.isEmpty()){
+        sql += QStringLiteral(" AND sql_text LIKE ? ESCAPE '\\'");
+    }
+    if(!connName.isEmpty()){
+        sql += QStringLiteral(" AND conn_name = ?");
+    }
+    sql += QStringLiteral(" ORDER BY id DESC LIMIT %1").arg(qMax(1, limit));
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    if(!needle.isEmpty()){
+        query.addBindValue(QStringLiteral("%%1%").arg(escapeLike(needle)));
+    }
+    if(!connName.isEmpty()){
+        query.addBindValue(connName);
+    }
+    if(!query.exec()){
+        if(errorMessage){
+            *errorMessage = query.lastError().text();
+        }
+        return entries;
+    }
+    while(query.next()){
+        QueryHistoryEntry entry;
+        entry.id = query.value(0).toLongLong();
+        entry.startedAt = QDateTime::fromMSecsSinceEpoch(query.value(1).toLongLong());
+        entry.connName = query.value(2).toString();
+        entry.dbName = query.value(3).toString();
+        entry.sql = query.value(4).toString();
+        entry.digest = query.value(5).toString();
+        entry.serverMs = query.value(6).toLongLong();
+        entry.fetchMs = query.value(7).toLongLong();
+        entry.rows = query.value(8).toLongLong();
+        entry.bytes = query.value(9).toLongLong();
+        entry.error = query.value(10).toString();
+        entry.wireReceived = query.value(11).toLongLong();
+        entry.wireSent = query.value(12).toLongLong();
+        entry.roundTrips = query.value(13).toLongLong();
+        entries << entry;
+    }
+    return entries;
+}
+
+QList<QueryDigestStats> QueryHistory::digestStats(const QString &text,
+                                                  const QString &connName,
+                                                  int sampleLimit,
+                                                  QString *errorMessage)
+{
+    QList<QueryDigestStats> result;
+    if(!openReader(errorMessage)){
+        return result;
+    }
+    QSqlDatabase db = QSqlDatabase::database(QLatin1String(kReaderConnection), false);
+    // Only the latest sampleLimit entries count; percentiles are computed in memory
+    QString sql = QStringLiteral("SELECT digest, sql_text, server_ms + fetch_ms, row_count, "
+                                 "COALESCE(error, '') <> '', started_at "
+                                 "FROM query_history WHERE 1=1");
+    const QString needle = text.trimmed();
+    if(!needle.isEmpty()){
+        sql += QStringLiteral(" AND digest LIKE ? ESCAPE '\\'");
+    }
+    if(!connName.isEmpty()){
+        sql += QStringLiteral(" AND conn_name = ?");
+    }
+    sql += QStringLiteral(" ORDER BY id DESC LIMIT %1").arg(qMax(1, sampleLimit));
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    if(!needle.isEmpty()){
+        query.addBindValue(QStringLiteral("%%1%").arg(escapeLike(normalizeDigest(needle))));
+    }
+    if(!connName.isEmpty()){
+        query.addBindValue(connName);
+    }
+    if(!query.exec()){
+        if(errorMessage){
+            *errorMessage = query.lastError().text();
+        }
+        return result;
+    }
+
+    QHash<QString, int> indexByDigest;
+    QVector<QVector<qint64>> latencies;
+    while(query.next()){
+        const QString digest = query.value(0).toString();
+        int slot = indexByDigest.value(digest, -1);
+        if(slot < 0){
+            slot = result.size();
+            indexByDigest.insert(digest, slot);
+            QueryDigestStats stats;
+            stats.digest = digest;
+            stats.sampleSql = query.value(1).toString();
+            stats.lastRun = QDateTime::fromMSecsSinceEpoch(query.value(5).toLongLong());
+            result << stats;
+            latencies.append(QVector<qint64>());
+        }
+        QueryDigestStats &stats = result[slot];
+        ++stats.count;
+        stats.totalRows += query.value(3).toLongLong();
+        if(query.value(4).toBool()){
+            ++stats.failed;
+        }else{
+            latencies[slot].append(query.value(2).toLongLong());
+        }
+    }
+    for(int i = 0; i < result.size(); ++i){
+        QVector<qint64> &times = latencies[i];
+        std::sort(times.begin(), times.end());
+        QueryDigestStats &stats = result[i];
+        stats.p50Ms = percentile(times, 0.50);
+        stats.p95Ms = percentile(times, 0.95);
+        stats.maxMs = times.isEmpty() ? 0 : times.last();
+    }
+    std::sort(result.begin(), result.end(), [](const QueryDigestStats &a, const QueryDigestStats &b) {
+        if(a.p95Ms != b.p95Ms){
+            return a.p95Ms > b.p95Ms;
+        }
+        return a.count > b.count;
+    });
+    return result;
+}
+
+bool QueryHistory::clearAll(QString *errorMessage)
+{
+    if(!m_writer){
+        return false;
+    }
+    bool ok = false;
+    QString error;
+    // Deleting needs the writer connection since the reader is read-only; pending entries
+    // are written first and deleted with the rest
+    QMetaObject::invokeMethod(m_writer, [&]() {
+        m_writer->flush();
+        QSqlQuery query(QSqlDatabase::database(QLatin1String(kWriterConnection), false));
+        ok = query.exec(QStringLiteral("DELETE FROM query_history"));
+        if(!ok){
+            error = query.lastError().text();
+        }
+    }, Qt::BlockingQueuedConnection);
+    if(!ok && errorMessage){
+        *errorMessage = error;
+    }
+    return ok;
+}
+
+QString QueryHistory::normalizeDigest(const QString &sql)
+{
+    QString out;
+    out.reserve(sql.size());
+    bool pendingSpace = false;
+    const int len = sql.size();
+    int i = 0;
+    auto emitChar = [&](QChar ch) {
+        if(pendingSpace && !out.isEmpty()){
+            out += QLatin1Char(' ');
+        }
+        pendingSpace = false;
+        out += ch;
+    };
+    while(i < len){
+        const QChar ch = sql.at(i);
+        const QChar next = i + 1 < len ? sql.at(i + 1) : QChar();
+        if(ch.isSpace()){
+            pendingSpace = true;
+            ++i;
+            continue;
+        }
+        // Comments are left out of the digest
+        if(ch == QLatin1Char('#')
+                || (ch == QLatin1Char('-') && next == QLatin1Char('-')
+                    && (i + 2 >= len || sql.at(i + 2).isSpace()))){
+            while(i < len && sql.at(i) != QLatin1Char('\n')){
+                ++i;
+            }
+            pendingSpace = true;
+            continue;
+        }
+        if(ch == QLatin1Char('/') && next == QLatin1Char('*')
+                && !(i + 2 < len && sql.at(i + 2) == QLatin1Char('!'))){
+            const int end = sql.indexOf(QStringLiteral("*/"), i + 2);
+            i = end < 0 ? len : end + 2;
+            pendingSpace = true;
+            continue;
+        }
+        if(ch == QLatin1Char('\'') || ch == QLatin1Char('"')){
+            ++i;
+            while(i < len){
+                const QChar c = sql.at(i);
+                if(c == QLatin1Char('\\')){
+                    i += 2;
+                    continue;
+                }
+                if(c == ch){
+                    if(i + 1 < len && sql.at(i + 1) == ch){
+                        i += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++i;
+            }
+            ++i;
+            emitChar(QLatin1Char('?'));
+            continue;
+        }
+        if(ch == QLatin1Char('`')){
+            const int end = sql.indexOf(QLatin1Char('`'), i + 1);
+            const int stop = end < 0 ? len : end + 1;
+            if(pendingSpace && !out.isEmpty()){
+                out += QLatin1Char(' ');
+            }
+            pendingSpace = false;
+            out += sql.midRef(i, stop - i);
+            i = stop;
+            continue;
+        }
+        const bool prevIdent = !out.isEmpty() && !pendingSpace && isIdentChar(out.at(out.size() - 1));
+        if(ch.isDigit() && !prevIdent){
+            // Numbers (hex, decimals and exponents too) become ?
+            ++i;
+            while(i < len && (sql.at(i).isLetterOrNumber() || sql.at(i) == QLatin1Char('.'))){
+                ++i;
+            }
+            emitChar(QLatin1Char('?'));
+            continue;
+        }
+        if(isIdentChar(ch)){
+            const int start = i;
+            while(i < len && isIdentChar(sql.at(i))){
+                ++i;
+            }
+            if(pendingSpace && !out.isEmpty()){
+                out += QLatin1Char(' ');
+            }
+            pendingSpace = false;
+            out += sql.midRef(start, i - start).toString().toLower();
+            continue;
+        }
+        emitChar(ch);
+        ++i;
+    }
+    while(out.endsWith(QLatin1Char(';')) || out.endsWith(QLatin1Char(' '))){
+        out.chop(1);
+    }
+    // IN (?, ?, ?) lists and multi-row VALUES fold into one digest
+    static const QRegularExpression listRe(QStringLiteral("\\(\\s*\\?(\\s*,\\s*\\?)+\\s*\\)"));
+    static const QRegularExpression rowsRe(QStringLiteral("\\((\\?|\\.\\.\\.)\\)(\\s*,\\s*\\((\\?|\\.\\.\\.)\\))+"));
+    out.replace(listRe, QStringLiteral("(...)"));
+    out.replace(rowsRe, QStringLiteral("(...)"));
+    return out;
+}
+
+QueryHistoryWriter::QueryHistoryWriter(const QString &path)
+    : m_path(path),
+      m_connId(QLatin1String(kWriterConnection))
+{
+}
+
+void QueryHistoryWriter::enqueue(const QueryHistoryEntry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending.append(entry);
+}
+
+int QueryHistoryWriter::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.size();
+}
+
+void QueryHistoryWriter::start()
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_connId);
+    db.setDatabaseName(m_path);
+    if(db.open()){
+        QSqlQuery pragma(db);
+        // WAL lets the UI thread's read-only connection run alongside the writer
+        pragma.exec(QStringLiteral("PRAGMA journal_mode=WAL"));
+        pragma.exec(QStringLiteral("PRAGMA synchronous=NORMAL"));
+        m_ready = ensureSchema();
+    }
+    if(!m_ready){
+        qWarning("Query history disabled: %s", qPrintable(db.lastError().text()));
+    }
+    m_timer = new QTimer(this);
+    m_timer->setInterval(kFlushIntervalMs);
+    connect(m_timer, &QTimer::timeout, this, &QueryHistoryWriter::flush);
+    m_timer->start();
+}
+
+bool QueryHistoryWriter::ensureSchema()
+{
+    QSqlQuery query(QSqlDatabase::database(m_connId, false));
+    const QStringList statements = {
+        QStringLiteral("CREATE TABLE IF NOT EXISTS query_history ("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                       "started_at INTEGER NOT NULL, "
+                       "conn_name TEXT, "
+                       "db_name TEXT, "
+                       "sql_text TEXT NOT NULL, "
+                       "digest TEXT NOT NULL, "
+                       "server_ms INTEGER NOT NULL DEFAULT 0, "
+                       "fetch_ms INTEGER NOT NULL DEFAULT 0, "
+                       "row_count INTEGER NOT NULL DEFAULT 0, "
+                       "byte_count INTEGER NOT NULL DEFAULT 0, "
+                       "error TEXT, "
+                       "wire_received INTEGER NOT NULL DEFAULT 0, "
+                       "wire_sent INTEGER NOT NULL DEFAULT 0, "
+                       "round_trips INTEGER NOT NULL DEFAULT 0)"),
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_query_history_digest ON query_history(digest)"),
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_query_history_conn ON query_history(conn_name)")
+    };
+    for(const QString &sql : statements){
+        if(!query.exec(sql)){
+            qWarning("Query history schema error: %s", qPrintable(query.lastError().text()));
+            return false;
+        }
+    }
+    // Tables created by older versions lack the network columns; add them as needed
+    QSet<QString> columns;
+    if(query.exec(QStringLiteral("PRAGMA table_info(query_history)"))){
+        while(query.next()){
+            columns.insert(query.value(1).toString());
+        }
+    }
+    const QStringList wireColumns = {
+        QStringLiteral("wire_received"),
+        QStringLiteral("wire_sent"),
+        QStringLiteral("round_trips")
+    };
+    for(const QString &column : wireColumns){
+        if(columns.contains(column)){
+            continue;
+        }
+        if(!query.exec(QStringLiteral("ALTER TABLE query_history ADD COLUMN %1 INTEGER NOT NULL DEFAULT 0").arg(column))){
+            qWarning("Query history schema error: %s", qPrintable(query.lastError().text()));
+            return false;
+        }
+    }
+    return true;
+}
+
+void QueryHistoryWriter::flush()
+{
+    QList<QueryHistoryEntry> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_pending);
+    }
+    if(batch.isEmpty() || !m_ready){
+        return;
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connId, false);
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare(QStringLiteral("INSERT INTO query_history (started_at, conn_name, db_name, sql_text, digest, "
+                                 "server_ms, fetch_ms, row_count, byte_count, error, "
+                                 "wire_received, wire_sent, round_trips) "
+                                 "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    for(const QueryHistoryEntry &entry : qAsConst(batch)){
+        query.addBindValue(entry.startedAt.toMSecsSinceEpoch());
+        query.addBindValue(entry.connName);
+        query.addBindValue(entry.dbName);
+        query.addBindValue(entry.sql);
+        query.addBindValue(entry.digest);
+        query.addBindValue(entry.serverMs);
+        query.addBindValue(entry.fetchMs);
+        query.addBindValue(entry.rows);
+        query.addBindValue(entry.bytes);
+        query.addBindValue(entry.error.isEmpty() ? QVariant(QVariant::String) : QVariant(entry.error));
+        query.addBindValue(entry.wireReceived);
+        query.addBindValue(entry.wireSent);
+        query.addBindValue(entry.roundTrips);
+        if(!query.exec()){
+            qWarning("Query history write error: %s", qPrintable(query.lastError().text()));
+        }
+    }
+    db.commit();
+    m_writesSincePrune += batch.size();
+    if(m_writesSincePrune >= kPruneEvery){
+        m_writesSincePrune = 0;
+        prune();
+    }
+    emit entriesWritten();
+}
+
+void QueryHistoryWriter::prune()
+{
+    QSqlQuery query(QSqlDatabase::database(m_connId, false));
+    query.prepare(QStringLiteral("DELETE FROM query_history WHERE id <= (SELECT MAX(id) FROM query_history) - ?"));
+    query.addBindValue(kMaxEntries);
+    query.exec();
+}
+
+void QueryHistoryWriter::stop()
+{
+    flush();
+    if(m_timer){
+        m_timer->stop();
+    }
+    {
+        QSqlDatabase db = QSqlDatabase::database(m_connId, false);
+        if(db.isValid()){
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(m_connId);
+    m_ready = false;
+}
@@ -0,0 +1,116 @@
+#ifndef QUERYHISTORY_H
+#define QUERYHISTORY_H
+
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+class QThread;
+class QTimer;
+
+struct QueryHistoryEntry {
+    qint64 id = 0;
+    QString sql;
+    QString digest;
+    QString connName;
+    QString dbName;
+    QDateTime startedAt;
+    qint64 serverMs = 0;
+    qint64 fetchMs = 0;
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    // bytes on the wire (after compression) and round trips of the session
+    qint64 wireReceived = 0;
+    qint64 wireSent = 0;
+    qint64 roundTrips = 0;
+    QString error;
+};
+
+struct QueryDigestStats {
+    QString digest;
+    QString sampleSql;
+    int count = 0;
+    int failed = 0;
+    qint64 p50Ms = 0;
+    qint64 p95Ms = 0;
+    qint64 maxMs = 0;
+    qint64 totalRows = 0;
+    QDateTime lastRun;
+};
+
+class QueryHistoryWriter;
+
+// Local, append-only query history kept in a SQLite file next to
+// connections.json. record() only queues the entry; a writer thread commits
+// queued entries in batches so the GUI thread never waits on disk. Searches
+// read the last committed snapshot and entriesWritten() signals newer rows.
+class QueryHistory : public QObject
+{
+    Q_OBJECT
+public:
+    static QueryHistory *instance();
+
+    void record(const QueryHistoryEntry &entry);
+    void flush();
+    void shutdown();
+
+    QList<QueryHistoryEntry> search(const QString &text,
+                                    const QString &connName = QString(),
+                                    int limit = 500,
+                                    QString *errorMessage = nullptr);
+    QList<QueryDigestStats> digestStats(const QString &text,
+                                        const QString &connName = QString(),
+                                        int sampleLimit = 20000,
+                                        QString *errorMessage = nullptr);
+    bool clearAll(QString *errorMessage = nullptr);
+
+    QString storagePath() const;
+
+    static QString normalizeDigest(const QString &sql);
+
+signals:
+    void entriesWritten();
+
+private:
+    explicit QueryHistory(QObject *parent = nullptr);
+
+    bool openReader(QString *errorMessage);
+
+    QThread *m_thread = nullptr;
+    QueryHistoryWriter *m_writer = nullptr;
+    bool m_readerOpen = false;
+};
+
+class QueryHistoryWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QueryHistoryWriter(const QString &path);
+
+    void enqueue(const QueryHistoryEntry &entry);
+    int pendingCount() const;
+
+public slots:
+    void start();
+    void flush();
+    void stop();
+
+signals:
+    void entriesWritten();
+
+private:
+    bool ensureSchema();
+    void prune();
+
+    QString m_path;
+    QString m_connId;
+    mutable QMutex m_mutex;
+    QList<QueryHistoryEntry> m_pending;
+    QTimer *m_timer = nullptr;
+    bool m_ready = false;
+    int m_writesSincePrune = 0;
+};
+
+#endif // QUERYHISTORY_H
@@ -0,0 +1,317 @@
+#include "queryhistorydialog.h"
+#include "connectionmanager.h"
+#include "languagemanager.h"
+#include "queryhistory.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QColor>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QIcon>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+namespace {
+
+const int kHistoryLimit = 1000;
+const int kSqlPreviewChars = 300;
+// List cells keep the full SQL, connection and database
+const int SqlRole = Qt::UserRole + 1;
+const int ConnRole = Qt::UserRole + 2;
+const int DbRole = Qt::UserRole + 3;
+
+QString previewSql(const QString &sql)
+{
+    QString text = sql.simplified();
+    if(text.size() > kSqlPreviewChars){
+        text = text.left(kSqlPreviewChars) + QStringLiteral("...");
+    }
+    return text;
+}
+
+QString formatBytes(qint64 bytes)
+{
+    const double value = static_cast<double>(bytes);
+    if(bytes >= 1024 * 1024){
+        return QStringLiteral("%1 MB").arg(value / (1024.0 * 1024), 0, 'f', 1);
+    }
+    if(bytes >= 1024){
+        return QStringLiteral("%1 KB").arg(value / 1024.0, 0, 'f', 1);
+    }
+    return QStringLiteral("%1 B").arg(bytes);
+}
+
+QTableWidgetItem *numberItem(qint64 value)
+{
+    auto *item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, value);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+QTableWidget *createTable(const QStringList &headers, QWidget *parent)
+{
+    auto *table = new QTableWidget(parent);
+    table->setColumnCount(headers.size());
+    table->setHorizontalHeaderLabels(headers);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->setWordWrap(false);
+    table->verticalHeader()->setVisible(false);
+    table->verticalHeader()->setDefaultSectionSize(24);
+    table->horizontalHeader()->setStretchLastSection(true);
+    return table;
+}
+
+}
+
+QueryHistoryDialog::QueryHistoryDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(trLang(QStringLiteral("查询历史"), QStringLiteral("Query History")));
+    setWindowIcon(QIcon(QStringLiteral(":/images/history.svg")));
+    resize(1100, 640);
+    buildUi();
+    loadConnections();
+    refresh();
+
+    // Refresh a little after new entries land so back-to-back runs do not keep rebuilding the table
+    connect(QueryHistory::instance(), &QueryHistory::entriesWritten, this, [this]() {
+        if(isVisible()){
+            refreshTimer->start();
+        }
+    });
+}
+
+void QueryHistoryDialog::buildUi()
+{
+    auto *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(12, 12, 12, 12);
+    mainLayout->setSpacing(8);
+
+    auto *filterLayout = new QHBoxLayout;
+    searchEdit = new QLineEdit(this);
+    searchEdit->setClearButtonEnabled(true);
+    searchEdit->setPlaceholderText(trLang(QStringLiteral("搜索 SQL"), QStringLiteral("Search SQL")));
+    connCombo = new QComboBox(this);
+    connCombo->setMinimumWidth(180);
+    filterLayout->addWidget(searchEdit, 1);
+    filterLayout->addWidget(new QLabel(trLang(QStringLiteral("连接："), QStringLiteral("Connection:")), this));
+    filterLayout->addWidget(connCombo);
+    mainLayout->addLayout(filterLayout);
+
+    tabs = new QTabWidget(this);
+    tabs->setDocumentMode(true);
+    historyTable = createTable({trLang(QStringLiteral("开始时间"), QStringLiteral("Started")),
+                                trLang(QStringLiteral("连接"), QStringLiteral("Connection")),
+                                trLang(QStringLiteral("数据库"), QStringLiteral("Database")),
+                                trLang(QStringLiteral("服务器(ms)"), QStringLiteral("Server (ms)")),
+                                trLang(QStringLiteral("获取(ms)"), QStringLiteral("Fetch (ms)")),
+                                trLang(QStringLiteral("行数"), QStringLiteral("Rows")),
+                                trLang(QStringLiteral("数据量"), QStringLiteral("Bytes")),
+                                trLang(QStringLiteral("网络收/发"), QStringLiteral("Wire In/Out")),
+                                trLang(QStringLiteral("往返"), QStringLiteral("Round Trips")),
+                                trLang(QStringLiteral("SQL"), QStringLiteral("SQL")),
+                                trLang(QStringLiteral("错误"), QStringLiteral("Error"))}, tabs);
+    statsTable = createTable({trLang(QStringLiteral("次数"), QStringLiteral("Count")),
+                              trLang(QStringLiteral("失败"), QStringLiteral("Failed")),
+                              QStringLiteral("p50 (ms)"),
+                              QStringLiteral("p95 (ms)"),
+                              trLang(QStringLiteral("最大(ms)"), QStringLiteral("Max (ms)")),
+                              trLang(QStringLiteral("平均行数"), QStringLiteral("Avg Rows")),
+                              trLang(QStringLiteral("最近执行"), QStringLiteral("Last Run")),
+                              trLang(QStringLiteral("摘要"), QStringLiteral("Digest"))}, tabs);
+    statsTable->horizontalHeader()->setSortIndicator(3, Qt::DescendingOrder);
+    tabs->addTab(historyTable, trLang(QStringLiteral("历史"), QStringLiteral("History")));
+    tabs->addTab(statsTable, trLang(QStringLiteral("按摘要统计"), QStringLiteral("By Digest")));
+    mainLayout->addWidget(tabs, 1);
+
+    auto *buttonLayout = new QHBoxLayout;
+    statusLabel = new QLabel(this);
+    buttonLayout->addWidget(statusLabel, 1);
+    openButton = new QPushButton(trLang(QStringLiteral("在编辑器中打开"), QStringLiteral("Open in Editor")), this);
+    copyButton = new QPushButton(trLang(QStringLiteral("复制 SQL"), QStringLiteral("Copy SQL")), this);
+    clearButton = new QPushButton(trLang(QStringLiteral("清空历史"), QStringLiteral("Clear History")), this);
+    closeButton = new QPushButton(trLang(QStringLiteral("关闭"), QStringLiteral("Close")), this);
+    buttonLayout->addWidget(openButton);
+    buttonLayout->addWidget(copyButton);
+    buttonLayout->addWidget(clearButton);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(250);
+    connect(refreshTimer, &QTimer::timeout, this, &QueryHistoryDialog::refresh);
+    connect(searchEdit, &QLineEdit::textChanged, refreshTimer, [this]() { refreshTimer->start(); });
+    connect(connCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QueryHistoryDialog::refresh);
+    connect(tabs, &QTabWidget::currentChanged, this, &QueryHistoryDialog::refresh);
+    connect(historyTable, &QTableWidget::cellDoubleClicked, this, &QueryHistoryDialog::openSelected);
+    connect(statsTable, &QTableWidget::cellDoubleClicked, this, &QueryHistoryDialog::openSelected);
+    connect(openButton, &QPushButton::clicked, this, &QueryHistoryDialog::openSelected);
+    connect(copyButton, &QPushButton::clicked, this, &QueryHistoryDialog::copySelected);
+    connect(clearButton, &QPushButton::clicked, this, &QueryHistoryDialog::clearHistory);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+}
+
+void QueryHistoryDialog::loadConnections()
+{
+    const QSignalBlocker blocker(connCombo);
+    connCombo->clear();
+    connCombo->addItem(trLang(QStringLiteral("全部"), QStringLiteral("All")), QString());
+    const auto connections = ConnectionManager::instance()->connections();
+    for(const auto &info : connections){
+        connCombo->addItem(info.name, info.name);
+    }
+}
+
+QTableWidget *QueryHistoryDialog::currentTable() const
+{
+    return tabs->currentWidget() == statsTable ? statsTable : historyTable;
+}
+
+void QueryHistoryDialog::refresh()
+{
+    if(tabs->currentWidget() == statsTable){
+        refreshStats();
+    }else{
+        refreshHistory();
+    }
+}
+
+void QueryHistoryDialog::refreshHistory()
+{
+    QString error;
+    const auto entries = QueryHistory::instance()->search(searchEdit->text(),
+                                                          connCombo->currentData().toString(),
+                                                          kHistoryLimit,
+                                                          &error);
+    historyTable->setSortingEnabled(false);
+    historyTable->setRowCount(entries.size());
+    for(int row = 0; row < entries.size(); ++row){
+        const QueryHistoryEntry &entry = entries.at(row);
+        auto *timeItem = new QTableWidgetItem(entry.startedAt.toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")));
+        timeItem->setData(SqlRole, entry.sql);
+        timeItem->setData(ConnRole, entry.connName);
+        timeItem->setData(DbRole, entry.dbName);
+        historyTable->setItem(row, 0, timeItem);
+        historyTable->setItem(row, 1, new QTableWidgetItem(entry.connName));
+        historyTable->setItem(row, 2, new QTableWidgetItem(entry.dbName));
+        historyTable->setItem(row, 3, numberItem(entry.serverMs));
+        historyTable->setItem(row, 4, numberItem(entry.fetchMs));
+        historyTable->setItem(row, 5, numberItem(entry.rows));
+        auto *bytesItem = new QTableWidgetItem(formatBytes(entry.bytes));
+        bytesItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        historyTable->setItem(row, 6, bytesItem);
+        // Batches of several statements do not sample traffic per statement
+        const bool hasWire = entry.wireReceived > 0 || entry.wireSent > 0;
+        auto *wireItem = new QTableWidgetItem(hasWire ? QStringLiteral("%1 / %2").arg(formatBytes(entry.wireReceived),
+                                                                                        formatBytes(entry.wireSent))
+                                                      : QString());
+        wireItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        historyTable->setItem(row, 7, wireItem);
+        historyTable->setItem(row, 8, numberItem(entry.roundTrips));
+        auto *sqlItem = new QTableWidgetItem(previewSql(entry.sql));
+        sqlItem->setToolTip(entry.sql.left(4000));
+        historyTable->setItem(row, 9, sqlItem);
+        auto *errorItem = new QTableWidgetItem(entry.error);
+        if(!entry.error.isEmpty()){
+            errorItem->setForeground(QColor(200, 40, 40));
+            errorItem->setToolTip(entry.error);
+        }
+        historyTable->setItem(row, 10, errorItem);
+    }
+    historyTable->setSortingEnabled(true);
+    historyTable->resizeColumnsToContents();
+    historyTable->setColumnWidth(9, qMin(historyTable->columnWidth(9), 520));
+    if(!error.isEmpty()){
+        statusLabel->setText(error);
+    }else{
+        statusLabel->setText(trLang(QStringLiteral("共 %1 条"), QStringLiteral("%1 entries")).arg(entries.size()));
+    }
+}
+
+void QueryHistoryDialog::refreshStats()
+{
+    QString error;
+    const auto stats = QueryHistory::instance()->digestStats(searchEdit->text(),
+                                                             connCombo->currentData().toString(),
+                                                             20000,
+                                                             &error);
+    statsTable->setSortingEnabled(false);
+    statsTable->setRowCount(stats.size());
+    for(int row = 0; row < stats.size(); ++row){
+        const QueryDigestStats &item = stats.at(row);
+        auto *countItem = numberItem(item.count);
+        countItem->setData(SqlRole, item.sampleSql);
+        statsTable->setItem(row, 0, countItem);
+        statsTable->setItem(row, 1, numberItem(item.failed));
+        statsTable->setItem(row, 2, numberItem(item.p50Ms));
+        statsTable->setItem(row, 3, numberItem(item.p95Ms));
+        statsTable->setItem(row, 4, numberItem(item.maxMs));
+        statsTable->setItem(row, 5, numberItem(item.count > 0 ? item.totalRows / item.count : 0));
+        statsTable->setItem(row, 6, new QTableWidgetItem(item.lastRun.toString(QStringLiteral("yyyy-MM-dd HH:mm:ss"))));
+        auto *digestItem = new QTableWidgetItem(previewSql(item.digest));
+        digestItem->setToolTip(item.digest.left(4000));
+        statsTable->setItem(row, 7, digestItem);
+    }
+    statsTable->setSortingEnabled(true);
+    statsTable->resizeColumnsToContents();
+    if(!error.isEmpty()){
+        statusLabel->setText(error);
+    }else{
+        statusLabel->setText(trLang(QStringLiteral("共 %1 类语句"), QStringLiteral("%1 digests")).arg(stats.size()));
+    }
+}
+
+void QueryHistoryDialog::openSelected()
+{
+    QTableWidget *table = currentTable();
+    const int row = table->currentRow();
+    if(row < 0){
+        return;
+    }
+    QTableWidgetItem *item = table->item(row, 0);
+    if(!item){
+        return;
+    }
+    emit openSqlRequested(item->data(SqlRole).toString(),
+                          item->data(ConnRole).toString(),
+                          item->data(DbRole).toString());
+}
+
+void QueryHistoryDialog::copySelected()
+{
+    QTableWidget *table = currentTable();
+    const int row = table->currentRow();
+    if(row < 0 || !table->item(row, 0)){
+        return;
+    }
+    QApplication::clipboard()->setText(table->item(row, 0)->data(SqlRole).toString());
+}
+
+void QueryHistoryDialog::clearHistory()
+{
+    const auto answer = QMessageBox::question(this,
+                                              trLang(QStringLiteral("清空历史"), QStringLiteral("Clear History")),
+                                              trLang(QStringLiteral("确定删除全部查询历史吗？"),
+                                                     QStringLiteral("Delete the whole query history?")));
+    if(answer != QMessageBox::Yes){
+        return;
+    }
+    QString error;
+    if(!QueryHistory::instance()->clearAll(&error)){
+        QMessageBox::warning(this, windowTitle(), error);
+    }
+    refresh();
+}
@@ -0,0 +1,49 @@
+#ifndef QUERYHISTORYDIALOG_H
+#define QUERYHISTORYDIALOG_H
+
+#include <QDialog>
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTabWidget;
+class QTableWidget;
+class QTimer;
+
+class QueryHistoryDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit QueryHistoryDialog(QWidget *parent = nullptr);
+
+signals:
+    void openSqlRequested(const QString &sql, const QString &connName, const QString &dbName);
+
+private slots:
+    void refresh();
+    void clearHistory();
+    void openSelected();
+    void copySelected();
+
+private:
+    void buildUi();
+    void loadConnections();
+    void refreshHistory();
+    void refreshStats();
+    QTableWidget *currentTable() const;
+
+    QLineEdit *searchEdit = nullptr;
+    QComboBox *connCombo = nullptr;
+    QTabWidget *tabs = nullptr;
+    QTableWidget *historyTable = nullptr;
+    QTableWidget *statsTable = nullptr;
+    QLabel *statusLabel = nullptr;
+    QPushButton *openButton = nullptr;
+    QPushButton *copyButton = nullptr;
+    QPushButton *clearButton = nullptr;
+    QPushButton *closeButton = nullptr;
+    QTimer *refreshTimer = nullptr;
+};
+
+#endif // QUERYHISTORYDIALOG_H
@@ -0,0 +1,347 @@
+#include "queryprofiler.h"
+
+#include <QColor>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+// Every statement the profiler runs carries this marker so it is left out of
+// performance_schema / SHOW PROFILES
+const char kMarker[] = "/* opendbkit_profile */ ";
+const char kMarkerName[] = "opendbkit_profile";
+
+QString markedSql(const QString &sql)
+{
+    return QLatin1String(kMarker) + sql;
+}
+
+// performance_schema times are in picoseconds
+double picoToMs(const QVariant &value)
+{
+    return value.toDouble() / 1000000000.0;
+}
+
+QString formatMs(double ms)
+{
+    if(ms < 0){
+        return QString();
+    }
+    return QString::number(ms, 'f', ms < 10 ? 3 : 1);
+}
+
+QTreeWidgetItem *addMetric(QTreeWidgetItem *parent, const QString &name, const QString &value, bool warn = false)
+{
+    auto *item = new QTreeWidgetItem(parent, {name, value});
+    item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+    if(warn){
+        item->setForeground(0, QColor(200, 40, 40));
+        item->setForeground(1, QColor(200, 40, 40));
+    }
+    return item;
+}
+
+void addCount(QTreeWidgetItem *parent, const QString &name, qint64 value, bool warnIfPositive = false)
+{
+    if(value < 0){
+        return;
+    }
+    addMetric(parent, name, QString::number(value), warnIfPositive && value > 0);
+}
+
+}
+
+QueryProfiler::QueryProfiler(const QSqlDatabase &db)
+    : m_db(db)
+{
+}
+
+void QueryProfiler::begin()
+{
+    QSqlQuery query(m_db);
+    if(query.exec(markedSql(QStringLiteral("SELECT @@performance_schema"))) && query.next()
+            && query.value(0).toInt() == 1){
+        if(query.exec(markedSql(QStringLiteral("SELECT THREAD_ID FROM performance_schema.threads "
+                                               "WHERE PROCESSLIST_ID = CONNECTION_ID()")))
+                && query.next()){
+            m_threadId = query.value(0).toLongLong();
+            m_performanceSchema = true;
+        }else{
+            m_notes << QObject::tr("performance_schema is not readable: %1").arg(query.lastError().text());
+        }
+    }else{
+        m_notes << QObject::tr("performance_schema is disabled, statement metrics come from session status.");
+    }
+    // Stage timings fall back to SHOW PROFILE when performance_schema does not collect stages
+    m_profiling = query.exec(markedSql(QStringLiteral("SET SESSION profiling = 1")));
+
+    // The difference between two back-to-back snapshots is what SHOW STATUS itself adds
+    const auto first = sessionStatus();
+    const auto second = sessionStatus();
+    for(auto it = second.cbegin(); it != second.cend(); ++it){
+        const qint64 delta = it.value() - first.value(it.key());
+        if(delta > 0){
+            m_overhead.insert(it.key(), delta);
+        }
+    }
+}
+
+void QueryProfiler::beforeStatement()
+{
+    m_before = sessionStatus();
+}
+
+StatementProfile QueryProfiler::afterStatement(int index, const QString &sql, qint64 wallMs)
+{
+    StatementProfile profile;
+    profile.index = index;
+    profile.sql = sql;
+    profile.wallMs = wallMs;
+
+    const auto after = sessionStatus();
+    QHash<QString, qint64> delta;
+    QStringList names = after.keys();
+    std::sort(names.begin(), names.end());
+    for(const QString &name : qAsConst(names)){
+        const qint64 value = after.value(name) - m_before.value(name) - m_overhead.value(name);
+        if(value > 0){
+            delta.insert(name, value);
+            profile.statusDeltas << qMakePair(name, value);
+        }
+    }
+
+    if(m_performanceSchema){
+        readStatementEvent(profile);
+    }
+    if(!profile.hasStatementEvent){
+        // Approximate with session status when there are no statement events
+        qint64 examined = 0;
+        for(auto it = delta.cbegin(); it != delta.cend(); ++it){
+            if(it.key().startsWith(QLatin1String("Handler_read_"))){
+                examined += it.value();
+            }
+        }
+        profile.rowsExamined = examined;
+        profile.tmpTables = delta.value(QStringLiteral("Created_tmp_tables"));
+        profile.tmpDiskTables = delta.value(QStringLiteral("Created_tmp_disk_tables"));
+        profile.sortMergePasses = delta.value(QStringLiteral("Sort_merge_passes"));
+        profile.sortRows = delta.value(QStringLiteral("Sort_rows"));
+        profile.selectFullJoin = delta.value(QStringLiteral("Select_full_join"));
+        profile.selectScan = delta.value(QStringLiteral("Select_scan"));
+    }
+    if(profile.stages.isEmpty() && m_profiling){
+        readProfileStages(profile);
+    }
+    return profile;
+}
+
+void QueryProfiler::end()
+{
+    if(m_profiling){
+        QSqlQuery query(m_db);
+        query.exec(markedSql(QStringLiteral("SET SESSION profiling = 0")));
+    }
+}
+
+QHash<QString, qint64> QueryProfiler::sessionStatus()
+{
+    QHash<QString, qint64> values;
+    QSqlQuery query(m_db);
+    if(!query.exec(markedSql(QStringLiteral("SHOW SESSION STATUS WHERE Variable_name REGEXP "
+                                            "'^(Handler_|Innodb_rows_|Innodb_buffer_pool_read|"
+                                            "Created_tmp|Sort_|Select_|Bytes_)'")))){
+        return values;
+    }
+    while(query.next()){
+        bool ok = false;
+        const qint64 value = query.value(1).toLongLong(&ok);
+        if(ok){
+            values.insert(query.value(0).toString(), value);
+        }
+    }
+    return values;
+}
+
+void QueryProfiler::readStatementEvent(StatementProfile &profile)
+{
+    QSqlQuery query(m_db);
+    const QString sql = QStringLiteral(
+        "SELECT EVENT_ID, TIMER_WAIT, LOCK_TIME, ROWS_EXAMINED, ROWS_SENT, ROWS_AFFECTED, "
+        "CREATED_TMP_TABLES, CREATED_TMP_DISK_TABLES, SORT_MERGE_PASSES, SORT_ROWS, "
+        "SELECT_FULL_JOIN, SELECT_SCAN, NO_INDEX_USED "
+        "FROM performance_schema.events_statements_history "
+        "WHERE THREAD_ID = %1 "
+        "AND (NESTING_EVENT_TYPE IS NULL OR NESTING_EVENT_TYPE = 'TRANSACTION') "
+        "AND COALESCE(SQL_TEXT, '') NOT LIKE '%%2%' "
+        "ORDER BY EVENT_ID DESC LIMIT 1").arg(m_threadId).arg(QLatin1String(kMarkerName));
+    if(!query.exec(markedSql(sql)) || !query.next()){
+        return;
+    }
+    const qint64 eventId = query.value(0).toLongLong();
+    profile.hasStatementEvent = true;
+    profile.serverMs = picoToMs(query.value(1));
+    profile.lockMs = picoToMs(query.value(2));
+    profile.rowsExamined = query.value(3).toLongLong();
+    profile.rowsSent = query.value(4).toLongLong();
+    profile.rowsAffected = query.value(5).toLongLong();
+    profile.tmpTables = query.value(6).toLongLong();
+    profile.tmpDiskTables = query.value(7).toLongLong();
+    profile.sortMergePasses = query.value(8).toLongLong();
+    profile.sortRows = query.value(9).toLongLong();
+    profile.selectFullJoin = query.value(10).toLongLong();
+    profile.selectScan = query.value(11).toLongLong();
+    profile.noIndexUsed = query.value(12).toLongLong() > 0;
+
+    // Stage events need stage instrumentation on the server; without data the caller
+    // falls back to SHOW PROFILE
+    const QString stageSql = QStringLiteral(
+        "SELECT EVENT_NAME, TIMER_WAIT FROM performance_schema.events_stages_history_long "
+        "WHERE THREAD_ID = %1 AND NESTING_EVENT_ID = %2 ORDER BY EVENT_ID").arg(m_threadId).arg(eventId);
+    if(!query.exec(markedSql(stageSql))){
+        return;
+    }
+    while(query.next()){
+        QString name = query.value(0).toString();
+        name.remove(QStringLiteral("stage/sql/"));
+        const double ms = picoToMs(query.value(1));
+        if(!profile.stages.isEmpty() && profile.stages.last().first == name){
+            profile.stages.last().second += ms;
+        }else{
+            profile.stages << qMakePair(name, ms);
+        }
+    }
+    if(!profile.stages.isEmpty()){
+        profile.stageSource = QStringLiteral("performance_schema");
+    }
+}
+
+void QueryProfiler::readProfileStages(StatementProfile &profile)
+{
+    QSqlQuery query(m_db);
+    if(!query.exec(markedSql(QStringLiteral("SHOW PROFILES")))){
+        return;
+    }
+    qint64 queryId = -1;
+    while(query.next()){
+        if(!query.value(2).toString().contains(QLatin1String(kMarkerName))){
+            queryId = query.value(0).toLongLong();
+        }
+    }
+    if(queryId < 0){
+        return;
+    }
+    if(!query.exec(markedSql(QStringLiteral("SHOW PROFILE FOR QUERY %1").arg(queryId)))){
+        return;
+    }
+    while(query.next()){
+        profile.stages << qMakePair(query.value(0).toString(), query.value(1).toDouble() * 1000.0);
+    }
+    if(!profile.stages.isEmpty()){
+        profile.stageSource = QStringLiteral("SHOW PROFILE");
+    }
+}
+
+QueryProfilePanel::QueryProfilePanel(QWidget *parent) : QWidget(parent)
+{
+    auto *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(4);
+    noteLabel = new QLabel(this);
+    noteLabel->setContentsMargins(6, 4, 6, 0);
+    noteLabel->setWordWrap(true);
+    noteLabel->hide();
+    layout->addWidget(noteLabel);
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels({tr("Metric"), tr("Value")});
+    tree->setUniformRowHeights(true);
+    tree->setAlternatingRowColors(true);
+    tree->header()->setStretchLastSection(false);
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    tree->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    layout->addWidget(tree, 1);
+}
+
+void QueryProfilePanel::clear()
+{
+    tree->clear();
+    noteLabel->clear();
+    noteLabel->hide();
+}
+
+void QueryProfilePanel::showProfiles(const QList<StatementProfile> &profiles, const QStringList &notes)
+{
+    clear();
+    if(!notes.isEmpty()){
+        noteLabel->setText(notes.join(QLatin1Char('\n')));
+        noteLabel->show();
+    }
+    for(const StatementProfile &profile : profiles){
+        QString preview = profile.sql.simplified();
+        if(preview.size() > 100){
+            preview = preview.left(97) + QStringLiteral("...");
+        }
+        auto *top = new QTreeWidgetItem(tree, {QStringLiteral("[%1] %2").arg(profile.index + 1).arg(preview),
+                                               tr("%1 ms").arg(profile.wallMs)});
+        top->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+        top->setToolTip(0, profile.sql.left(4000));
+
+        auto *summary = new QTreeWidgetItem(top, {tr("Summary")});
+        if(profile.serverMs >= 0){
+            addMetric(summary, tr("Server time (ms)"), formatMs(profile.serverMs));
+        }
+        if(profile.lockMs >= 0){
+            addMetric(summary, tr("Lock time (ms)"), formatMs(profile.lockMs));
+        }
+        addCount(summary, tr("Rows examined"), profile.rowsExamined);
+        addCount(summary, tr("Rows sent"), profile.rowsSent);
+        addCount(summary, tr("Rows affected"), profile.rowsAffected);
+        if(profile.rowsExamined > 0 && profile.rowsSent > 0){
+            const double ratio = static_cast<double>(profile.rowsExamined) / profile.rowsSent;
+            addMetric(summary, tr("Examined / sent"), QString::number(ratio, 'f', 1), ratio >= 100);
+        }
+        addCount(summary, tr("Temporary tables"), profile.tmpTables);
+        addCount(summary, tr("Temporary disk tables"), profile.tmpDiskTables, true);
+        addCount(summary, tr("Sort merge passes"), profile.sortMergePasses, true);
+        addCount(summary, tr("Sort rows"), profile.sortRows);
+        addCount(summary, tr("Full joins"), profile.selectFullJoin, true);
+        addCount(summary, tr("Full scans"), profile.selectScan);
+        if(profile.noIndexUsed){
+            addMetric(summary, tr("No index used"), tr("Yes"), true);
+        }
+        if(!profile.hasStatementEvent){
+            addMetric(summary, tr("Source"), tr("session status (approximate)"));
+        }
+
+        if(!profile.stages.isEmpty()){
+            double total = 0;
+            for(const auto &stage : profile.stages){
+                total += stage.second;
+            }
+            auto *stages = new QTreeWidgetItem(top, {tr("Stages (%1)").arg(profile.stageSource), formatMs(total)});
+            stages->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+            for(const auto &stage : profile.stages){
+                const double share = total > 0 ? stage.second * 100.0 / total : 0;
+                addMetric(stages, stage.first,
+                          QStringLiteral("%1  (%2%)").arg(formatMs(stage.second)).arg(share, 0, 'f', 1),
+                          share >= 50 && profile.stages.size() > 1);
+            }
+            stages->setExpanded(true);
+        }
+
+        if(!profile.statusDeltas.isEmpty()){
+            auto *status = new QTreeWidgetItem(top, {tr("Status changes")});
+            for(const auto &delta : profile.statusDeltas){
+                addCount(status, delta.first, delta.second);
+            }
+        }
+        summary->setExpanded(true);
+        top->setExpanded(true);
+    }
+}
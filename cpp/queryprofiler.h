@@ -0,0 +1,79 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSqlDatabase>
+#include <QString>
+#include <QWidget>
+
+class QLabel;
+class QTreeWidget;
+
+struct StatementProfile {
+    int index = 0;
+    QString sql;
+    qint64 wallMs = 0;
+    bool hasStatementEvent = false;
+    double serverMs = -1;
+    double lockMs = -1;
+    qint64 rowsExamined = -1;
+    qint64 rowsSent = -1;
+    qint64 rowsAffected = -1;
+    qint64 tmpTables = -1;
+    qint64 tmpDiskTables = -1;
+    qint64 sortMergePasses = -1;
+    qint64 sortRows = -1;
+    qint64 selectFullJoin = -1;
+    qint64 selectScan = -1;
+    bool noIndexUsed = false;
+    QString stageSource;
+    QList<QPair<QString, double>> stages;
+    QList<QPair<QString, qint64>> statusDeltas;
+};
+
+// Collects server-side metrics around each statement on the session that
+// runs it: the performance_schema statement/stage events when readable,
+// SHOW PROFILE as the stage fallback, and session status deltas.
+class QueryProfiler
+{
+public:
+    explicit QueryProfiler(const QSqlDatabase &db);
+
+    void begin();
+    void beforeStatement();
+    StatementProfile afterStatement(int index, const QString &sql, qint64 wallMs);
+    void end();
+
+    QStringList notes() const { return m_notes; }
+
+private:
+    QHash<QString, qint64> sessionStatus();
+    void readStatementEvent(StatementProfile &profile);
+    void readProfileStages(StatementProfile &profile);
+
+    QSqlDatabase m_db;
+    qint64 m_threadId = -1;
+    bool m_performanceSchema = false;
+    bool m_profiling = false;
+    QHash<QString, qint64> m_before;
+    QHash<QString, qint64> m_overhead;
+    QStringList m_notes;
+};
+
+class QueryProfilePanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit QueryProfilePanel(QWidget *parent = nullptr);
+
+    void showProfiles(const QList<StatementProfile> &profiles, const QStringList &notes);
+    void clear();
+
+private:
+    QLabel *noteLabel = nullptr;
+    QTreeWidget *tree = nullptr;
+};
+
+#endif // QUERYPROFILER_H
@@ -0,0 +1,575 @@
+#include "resultfile.h"
+
+#include <QDate>
+#include <QLocale>
+#include <QMetaType>
+#include <QObject>
+#include <QSaveFile>
+#include <QTime>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char kHeaderMagic[] = "ODBKRSLT";
+const char kTrailerMagic[] = "ODBK";
+const quint16 kFormatVersion = 2;
+const int kHeaderBytes = 16;
+const int kTrailerBytes = 16;
+// Rows per row group; the writer holds one group in memory at a time
+const int kGroupRows = 65536;
+// A group ends early once a column reaches this many bytes, which keeps
+// chunk offsets and lengths in 32 bits
+const int kMaxChunkBytes = 64 * 1024 * 1024;
+// Largest single value, so no chunk exceeds kMaxChunkBytes plus one value
+const int kMaxCellBytes = 1024 * 1024 * 1024;
+// Bytes of inflated chunks kept in the cache
+const int kInflatedCacheBytes = 64 * 1024 * 1024;
+const qint64 kMsecsPerDay = 86400000;
+
+enum Codec : quint8 {
+    CodecNone = 0,
+    CodecZlib = 1
+};
+
+template <typename T>
+void putNumber(QByteArray &out, T value)
+{
+    const T little = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&little), int(sizeof(T)));
+}
+
+// Bounds-checked footer reads; past the end ok turns false and every
+// further read returns 0
+struct FooterReader
+{
+    const uchar *pos;
+    const uchar *end;
+    bool ok = true;
+
+    template <typename T>
+    T take()
+    {
+        if(!ok || end - pos < qint64(sizeof(T))){
+            ok = false;
+            return T(0);
+        }
+        const T value = qFromLittleEndian<T>(pos);
+        pos += sizeof(T);
+        return value;
+    }
+
+    QByteArray bytes(int size)
+    {
+        if(!ok || end - pos < size){
+            ok = false;
+            return QByteArray();
+        }
+        const QByteArray value(reinterpret_cast<const char *>(pos), size);
+        pos += size;
+        return value;
+    }
+};
+
+// Per-column format flags, stored in the footer byte after the column type
+enum FormatFlag : quint8 {
+    SpaceSeparator = 0x1,
+    NoMilliseconds = 0x2
+};
+
+QString formatTime(quint8 flags, int msecs)
+{
+    return QTime::fromMSecsSinceStartOfDay(msecs).toString((flags & NoMilliseconds) ? Qt::ISODate : Qt::ISODateWithMs);
+}
+
+QString formatValue(ResultFile::ColumnType type, quint8 flags, qint64 bits)
+{
+    switch(type){
+    case ResultFile::Int64:
+        return QString::number(bits);
+    case ResultFile::Real: {
+        double real = 0;
+        std::memcpy(&real, &bits, sizeof(real));
+        return QString::number(real, 'g', QLocale::FloatingPointShortest); }
+    case ResultFile::Date:
+        return QDate::fromJulianDay(bits).toString(Qt::ISODate);
+    case ResultFile::Time:
+        return formatTime(flags, int(bits));
+    case ResultFile::DateTime: {
+        qint64 day = bits / kMsecsPerDay;
+        qint64 msecs = bits % kMsecsPerDay;
+        if(msecs < 0){
+            msecs += kMsecsPerDay;
+            --day;
+        }
+        // Joined as wall-clock time without QDateTime, so the local time zone never matters
+        return QDate::fromJulianDay(day).toString(Qt::ISODate)
+                + QLatin1Char((flags & SpaceSeparator) ? ' ' : 'T')
+                + formatTime(flags, int(msecs)); }
+    case ResultFile::Text:
+        break;
+    }
+    return QString();
+}
+
+// True when text can be stored as type and reads back exactly as it was
+bool parseValue(ResultFile::ColumnType type, quint8 flags, const QString &text, qint64 *bits)
+{
+    bool ok = false;
+    switch(type){
+    case ResultFile::Int64:
+        *bits = text.toLongLong(&ok);
+        break;
+    case ResultFile::Real: {
+        const double real = text.toDouble(&ok);
+        std::memcpy(bits, &real, sizeof(real));
+        break; }
+    case ResultFile::Date: {
+        const QDate date = QDate::fromString(text, Qt::ISODate);
+        ok = date.isValid();
+        *bits = date.toJulianDay();
+        break; }
+    case ResultFile::Time: {
+        const QTime time = QTime::fromString(text, Qt::ISODateWithMs);
+        ok = time.isValid();
+        *bits = time.msecsSinceStartOfDay();
+        break; }
+    case ResultFile::DateTime: {
+        const int split = text.indexOf(QLatin1Char((flags & SpaceSeparator) ? ' ' : 'T'));
+        const QDate date = QDate::fromString(text.left(split), Qt::ISODate);
+        const QTime time = QTime::fromString(text.mid(split + 1), Qt::ISODateWithMs);
+        ok = split > 0 && date.isValid() && time.isValid();
+        *bits = date.toJulianDay() * kMsecsPerDay + time.msecsSinceStartOfDay();
+        break; }
+    case ResultFile::Text:
+        return false;
+    }
+    return ok && formatValue(type, flags, *bits) == text;
+}
+
+// Storage type for a column whose values have the given QMetaType id
+ResultFile::ColumnType columnTypeFor(int metaType)
+{
+    switch(metaType){
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+        return ResultFile::Int64;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return ResultFile::Real;
+    case QMetaType::QDate:
+        return ResultFile::Date;
+    case QMetaType::QTime:
+        return ResultFile::Time;
+    case QMetaType::QDateTime:
+        return ResultFile::DateTime;
+    default:
+        return ResultFile::Text;
+    }
+}
+
+// How the grid showed a time or date-time, taken from one of its cells
+quint8 formatFlagsFor(ResultFile::ColumnType type, const QString &text)
+{
+    quint8 flags = 0;
+    if(type == ResultFile::DateTime && text.size() > 10 && text.at(10) == QLatin1Char(' ')){
+        flags |= SpaceSeparator;
+    }
+    if((type == ResultFile::Time || type == ResultFile::DateTime) && !text.contains(QLatin1Char('.'))){
+        flags |= NoMilliseconds;
+    }
+    return flags;
+}
+
+// One column of a row group
+struct ChunkBuilder
+{
+    QByteArray nulls;
+    QByteArray values;
+    QVector<quint32> offsets;
+};
+
+bool writeAll(QSaveFile &file, const QByteArray &data, qint64 *pos)
+{
+    if(file.write(data) != data.size()){
+        return false;
+    }
+    *pos += data.size();
+    return true;
+}
+
+}
+
+bool ResultFile::write(const QString &path,
+                       const QStringList &headers,
+                       const QVector<int> &columnTypes,
+                       int rowCount,
+                       const CellReader &cell,
+                       QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if(errorMessage){
+            *errorMessage = message;
+        }
+        return false;
+    };
+    const int columns = headers.size();
+
+    // First pass: a column keeps the type of its values only when every
+    // non-NULL cell reads back as the text the grid showed
+    QVector<ColumnType> types(columns, Text);
+    QVector<quint8> formats(columns, 0);
+    QVector<bool> checked(columns, false);
+    int typedColumns = 0;
+    for(int col = 0; col < columns; ++col){
+        types[col] = columnTypeFor(columnTypes.value(col));
+        if(types.at(col) != Text){
+            ++typedColumns;
+        }
+    }
+    for(int row = 0; row < rowCount && typedColumns > 0; ++row){
+        for(int col = 0; col < columns; ++col){
+            if(types.at(col) == Text){
+                continue;
+            }
+            bool isNull = false;
+            const QString text = cell(row, col, &isNull);
+            if(isNull){
+                continue;
+            }
+            if(!checked.at(col)){
+                formats[col] = formatFlagsFor(types.at(col), text);
+                checked[col] = true;
+            }
+            qint64 bits = 0;
+            if(!parseValue(types.at(col), formats.at(col), text, &bits)){
+                types[col] = Text;
+                formats[col] = 0;
+                --typedColumns;
+            }
+        }
+    }
+
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)){
+        return fail(QObject::tr("Cannot open %1: %2").arg(path, file.errorString()));
+    }
+    qint64 pos = 0;
+    QByteArray header(kHeaderMagic, 8);
+    putNumber<quint16>(header, kFormatVersion);
+    putNumber<quint16>(header, 0);
+    putNumber<quint32>(header, 0);
+    if(!writeAll(file, header, &pos)){
+        return fail(file.errorString());
+    }
+
+    // Second pass: rows are gathered column by column into the current group,
+    // which is written out once it is full or a column reaches the byte limit
+    QByteArray index;
+    QVector<quint32> groupRows;
+    QVector<ChunkBuilder> chunks(columns);
+    int count = 0;
+    auto writeGroup = [&]() -> bool {
+        for(int col = 0; col < columns; ++col){
+            ChunkBuilder &chunk = chunks[col];
+            QByteArray raw = chunk.nulls;
+            if(types.at(col) == Text){
+                chunk.offsets.append(quint32(chunk.values.size()));
+                for(quint32 offset : qAsConst(chunk.offsets)){
+                    putNumber<quint32>(raw, offset);
+                }
+            }
+            raw += chunk.values;
+            chunk = ChunkBuilder();
+            // Compress only when that saves at least a quarter
+            quint8 codec = CodecNone;
+            QByteArray stored = qCompress(raw, 6);
+            if(stored.size() <= raw.size() - raw.size() / 4){
+                codec = CodecZlib;
+            }else{
+                stored = raw;
+            }
+            const QByteArray padding(int((8 - pos % 8) % 8), '\0');
+            if(!writeAll(file, padding, &pos)){
+                return false;
+            }
+            putNumber<quint64>(index, quint64(pos));
+            putNumber<quint32>(index, quint32(stored.size()));
+            putNumber<quint32>(index, quint32(raw.size()));
+            index.append(char(codec));
+            index.append(3, '\0');
+            if(!writeAll(file, stored, &pos)){
+                return false;
+            }
+        }
+        groupRows << quint32(count);
+        count = 0;
+        return true;
+    };
+    for(int row = 0; row < rowCount; ++row){
+        qint64 largest = 0;
+        for(int col = 0; col < columns; ++col){
+            ChunkBuilder &chunk = chunks[col];
+            bool isNull = false;
+            const QString text = cell(row, col, &isNull);
+            if((count & 7) == 0){
+                chunk.nulls.append('\0');
+            }
+            if(isNull){
+                chunk.nulls[count >> 3] = char(chunk.nulls.at(count >> 3) | (1 << (count & 7)));
+            }
+            if(types.at(col) == Text){
+                chunk.offsets.append(quint32(chunk.values.size()));
+                if(!isNull){
+                    const QByteArray utf8 = text.toUtf8();
+                    if(utf8.size() > kMaxCellBytes){
+                        return fail(QObject::tr("A value in column %1 is too large to save").arg(headers.at(col)));
+                    }
+                    chunk.values += utf8;
+                }
+            }else{
+                qint64 bits = 0;
+                if(!isNull){
+                    parseValue(types.at(col), formats.at(col), text, &bits);
+                }
+                putNumber<qint64>(chunk.values, bits);
+            }
+            largest = qMax(largest, qint64(chunk.values.size()));
+        }
+        ++count;
+        if((count == kGroupRows || largest >= kMaxChunkBytes) && !writeGroup()){
+            return fail(QObject::tr("Cannot write %1: %2").arg(path, file.errorString()));
+        }
+    }
+    if(count > 0 && !writeGroup()){
+        return fail(QObject::tr("Cannot write %1: %2").arg(path, file.errorString()));
+    }
+
+    QByteArray footer;
+    putNumber<quint64>(footer, quint64(QDateTime::currentMSecsSinceEpoch()));
+    putNumber<quint32>(footer, quint32(columns));
+    for(int col = 0; col < columns; ++col){
+        const QByteArray name = headers.at(col).toUtf8().left(std::numeric_limits<quint16>::max());
+        footer.append(char(types.at(col)));
+        footer.append(char(formats.at(col)));
+        putNumber<quint16>(footer, quint16(name.size()));
+        footer += name;
+    }
+    putNumber<quint64>(footer, quint64(rowCount));
+    putNumber<quint32>(footer, quint32(groupRows.size()));
+    for(quint32 rows : qAsConst(groupRows)){
+        putNumber<quint32>(footer, rows);
+    }
+    footer += index;
+    QByteArray trailer;
+    putNumber<quint64>(trailer, quint64(pos));
+    putNumber<quint32>(trailer, quint32(footer.size()));
+    trailer.append(kTrailerMagic, 4);
+    if(!writeAll(file, footer, &pos) || !writeAll(file, trailer, &pos) || !file.commit()){
+        return fail(QObject::tr("Cannot write %1: %2").arg(path, file.errorString()));
+    }
+    return true;
+}
+
+ResultFile::ResultFile()
+    : m_inflated(kInflatedCacheBytes)
+{
+}
+
+ResultFile::~ResultFile()
+{
+    if(m_map){
+        m_file.unmap(m_map);
+    }
+}
+
+bool ResultFile::open(const QString &path, QString *errorMessage)
+{
+    const QString damaged = QObject::tr("%1 is not a result file or is damaged").arg(path);
+    auto fail = [this, errorMessage](const QString &message) {
+        if(errorMessage){
+            *errorMessage = message;
+        }
+        if(m_map){
+            m_file.unmap(m_map);
+            m_map = nullptr;
+        }
+        m_file.close();
+        return false;
+    };
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::ReadOnly)){
+        return fail(QObject::tr("Cannot open %1: %2").arg(path, m_file.errorString()));
+    }
+    const qint64 size = m_file.size();
+    if(size < kHeaderBytes + kTrailerBytes){
+        return fail(damaged);
+    }
+    m_map = m_file.map(0, size);
+    if(!m_map){
+        return fail(QObject::tr("Cannot map %1: %2").arg(path, m_file.errorString()));
+    }
+    if(std::memcmp(m_map, kHeaderMagic, 8) != 0){
+        return fail(damaged);
+    }
+    if(qFromLittleEndian<quint16>(m_map + 8) != kFormatVersion){
+        return fail(QObject::tr("%1 was saved in an unsupported format version").arg(path));
+    }
+    const uchar *trailer = m_map + size - kTrailerBytes;
+    const quint64 footerOffset = qFromLittleEndian<quint64>(trailer);
+    const quint32 footerLength = qFromLittleEndian<quint32>(trailer + 8);
+    if(std::memcmp(trailer + 12, kTrailerMagic, 4) != 0
+       || footerOffset < quint64(kHeaderBytes)
+       || footerOffset > quint64(size - kTrailerBytes)
+       || footerLength > quint64(size - kTrailerBytes) - footerOffset){
+        return fail(damaged);
+    }
+
+    FooterReader footer{m_map + footerOffset, m_map + footerOffset + footerLength};
+    m_savedAt = QDateTime::fromMSecsSinceEpoch(qint64(footer.take<quint64>()), Qt::UTC);
+    const quint32 columns = footer.take<quint32>();
+    if(columns > footerLength){
+        return fail(damaged);
+    }
+    m_headers.clear();
+    m_types.clear();
+    m_formats.clear();
+    for(quint32 col = 0; col < columns && footer.ok; ++col){
+        const quint8 type = footer.take<quint8>();
+        const quint8 format = footer.take<quint8>();
+        const quint16 nameLength = footer.take<quint16>();
+        m_headers << QString::fromUtf8(footer.bytes(nameLength));
+        if(type < Int64 || type > DateTime){
+            return fail(damaged);
+        }
+        m_types << ColumnType(type);
+        m_formats << format;
+    }
+    const quint64 rows = footer.take<quint64>();
+    const quint32 groups = footer.take<quint32>();
+    if(!footer.ok || rows > quint64(std::numeric_limits<int>::max()) || groups > rows){
+        return fail(damaged);
+    }
+    // First row of each group, followed by the total row count
+    m_groupStarts.clear();
+    m_groupStarts.reserve(int(groups) + 1);
+    quint64 start = 0;
+    for(quint32 group = 0; group < groups && footer.ok; ++group){
+        const quint32 groupRows = footer.take<quint32>();
+        if(groupRows == 0 || start + groupRows > rows){
+            return fail(damaged);
+        }
+        m_groupStarts << int(start);
+        start += groupRows;
+    }
+    m_groupStarts << int(start);
+    if(!footer.ok || start != rows
+       || quint64(groups) * columns * 20 != quint64(footer.end - footer.pos)){
+        return fail(damaged);
+    }
+    m_rows = int(rows);
+    m_chunks.clear();
+    m_chunks.reserve(int(groups * columns));
+    for(quint64 i = 0; i < quint64(groups) * columns; ++i){
+        ChunkEntry entry;
+        entry.offset = footer.take<quint64>();
+        entry.storedLength = footer.take<quint32>();
+        entry.rawLength = footer.take<quint32>();
+        entry.codec = footer.take<quint8>();
+        footer.bytes(3);
+        if(!footer.ok || entry.offset < quint64(kHeaderBytes)
+           || entry.offset > footerOffset
+           || entry.storedLength > footerOffset - entry.offset
+           || entry.rawLength > quint32(std::numeric_limits<int>::max())
+           || (entry.codec != CodecNone && entry.codec != CodecZlib)
+           || (entry.codec == CodecNone && entry.storedLength != entry.rawLength)){
+            return fail(damaged);
+        }
+        m_chunks << entry;
+    }
+    m_inflated.clear();
+    m_lastKey = -1;
+    m_lastChunk.clear();
+    return true;
+}
+
+QByteArray ResultFile::chunkData(int group, int column) const
+{
+    const qint64 key = qint64(group) * columnCount() + column;
+    const ChunkEntry &entry = m_chunks.at(int(key));
+    const QByteArray stored = QByteArray::fromRawData(reinterpret_cast<const char *>(m_map + entry.offset),
+                                                      int(entry.storedLength));
+    if(entry.codec == CodecNone){
+        return stored;
+    }
+    if(key == m_lastKey){
+        return m_lastChunk;
+    }
+    if(const QByteArray *cached = m_inflated.object(key)){
+        return *cached;
+    }
+    QByteArray raw = qUncompress(stored);
+    if(raw.size() != int(entry.rawLength)){
+        raw.clear();
+    }
+    // The cache refuses chunks larger than its budget; the last one is kept
+    // aside so painting a screen of such a chunk inflates it only once
+    if(raw.size() <= m_inflated.maxCost()){
+        m_inflated.insert(key, new QByteArray(raw), qMax(1, raw.size()));
+    }
+    m_lastKey = key;
+    m_lastChunk = raw;
+    return raw;
+}
+
+QString ResultFile::text(int row, int column, bool *isNull) const
+{
+    *isNull = true;
+    if(!m_map || row < 0 || row >= m_rows || column < 0 || column >= columnCount()){
+        return QString();
+    }
+    const int group = int(std::upper_bound(m_groupStarts.cbegin(), m_groupStarts.cend(), row) - m_groupStarts.cbegin()) - 1;
+    const int index = row - m_groupStarts.at(group);
+    const int count = m_groupStarts.at(group + 1) - m_groupStarts.at(group);
+    const QByteArray chunk = chunkData(group, column);
+    const int bitmapBytes = (count + 7) / 8;
+    if(chunk.size() < bitmapBytes){
+        return QString();
+    }
+    const uchar *data = reinterpret_cast<const uchar *>(chunk.constData());
+    if(data[index >> 3] & (1 << (index & 7))){
+        return QString();
+    }
+    const uchar *values = data + bitmapBytes;
+    const qint64 valueBytes = chunk.size() - bitmapBytes;
+    const ColumnType type = m_types.at(column);
+    if(type == Text){
+        const qint64 offsetBytes = (qint64(count) + 1) * 4;
+        if(valueBytes < offsetBytes){
+            return QString();
+        }
+        const quint32 begin = qFromLittleEndian<quint32>(values + qint64(index) * 4);
+        const quint32 end = qFromLittleEndian<quint32>(values + (qint64(index) + 1) * 4);
+        if(begin > end || end > valueBytes - offsetBytes){
+            return QString();
+        }
+        *isNull = false;
+        return QString::fromUtf8(reinterpret_cast<const char *>(values + offsetBytes + begin), int(end - begin));
+    }
+    if(valueBytes < qint64(count) * 8){
+        return QString();
+    }
+    *isNull = false;
+    return formatValue(type, m_formats.at(column), qFromLittleEndian<qint64>(values + qint64(index) * 8));
+}
@@ -0,0 +1,142 @@
+#ifndef RESULTFILE_H
+#define RESULTFILE_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+/*
+    Result file format (.odbr), version 2
+
+    A self-describing columnar snapshot of a result grid. Rows are cut into
+    row groups; within a group every column is stored as one chunk, so a
+    reader maps the file and decodes only the chunks it touches. A group
+    holds at most 65536 rows and ends early once any of its chunks reaches
+    64 MiB of values, which keeps chunk offsets and lengths in 32 bits. All
+    integers are little-endian.
+
+    File layout
+
+        header      8 bytes   magic "ODBKRSLT"
+                    2 bytes   uint16 format version (2)
+                    2 bytes   uint16 flags (0)
+                    4 bytes   reserved (0)
+        chunks      column chunks of each row group, group by group, each
+                    starting on an 8-byte boundary
+        footer      see below
+        trailer     8 bytes   uint64 offset of the footer
+                    4 bytes   uint32 length of the footer
+                    4 bytes   magic "ODBK"
+
+    Footer
+
+        uint64      saved at, milliseconds since the epoch (UTC)
+        uint32      column count C
+        C times     uint8 column type, uint8 format flags, uint16 name
+                    length, column name (UTF-8)
+        uint64      row count R
+        uint32      group count N
+        N times     uint32 rows in the group (at least 1, summing to R)
+        N * C times chunk index entry, groups in order, columns in order:
+                    uint64 chunk offset, uint32 stored length,
+                    uint32 raw length, uint8 codec, 3 bytes reserved
+
+    Column types and their values
+
+        1 Int64     int64
+        2 Real      IEEE 754 double (its bits as uint64)
+        3 Text      UTF-8
+        4 Date      int64 Julian day
+        5 Time      int64 milliseconds since midnight
+        6 DateTime  int64 Julian day * 86400000 + milliseconds since midnight
+
+    A column takes the type of the values the grid holds (integers,
+    floating point, dates, times, date-times; anything else is Text). It
+    falls back to Text when a non-NULL cell does not print back to exactly
+    the text the grid showed, so reopening always shows the saved text.
+    Date-times are wall-clock values with no time zone and read back the
+    same on any machine.
+
+    Format flags (0 except for Time and DateTime columns)
+
+        bit 0       date and time are separated by a space, not 'T'
+        bit 1       times have no milliseconds
+
+    Chunk of n rows (raw form)
+
+        null bitmap ceil(n / 8) bytes, bit i (LSB first) set when row i
+                    is NULL
+        values      typed columns: n fixed 8-byte slots (0 for NULL)
+                    Text: (n + 1) uint32 offsets into the data that
+                    follows, then the UTF-8 data; NULL cells are empty
+
+    Codec 0 stores the raw chunk as is. Codec 1 stores the output of
+    qCompress(): a big-endian uint32 raw length followed by a zlib stream.
+    The writer compresses a chunk only when that saves at least a quarter.
+*/
+class ResultFile
+{
+public:
+    enum ColumnType : quint8 {
+        Int64 = 1,
+        Real = 2,
+        Text = 3,
+        Date = 4,
+        Time = 5,
+        DateTime = 6
+    };
+
+    // Returns the text the grid shows for a cell, or sets *isNull
+    using CellReader = std::function<QString(int row, int column, bool *isNull)>;
+    // columnTypes holds the QMetaType id of each column's values, 0 when unknown
+    static bool write(const QString &path,
+                      const QStringList &headers,
+                      const QVector<int> &columnTypes,
+                      int rowCount,
+                      const CellReader &cell,
+                      QString *errorMessage);
+
+    ResultFile();
+    ~ResultFile();
+
+    // Maps the file and reads the footer; chunks are decoded when a cell needs them
+    bool open(const QString &path, QString *errorMessage);
+
+    QStringList headers() const { return m_headers; }
+    int rowCount() const { return m_rows; }
+    int columnCount() const { return m_headers.size(); }
+    ColumnType columnType(int column) const { return m_types.value(column, Text); }
+    QDateTime savedAt() const { return m_savedAt; }
+    QString text(int row, int column, bool *isNull) const;
+
+private:
+    struct ChunkEntry {
+        quint64 offset = 0;
+        quint32 storedLength = 0;
+        quint32 rawLength = 0;
+        quint8 codec = 0;
+    };
+
+    QByteArray chunkData(int group, int column) const;
+
+    mutable QFile m_file;
+    uchar *m_map = nullptr;
+    QStringList m_headers;
+    QVector<ColumnType> m_types;
+    QVector<quint8> m_formats;
+    QVector<ChunkEntry> m_chunks;
+    int m_rows = 0;
+    // first row of each group, then the total row count
+    QVector<int> m_groupStarts;
+    QDateTime m_savedAt;
+    // inflated chunks, cost in bytes
+    mutable QCache<qint64, QByteArray> m_inflated;
+    // most recently inflated chunk, also when it is too large for the cache
+    mutable qint64 m_lastKey = -1;
+    mutable QByteArray m_lastChunk;
+};
+
+#endif // RESULTFILE_H
@@ -1,18 +1,27 @@
 #include "resultform.h"
 #include "exportdialog.h"
+#include "resultfile.h"
+#include "resultspill.h"
 
 #include <QAbstractItemModel>
 #include <QApplication>
 #include <QDebug>
 #include <QPainter>
+#include <QScrollBar>
 #include <QStandardPaths>
 #include <QAbstractItemView>
+#include <QAbstractTableModel>
+#include <QCache>
 #include <QClipboard>
+#include <QContextMenuEvent>
+#include <QCollator>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QHeaderView>
 #include <QHBoxLayout>
 #include <QFontMetrics>
@@ -22,22 +31,45 @@
 #include <QDateTimeEdit>
 #include <QTimeEdit>
 #include <QMap>
+#include <QMenu>
+#include <QPaintEvent>
+#include <QRunnable>
 #include <QSortFilterProxyModel>
+#include <QSemaphore>
 #include <QSet>
 #include <QStandardItem>
 #include <QStandardItemModel>
 #include <QStandardPaths>
 #include <QItemSelection>
+#include <QStyleOption>
 #include <QStyledItemDelegate>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 #include <QXmlStreamWriter>
 #include <private/qzipwriter_p.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <vector>
 
 // Role to mark NULL values (UserRole+2 is used for rowId in queryform.cpp)
 static const int NullRole = Qt::UserRole + 3;
 // Role to store column type (QVariant::Type)
 static const int TypeRole = Qt::UserRole + 4;
+// Role to store the full size in bytes of a cell loaded as a preview
+static const int TruncatedRole = Qt::UserRole + 5;
+
+// Band colour of every third row, and the text colour of NULL
+static const QRgb kStripeBackground = 0xf0f8ff;
+static const QRgb kNullText = 0xa0a0a0;
+// Cells the fast path caches (several 4K screens worth) and characters kept per cell
+static const int kMaxCachedCells = 20000;
+static const int kMaxCachedChars = 4096;
 
 // Custom delegate to display NULL values with special style
 class NullAwareDelegate : public QStyledItemDelegate
@@ -45,45 +77,66 @@ class NullAwareDelegate : public QStyledItemDelegate
 public:
     using QStyledItemDelegate::QStyledItemDelegate;
 
+    // Load the full value of a preview cell before editing it; no editor opens if that fails
+    std::function<bool(int sourceRow, int column)> loadFullValue;
+    // Fast painting for data results: no QStyle, elided text cached per cell, row
+    // backgrounds laid by the view
+    bool fastPaint = false;
+
+    void clearCellCache()
+    {
+        cellCache.clear();
+    }
+
+    // Pick up the cell margins again after a stylesheet or font change
+    void clearStyleCache()
+    {
+        cellCache.clear();
+        styleResolved = false;
+    }
+
     void paint(QPainter *painter, const QStyleOptionViewItem &option,
                const QModelIndex &index) const override
     {
-        QStyleOptionViewItem opt = option;
-        initStyleOption(&opt, index);
-        int sourceRow = index.row();
-        if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
-            sourceRow = proxy->mapToSource(index).row();
-        }
-        if(sourceRow % 3 == 2 && !(opt.state & QStyle::State_Selected)){
-            opt.backgroundBrush = QColor(240, 248, 255);
+        // At most one hovered and one focused cell per frame; the style paints their
+        // stylesheet background
+        if(!fastPaint || (option.state & (QStyle::State_MouseOver | QStyle::State_HasFocus))){
+            paintStyled(painter, option, index);
+            return;
         }
-        bool isNull = false;
-        if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
-            QModelIndex sourceIndex = proxy->mapToSource(index);
-            if(auto *srcModel = qobject_cast<const QStandardItemModel*>(proxy->sourceModel())){
-                if(auto *item = srcModel->itemFromIndex(sourceIndex)){
-                    QVariant nullData = item->data(NullRole);
-                    isNull = nullData.isValid() && nullData.toBool();
-                }
-            }
-        } else if(auto *stdModel = qobject_cast<const QStandardItemModel*>(index.model())){
-            if(auto *item = stdModel->itemFromIndex(index)){
-                QVariant nullData = item->data(NullRole);
-                isNull = nullData.isValid() && nullData.toBool();
-            }
+        const CachedCell &cell = cachedCell(option, index);
+        const QStyle::State state = option.state;
+        const QPalette::ColorGroup group = !(state & QStyle::State_Enabled) ? QPalette::Disabled
+                : (state & QStyle::State_Active) ? QPalette::Normal : QPalette::Inactive;
+        if(state & QStyle::State_Selected){
+            painter->fillRect(option.rect, option.palette.brush(group, QPalette::Highlight));
+        }else if(cell.background.isValid()){
+            painter->fillRect(option.rect, cell.background);
         }
-
-        if(isNull){
-            opt.text = QStringLiteral("NULL");
-            opt.font.setItalic(true);
-            opt.palette.setColor(QPalette::Text, QColor(160, 160, 160));
+        if(!cell.elided.isEmpty()){
+            painter->setFont(cell.isNull ? nullFont : option.font);
+            painter->setPen(cell.isNull ? QColor(kNullText)
+                                        : option.palette.color(group, (state & QStyle::State_Selected)
+                                                               ? QPalette::HighlightedText : QPalette::Text));
+            painter->drawText(option.rect.marginsRemoved(textMargins),
+                              Qt::AlignLeft | Qt::AlignVCenter, cell.elided);
         }
-        QApplication::style()->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
     }
 
     QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
                           const QModelIndex &index) const override
     {
+        if(loadFullValue){
+            QModelIndex sourceIndex = index;
+            if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
+                sourceIndex = proxy->mapToSource(index);
+            }
+            if(sourceIndex.data(TruncatedRole).isValid()
+               && !loadFullValue(sourceIndex.row(), sourceIndex.column())){
+                return nullptr;
+            }
+        }
+
         // Check column type from TypeRole
         int colType = QVariant::Invalid;
         if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
@@ -176,6 +229,181 @@ public:
         }
         QStyledItemDelegate::setModelData(editor, model, index);
     }
+
+private:
+    struct CachedCell
+    {
+        QString text;
+        QString elided;
+        QColor background;
+        int width = -1;
+        bool isNull = false;
+    };
+
+    // Cached by view row and column; ResultForm clears it on any model change
+    const CachedCell &cachedCell(const QStyleOptionViewItem &option, const QModelIndex &index) const
+    {
+        if(!styleResolved || option.font != cacheFont){
+            cellCache.clear();
+            cacheFont = option.font;
+            nullFont = option.font;
+            nullFont.setItalic(true);
+            // The text rect comes from the style (including the stylesheet item padding),
+            // plus the side margins QCommonStyle leaves when drawing text
+            QStyleOptionViewItem sample = option;
+            initStyleOption(&sample, index);
+            sample.rect = QRect(0, 0, 1000, 100);
+            sample.state &= ~(QStyle::State_Selected | QStyle::State_MouseOver | QStyle::State_HasFocus);
+            const QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+            const QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &sample, option.widget);
+            const int margin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, option.widget) + 1;
+            textMargins = QMargins(textRect.left() - sample.rect.left() + margin,
+                                   textRect.top() - sample.rect.top(),
+                                   sample.rect.right() - textRect.right() + margin,
+                                   sample.rect.bottom() - textRect.bottom());
+            styleResolved = true;
+        }
+        const quint64 key = (quint64(quint32(index.row())) << 32) | quint32(index.column());
+        auto it = cellCache.find(key);
+        if(it == cellCache.end()){
+            if(cellCache.size() >= kMaxCachedCells){
+                cellCache.clear();
+            }
+            // Fetch all roles of the item at once instead of one lookup per role
+            const QMap<int, QVariant> data = index.model()->itemData(index);
+            CachedCell cell;
+            cell.isNull = data.value(NullRole).toBool();
+            if(cell.isNull){
+                cell.text = QStringLiteral("NULL");
+            }else{
+                // Single line: newlines and tabs draw as spaces
+                cell.text = data.value(Qt::DisplayRole).toString().left(kMaxCachedChars);
+                for(QChar &ch : cell.text){
+                    if(ch == QLatin1Char('\n') || ch == QLatin1Char('\r') || ch == QLatin1Char('\t')){
+                        ch = QLatin1Char(' ');
+                    }
+                }
+            }
+            const QVariant background = data.value(Qt::BackgroundRole);
+            if(background.isValid()){
+                cell.background = background.value<QBrush>().color();
+            }
+            it = cellCache.insert(key, cell);
+        }
+        const int width = option.rect.width() - textMargins.left() - textMargins.right();
+        if(it->width != width){
+            const QFontMetrics metrics(it->isNull ? nullFont : cacheFont);
+            it->elided = metrics.elidedText(it->text, Qt::ElideRight, width);
+            it->width = width;
+        }
+        return *it;
+    }
+
+    void paintStyled(QPainter *painter, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) const
+    {
+        QStyleOptionViewItem opt = option;
+        initStyleOption(&opt, index);
+        int sourceRow = index.row();
+        if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
+            sourceRow = proxy->mapToSource(index).row();
+        }
+        if(sourceRow % 3 == 2 && opt.backgroundBrush.style() == Qt::NoBrush
+           && !(opt.state & QStyle::State_Selected)){
+            opt.backgroundBrush = QColor(240, 248, 255);
+        }
+        bool isNull = false;
+        if(auto *proxy = qobject_cast<const QSortFilterProxyModel*>(index.model())){
+            QModelIndex sourceIndex = proxy->mapToSource(index);
+            if(auto *srcModel = qobject_cast<const QStandardItemModel*>(proxy->sourceModel())){
+                if(auto *item = srcModel->itemFromIndex(sourceIndex)){
+                    QVariant nullData = item->data(NullRole);
+                    isNull = nullData.isValid() && nullData.toBool();
+                }
+            }
+        } else if(auto *stdModel = qobject_cast<const QStandardItemModel*>(index.model())){
+            if(auto *item = stdModel->itemFromIndex(index)){
+                QVariant nullData = item->data(NullRole);
+                isNull = nullData.isValid() && nullData.toBool();
+            }
+        }
+
+        if(isNull){
+            opt.text = QStringLiteral("NULL");
+            opt.font.setItalic(true);
+            opt.palette.setColor(QPalette::Text, QColor(160, 160, 160));
+        }
+        const QStyle *style = opt.widget ? opt.widget->style() : QApplication::style();
+        style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+    }
+
+    mutable QHash<quint64, CachedCell> cellCache;
+    mutable QFont cacheFont;
+    mutable QFont nullFont;
+    mutable QMargins textMargins = QMargins(3, 0, 3, 0);
+    mutable bool styleResolved = false;
+};
+
+// With fast painting, lay alternate and band backgrounds once per row; cells only draw
+// selection, highlight and text
+class ResultGridView : public QTableView
+{
+public:
+    using QTableView::QTableView;
+
+    bool fillRows = false;
+    std::function<void(const QPoint &globalPos)> contextMenu;
+
+protected:
+    void changeEvent(QEvent *event) override
+    {
+        if(event->type() == QEvent::StyleChange || event->type() == QEvent::FontChange){
+            if(auto *delegate = dynamic_cast<NullAwareDelegate*>(itemDelegate())){
+                delegate->clearStyleCache();
+            }
+        }
+        QTableView::changeEvent(event);
+    }
+
+    void contextMenuEvent(QContextMenuEvent *event) override
+    {
+        if(!contextMenu){
+            QTableView::contextMenuEvent(event);
+            return;
+        }
+        contextMenu(event->globalPos());
+        event->accept();
+    }
+
+    void paintEvent(QPaintEvent *event) override
+    {
+        auto *proxyModel = qobject_cast<QSortFilterProxyModel*>(model());
+        const QRect area = event->rect();
+        const int first = rowAt(area.top());
+        const int right = qMin(area.right() + 1, horizontalHeader()->length() - horizontalOffset());
+        if(fillRows && proxyModel && first >= 0 && right > area.left()){
+            int last = rowAt(area.bottom());
+            if(last < 0){
+                last = proxyModel->rowCount() - 1;
+            }
+            const QBrush alternate = palette().brush(QPalette::AlternateBase);
+            const QColor stripe(kStripeBackground);
+            QPainter painter(viewport());
+            for(int row = first; row <= last; ++row){
+                if(isRowHidden(row)){
+                    continue;
+                }
+                const int sourceRow = proxyModel->mapToSource(proxyModel->index(row, 0)).row();
+                const QRect rowRect(area.left(), rowViewportPosition(row), right - area.left(), rowHeight(row));
+                if(sourceRow % 3 == 2){
+                    painter.fillRect(rowRect, stripe);
+                }else if(alternatingRowColors() && row % 2 == 1){
+                    painter.fillRect(rowRect, alternate);
+                }
+            }
+        }
+        QTableView::paintEvent(event);
+    }
 };
 
 namespace {
@@ -199,91 +427,825 @@ bool isNumeric(const QString &value, QString *normalized)
     if(!ok){
         return false;
     }
-    if(normalized){
-        *normalized = QString::number(num, 'g', 15);
+    if(normalized){
+        *normalized = QString::number(num, 'g', 15);
+    }
+    return true;
+}
+
+// Separator between cell texts so a match cannot span two cells
+const QChar kCellSeparator(0x1F);
+// Fewest rows in one parallel scan chunk
+const int kScanChunkRows = 16384;
+// Character limit of the text store; beyond it filtering reads the model row by row
+const qint64 kMaxFilterStoreChars = 1 << 28;
+// With many rows, filter once typing in the filter box pauses
+const int kFilterDebounceRows = 20000;
+const int kFilterDebounceMs = 200;
+// Decoded blocks cached for a spilled result, and the rows auto-fit looks at
+const int kCachedSpillBlocks = 64;
+const int kAutoFitSampleRows = 1000;
+
+// Chunks to split count items into: at least minChunk items each, at most four per thread
+int chunkCount(int count, int minChunk)
+{
+    const int maxChunks = qMax(1, QThread::idealThreadCount()) * 4;
+    return qBound(1, (count + minChunk - 1) / qMax(1, minChunk), maxChunks);
+}
+
+// Runs work(chunk, begin, end) on the global thread pool, the first chunk on the calling
+// thread, and returns when all are done
+void runChunks(int count, int chunks, const std::function<void(int, int, int)> &work)
+{
+    const int perChunk = (count + chunks - 1) / qMax(1, chunks);
+    QSemaphore done;
+    for(int c = 1; c < chunks; ++c){
+        const int begin = qMin(count, c * perChunk);
+        const int end = qMin(count, begin + perChunk);
+        QThreadPool::globalInstance()->start(QRunnable::create([&work, &done, c, begin, end]() {
+            work(c, begin, end);
+            done.release();
+        }));
+    }
+    work(0, 0, qMin(count, perChunk));
+    done.acquire(chunks - 1);
+}
+
+// Finds needle in the folded row text; rows are the candidates in ascending order, and
+// the matches come back ascending
+QVector<int> scanRows(const QString &text,
+                      const QVector<int> &offsets,
+                      const QString &needle,
+                      const QVector<int> &rows)
+{
+    const int chunks = chunkCount(rows.size(), kScanChunkRows);
+    QVector<QVector<int>> parts(chunks);
+    QVector<int> *out = parts.data();
+    runChunks(rows.size(), chunks, [&text, &offsets, &needle, &rows, out](int chunk, int begin, int end) {
+        const QStringView all(text);
+        const QStringView key(needle);
+        for(int i = begin; i < end; ++i){
+            const int row = rows.at(i);
+            const int start = offsets.at(row);
+            if(all.mid(start, offsets.at(row + 1) - start).indexOf(key) >= 0){
+                out[chunk].append(row);
+            }
+        }
+    });
+    QVector<int> matches = parts.first();
+    for(int c = 1; c < chunks; ++c){
+        matches += parts.at(c);
+    }
+    return matches;
+}
+
+// Sort key kinds: integers and dates/times fold to int64, reals to double, text to collation keys
+enum class SortKind {
+    Auto,
+    Integer,
+    Unsigned,
+    Real,
+    Date,
+    DateTime,
+    Time,
+    Text
+};
+
+SortKind sortKindForType(int type)
+{
+    switch(type){
+    case QMetaType::Bool:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        return SortKind::Integer;
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        return SortKind::Unsigned;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return SortKind::Real;
+    case QMetaType::QDate:
+        return SortKind::Date;
+    case QMetaType::QDateTime:
+        return SortKind::DateTime;
+    case QMetaType::QTime:
+        return SortKind::Time;
+    default:
+        return SortKind::Text;
+    }
+}
+
+// Key for integers, dates and times; values that do not parse sort before all other non-NULL values
+qint64 integerKey(SortKind kind, const QString &text)
+{
+    const qint64 invalid = std::numeric_limits<qint64>::min();
+    switch(kind){
+    case SortKind::Integer: {
+        bool ok = false;
+        const qint64 value = text.toLongLong(&ok);
+        if(ok){
+            return value;
+        }
+        if(text == QLatin1String("true")){
+            return 1;
+        }
+        if(text == QLatin1String("false")){
+            return 0;
+        }
+        const double real = text.toDouble(&ok);
+        return ok ? qint64(real) : invalid; }
+    case SortKind::Unsigned: {
+        bool ok = false;
+        // With the sign bit flipped, signed comparison gives the unsigned order
+        const quint64 value = text.toULongLong(&ok);
+        return ok ? qint64(value ^ (Q_UINT64_C(1) << 63)) : invalid; }
+    case SortKind::Date: {
+        const QDate date = QDate::fromString(text, Qt::ISODate);
+        return date.isValid() ? date.toJulianDay() : invalid; }
+    case SortKind::DateTime: {
+        QDateTime dateTime = QDateTime::fromString(text, Qt::ISODateWithMs);
+        if(!dateTime.isValid()){
+            dateTime = QDateTime::fromString(text, QStringLiteral("yyyy-MM-dd HH:mm:ss"));
+        }
+        if(!dateTime.isValid()){
+            return invalid;
+        }
+        // Read as UTC to skip a time zone conversion per row
+        dateTime.setTimeSpec(Qt::UTC);
+        return dateTime.toMSecsSinceEpoch(); }
+    case SortKind::Time: {
+        const QTime time = QTime::fromString(text, Qt::ISODateWithMs);
+        return time.isValid() ? time.msecsSinceStartOfDay() : invalid; }
+    default:
+        return invalid;
+    }
+}
+
+bool usesIntegerKey(SortKind kind)
+{
+    return kind != SortKind::Auto && kind != SortKind::Real && kind != SortKind::Text;
+}
+
+// Sort keys of one column, indexed by source row
+struct SortKeys {
+    SortKind kind = SortKind::Auto;
+    QVector<quint8> nulls;
+    QVector<qint64> integers;
+    QVector<double> reals;
+    std::vector<QCollatorSortKey> texts;
+
+    // NULL is always smallest: first ascending, last descending
+    bool less(int a, int b) const
+    {
+        if(nulls.at(a) != nulls.at(b)){
+            return nulls.at(a) > nulls.at(b);
+        }
+        if(nulls.at(a)){
+            return false;
+        }
+        if(usesIntegerKey(kind)){
+            return integers.at(a) < integers.at(b);
+        }
+        if(kind == SortKind::Real){
+            return reals.at(a) < reals.at(b);
+        }
+        return texts.at(size_t(a)).compare(texts.at(size_t(b))) < 0;
+    }
+};
+
+// Builds sort keys from cell text in parallel; an Auto column sorts numerically when
+// every value parses as a number, as text otherwise
+SortKeys buildSortKeys(SortKind kind, const QVector<QString> &values, const QVector<quint8> &nulls)
+{
+    SortKeys keys;
+    keys.nulls = nulls;
+    const int count = values.size();
+    const int chunks = chunkCount(count, kScanChunkRows);
+    if(kind == SortKind::Auto || kind == SortKind::Real){
+        keys.reals.resize(count);
+        double *reals = keys.reals.data();
+        std::atomic<bool> allNumeric(true);
+        runChunks(count, chunks, [&values, &nulls, reals, &allNumeric](int, int begin, int end) {
+            for(int i = begin; i < end; ++i){
+                bool ok = true;
+                reals[i] = nulls.at(i) ? 0.0 : values.at(i).toDouble(&ok);
+                if(!ok){
+                    reals[i] = -std::numeric_limits<double>::infinity();
+                    allNumeric.store(false, std::memory_order_relaxed);
+                }
+            }
+        });
+        if(kind == SortKind::Real || allNumeric.load()){
+            keys.kind = SortKind::Real;
+            return keys;
+        }
+        keys.reals.clear();
+        kind = SortKind::Text;
+    }
+    keys.kind = kind;
+    if(usesIntegerKey(kind)){
+        keys.integers.resize(count);
+        qint64 *integers = keys.integers.data();
+        runChunks(count, chunks, [kind, &values, &nulls, integers](int, int begin, int end) {
+            for(int i = begin; i < end; ++i){
+                integers[i] = nulls.at(i) ? 0 : integerKey(kind, values.at(i));
+            }
+        });
+        return keys;
+    }
+    // QCollator cannot be shared across threads; one per chunk
+    std::vector<std::vector<QCollatorSortKey>> parts(size_t(chunks));
+    std::vector<QCollatorSortKey> *out = parts.data();
+    runChunks(count, chunks, [&values, out](int chunk, int begin, int end) {
+        QCollator collator;
+        out[chunk].reserve(size_t(end - begin));
+        for(int i = begin; i < end; ++i){
+            out[chunk].push_back(collator.sortKey(values.at(i)));
+        }
+    });
+    keys.texts.reserve(size_t(count));
+    for(auto &part : parts){
+        std::move(part.begin(), part.end(), std::back_inserter(keys.texts));
+    }
+    return keys;
+}
+
+// Sorts row numbers in parallel and ranks each row; equal keys share a rank
+QVector<int> rankRows(const SortKeys &keys)
+{
+    const int count = keys.nulls.size();
+    QVector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&keys](int a, int b) {
+        if(keys.less(a, b)){
+            return true;
+        }
+        return !keys.less(b, a) && a < b;
+    };
+    const int chunks = chunkCount(count, kScanChunkRows);
+    const int perChunk = (count + chunks - 1) / chunks;
+    int *data = order.data();
+    runChunks(count, chunks, [data, &less](int, int begin, int end) {
+        std::sort(data + begin, data + end, less);
+    });
+    // Once each chunk is sorted, merge them pairwise round by round
+    for(int width = perChunk; width < count; width *= 2){
+        const int pairs = (count + 2 * width - 1) / (2 * width);
+        runChunks(pairs, chunkCount(pairs, 1), [data, &less, width, count](int, int begin, int end) {
+            for(int pair = begin; pair < end; ++pair){
+                const int first = pair * 2 * width;
+                const int middle = qMin(count, first + width);
+                const int last = qMin(count, first + 2 * width);
+                if(middle < last){
+                    std::inplace_merge(data + first, data + middle, data + last, less);
+                }
+            }
+        });
+    }
+    QVector<int> ranks(count);
+    for(int i = 0; i < count; ++i){
+        ranks[order.at(i)] = (i > 0 && !keys.less(order.at(i - 1), order.at(i)))
+                ? ranks.at(order.at(i - 1))
+                : i;
+    }
+    return ranks;
+}
+
+}
+
+class ResultFilterProxy : public QSortFilterProxyModel
+{
+public:
+    explicit ResultFilterProxy(QObject *parent = nullptr)
+        : QSortFilterProxyModel(parent)
+    {
+        setFilterCaseSensitivity(Qt::CaseInsensitive);
+        setDynamicSortFilter(true);
+    }
+
+    void setSourceModel(QAbstractItemModel *source) override
+    {
+        if(source == sourceModel()){
+            return;
+        }
+        for(const auto &connection : qAsConst(storeConnections)){
+            disconnect(connection);
+        }
+        storeConnections.clear();
+        sourceChanged();
+        // Connected before the base class so the text store is current when it refilters
+        if(source){
+            storeConnections
+                    << connect(source, &QAbstractItemModel::dataChanged, this, &ResultFilterProxy::sourceDataChanged)
+                    << connect(source, &QAbstractItemModel::rowsInserted, this, &ResultFilterProxy::sourceRowsInserted)
+                    << connect(source, &QAbstractItemModel::modelReset, this, &ResultFilterProxy::sourceChanged)
+                    << connect(source, &QAbstractItemModel::layoutChanged, this, &ResultFilterProxy::sourceChanged)
+                    << connect(source, &QAbstractItemModel::rowsRemoved, this, &ResultFilterProxy::sourceChanged)
+                    << connect(source, &QAbstractItemModel::rowsMoved, this, &ResultFilterProxy::sourceChanged)
+                    << connect(source, &QAbstractItemModel::columnsInserted, this, &ResultFilterProxy::sourceChanged)
+                    << connect(source, &QAbstractItemModel::columnsRemoved, this, &ResultFilterProxy::sourceChanged);
+        }
+        QSortFilterProxyModel::setSourceModel(source);
+    }
+
+    void setFilterNeedle(const QString &text)
+    {
+        const QString trimmed = text.trimmed();
+        if(needle == trimmed){
+            return;
+        }
+        needle = trimmed;
+        foldedNeedle = needle.toCaseFolded();
+        invalidateFilter();
+    }
+
+    QString filterNeedle() const
+    {
+        return needle;
+    }
+
+    // When off, filtering reads the model row by row instead of keeping all row text in memory
+    void setTextStoreEnabled(bool enabled)
+    {
+        storeAllowed = enabled;
+        resetStore();
+    }
+
+    // Once a browsed result drops its first rows, row numbers still show the position in
+    // the whole result
+    void setRowNumberOffset(int offset)
+    {
+        if(rowOffset == offset){
+            return;
+        }
+        rowOffset = offset;
+        if(rowCount() > 0){
+            emit headerDataChanged(Qt::Vertical, 0, rowCount() - 1);
+        }
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override
+    {
+        if(orientation == Qt::Vertical && role == Qt::DisplayRole && rowOffset > 0){
+            const QModelIndex source = mapToSource(index(section, 0));
+            if(source.isValid()){
+                return source.row() + 1 + rowOffset;
+            }
+        }
+        return QSortFilterProxyModel::headerData(section, orientation, role);
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    {
+        if(needle.isEmpty() || sourceParent.isValid()){
+            return true;
+        }
+        if(!sourceModel()){
+            return true;
+        }
+        if(!storeAllowed || storeDisabled || dirtyRows.contains(sourceRow)){
+            return rowMatches(sourceRow);
+        }
+        if(scannedNeedle != foldedNeedle || sourceRow >= accepted.size()){
+            updateMatches();
+            if(storeDisabled){
+                return rowMatches(sourceRow);
+            }
+        }
+        return sourceRow < accepted.size() && accepted.at(sourceRow);
+    }
+
+    void sort(int column, Qt::SortOrder order) override
+    {
+        buildRanks(column);
+        QSortFilterProxyModel::sort(column, order);
+    }
+
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override
+    {
+        if(left.column() == rankColumn){
+            const int leftRank = left.row() < ranks.size() ? ranks.at(left.row()) : -1;
+            const int rightRank = right.row() < ranks.size() ? ranks.at(right.row()) : -1;
+            if(leftRank >= 0 && rightRank >= 0){
+                return leftRank < rightRank;
+            }
+        }
+        // Rows added or changed since the sort compare one by one, in the same order as the ranks
+        const auto *src = sourceModel();
+        const bool lNull = src->data(left, NullRole).toBool();
+        const bool rNull = src->data(right, NullRole).toBool();
+        if(lNull != rNull){
+            return lNull;
+        }
+        if(lNull){
+            return false;
+        }
+        const QString lValue = src->data(left, Qt::DisplayRole).toString();
+        const QString rValue = src->data(right, Qt::DisplayRole).toString();
+        const SortKind kind = left.column() == rankColumn ? rankKind : columnSortKind(left.column());
+        if(usesIntegerKey(kind)){
+            return integerKey(kind, lValue) < integerKey(kind, rValue);
+        }
+        if(kind == SortKind::Real){
+            return lValue.toDouble() < rValue.toDouble();
+        }
+        if(kind == SortKind::Text){
+            return collator.compare(lValue, rValue) < 0;
+        }
+        QString lNumeric;
+        QString rNumeric;
+        const bool lIsNumeric = isNumeric(lValue, &lNumeric);
+        const bool rIsNumeric = isNumeric(rValue, &rNumeric);
+        if(lIsNumeric && rIsNumeric){
+            bool okL = false;
+            bool okR = false;
+            const double ln = lNumeric.toDouble(&okL);
+            const double rn = rNumeric.toDouble(&okR);
+            if(okL && okR){
+                return ln < rn;
+            }
+        }
+        return collator.compare(lValue, rValue) < 0;
+    }
+
+private:
+    // Checks the model cell by cell, for rows changed after the store was built
+    bool rowMatches(int sourceRow) const
+    {
+        const auto *src = sourceModel();
+        for(int c = 0; c < src->columnCount(); ++c){
+            const QModelIndex idx = src->index(sourceRow, c);
+            if(!idx.isValid()){
+                continue;
+            }
+            const QString text = src->data(idx, Qt::DisplayRole).toString();
+            if(text.contains(needle, Qt::CaseInsensitive)){
+                return true;
+            }
+            const QVariant boolData = src->data(idx, Qt::UserRole + 1);
+            if(boolData.isValid()){
+                const QString boolText = boolData.toBool() ? QStringLiteral("1") : QStringLiteral("0");
+                if(boolText.contains(needle, Qt::CaseInsensitive)){
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void appendRowText(int sourceRow) const
+    {
+        const auto *src = sourceModel();
+        for(int c = 0; c < src->columnCount(); ++c){
+            const QModelIndex idx = src->index(sourceRow, c);
+            storeText += src->data(idx, Qt::DisplayRole).toString().toCaseFolded();
+            const QVariant boolData = src->data(idx, Qt::UserRole + 1);
+            if(boolData.isValid()){
+                storeText += kCellSeparator;
+                storeText += boolData.toBool() ? QLatin1Char('1') : QLatin1Char('0');
+            }
+            storeText += kCellSeparator;
+        }
+        storeOffsets.append(storeText.size());
+    }
+
+    // Scan after topping up the store: when needle contains the previous one only the
+    // previous matches are rechecked; appended rows are always scanned
+    void updateMatches() const
+    {
+        const int rowCount = sourceModel()->rowCount();
+        if(storeOffsets.isEmpty()){
+            storeOffsets.append(0);
+        }
+        // The store is a second copy of the grid text, so it shares the
+        // per-result memory budget (two bytes per QChar)
+        const qint64 budget = ResultSpill::memoryBudget();
+        const qint64 maxChars = budget > 0 ? qMin(budget / qint64(sizeof(QChar)), kMaxFilterStoreChars)
+                                           : kMaxFilterStoreChars;
+        for(int row = storeOffsets.size() - 1; row < rowCount; ++row){
+            if(storeText.size() > maxChars){
+                resetStore();
+                storeDisabled = true;
+                return;
+            }
+            appendRowText(row);
+        }
+
+        QVector<int> candidates;
+        const bool sameNeedle = scannedNeedle == foldedNeedle;
+        const bool narrowing = !scannedNeedle.isEmpty() && foldedNeedle.contains(scannedNeedle);
+        const int firstNew = (sameNeedle || narrowing) ? scannedRows : 0;
+        if(!sameNeedle && narrowing){
+            candidates = matches;
+        }
+        candidates.reserve(candidates.size() + rowCount - firstNew);
+        for(int row = firstNew; row < rowCount; ++row){
+            candidates.append(row);
+        }
+        const QVector<int> found = scanRows(storeText, storeOffsets, foldedNeedle, candidates);
+        if(sameNeedle){
+            matches += found;
+        }else{
+            matches = found;
+        }
+
+        accepted.fill(0, rowCount);
+        for(int row : qAsConst(matches)){
+            accepted[row] = 1;
+        }
+        scannedNeedle = foldedNeedle;
+        scannedRows = rowCount;
+    }
+
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+    {
+        const bool textChanged = roles.isEmpty() || roles.contains(Qt::DisplayRole) || roles.contains(Qt::EditRole);
+        if(!textChanged && !roles.contains(Qt::UserRole + 1) && !roles.contains(NullRole)){
+            return;
+        }
+        if(bottomRight.row() - topLeft.row() > 1000){
+            sourceChanged();
+            return;
+        }
+        for(int row = topLeft.row(); row <= bottomRight.row(); ++row){
+            if(row < storeOffsets.size() - 1){
+                dirtyRows.insert(row);
+            }
+            // Rows whose rank went stale compare one by one in lessThan
+            if(row < ranks.size() && rankColumn >= topLeft.column() && rankColumn <= bottomRight.column()){
+                ranks[row] = -1;
+            }
+        }
+    }
+
+    void sourceRowsInserted(const QModelIndex &parent, int first, int)
+    {
+        // Rows appended at the end are added to the store on the next filter; rows
+        // inserted elsewhere rebuild it
+        if(!parent.isValid() && (first < storeOffsets.size() - 1 || first < ranks.size())){
+            sourceChanged();
+        }
+    }
+
+    SortKind columnSortKind(int column) const
+    {
+        const QVariant type = sourceModel()->index(0, column).data(TypeRole);
+        return type.isValid() ? sortKindForType(type.toInt()) : SortKind::Auto;
+    }
+
+    // Builds keys for every row by column type at once and ranks them; lessThan only compares ranks
+    void buildRanks(int column)
+    {
+        resetRanks();
+        const auto *src = sourceModel();
+        if(!src || column < 0 || column >= src->columnCount()){
+            return;
+        }
+        const int rowCount = src->rowCount();
+        QVector<QString> values(rowCount);
+        QVector<quint8> nulls(rowCount);
+        for(int row = 0; row < rowCount; ++row){
+            const QModelIndex idx = src->index(row, column);
+            values[row] = src->data(idx, Qt::DisplayRole).toString();
+            nulls[row] = src->data(idx, NullRole).toBool() ? 1 : 0;
+        }
+        const SortKeys keys = buildSortKeys(columnSortKind(column), values, nulls);
+        ranks = rankRows(keys);
+        rankKind = keys.kind;
+        rankColumn = column;
+    }
+
+    void resetRanks()
+    {
+        ranks.clear();
+        rankColumn = -1;
+        rankKind = SortKind::Auto;
+    }
+
+    void sourceChanged()
+    {
+        resetStore();
+        resetRanks();
+    }
+
+    void resetStore() const
+    {
+        storeText.clear();
+        storeOffsets.clear();
+        dirtyRows.clear();
+        matches.clear();
+        accepted.clear();
+        scannedNeedle.clear();
+        scannedRows = 0;
+        storeDisabled = false;
+    }
+
+    QString needle;
+    QString foldedNeedle;
+    QVector<QMetaObject::Connection> storeConnections;
+    // Case-folded row text; row r is at [storeOffsets[r], storeOffsets[r + 1])
+    mutable QString storeText;
+    mutable QVector<int> storeOffsets;
+    mutable QSet<int> dirtyRows;
+    mutable QVector<int> matches;
+    mutable QVector<quint8> accepted;
+    mutable QString scannedNeedle;
+    mutable int scannedRows = 0;
+    mutable bool storeDisabled = false;
+    bool storeAllowed = true;
+    // Rank of each source row in the sort column; -1 means compare directly
+    QVector<int> ranks;
+    int rankColumn = -1;
+    SortKind rankKind = SortKind::Auto;
+    QCollator collator;
+    int rowOffset = 0;
+};
+
+// A result past the memory budget: the first rows stay in memory, the rest decode block
+// by block from the temporary file, caching only recent blocks
+class SpilledResultModel : public QAbstractTableModel
+{
+public:
+    SpilledResultModel(const QStringList &headers,
+                       const QList<QVariantList> &rows,
+                       std::unique_ptr<ResultSpill> spill,
+                       const QVector<int> &columnTypes,
+                       QObject *parent = nullptr)
+        : QAbstractTableModel(parent),
+          headers(headers),
+          columnTypes(columnTypes),
+          memoryRows(rows),
+          spill(std::move(spill)),
+          blocks(kCachedSpillBlocks)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : memoryRows.size() + spill->rowCount();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : headers.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override
+    {
+        if(role == TypeRole){
+            return index.column() < columnTypes.size() ? QVariant(columnTypes.at(index.column())) : QVariant();
+        }
+        if(role != Qt::DisplayRole && role != Qt::EditRole && role != NullRole){
+            return QVariant();
+        }
+        const QVariant value = valueAt(index.row(), index.column());
+        if(role == NullRole){
+            return value.isNull();
+        }
+        return value.isNull() ? QString() : value.toString();
+    }
+
+    QMap<int, QVariant> itemData(const QModelIndex &index) const override
+    {
+        const QVariant value = valueAt(index.row(), index.column());
+        QMap<int, QVariant> roles;
+        roles.insert(Qt::DisplayRole, value.isNull() ? QString() : value.toString());
+        roles.insert(NullRole, value.isNull());
+        return roles;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override
+    {
+        if(orientation == Qt::Horizontal && role == Qt::DisplayRole){
+            return headers.value(section);
+        }
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    int spilledRows() const
+    {
+        return spill->rowCount();
+    }
+
+    qint64 spillBytes() const
+    {
+        return spill->fileBytes();
     }
-    return true;
-}
 
-}
+private:
+    QVariant valueAt(int row, int column) const
+    {
+        if(row < 0 || column < 0){
+            return QVariant();
+        }
+        if(row < memoryRows.size()){
+            return memoryRows.at(row).value(column);
+        }
+        const int spillRow = row - memoryRows.size();
+        const int block = spillRow / ResultSpill::rowsPerBlock();
+        QList<QVariantList> *rows = blocks.object(block);
+        if(!rows){
+            rows = new QList<QVariantList>(spill->readBlock(block));
+            blocks.insert(block, rows);
+        }
+        return rows->value(spillRow % ResultSpill::rowsPerBlock()).value(column);
+    }
 
-class ResultFilterProxy : public QSortFilterProxyModel
+    QStringList headers;
+    QVector<int> columnTypes;
+    QList<QVariantList> memoryRows;
+    std::unique_ptr<ResultSpill> spill;
+    mutable QCache<int, QList<QVariantList>> blocks;
+};
+
+// An opened .odbr result file: cells decode from the mapped file when scrolled to
+class ResultFileModel : public QAbstractTableModel
 {
 public:
-    explicit ResultFilterProxy(QObject *parent = nullptr)
-        : QSortFilterProxyModel(parent)
+    ResultFileModel(std::unique_ptr<ResultFile> file, QObject *parent = nullptr)
+        : QAbstractTableModel(parent),
+          file(std::move(file))
     {
-        setFilterCaseSensitivity(Qt::CaseInsensitive);
-        setDynamicSortFilter(true);
     }
 
-    void setFilterNeedle(const QString &text)
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
     {
-        const QString trimmed = text.trimmed();
-        if(needle == trimmed){
-            return;
-        }
-        needle = trimmed;
-        invalidateFilter();
+        return parent.isValid() ? 0 : file->rowCount();
     }
 
-    QString filterNeedle() const
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
     {
-        return needle;
+        return parent.isValid() ? 0 : file->columnCount();
     }
 
-protected:
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override
     {
-        if(needle.isEmpty()){
-            return true;
+        if(role == TypeRole){
+            return typeHint(index.column());
         }
-        const auto *src = sourceModel();
-        if(!src){
-            return true;
+        if(role != Qt::DisplayRole && role != Qt::EditRole && role != NullRole){
+            return QVariant();
         }
-        for(int c = 0; c < src->columnCount(sourceParent); ++c){
-            const QModelIndex idx = src->index(sourceRow, c, sourceParent);
-            if(!idx.isValid()){
-                continue;
-            }
-            const QString text = src->data(idx, Qt::DisplayRole).toString();
-            if(text.contains(needle, Qt::CaseInsensitive)){
-                return true;
-            }
-            const QVariant boolData = src->data(idx, Qt::UserRole + 1);
-            if(boolData.isValid()){
-                const QString boolText = boolData.toBool() ? QStringLiteral("1") : QStringLiteral("0");
-                if(boolText.contains(needle, Qt::CaseInsensitive)){
-                    return true;
-                }
-            }
+        bool isNull = true;
+        const QString text = file->text(index.row(), index.column(), &isNull);
+        if(role == NullRole){
+            return isNull;
         }
-        return false;
+        return text;
     }
 
-    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override
+    QMap<int, QVariant> itemData(const QModelIndex &index) const override
     {
-        const QString lValue = sourceModel()->data(left, Qt::DisplayRole).toString();
-        const QString rValue = sourceModel()->data(right, Qt::DisplayRole).toString();
-        QString lNumeric;
-        QString rNumeric;
-        const bool lIsNumeric = isNumeric(lValue, &lNumeric);
-        const bool rIsNumeric = isNumeric(rValue, &rNumeric);
-        if(lIsNumeric && rIsNumeric){
-            bool okL = false;
-            bool okR = false;
-            const double ln = lNumeric.toDouble(&okL);
-            const double rn = rNumeric.toDouble(&okR);
-            if(okL && okR){
-                return ln < rn;
-            }
+        bool isNull = true;
+        QMap<int, QVariant> roles;
+        roles.insert(Qt::DisplayRole, file->text(index.row(), index.column(), &isNull));
+        roles.insert(NullRole, isNull);
+        return roles;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override
+    {
+        if(orientation == Qt::Horizontal && role == Qt::DisplayRole){
+            return file->headers().value(section);
         }
-        return QString::localeAwareCompare(lValue, rValue) < 0;
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    QDateTime savedAt() const
+    {
+        return file->savedAt();
     }
 
 private:
-    QString needle;
+    // Sort hint from the column type, matching the TypeRole of query results
+    QVariant typeHint(int column) const
+    {
+        switch(file->columnType(column)){
+        case ResultFile::Int64:
+            return int(QMetaType::LongLong);
+        case ResultFile::Real:
+            return int(QMetaType::Double);
+        case ResultFile::Date:
+            return int(QMetaType::QDate);
+        case ResultFile::Time:
+            return int(QMetaType::QTime);
+        case ResultFile::DateTime:
+            return int(QMetaType::QDateTime);
+        case ResultFile::Text:
+            break;
+        }
+        return QVariant();
+    }
+
+    std::unique_ptr<ResultFile> file;
 };
 
 namespace {
@@ -317,8 +1279,14 @@ ResultForm::ResultForm(QWidget *parent) : QWidget(parent)
     stack = new QStackedLayout;
     layout->addLayout(stack);
 
-    tableView = new QTableView(this);
-    tableView->setItemDelegate(new NullAwareDelegate(tableView));
+    gridView = new ResultGridView(this);
+    tableView = gridView;
+    gridView->contextMenu = [this](const QPoint &globalPos) { showContextMenu(globalPos); };
+    gridDelegate = new NullAwareDelegate(tableView);
+    gridDelegate->loadFullValue = [this](int sourceRow, int column) {
+        return !valueLoader || valueLoader(column, {sourceRow});
+    };
+    tableView->setItemDelegate(gridDelegate);
     tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
     tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
     tableView->setSelectionMode(QAbstractItemView::ExtendedSelection);
@@ -328,6 +1296,7 @@ ResultForm::ResultForm(QWidget *parent) : QWidget(parent)
     tableView->setFrameShape(QFrame::NoFrame);
     tableView->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
     tableView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    connect(tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, &ResultForm::checkFetchMore);
     tableView->setStyleSheet(QStringLiteral(
         "QTableView {"
         "  background: #fdfdfd;"
@@ -362,6 +1331,20 @@ ResultForm::ResultForm(QWidget *parent) : QWidget(parent)
     proxy = new ResultFilterProxy(this);
     proxy->setSourceModel(model);
     tableView->setModel(proxy);
+    // Any change to the view's rows or columns invalidates the fast path's cell cache
+    const auto clearCellCache = [this]() { gridDelegate->clearCellCache(); };
+    connect(proxy, &QAbstractItemModel::modelReset, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::layoutChanged, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::rowsInserted, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::rowsRemoved, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::columnsInserted, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::columnsRemoved, this, clearCellCache);
+    connect(proxy, &QAbstractItemModel::dataChanged, this, clearCellCache);
+
+    filterTimer = new QTimer(this);
+    filterTimer->setSingleShot(true);
+    filterTimer->setInterval(kFilterDebounceMs);
+    connect(filterTimer, &QTimer::timeout, this, &ResultForm::applyFilter);
 
     messageLabel = new QLabel(tr("Ready."), this);
     messageLabel->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
@@ -450,6 +1433,8 @@ void ResultForm::showRows(const QStringList &headers,
     if(!model || !tableView){
         return;
     }
+    fetchMoreEnabled = false;
+    useStandardModel();
     const bool sortingEnabled = tableView->isSortingEnabled();
     tableView->setSortingEnabled(false);
     tableView->setEditTriggers(editable
@@ -472,6 +1457,7 @@ void ResultForm::showRows(const QStringList &headers,
     tableView->setSortingEnabled(sortingEnabled);
     stack->setCurrentWidget(tableView);
     mode = DisplayMode::Data;
+    setFastRendering(true);
     QString summary = tr("Rows: %1%2")
             .arg(rows.count())
             .arg(elapsedMs >= 0 ? tr("  Time: %1 ms").arg(elapsedMs) : QString());
@@ -494,6 +1480,8 @@ void ResultForm::showRows(const QStringList &headers,
     if(!model || !tableView){
         return;
     }
+    fetchMoreEnabled = false;
+    useStandardModel();
     const bool sortingEnabled = tableView->isSortingEnabled();
     tableView->setSortingEnabled(false);
     tableView->setEditTriggers(editable
@@ -521,6 +1509,7 @@ void ResultForm::showRows(const QStringList &headers,
     tableView->setSortingEnabled(sortingEnabled);
     stack->setCurrentWidget(tableView);
     mode = DisplayMode::Data;
+    setFastRendering(true);
     QString summary = tr("Rows: %1%2")
             .arg(rows.count())
             .arg(elapsedMs >= 0 ? tr("  Time: %1 ms").arg(elapsedMs) : QString());
@@ -533,11 +1522,320 @@ void ResultForm::showRows(const QStringList &headers,
     autoFitColumns();
 }
 
+void ResultForm::showSpilledRows(const QStringList &headers,
+                                 const QList<QVariantList> &rows,
+                                 std::unique_ptr<ResultSpill> spill,
+                                 qint64 elapsedMs,
+                                 const QString &note,
+                                 const QVector<int> &columnTypes)
+{
+    if(!model || !tableView || !spill){
+        return;
+    }
+    auto *store = new SpilledResultModel(headers, rows, std::move(spill), columnTypes, this);
+    QString summary = tr("Rows: %1%2")
+            .arg(store->rowCount())
+            .arg(elapsedMs >= 0 ? tr("  Time: %1 ms").arg(elapsedMs) : QString());
+    summary += tr("  %1 rows kept on disk (%2 MB)")
+            .arg(store->spilledRows())
+            .arg(qMax<qint64>(1, store->spillBytes() / (1024 * 1024)));
+    if(!note.trimmed().isEmpty()){
+        summary += tr("  %1").arg(note.trimmed());
+    }
+    showStoreModel(store, summary);
+}
+
+bool ResultForm::saveResultFile(const QString &path, QString *errorMessage)
+{
+    const QAbstractItemModel *source = dataModel();
+    if(mode != DisplayMode::Data || !source || !proxy){
+        if(errorMessage){
+            *errorMessage = tr("No data to save.");
+        }
+        return false;
+    }
+    QStringList headers;
+    QVector<int> columnTypes;
+    for(int c = 0; c < source->columnCount(); ++c){
+        headers << source->headerData(c, Qt::Horizontal).toString();
+        columnTypes << source->index(0, c).data(TypeRole).toInt();
+    }
+    // Saved as the view shows it, like exports: filtered rows in the current sort order
+    const ResultFilterProxy *view = proxy;
+    return ResultFile::write(path, headers, columnTypes, view->rowCount(),
+                             [view](int row, int column, bool *isNull) {
+        const QModelIndex index = view->index(row, column);
+        *isNull = index.data(NullRole).toBool();
+        return *isNull ? QString() : index.data(Qt::DisplayRole).toString();
+    }, errorMessage);
+}
+
+bool ResultForm::openResultFile(const QString &path, QString *errorMessage)
+{
+    if(!model || !tableView){
+        return false;
+    }
+    auto file = std::make_unique<ResultFile>();
+    if(!file->open(path, errorMessage)){
+        return false;
+    }
+    auto *store = new ResultFileModel(std::move(file), this);
+    const QString summary = tr("Rows: %1  Saved: %2  %3")
+            .arg(store->rowCount())
+            .arg(store->savedAt().toLocalTime().toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")))
+            .arg(QFileInfo(path).fileName());
+    showStoreModel(store, summary);
+    return true;
+}
+
+void ResultForm::saveResult()
+{
+    if(mode != DisplayMode::Data || !dataModel() || dataModel()->rowCount() == 0){
+        updateSummaryLabel(tr("No data to save."));
+        return;
+    }
+    const QString baseDir = lastExportDir.isEmpty() ? QDir::homePath() : lastExportDir;
+    QString path = QFileDialog::getSaveFileName(this,
+                                                tr("Save Result"),
+                                                QDir(baseDir).filePath(QStringLiteral("result.odbr")),
+                                                tr("Result Files (*.odbr)"));
+    if(path.isEmpty()){
+        return;
+    }
+    if(QFileInfo(path).suffix().isEmpty()){
+        path += QStringLiteral(".odbr");
+    }
+    QString error;
+    if(!saveResultFile(path, &error)){
+        updateSummaryLabel(error);
+        return;
+    }
+    lastExportDir = QFileInfo(path).absolutePath();
+    updateSummaryLabel(tr("Saved to %1").arg(QDir::toNativeSeparators(path)));
+}
+
+void ResultForm::openResult()
+{
+    const QString baseDir = lastExportDir.isEmpty() ? QDir::homePath() : lastExportDir;
+    const QString path = QFileDialog::getOpenFileName(this,
+                                                      tr("Open Result"),
+                                                      baseDir,
+                                                      tr("Result Files (*.odbr);;All Files (*)"));
+    if(path.isEmpty()){
+        return;
+    }
+    QString error;
+    if(!openResultFile(path, &error)){
+        updateSummaryLabel(error);
+        return;
+    }
+    lastExportDir = QFileInfo(path).absolutePath();
+}
+
+void ResultForm::showContextMenu(const QPoint &globalPos)
+{
+    QMenu menu(this);
+    QAction *saveAction = menu.addAction(tr("Save Result..."));
+    saveAction->setEnabled(mode == DisplayMode::Data && dataModel() && dataModel()->rowCount() > 0);
+    QAction *openAction = menu.addAction(tr("Open Result..."));
+    QAction *chosen = menu.exec(globalPos);
+    if(chosen == saveAction){
+        saveResult();
+    }else if(chosen == openAction){
+        openResult();
+    }
+}
+
+void ResultForm::showStoreModel(QAbstractTableModel *store, const QString &summary)
+{
+    fetchMoreEnabled = false;
+    const bool sortingEnabled = tableView->isSortingEnabled();
+    tableView->setSortingEnabled(false);
+    tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    model->clear();
+    QAbstractTableModel *previous = storeModel;
+    storeModel = store;
+    droppedRows = 0;
+    proxy->setRowNumberOffset(0);
+    proxy->setTextStoreEnabled(false);
+    proxy->setSourceModel(storeModel);
+    delete previous;
+    tableView->setSortingEnabled(sortingEnabled);
+    stack->setCurrentWidget(tableView);
+    mode = DisplayMode::Data;
+    setFastRendering(true);
+    QStringList headers;
+    for(int c = 0; c < storeModel->columnCount(); ++c){
+        headers << storeModel->headerData(c, Qt::Horizontal).toString();
+    }
+    rememberHeaders(headers);
+    rememberSummary(summary.trimmed());
+    applyFilter();
+    autoFitColumns();
+}
+
+void ResultForm::useStandardModel()
+{
+    // A new result is numbered from row 1
+    droppedRows = 0;
+    proxy->setRowNumberOffset(0);
+    if(!storeModel){
+        return;
+    }
+    proxy->setSourceModel(model);
+    proxy->setTextStoreEnabled(true);
+    delete storeModel;
+    storeModel = nullptr;
+}
+
+QAbstractItemModel *ResultForm::dataModel() const
+{
+    if(storeModel){
+        return storeModel;
+    }
+    return model;
+}
+
+void ResultForm::appendRows(const QStringList &headers,
+                            const QList<QVariantList> &rows,
+                            const QString &note,
+                            int maxRows)
+{
+    if(!model || !tableView){
+        return;
+    }
+    if(mode != DisplayMode::Data){
+        showRows(headers, rows, -1, note);
+        return;
+    }
+    QStringList merged = lastHeaders;
+    QVector<int> columnMap;
+    columnMap.reserve(headers.size());
+    // Identical headers map by position, so duplicate column names stay apart
+    const bool sameHeaders = headers == lastHeaders;
+    for(const QString &header : headers){
+        if(sameHeaders){
+            columnMap << columnMap.size();
+            continue;
+        }
+        int index = merged.indexOf(header);
+        if(index < 0){
+            merged << header;
+            index = merged.size() - 1;
+        }
+        columnMap << index;
+    }
+    if(merged.size() != lastHeaders.size()){
+        model->setColumnCount(merged.size());
+        model->setHorizontalHeaderLabels(merged);
+        rememberHeaders(merged);
+    }
+
+    const bool sortingEnabled = tableView->isSortingEnabled();
+    tableView->setSortingEnabled(false);
+    const int colCount = merged.size();
+    for(const auto &row : rows){
+        QList<QStandardItem*> items;
+        items.reserve(colCount);
+        for(int c = 0; c < colCount; ++c){
+            auto *item = createTextItem(QString());
+            item->setData(true, NullRole);
+            items << item;
+        }
+        for(int c = 0; c < columnMap.size() && c < row.size(); ++c){
+            const QVariant &val = row.at(c);
+            QStandardItem *item = items.at(columnMap.at(c));
+            item->setText(val.toString());
+            item->setData(val.isNull(), NullRole);
+        }
+        model->appendRow(items);
+    }
+    if(maxRows > 0 && model->rowCount() > maxRows){
+        // Drop the first rows; the height of those above the visible area comes off the
+        // scroll position so the view does not jump
+        const int excess = model->rowCount() - maxRows;
+        const int topRow = tableView->rowAt(0);
+        int removedAbove = 0;
+        for(int r = 0; r < excess; ++r){
+            const int proxyRow = proxy->mapFromSource(model->index(r, 0)).row();
+            if(proxyRow >= 0 && proxyRow < topRow){
+                ++removedAbove;
+            }
+        }
+        QScrollBar *bar = tableView->verticalScrollBar();
+        const int scrollValue = bar->value();
+        model->removeRows(0, excess);
+        droppedRows += excess;
+        proxy->setRowNumberOffset(droppedRows);
+        bar->setValue(scrollValue - removedAbove * tableView->verticalHeader()->defaultSectionSize());
+    }
+    tableView->setSortingEnabled(sortingEnabled);
+    QString summary = droppedRows > 0
+            ? tr("Rows: %1  Showing %2-%3").arg(droppedRows + model->rowCount()).arg(droppedRows + 1).arg(droppedRows + model->rowCount())
+            : tr("Rows: %1").arg(model->rowCount());
+    if(!note.trimmed().isEmpty()){
+        summary += tr("  %1").arg(note.trimmed());
+    }
+    rememberSummary(summary.trimmed());
+    applyFilter();
+}
+
+void ResultForm::setCanFetchMore(bool enabled)
+{
+    fetchMoreEnabled = enabled;
+    if(enabled){
+        // With less than a screen of rows there is no scroll bar; check again once layout is done
+        QTimer::singleShot(0, this, &ResultForm::checkFetchMore);
+    }
+}
+
+void ResultForm::checkFetchMore()
+{
+    if(!fetchMoreEnabled || mode != DisplayMode::Data){
+        return;
+    }
+    const QScrollBar *bar = tableView->verticalScrollBar();
+    if(bar->maximum() == 0 || bar->value() >= bar->maximum() - bar->pageStep()){
+        emit fetchMoreRequested();
+    }
+}
+
+void ResultForm::setFastRendering(bool enabled)
+{
+    gridDelegate->fastPaint = enabled;
+    gridDelegate->clearCellCache();
+    gridView->fillRows = enabled;
+    tableView->viewport()->update();
+}
+
+double ResultForm::benchmarkScrolling(int frames, bool fastRendering)
+{
+    if(mode != DisplayMode::Data || frames <= 0){
+        return 0;
+    }
+    setFastRendering(fastRendering);
+    QScrollBar *bar = tableView->verticalScrollBar();
+    const int step = qMax(1, tableView->verticalHeader()->defaultSectionSize());
+    bar->setValue(0);
+    tableView->viewport()->repaint();
+    QElapsedTimer timer;
+    timer.start();
+    for(int frame = 0; frame < frames; ++frame){
+        bar->setValue(bar->value() + step >= bar->maximum() ? 0 : bar->value() + step);
+        tableView->viewport()->repaint();
+    }
+    const qint64 elapsedNs = timer.nsecsElapsed();
+    setFastRendering(true);
+    return elapsedNs > 0 ? frames * 1e9 / elapsedNs : 0;
+}
+
 void ResultForm::showTableStructure(const QList<ColumnInfo> &columns, qint64 elapsedMs)
 {
     if(!model || !tableView){
         return;
     }
+    fetchMoreEnabled = false;
+    useStandardModel();
     const bool sortingEnabled = tableView->isSortingEnabled();
     tableView->setSortingEnabled(false);
     model->clear();
@@ -574,6 +1872,7 @@ void ResultForm::showTableStructure(const QList<ColumnInfo> &columns, qint64 ela
     tableView->setSortingEnabled(sortingEnabled);
     stack->setCurrentWidget(tableView);
     mode = DisplayMode::Structure;
+    setFastRendering(false);
     QString summary = tr("Columns: %1%2")
             .arg(columns.count())
             .arg(elapsedMs >= 0 ? tr("  Time: %1 ms").arg(elapsedMs) : QString());
@@ -593,6 +1892,8 @@ void ResultForm::showAffectRows(int affectedRows, qint64 elapsedMs)
 
 void ResultForm::showMessage(const QString &text)
 {
+    fetchMoreEnabled = false;
+    useStandardModel();
     messageLabel->setText(text);
     stack->setCurrentWidget(messageLabel);
     mode = DisplayMode::Message;
@@ -603,6 +1904,8 @@ void ResultForm::showMessage(const QString &text)
 
 void ResultForm::reset()
 {
+    fetchMoreEnabled = false;
+    useStandardModel();
     if(model){
         model->clear();
     }
@@ -627,7 +1930,8 @@ void ResultForm::updateSummaryLabel(const QString &text)
 
 QString ResultForm::selectedRowsAsTsv() const
 {
-    if(!tableView || !model || model->rowCount() == 0){
+    const QAbstractItemModel *source = dataModel();
+    if(!tableView || !source || source->rowCount() == 0){
         return {};
     }
     QStringList chunks;
@@ -651,8 +1955,8 @@ QString ResultForm::selectedRowsAsTsv() const
         return {};
     }
     QStringList header;
-    for(int c = 0; c < model->columnCount(); ++c){
-        header << model->headerData(c, Qt::Horizontal).toString();
+    for(int c = 0; c < source->columnCount(); ++c){
+        header << source->headerData(c, Qt::Horizontal).toString();
     }
     chunks << header.join('\t');
     QAbstractItemModel *viewModel = tableView->model();
@@ -661,7 +1965,7 @@ QString ResultForm::selectedRowsAsTsv() const
     }
     for(const QModelIndex &idx : selected){
         QStringList row;
-        for(int c = 0; c < model->columnCount(); ++c){
+        for(int c = 0; c < source->columnCount(); ++c){
             const QModelIndex cell = viewModel->index(idx.row(), c);
             row << itemTextForExport(cell);
         }
@@ -715,14 +2019,8 @@ QString ResultForm::itemTextForExport(const QModelIndex &index) const
         return {};
     }
     // Check if this cell is NULL
-    if(proxy && model){
-        QModelIndex srcIndex = proxy->mapToSource(index);
-        if(auto *item = model->itemFromIndex(srcIndex)){
-            QVariant nullData = item->data(NullRole);
-            if(nullData.isValid() && nullData.toBool()){
-                return QStringLiteral("NULL");
-            }
-        }
+    if(proxy && proxy->mapToSource(index).data(NullRole).toBool()){
+        return QStringLiteral("NULL");
     }
     const QVariant boolData = index.data(Qt::UserRole + 1);
     if(boolData.isValid()){
@@ -734,11 +2032,12 @@ QString ResultForm::itemTextForExport(const QModelIndex &index) const
 QStringList ResultForm::visibleHeaders() const
 {
     QStringList headers;
-    if(!model){
+    const QAbstractItemModel *source = dataModel();
+    if(!source){
         return headers;
     }
-    for(int c = 0; c < model->columnCount(); ++c){
-        headers << model->headerData(c, Qt::Horizontal).toString();
+    for(int c = 0; c < source->columnCount(); ++c){
+        headers << source->headerData(c, Qt::Horizontal).toString();
     }
     return headers;
 }
@@ -1014,6 +2313,20 @@ bool ResultForm::writeXlsxFile(const ExportOptions &opts)
 
 void ResultForm::copySelectedCells()
 {
+    if(tableView && tableView->selectionModel() && proxy){
+        QSet<int> rowSet;
+        QSet<int> columnSet;
+        const QModelIndexList selected = tableView->selectionModel()->selectedIndexes();
+        for(const QModelIndex &index : selected){
+            const QModelIndex sourceIndex = proxy->mapToSource(index);
+            rowSet.insert(sourceIndex.row());
+            columnSet.insert(sourceIndex.column());
+        }
+        if(!rowSet.isEmpty() && !loadTruncatedValues(rowSet.values(), columnSet.values())){
+            updateSummaryLabel(tr("Nothing copied: the full value of a truncated cell could not be loaded."));
+            return;
+        }
+    }
     const QString serialized = selectedCellsAsTsv();
     if(serialized.isEmpty()){
         updateSummaryLabel(tr("No cells selected to copy."));
@@ -1032,6 +2345,11 @@ void ResultForm::copySelectedCells()
 
 void ResultForm::copySelectedRows()
 {
+    // Copy every row when none is selected
+    if(!loadTruncatedValues(selectedSourceRows())){
+        updateSummaryLabel(tr("Nothing copied: the full value of a truncated cell could not be loaded."));
+        return;
+    }
     const QString serialized = selectedRowsAsTsv();
     if(serialized.isEmpty()){
         updateSummaryLabel(tr("No rows selected to copy."));
@@ -1050,7 +2368,7 @@ void ResultForm::copySelectedRows()
 
 void ResultForm::exportData()
 {
-    if(!model || model->rowCount() == 0){
+    if(!dataModel() || dataModel()->rowCount() == 0){
         updateSummaryLabel(tr("No data to export."));
         return;
     }
@@ -1082,6 +2400,10 @@ void ResultForm::exportData()
     if(info.suffix().isEmpty()){
         opts.filePath = opts.filePath + QLatin1Char('.') + ext;
     }
+    if(!loadTruncatedValues()){
+        updateSummaryLabel(tr("Export cancelled: the full value of a truncated cell could not be loaded."));
+        return;
+    }
     bool ok = false;
     if(opts.format == QStringLiteral("xlsx")){
         ok = writeXlsxFile(opts);
@@ -1102,6 +2424,11 @@ void ResultForm::setFilterText(const QString &text)
         return;
     }
     filterText = text;
+    if(dataModel() && dataModel()->rowCount() > kFilterDebounceRows){
+        filterTimer->start();
+        return;
+    }
+    filterTimer->stop();
     applyFilter();
 }
 
@@ -1118,12 +2445,12 @@ QStringList ResultForm::headers() const
 QStringList ResultForm::rowValues(int sourceRow) const
 {
     QStringList values;
-    if(!model || sourceRow < 0 || sourceRow >= model->rowCount()){
+    const QAbstractItemModel *source = dataModel();
+    if(!source || sourceRow < 0 || sourceRow >= source->rowCount()){
         return values;
     }
-    for(int c = 0; c < model->columnCount(); ++c){
-        QStandardItem *item = model->item(sourceRow, c);
-        values << (item ? item->text() : QString());
+    for(int c = 0; c < source->columnCount(); ++c){
+        values << source->index(sourceRow, c).data(Qt::DisplayRole).toString();
     }
     return values;
 }
@@ -1131,21 +2458,95 @@ QStringList ResultForm::rowValues(int sourceRow) const
 QVector<bool> ResultForm::rowNullFlags(int sourceRow) const
 {
     QVector<bool> flags;
-    if(!model || sourceRow < 0 || sourceRow >= model->rowCount()){
+    const QAbstractItemModel *source = dataModel();
+    if(!source || sourceRow < 0 || sourceRow >= source->rowCount()){
         return flags;
     }
-    for(int c = 0; c < model->columnCount(); ++c){
-        QStandardItem *item = model->item(sourceRow, c);
-        if(item){
-            QVariant nullData = item->data(NullRole);
-            flags << (nullData.isValid() && nullData.toBool());
-        } else {
-            flags << false;
-        }
+    for(int c = 0; c < source->columnCount(); ++c){
+        flags << source->index(sourceRow, c).data(NullRole).toBool();
     }
     return flags;
 }
 
+void ResultForm::highlightRows(const QList<int> &sourceRows)
+{
+    if(!model){
+        return;
+    }
+    static const QBrush brush(QColor(255, 243, 205));
+    for(int row : sourceRows){
+        if(row < 0 || row >= model->rowCount()){
+            continue;
+        }
+        for(int c = 0; c < model->columnCount(); ++c){
+            if(QStandardItem *item = model->item(row, c)){
+                item->setBackground(brush);
+            }
+        }
+    }
+}
+
+void ResultForm::setValueLoader(ValueLoader loader)
+{
+    valueLoader = std::move(loader);
+}
+
+void ResultForm::markTruncated(int sourceRow, int column, qint64 fullBytes)
+{
+    if(QStandardItem *item = model ? model->item(sourceRow, column) : nullptr){
+        item->setData(fullBytes, TruncatedRole);
+        item->setToolTip(tr("Preview of a %1-byte value; the full value loads when edited, copied or exported.").arg(fullBytes));
+    }
+}
+
+bool ResultForm::isTruncated(int sourceRow, int column) const
+{
+    QStandardItem *item = model ? model->item(sourceRow, column) : nullptr;
+    return item && item->data(TruncatedRole).isValid();
+}
+
+void ResultForm::setFullValue(int sourceRow, int column, const QVariant &value)
+{
+    if(QStandardItem *item = model ? model->item(sourceRow, column) : nullptr){
+        item->setData(QVariant(), TruncatedRole);
+        item->setToolTip(QString());
+        item->setData(value.isNull(), NullRole);
+        item->setText(value.isNull() ? QString() : value.toString());
+    }
+}
+
+bool ResultForm::loadTruncatedValues(const QList<int> &sourceRows, const QList<int> &columns)
+{
+    // Only cells of the default model can be previews
+    if(!model || dataModel() != model){
+        return true;
+    }
+    QList<int> rows = sourceRows;
+    if(rows.isEmpty()){
+        for(int r = 0; r < model->rowCount(); ++r){
+            rows << r;
+        }
+    }
+    QList<int> cols = columns;
+    if(cols.isEmpty()){
+        for(int c = 0; c < model->columnCount(); ++c){
+            cols << c;
+        }
+    }
+    for(int column : qAsConst(cols)){
+        QList<int> pending;
+        for(int row : qAsConst(rows)){
+            if(isTruncated(row, column)){
+                pending << row;
+            }
+        }
+        if(!pending.isEmpty() && (!valueLoader || !valueLoader(column, pending))){
+            return false;
+        }
+    }
+    return true;
+}
+
 QList<int> ResultForm::selectedSourceRows() const
 {
     QList<int> rows;
@@ -1205,7 +2606,8 @@ void ResultForm::rememberHeaders(const QStringList &headers)
 
 void ResultForm::autoFitColumns()
 {
-    if(!tableView || !model){
+    const QAbstractItemModel *source = dataModel();
+    if(!tableView || !source){
         return;
     }
     auto *header = tableView->horizontalHeader();
@@ -1213,13 +2615,15 @@ void ResultForm::autoFitColumns()
     if(!header || !viewModel){
         return;
     }
-    const int columnCount = model->columnCount();
-    const int rowCount = viewModel->rowCount();
+    const int columnCount = source->columnCount();
+    // Spilled or file-backed results size from their first rows so column widths do not
+    // read the whole file
+    const int rowCount = storeModel ? qMin(viewModel->rowCount(), kAutoFitSampleRows) : viewModel->rowCount();
     const QFontMetrics dataFm(tableView->font());
     const QFontMetrics headerFm(header->font());
     const int padding = 30;
     for(int c = 0; c < columnCount; ++c){
-        QString headerText = model->headerData(c, Qt::Horizontal).toString();
+        QString headerText = source->headerData(c, Qt::Horizontal).toString();
         int maxWidth = headerFm.horizontalAdvance(headerText) + padding;
         for(int r = 0; r < rowCount; ++r){
             const QString text = viewModel->index(r, c).data(Qt::DisplayRole).toString();
@@ -1246,11 +2650,12 @@ void ResultForm::rebuildSummaryWithFilter()
 
 int ResultForm::columnIndexByName(const QString &headerName) const
 {
-    if(!model){
+    const QAbstractItemModel *source = dataModel();
+    if(!source){
         return -1;
     }
-    for(int i = 0; i < model->columnCount(); ++i){
-        const QString text = model->headerData(i, Qt::Horizontal).toString();
+    for(int i = 0; i < source->columnCount(); ++i){
+        const QString text = source->headerData(i, Qt::Horizontal).toString();
         if(text == headerName){
             return i;
         }
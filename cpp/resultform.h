@@ -11,10 +11,17 @@
 #include <QItemSelectionModel>
 #include <QList>
 #include <QVariant>
+#include <functional>
+#include <memory>
 
+class NullAwareDelegate;
 class QModelIndex;
 class ResultFilterProxy;
+class ResultGridView;
+class ResultSpill;
+class QAbstractTableModel;
 class QStandardItemModel;
+class QTimer;
 struct ExportOptions;
 
 class ResultForm : public QWidget
@@ -49,6 +56,28 @@ public:
                   const QString &note = QString(),
                   bool editable = false,
                   const QVector<int> &columnTypes = QVector<int>());
+    // A result past the memory budget: rows stay in memory, the rows in spill are read
+    // from its temporary file when scrolled to; read-only
+    void showSpilledRows(const QStringList &headers,
+                         const QList<QVariantList> &rows,
+                         std::unique_ptr<ResultSpill> spill,
+                         qint64 elapsedMs = -1,
+                         const QString &note = QString(),
+                         const QVector<int> &columnTypes = QVector<int>());
+    // Saves the result as an .odbr columnar file (current filter and sort order) and maps
+    // such a file back in, read-only
+    bool saveResultFile(const QString &path, QString *errorMessage = nullptr);
+    bool openResultFile(const QString &path, QString *errorMessage = nullptr);
+    // Appends rows, matching columns by name and adding new ones at the end. With maxRows
+    // > 0 only the last maxRows rows are kept; dropped rows still count in row numbers
+    // and totals
+    void appendRows(const QStringList &headers,
+                    const QList<QVariantList> &rows,
+                    const QString &note = QString(),
+                    int maxRows = 0);
+    // While the result has unfetched rows, scrolling near the bottom emits fetchMoreRequested()
+    void setCanFetchMore(bool enabled);
+    bool canFetchMore() const { return fetchMoreEnabled; }
     void showTableStructure(const QList<ColumnInfo> &columns, qint64 elapsedMs = -1);
     void showAffectRows(int affectedRows, qint64 elapsedMs);
     void showMessage(const QString &text);
@@ -67,11 +96,28 @@ public:
     QList<int> selectedSourceRows() const;
     QStringList rowValues(int sourceRow) const;
     QVector<bool> rowNullFlags(int sourceRow) const;
+    // Highlights these rows until the next showRows
+    void highlightRows(const QList<int> &sourceRows);
+    // Cells holding only a prefix: records their full byte length, and loader fetches the
+    // full value before an editor opens
+    // Called once per column with every row to fill in, so the loader can fetch them in one query
+    using ValueLoader = std::function<bool(int column, const QList<int> &sourceRows)>;
+    void setValueLoader(ValueLoader loader);
+    void markTruncated(int sourceRow, int column, qint64 fullBytes);
+    bool isTruncated(int sourceRow, int column) const;
+    void setFullValue(int sourceRow, int column, const QVariant &value);
+    // Before a copy or export, loads the full values of preview cells in these rows and
+    // columns (empty means all); false when any cell cannot be loaded
+    bool loadTruncatedValues(const QList<int> &sourceRows = {}, const QList<int> &columns = {});
+    // Scrolls from the top a frame at a time, repainting synchronously, and returns
+    // frames per second; fastRendering false paints through QStyle for comparison
+    double benchmarkScrolling(int frames, bool fastRendering);
     QTableView *tableWidget() const { return tableView; }
     QStandardItemModel *sourceModel() const { return model; }
 
 signals:
     void summaryChanged(const QString &summary);
+    void fetchMoreRequested();
 
 private:
     enum class DisplayMode {
@@ -97,20 +143,35 @@ private:
     void rebuildSummaryWithFilter();
     int columnIndexByName(const QString &headerName) const;
     void exportData();
+    void saveResult();
+    void openResult();
+    void showContextMenu(const QPoint &globalPos);
     void autoFitColumns();
+    void checkFetchMore();
+    void setFastRendering(bool enabled);
+    void useStandardModel();
+    void showStoreModel(QAbstractTableModel *store, const QString &summary);
+    QAbstractItemModel *dataModel() const;
 
     QTableView *tableView = nullptr;
+    ResultGridView *gridView = nullptr;
+    NullAwareDelegate *gridDelegate = nullptr;
     QStandardItemModel *model = nullptr;
+    QAbstractTableModel *storeModel = nullptr;
+    ValueLoader valueLoader;
     ResultFilterProxy *proxy = nullptr;
     QLabel *messageLabel = nullptr;
     QLabel *summaryLabel = nullptr;
     QWidget *toolbarWidget = nullptr;
     QStackedLayout *stack = nullptr;
+    QTimer *filterTimer = nullptr;
     QString lastExportDir;
     DisplayMode mode = DisplayMode::Message;
     QString filterText;
     QString summaryBase;
     QStringList lastHeaders;
+    bool fetchMoreEnabled = false;
+    int droppedRows = 0;
 };
 
 #endif // RESULTFORM_H
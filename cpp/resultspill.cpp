@@ -0,0 +1,350 @@
+#include "resultspill.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QDir>
+#include <QObject>
+#include <QSettings>
+#include <QTime>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+constexpr auto kSettingsMemoryBudgetMb = "results/memoryBudgetMb";
+const int kDefaultMemoryBudgetMb = 256;
+// Rows per block; only block offsets are kept and a whole block decodes at once
+const int kBlockRows = 64;
+// Write buffer flushed to disk once this full
+const int kWriteBufferBytes = 1 << 20;
+// Overhead of a cell in the grid beyond its content (QStandardItem, QVariant and string header)
+const qint64 kCellOverheadBytes = 96;
+
+// Every value starts with a one-byte type tag
+enum Tag : quint8 {
+    TagNull,
+    TagInt,
+    TagUInt,
+    TagReal,
+    TagBool,
+    TagText,
+    TagBytes,
+    TagDate,
+    TagTime,
+    TagDateTime
+};
+
+template <typename T>
+void putNumber(QByteArray &out, T value)
+{
+    const T little = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&little), int(sizeof(T)));
+}
+
+void putBlob(QByteArray &out, Tag tag, const QByteArray &data)
+{
+    out.append(char(tag));
+    putNumber<quint32>(out, quint32(data.size()));
+    out.append(data);
+}
+
+void encodeValue(QByteArray &out, const QVariant &value)
+{
+    if(value.isNull()){
+        out.append(char(TagNull));
+        return;
+    }
+    switch(value.userType()){
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::Short:
+    case QMetaType::Int:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        out.append(char(TagInt));
+        putNumber<qint64>(out, value.toLongLong());
+        return;
+    case QMetaType::UChar:
+    case QMetaType::UShort:
+    case QMetaType::UInt:
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        out.append(char(TagUInt));
+        putNumber<quint64>(out, value.toULongLong());
+        return;
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double real = value.toDouble();
+        quint64 bits = 0;
+        std::memcpy(&bits, &real, sizeof(bits));
+        out.append(char(TagReal));
+        putNumber<quint64>(out, bits);
+        return; }
+    case QMetaType::Bool:
+        out.append(char(TagBool));
+        out.append(char(value.toBool() ? 1 : 0));
+        return;
+    case QMetaType::QByteArray:
+        putBlob(out, TagBytes, value.toByteArray());
+        return;
+    case QMetaType::QDate:
+        if(value.toDate().isValid()){
+            out.append(char(TagDate));
+            putNumber<qint64>(out, value.toDate().toJulianDay());
+            return;
+        }
+        break;
+    case QMetaType::QTime:
+        if(value.toTime().isValid()){
+            out.append(char(TagTime));
+            putNumber<qint32>(out, value.toTime().msecsSinceStartOfDay());
+            return;
+        }
+        break;
+    case QMetaType::QDateTime: {
+        // Stored as date and milliseconds of the day; it reads back as local time and
+        // shows as before
+        const QDateTime dateTime = value.toDateTime();
+        if(dateTime.isValid()){
+            out.append(char(TagDateTime));
+            putNumber<qint64>(out, dateTime.date().toJulianDay());
+            putNumber<qint32>(out, dateTime.time().msecsSinceStartOfDay());
+            return;
+        }
+        break; }
+    default:
+        break;
+    }
+    putBlob(out, TagText, value.toString().toUtf8());
+}
+
+// Decodes one value from [*pos, end) and advances *pos; false on incomplete data
+bool decodeValue(const uchar *&pos, const uchar *end, QVariant *value)
+{
+    if(pos >= end){
+        return false;
+    }
+    const Tag tag = Tag(*pos++);
+    auto need = [&pos, end](qint64 bytes) { return end - pos >= bytes; };
+    switch(tag){
+    case TagNull:
+        *value = QVariant();
+        return true;
+    case TagInt:
+        if(!need(8)){
+            return false;
+        }
+        *value = qFromLittleEndian<qint64>(pos);
+        pos += 8;
+        return true;
+    case TagUInt:
+        if(!need(8)){
+            return false;
+        }
+        *value = qFromLittleEndian<quint64>(pos);
+        pos += 8;
+        return true;
+    case TagReal: {
+        if(!need(8)){
+            return false;
+        }
+        const quint64 bits = qFromLittleEndian<quint64>(pos);
+        double real = 0;
+        std::memcpy(&real, &bits, sizeof(real));
+        *value = real;
+        pos += 8;
+        return true; }
+    case TagBool:
+        if(!need(1)){
+            return false;
+        }
+        *value = *pos++ != 0;
+        return true;
+    case TagText:
+    case TagBytes: {
+        if(!need(4)){
+            return false;
+        }
+        const quint32 size = qFromLittleEndian<quint32>(pos);
+        pos += 4;
+        if(!need(size)){
+            return false;
+        }
+        const char *data = reinterpret_cast<const char *>(pos);
+        if(tag == TagText){
+            *value = QString::fromUtf8(data, int(size));
+        }else{
+            *value = QByteArray(data, int(size));
+        }
+        pos += size;
+        return true; }
+    case TagDate:
+        if(!need(8)){
+            return false;
+        }
+        *value = QDate::fromJulianDay(qFromLittleEndian<qint64>(pos));
+        pos += 8;
+        return true;
+    case TagTime:
+        if(!need(4)){
+            return false;
+        }
+        *value = QTime::fromMSecsSinceStartOfDay(qFromLittleEndian<qint32>(pos));
+        pos += 4;
+        return true;
+    case TagDateTime:
+        if(!need(12)){
+            return false;
+        }
+        *value = QDateTime(QDate::fromJulianDay(qFromLittleEndian<qint64>(pos)),
+                           QTime::fromMSecsSinceStartOfDay(qFromLittleEndian<qint32>(pos + 8)));
+        pos += 12;
+        return true;
+    }
+    return false;
+}
+
+}
+
+ResultSpill::ResultSpill()
+{
+    m_file.setFileTemplate(QDir::temp().filePath(QStringLiteral("opendbkit-result-XXXXXX.bin")));
+}
+
+ResultSpill::~ResultSpill()
+{
+    if(m_map){
+        m_file.unmap(m_map);
+    }
+}
+
+bool ResultSpill::open(int columnCount, QString *errorMessage)
+{
+    if(!m_file.open()){
+        if(errorMessage){
+            *errorMessage = QObject::tr("Cannot create temporary file: %1").arg(m_file.errorString());
+        }
+        return false;
+    }
+    m_columns = columnCount;
+    m_buffer.reserve(kWriteBufferBytes + 4096);
+    return true;
+}
+
+bool ResultSpill::append(const QVariantList &row, QString *errorMessage)
+{
+    if(m_finished || !m_file.isOpen()){
+        return false;
+    }
+    if(m_rows % kBlockRows == 0){
+        m_blockOffsets.append(m_written + m_buffer.size());
+    }
+    for(int col = 0; col < m_columns; ++col){
+        encodeValue(m_buffer, row.value(col));
+    }
+    ++m_rows;
+    return m_buffer.size() < kWriteBufferBytes || flush(errorMessage);
+}
+
+bool ResultSpill::flush(QString *errorMessage)
+{
+    if(m_buffer.isEmpty()){
+        return true;
+    }
+    if(m_file.write(m_buffer) != m_buffer.size()){
+        if(errorMessage){
+            *errorMessage = QObject::tr("Cannot write temporary file: %1").arg(m_file.errorString());
+        }
+        return false;
+    }
+    m_written += m_buffer.size();
+    m_buffer.clear();
+    return true;
+}
+
+bool ResultSpill::finish(QString *errorMessage)
+{
+    if(m_finished){
+        return true;
+    }
+    if(!flush(errorMessage) || !m_file.flush()){
+        if(errorMessage && errorMessage->isEmpty()){
+            *errorMessage = QObject::tr("Cannot write temporary file: %1").arg(m_file.errorString());
+        }
+        return false;
+    }
+    m_buffer = QByteArray();
+    m_finished = true;
+    // When mapping fails (say a 32-bit process runs out of address space) blocks are read
+    // from the file
+    if(m_written > 0){
+        m_map = m_file.map(0, m_written);
+    }
+    return true;
+}
+
+QList<QVariantList> ResultSpill::readBlock(int block) const
+{
+    QList<QVariantList> rows;
+    if(!m_finished || block < 0 || block >= m_blockOffsets.size()){
+        return rows;
+    }
+    const qint64 begin = m_blockOffsets.at(block);
+    const qint64 end = block + 1 < m_blockOffsets.size() ? m_blockOffsets.at(block + 1) : m_written;
+    QByteArray data;
+    if(m_map){
+        data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_map + begin), int(end - begin));
+    }else if(m_file.seek(begin)){
+        data = m_file.read(end - begin);
+    }
+    const uchar *pos = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *last = pos + data.size();
+    const int count = qMin(kBlockRows, m_rows - block * kBlockRows);
+    rows.reserve(count);
+    for(int r = 0; r < count; ++r){
+        QVariantList row;
+        row.reserve(m_columns);
+        for(int col = 0; col < m_columns; ++col){
+            QVariant value;
+            if(!decodeValue(pos, last, &value)){
+                return rows;
+            }
+            row << value;
+        }
+        rows << row;
+    }
+    return rows;
+}
+
+int ResultSpill::rowsPerBlock()
+{
+    return kBlockRows;
+}
+
+qint64 ResultSpill::rowFootprint(const QVariantList &row)
+{
+    qint64 bytes = 0;
+    for(const QVariant &value : row){
+        bytes += kCellOverheadBytes;
+        if(value.userType() == QMetaType::QString){
+            bytes += value.toString().size() * 2;
+        }else if(value.userType() == QMetaType::QByteArray){
+            // Shown as text, each byte takes about one QChar
+            bytes += value.toByteArray().size() * 3;
+        }
+    }
+    return bytes;
+}
+
+qint64 ResultSpill::memoryBudget()
+{
+    QSettings settings;
+    const int megabytes = settings.value(QLatin1String(kSettingsMemoryBudgetMb), kDefaultMemoryBudgetMb).toInt();
+    return qMax(0, megabytes) * qint64(1024 * 1024);
+}
+
+void ResultSpill::setMemoryBudget(qint64 bytes)
+{
+    QSettings settings;
+    settings.setValue(QLatin1String(kSettingsMemoryBudgetMb), int(qMax<qint64>(0, bytes) / (1024 * 1024)));
+}
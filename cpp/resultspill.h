@@ -0,0 +1,51 @@
+#ifndef RESULTSPILL_H
+#define RESULTSPILL_H
+
+#include <QList>
+#include <QTemporaryFile>
+#include <QVariant>
+#include <QVector>
+
+// Rows of a result set that went past the per-result memory budget. Rows are
+// appended to a temporary file in a compact tagged binary encoding; once the
+// result is complete the file is memory-mapped and read back block by block
+// on demand. Only one file offset per block of rows stays in memory.
+class ResultSpill
+{
+public:
+    ResultSpill();
+    ~ResultSpill();
+
+    bool open(int columnCount, QString *errorMessage = nullptr);
+    bool append(const QVariantList &row, QString *errorMessage = nullptr);
+    // Call after the last row; read-only from then on
+    bool finish(QString *errorMessage = nullptr);
+
+    int rowCount() const { return m_rows; }
+    int columnCount() const { return m_columns; }
+    qint64 fileBytes() const { return m_written + m_buffer.size(); }
+    // Rows of block number block, rowsPerBlock() each (the last may have fewer)
+    QList<QVariantList> readBlock(int block) const;
+    static int rowsPerBlock();
+
+    // Rough memory a result row takes in the grid
+    static qint64 rowFootprint(const QVariantList &row);
+    // Bytes of each result kept in memory before further rows go to a temporary file; 0
+    // means no limit
+    static qint64 memoryBudget();
+    static void setMemoryBudget(qint64 bytes);
+
+private:
+    bool flush(QString *errorMessage);
+
+    mutable QTemporaryFile m_file;
+    QByteArray m_buffer;
+    QVector<qint64> m_blockOffsets;
+    qint64 m_written = 0;
+    uchar *m_map = nullptr;
+    int m_rows = 0;
+    int m_columns = 0;
+    bool m_finished = false;
+};
+
+#endif // RESULTSPILL_H
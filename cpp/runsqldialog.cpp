@@ -1,237 +1,551 @@
 #include "runsqldialog.h"
-#include "ui_runsqldialog.h"
-#include "widgetutils.h"
-
-#include <QTextCodec>
-#include <QSettings>
+#include "jobscheduler.h"
+#include "languagemanager.h"
+#include "sessionpool.h"
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
 #include <QMessageBox>
-#include <QTimer>
-#include <QTime>
-
-RunSqlDialog::RunSqlDialog(QSharedPointer<ConnData> connData,QString dbName,QWidget *parent) :
-    QDialog(parent),
-    ui(new Ui::RunSqlDialog)
-{
-    ui->setupUi(this);
-
-    WidgetUtils::setSafeDeleteOnClose(this);
-
-#if defined(Q_OS_MAC)
-    this->setWindowFlag(Qt::Tool,true);
-#endif
-
-    if(connData){
-        this->connData=connData->cloneBase();
-        this->connData->dbName=connData->dbName;
-
-        QString str=QString{"%1:%2"}.arg(this->connData->host).arg(this->connData->port);
+#include <QPlainTextEdit>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QScopedPointer>
+#include <QSettings>
+#include <QSignalBlocker>
+#include <QSpinBox>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextCodec>
+#include <QThread>
+#include <QVBoxLayout>
+#include <algorithm>
 
-        this->setWindowTitle(tr("Execute %1 File - %2").arg(StringUtils::fileTypeName(connData),str));
-        this->ui->lb_ds->setText(this->connData->connName);
+namespace {
 
-        this->ui->chk_autoCommit->setChecked(false);
-        this->ui->chk_autoCommit->setHidden(true);//暂不启用AutoCommit选项
+constexpr auto kSettingsLastSqlDir = "runSql/lastDir";
+// Bytes read from the file at a time
+const qint64 kChunkSize = 1024 * 1024;
+// Most characters in one combined batch; must stay below the server's max_allowed_packet
+const int kMaxBatchChars = 1024 * 1024;
+const int kProgressIntervalMs = 250;
 
-        switch (connData->typeId) {
-        }
+QString formatBytes(qint64 bytes)
+{
+    const double value = static_cast<double>(bytes);
+    if(bytes >= 1024LL * 1024 * 1024){
+        return QStringLiteral("%1 GB").arg(value / (1024.0 * 1024 * 1024), 0, 'f', 2);
     }
-
-    WidgetUtils::customComboBoxWidget(ui->cbox_dbName);
-    WidgetUtils::widgetDisableWheel(ui->cbox_dbName);
-    ui->cbox_dbName->setCurrentText(dbName);
-
-    auto codecList=QTextCodec::availableCodecs();
-    std::sort(codecList.begin(), codecList.end());
-    for(QByteArray ba:codecList){
-        this->ui->cbox_encoding->addItem(ba);
+    if(bytes >= 1024 * 1024){
+        return QStringLiteral("%1 MB").arg(value / (1024.0 * 1024), 0, 'f', 1);
     }
-    WidgetUtils::setOrAddCurrItem(this->ui->cbox_encoding,"UTF-8",false);
-
-    WidgetUtils::customComboBoxWidget(this->ui->cbox_encoding);
-
-    auto getFileBtnFunc=[=](){
-        QSettings setting(QCoreApplication::applicationName());
-        QString lastPath = setting.value("ExportPath").toString();
-
-        QString filter=QObject::tr("Execute file (*.%1 *.txt);;All files(*.*)").arg(StringUtils::fileExtensionName(connData));
+    if(bytes >= 1024){
+        return QStringLiteral("%1 KB").arg(value / 1024.0, 0, 'f', 1);
+    }
+    return QStringLiteral("%1 B").arg(bytes);
+}
 
-        QFileDialog fdialog(this,QObject::tr("Execute File"),lastPath,filter);
-        fdialog.setOption(QFileDialog::DontUseNativeDialog,true);
-        fdialog.setWindowModality(Qt::WindowModal);
-        fdialog.setAcceptMode(QFileDialog::AcceptOpen);
+}
 
-        if (fdialog.exec() == QDialog::Accepted && fdialog.selectedFiles().length()>0){
-            QStringList fnames=fdialog.selectedFiles();
-            QString lastName=fnames.last();
+RunSqlDialog::RunSqlDialog(const QString &connName, const QString &dbName, QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(trLang(QStringLiteral("运行 SQL 文件"), QStringLiteral("Run SQL File")));
+    resize(760, 560);
+    buildUi();
+    loadConnections(connName);
+    populateDatabases(dbName);
+    setRunning(false);
+}
 
-            if(fnames.count()>0&&!lastName.isEmpty()){
-                this->ui->le_file->setText(lastName);
-                int idx=lastName.lastIndexOf('.');
-                if(idx>=0){
-                    QString type=lastName.right(lastName.length()-idx-1);
+RunSqlDialog::~RunSqlDialog()
+{
+    if(worker){
+        worker->cancel();
+    }
+    if(runThread){
+        runThread->quit();
+        runThread->wait();
+    }
+}
 
-                }
+void RunSqlDialog::buildUi()
+{
+    auto *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(12, 12, 12, 12);
+    mainLayout->setSpacing(10);
+
+    auto *form = new QFormLayout;
+    form->setLabelAlignment(Qt::AlignRight | Qt::AlignVCenter);
+
+    connCombo = new QComboBox(this);
+    dbCombo = new QComboBox(this);
+    dbCombo->setEditable(true);
+    form->addRow(trLang(QStringLiteral("连接："), QStringLiteral("Connection:")), connCombo);
+    form->addRow(trLang(QStringLiteral("数据库："), QStringLiteral("Database:")), dbCombo);
+
+    auto *fileLayout = new QHBoxLayout;
+    fileEdit = new QLineEdit(this);
+    browseButton = new QPushButton(trLang(QStringLiteral("浏览..."), QStringLiteral("Browse...")), this);
+    fileLayout->addWidget(fileEdit, 1);
+    fileLayout->addWidget(browseButton);
+    form->addRow(trLang(QStringLiteral("文件："), QStringLiteral("File:")), fileLayout);
+
+    codecCombo = new QComboBox(this);
+    auto codecs = QTextCodec::availableCodecs();
+    std::sort(codecs.begin(), codecs.end());
+    for(const QByteArray &codec : qAsConst(codecs)){
+        codecCombo->addItem(QString::fromLatin1(codec));
+    }
+    codecCombo->setCurrentText(QStringLiteral("UTF-8"));
+    form->addRow(trLang(QStringLiteral("编码："), QStringLiteral("Encoding:")), codecCombo);
+
+    batchSpin = new QSpinBox(this);
+    batchSpin->setRange(1, 1000);
+    batchSpin->setValue(1);
+    batchSpin->setToolTip(trLang(QStringLiteral("每次往返合并发送的语句数，1 表示逐条执行"),
+                                 QStringLiteral("Statements sent per round trip, 1 executes them one by one")));
+    form->addRow(trLang(QStringLiteral("批量语句数："), QStringLiteral("Statements per batch:")), batchSpin);
+
+    continueOnErrorCheck = new QCheckBox(trLang(QStringLiteral("出错时跳过并继续"),
+                                                QStringLiteral("Skip failed statements and continue")), this);
+    form->addRow(QString(), continueOnErrorCheck);
+    mainLayout->addLayout(form);
+
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, 1000);
+    progressBar->setValue(0);
+    progressBar->setTextVisible(false);
+    mainLayout->addWidget(progressBar);
+
+    statsLabel = new QLabel(this);
+    mainLayout->addWidget(statsLabel);
+
+    logEdit = new QPlainTextEdit(this);
+    logEdit->setReadOnly(true);
+    logEdit->setMaximumBlockCount(5000);
+    mainLayout->addWidget(logEdit, 1);
+
+    auto *buttonLayout = new QHBoxLayout;
+    buttonLayout->addStretch();
+    startButton = new QPushButton(trLang(QStringLiteral("开始"), QStringLiteral("Start")), this);
+    stopButton = new QPushButton(trLang(QStringLiteral("停止"), QStringLiteral("Stop")), this);
+    closeButton = new QPushButton(trLang(QStringLiteral("关闭"), QStringLiteral("Close")), this);
+    buttonLayout->addWidget(startButton);
+    buttonLayout->addWidget(stopButton);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(browseButton, &QPushButton::clicked, this, &RunSqlDialog::browseFile);
+    connect(startButton, &QPushButton::clicked, this, &RunSqlDialog::startRun);
+    connect(stopButton, &QPushButton::clicked, this, &RunSqlDialog::stopRun);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+    connect(connCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &RunSqlDialog::onConnectionChanged);
+}
 
-                QDir dir(lastName);
-                dir.cdUp();
-                setting.setValue("ExportPath",dir.path());
+void RunSqlDialog::loadConnections(const QString &preferredConn)
+{
+    const QSignalBlocker blocker(connCombo);
+    connCombo->clear();
+    const auto connections = ConnectionManager::instance()->connections();
+    for(const auto &info : connections){
+        connCombo->addItem(info.name, info.name);
+    }
+    const int index = connCombo->findData(preferredConn);
+    connCombo->setCurrentIndex(index >= 0 ? index : 0);
+}
 
-                QTimer::singleShot(0,this,[=](){
-                    this->on_btn_detect_clicked();
-                });
-            }
-        }
-    };
-    WidgetUtils::customLineEditWidgetAddBtnFunc(ui->le_file,getFileBtnFunc,true,QIcon {":/images/open.svg"});
-
-    QTimer::singleShot(0,this,[=](){
-        auto runRef=WidgetUtils::createRunRef(this);
-
-        if(Utils::testOrReconn(connData)){
-            StringListResult slr=WidgetUtils::getDBNameList(connData);
-            ui->cbox_dbName->clear();
-            ui->cbox_dbName->addItem("");
-            ui->cbox_dbName->addItems(slr.list);
-            WidgetUtils::setOrAddCurrItem(ui->cbox_dbName,dbName);
-        }
-    });
+void RunSqlDialog::populateDatabases(const QString &preferredDb)
+{
+    dbCombo->clear();
+    const QString connName = connCombo->currentData().toString();
+    if(connName.isEmpty()){
+        return;
+    }
+    const ConnectionInfo info = ConnectionManager::instance()->connection(connName);
+    QString error;
+    QStringList dbs = ConnectionManager::instance()->fetchDatabases(info, &error);
+    if(dbs.isEmpty() && !info.defaultDb.isEmpty()){
+        dbs << info.defaultDb;
+    }
+    dbCombo->addItem(QString());
+    dbCombo->addItems(dbs);
+    const QString target = preferredDb.isEmpty() ? info.defaultDb : preferredDb;
+    dbCombo->setCurrentText(target);
+}
 
+void RunSqlDialog::onConnectionChanged(int index)
+{
+    Q_UNUSED(index);
+    populateDatabases(QString());
 }
 
-void RunSqlDialog::closeEvent(QCloseEvent *event)
+void RunSqlDialog::browseFile()
 {
-    this->hide();
+    QSettings settings;
+    const QString lastDir = settings.value(QString::fromUtf8(kSettingsLastSqlDir), QDir::homePath()).toString();
+    const QString file = QFileDialog::getOpenFileName(this,
+                                                      trLang(QStringLiteral("选择 SQL 文件"), QStringLiteral("Choose SQL File")),
+                                                      lastDir,
+                                                      trLang(QStringLiteral("SQL 文件 (*.sql *.txt);;所有文件 (*.*)"),
+                                                             QStringLiteral("SQL Files (*.sql *.txt);;All Files (*.*)")));
+    if(file.isEmpty()){
+        return;
+    }
+    settings.setValue(QString::fromUtf8(kSettingsLastSqlDir), QFileInfo(file).absolutePath());
+    fileEdit->setText(QDir::toNativeSeparators(file));
+}
 
-    stop=true;
-    if(connData){
-        connData->stopConn();
+void RunSqlDialog::startRun()
+{
+    if(runThread){
+        return;
+    }
+    const QString filePath = QDir::fromNativeSeparators(fileEdit->text().trimmed());
+    if(filePath.isEmpty() || !QFileInfo(filePath).isFile()){
+        QMessageBox::warning(this,
+                             windowTitle(),
+                             trLang(QStringLiteral("请选择要执行的 SQL 文件。"),
+                                    QStringLiteral("Please choose the SQL file to execute.")));
+        return;
+    }
+    const ConnectionInfo info = ConnectionManager::instance()->connection(connCombo->currentData().toString());
+    if(info.name.isEmpty()){
+        QMessageBox::warning(this,
+                             windowTitle(),
+                             trLang(QStringLiteral("请选择有效的连接。"),
+                                    QStringLiteral("Please choose a valid connection.")));
+        return;
     }
 
-    QTimer *timer = new QTimer(this);
-    // setup signal and slot
-    connect(timer, &QTimer::timeout,
-         this, [=](){
-     if(!WidgetUtils::isRunning(this)){
-         this->deleteLater();
-     }
+    SqlFileRunOptions options;
+    options.info = info;
+    options.dbName = dbCombo->currentText().trimmed();
+    options.filePath = filePath;
+    options.codec = codecCombo->currentText().toLatin1();
+    options.batchSize = batchSpin->value();
+    options.continueOnError = continueOnErrorCheck->isChecked();
+
+    // Queued at background priority so interactive queries on the connection go first
+    const quint64 jobId = JobScheduler::instance()->enqueue(QStringLiteral("sql file"),
+                                                             QFileInfo(filePath).fileName(),
+                                                             {info.name},
+                                                             JobScheduler::Background);
+    worker = new SqlFileRunWorker(options, jobId);
+    auto *workerThread = new QThread(this);
+    runThread = workerThread;
+    worker->moveToThread(workerThread);
+    connect(workerThread, &QThread::started, worker, &SqlFileRunWorker::process);
+    connect(worker, &SqlFileRunWorker::logMessage, this, &RunSqlDialog::appendLogMessage);
+    connect(worker, &SqlFileRunWorker::progressChanged, this, &RunSqlDialog::handleProgress);
+    connect(worker, &SqlFileRunWorker::finished, this, &RunSqlDialog::handleFinished);
+    // Finish the job on the worker thread so a dialog closed early does not keep its slot
+    connect(worker, &SqlFileRunWorker::finished, worker, [jobId](bool aborted, const QString &message) {
+        JobScheduler::instance()->finish(jobId, !aborted, aborted ? message : QString());
+    }, Qt::DirectConnection);
+    connect(worker, &SqlFileRunWorker::finished, worker, &QObject::deleteLater);
+    connect(worker, &SqlFileRunWorker::finished, workerThread, &QThread::quit);
+    connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
+    connect(workerThread, &QThread::finished, this, [this, workerThread]() {
+        if(runThread == workerThread){
+            runThread = nullptr;
+        }
+        setRunning(false);
     });
-    // msec
-    timer->start(50);
 
-    event->ignore();
+    logEdit->clear();
+    progressBar->setValue(0);
+    statsLabel->clear();
+    appendLogMessage(trLang(QStringLiteral("开始执行 %1"), QStringLiteral("Executing %1"))
+                     .arg(QDir::toNativeSeparators(filePath)));
+    runTimer.start();
+    setRunning(true);
+    workerThread->start();
 }
 
-RunSqlDialog::~RunSqlDialog()
+void RunSqlDialog::stopRun()
 {
-    delete ui;
+    if(worker){
+        worker->cancel();
+        appendLogMessage(trLang(QStringLiteral("正在停止，将在当前语句完成后结束..."),
+                                QStringLiteral("Stopping after the current statement...")));
+    }
 }
 
-void RunSqlDialog::on_btn_close_clicked()
+void RunSqlDialog::handleProgress(qint64 bytesRead, qint64 totalBytes, qint64 statements, qint64 failed)
 {
-    this->ui->btn_close->setEnabled(false);
-
-    if(this->connData){
-        this->connData->stopConn();
+    if(totalBytes > 0){
+        progressBar->setValue(static_cast<int>(bytesRead * 1000 / totalBytes));
     }
-
-    this->close();
+    const qint64 elapsed = qMax<qint64>(1, runTimer.elapsed());
+    statsLabel->setText(trLang(QStringLiteral("%1 / %2    %3/s    %4 条语句（%5 条/秒）    失败 %6"),
+                               QStringLiteral("%1 / %2    %3/s    %4 statements (%5/s)    %6 failed"))
+                        .arg(formatBytes(bytesRead),
+                             formatBytes(totalBytes),
+                             formatBytes(bytesRead * 1000 / elapsed))
+                        .arg(statements)
+                        .arg(statements * 1000 / elapsed)
+                        .arg(failed));
 }
 
-void RunSqlDialog::on_btn_detect_clicked()
+void RunSqlDialog::handleFinished(bool aborted, const QString &message, qint64 statements, qint64 failed)
 {
-    QString fname=this->ui->le_file->text();
-    QFile file(fname);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
-
-        QMessageBox::critical(this, QCoreApplication::applicationName(),
-                             tr("File open error!"));
+    worker = nullptr;
+    const QString elapsed = QString::number(runTimer.elapsed() / 1000.0, 'f', 1);
+    if(aborted){
+        appendLogMessage(message);
         return;
     }
-    LastRun lr{[&](){
-            file.close();
-               }};
-
-    QString codecName=WidgetUtils::detectEncoding(file);
-    if(codecName.length()>0){
-        WidgetUtils::setOrAddCurrItem(this->ui->cbox_encoding,codecName,false);
-    }
+    appendLogMessage(trLang(QStringLiteral("执行完成：%1 条语句，失败 %2 条，用时 %3 秒。"),
+                            QStringLiteral("Finished: %1 statements, %2 failed, %3 s.")).arg(statements).arg(failed).arg(elapsed));
 }
 
-void RunSqlDialog::on_btn_start_clicked()
+void RunSqlDialog::appendLogMessage(const QString &message)
 {
-    auto runRef=WidgetUtils::createRunRef(this);
+    const QString stamp = QDateTime::currentDateTime().toString(QStringLiteral("HH:mm:ss"));
+    logEdit->appendPlainText(QStringLiteral("[%1] %2").arg(stamp, message));
+}
 
-    this->ui->btn_start->setEnabled(false);
+void RunSqlDialog::setRunning(bool running)
+{
+    startButton->setEnabled(!running);
+    stopButton->setEnabled(running);
+    connCombo->setEnabled(!running);
+    dbCombo->setEnabled(!running);
+    fileEdit->setEnabled(!running);
+    browseButton->setEnabled(!running);
+    codecCombo->setEnabled(!running);
+    batchSpin->setEnabled(!running);
+    continueOnErrorCheck->setEnabled(!running);
+}
 
-    LastRun lr{[=](){
+void RunSqlDialog::closeEvent(QCloseEvent *event)
+{
+    if(runThread){
+        const auto ret = QMessageBox::question(this,
+                                               windowTitle(),
+                                               trLang(QStringLiteral("任务仍在执行，是否停止并关闭？"),
+                                                      QStringLiteral("The file is still running. Stop and close?")));
+        if(ret != QMessageBox::Yes){
+            event->ignore();
+            return;
+        }
+        if(worker){
+            worker->cancel();
+        }
+        runThread->quit();
+        runThread->wait();
+    }
+    QDialog::closeEvent(event);
+}
 
-            this->ui->btn_start->setEnabled(true);
+SqlFileRunWorker::SqlFileRunWorker(const SqlFileRunOptions &options, quint64 jobId)
+    : QObject(nullptr)
+    , m_options(options)
+    , m_jobId(jobId)
+{
+}
 
-            
-               }};
+void SqlFileRunWorker::cancel()
+{
+    m_cancelled = true;
+    // Wakes waitForStart() while still queued
+    JobScheduler::instance()->cancel(m_jobId);
+}
 
-//    BtnLoadingIcon bli{this->ui->btn_start};
+bool SqlFileRunWorker::stopRequested()
+{
+    // checkpoint() yields while interactive work waits for the connection and returns
+    // false once cancelled
+    if(!m_cancelled && !JobScheduler::instance()->checkpoint(m_jobId)){
+        m_cancelled = true;
+    }
+    return m_cancelled;
+}
 
-    if(ui->cbox_dbName->currentText().trimmed().isEmpty()){
-        QMessageBox::warning(this, QCoreApplication::applicationName(),tr("No database selected!").trimmed());
+void SqlFileRunWorker::process()
+{
+    if(!JobScheduler::instance()->waitForStart(m_jobId)){
+        emit finished(true, trLang(QStringLiteral("已取消。"), QStringLiteral("Cancelled.")), 0, 0);
+        return;
+    }
+    QFile file(m_options.filePath);
+    if(!file.open(QIODevice::ReadOnly)){
+        emit finished(true,
+                      trLang(QStringLiteral("无法打开文件：%1"), QStringLiteral("Unable to open file: %1"))
+                      .arg(file.errorString()),
+                      0, 0);
+        return;
+    }
+    QTextCodec *codec = QTextCodec::codecForName(m_options.codec);
+    if(!codec){
+        codec = QTextCodec::codecForName("UTF-8");
+    }
+    QScopedPointer<QTextDecoder> decoder(codec->makeDecoder());
+
+    QString error;
+    QSqlDatabase db = SessionPool::instance()->acquire(m_options.info, m_options.dbName, &error);
+    if(!db.isValid()){
+        emit finished(true,
+                      trLang(QStringLiteral("连接失败：%1"), QStringLiteral("Connection failed: %1")).arg(error),
+                      0, 0);
         return;
     }
 
-    QString fname=this->ui->le_file->text();
-
-    if(!Utils::testOrReconn(this->connData))return;
-
-    QJsonObject json;
-    json.insert("funcId", RUN_SQL_FILE);
-    json.insert("file", fname);
-    json.insert("dbName", ui->cbox_dbName->currentText().trimmed());
-    json.insert("autoCommit", this->ui->chk_autoCommit->isChecked());
-    json.insert("stopOnError", !this->ui->chk_contionueOnError->isChecked());
-    json.insert("batchSize", this->ui->spin_batchSize->value());
-    json.insert("codec", this->ui->cbox_encoding->currentText().trimmed());
-
-    int reqNum=Utils::nextReqNum();
-
-
-    int64_t startTime=QDateTime::currentMSecsSinceEpoch();
-
-    this->ui->progressBar->setValue(0);
-    this->ui->lb_times->clear();
-
-    QTimer timer;
-    connect(&timer, &QTimer::timeout,
-             this, [=](){
-
-        auto runRef=WidgetUtils::createRunRef(this);
-        QJsonObject json;
-        json.insert("funcId", PROGRESS_RATE);
-        json.insert("startReqNum", reqNum);
-        QJsonObject res2=this->connData->getResJson(json);
-        if(Utils::testResult(res2,false)){
-            double rate=Utils::getDouble(res2,"rate");
-            this->ui->progressBar->setValue(rate);
-
-            int64_t endTime=QDateTime::currentMSecsSinceEpoch();
-
-            this->ui->lb_times->setText(tr("%1s").arg((endTime-startTime)/1000));
+    m_totalBytes = file.size();
+    m_progressTimer.start();
+    SqlSplitter splitter;
+    bool aborted = false;
+    QString message;
+    while(!aborted){
+        const QByteArray chunk = file.read(kChunkSize);
+        if(chunk.isEmpty()){
+            if(file.error() != QFileDevice::NoError){
+                aborted = true;
+                message = trLang(QStringLiteral("读取文件失败：%1"), QStringLiteral("Failed to read file: %1"))
+                        .arg(file.errorString());
+            }
+            break;
         }
-        });
-    timer.start(700);
-
-
-    QJsonObject res=connData->getResJson(json,reqNum);
+        m_bytesRead += chunk.size();
+        splitter.feed(decoder->toUnicode(chunk));
+        while(splitter.hasStatement() && !aborted){
+            const SqlStatement statement = splitter.takeStatement();
+            m_pending << statement;
+            m_pendingChars += statement.text.size();
+            if(m_pending.size() >= m_options.batchSize
+                    || m_pendingChars >= kMaxBatchChars
+                    || !canBatch(statement)){
+                aborted = !executePending(db, &message);
+            }
+        }
+        if(!aborted && stopRequested()){
+            aborted = true;
+            message = trLang(QStringLiteral("已停止。"), QStringLiteral("Stopped."));
+        }
+        reportProgress();
+    }
+    if(!aborted){
+        splitter.finish();
+        while(splitter.hasStatement()){
+            m_pending << splitter.takeStatement();
+        }
+        aborted = !executePending(db, &message);
+    }
+    reportProgress(true);
+    SessionPool::instance()->release(db);
+    emit finished(aborted, message, m_executed, m_failed);
+}
 
-    timer.stop();
-    this->ui->progressBar->setValue(100);
+bool SqlFileRunWorker::executePending(QSqlDatabase &db, QString *errorMessage)
+{
+    int index = 0;
+    while(index < m_pending.size()){
+        if(stopRequested()){
+            *errorMessage = trLang(QStringLiteral("已停止。"), QStringLiteral("Stopped."));
+            m_pending.clear();
+            m_pendingChars = 0;
+            return false;
+        }
+        int count = 1;
+        if(canBatch(m_pending.at(index))){
+            while(index + count < m_pending.size()
+                  && count < m_options.batchSize
+                  && canBatch(m_pending.at(index + count))){
+                ++count;
+            }
+        }
+        QString error;
+        const int succeeded = executeBatch(db, index, count, &error);
+        m_executed += succeeded;
+        index += succeeded;
+        if(succeeded < count){
+            const SqlStatement &statement = m_pending.at(index);
+            ++m_failed;
+            ++index;
+            emit logMessage(trLang(QStringLiteral("[错误] 第 %1 行：%2"), QStringLiteral("[ERROR] Line %1: %2"))
+                            .arg(statement.line)
+                            .arg(error));
+            if(!m_options.continueOnError){
+                *errorMessage = trLang(QStringLiteral("第 %1 行执行失败，已中止：%2"),
+                                       QStringLiteral("Aborted at line %1: %2"))
+                        .arg(statement.line)
+                        .arg(error);
+                m_pending.clear();
+                m_pendingChars = 0;
+                return false;
+            }
+        }
+        reportProgress();
+    }
+    m_pending.clear();
+    m_pendingChars = 0;
+    return true;
+}
 
-    if(Utils::testResult(res)){
+int SqlFileRunWorker::executeBatch(QSqlDatabase &db, int from, int count, QString *errorMessage)
+{
+    QString sql;
+    if(count == 1){
+        sql = m_pending.at(from).text;
+    }else{
+        QStringList parts;
+        parts.reserve(count);
+        for(int i = from; i < from + count; ++i){
+            parts << m_pending.at(i).text;
+        }
+        // The delimiter goes on its own line so a trailing line comment cannot swallow it
+        sql = parts.join(QStringLiteral("\n;\n"));
+    }
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if(!query.exec(sql)){
+        *errorMessage = query.lastError().text();
+        return 0;
+    }
+    // A multi-statement batch returns one result per statement; the server stops at the
+    // first failure
+    int succeeded = 1;
+    while(succeeded < count){
+        if(!query.nextResult()){
+            if(query.lastError().isValid()){
+                *errorMessage = query.lastError().text();
+                return succeeded;
+            }
+            break;
+        }
+        ++succeeded;
+    }
+    while(query.nextResult()){
+    }
+    return count;
+}
 
-        int errors=Utils::getInt(res,"errorNum");
-        if(errors<0)errors=0;
+bool SqlFileRunWorker::canBatch(const SqlStatement &statement) const
+{
+    // CALL may return several result sets; statements not ended by ; (routine bodies and
+    // the like) are sent alone
+    return m_options.batchSize > 1
+            && statement.delimiter == QStringLiteral(";")
+            && !statement.text.startsWith(QStringLiteral("CALL"), Qt::CaseInsensitive);
+}
 
-        const int diaRet=WidgetUtils::showSuccDialog(QCoreApplication::applicationName(),
-                                                  tr("Dump succeeded.\nFile: %1\nErrors: %2").arg(fname).arg(errors),
-                                                  tr("OK"));
+void SqlFileRunWorker::reportProgress(bool force)
+{
+    if(!force && m_progressTimer.elapsed() < kProgressIntervalMs){
+        return;
     }
+    m_progressTimer.restart();
+    emit progressChanged(m_bytesRead, m_totalBytes, m_executed, m_failed);
 }
@@ -1,42 +1,119 @@
 #ifndef RUNSQLDIALOG_H
 #define RUNSQLDIALOG_H
 
-#include "utils.h"
+#include "connectionmanager.h"
+#include "sqlsplitter.h"
 
 #include <QDialog>
-
-namespace Ui {
-class RunSqlDialog;
-}
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <atomic>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPlainTextEdit;
+class QProgressBar;
+class QPushButton;
+class QSpinBox;
+class QSqlDatabase;
+class QThread;
+
+class SqlFileRunWorker;
+
+struct SqlFileRunOptions {
+    ConnectionInfo info;
+    QString dbName;
+    QString filePath;
+    QByteArray codec = QByteArrayLiteral("UTF-8");
+    int batchSize = 1;
+    bool continueOnError = false;
+};
 
 class RunSqlDialog : public QDialog
 {
     Q_OBJECT
-
 public:
-    explicit RunSqlDialog(QSharedPointer<ConnData> connData,QString dbName,QWidget *parent = nullptr);
+    explicit RunSqlDialog(const QString &connName = QString(),
+                          const QString &dbName = QString(),
+                          QWidget *parent = nullptr);
+    ~RunSqlDialog() override;
 
-private slots:
-    void on_btn_close_clicked();
-
-    void on_btn_detect_clicked();
+protected:
+    void closeEvent(QCloseEvent *event) override;
 
-    void on_btn_start_clicked();
+private slots:
+    void browseFile();
+    void startRun();
+    void stopRun();
+    void onConnectionChanged(int index);
+    void handleProgress(qint64 bytesRead, qint64 totalBytes, qint64 statements, qint64 failed);
+    void handleFinished(bool aborted, const QString &message, qint64 statements, qint64 failed);
 
 private:
-    ~RunSqlDialog();
-
-    Ui::RunSqlDialog *ui;
-    QSharedPointer<ConnData> connData;
+    void buildUi();
+    void loadConnections(const QString &preferredConn);
+    void populateDatabases(const QString &preferredDb);
+    void appendLogMessage(const QString &message);
+    void setRunning(bool running);
+
+    QComboBox *connCombo = nullptr;
+    QComboBox *dbCombo = nullptr;
+    QLineEdit *fileEdit = nullptr;
+    QPushButton *browseButton = nullptr;
+    QComboBox *codecCombo = nullptr;
+    QSpinBox *batchSpin = nullptr;
+    QCheckBox *continueOnErrorCheck = nullptr;
+    QProgressBar *progressBar = nullptr;
+    QLabel *statsLabel = nullptr;
+    QPlainTextEdit *logEdit = nullptr;
+    QPushButton *startButton = nullptr;
+    QPushButton *stopButton = nullptr;
+    QPushButton *closeButton = nullptr;
+
+    QThread *runThread = nullptr;
+    SqlFileRunWorker *worker = nullptr;
+    QElapsedTimer runTimer;
+};
 
+// Streams a SQL file through SqlSplitter chunk by chunk, so memory use does
+// not depend on the file size.
+class SqlFileRunWorker : public QObject
+{
+    Q_OBJECT
 public:
+    explicit SqlFileRunWorker(const SqlFileRunOptions &options, quint64 jobId = 0);
 
-    void closeEvent(QCloseEvent *event) override;
+    void cancel();
+    quint64 jobId() const { return m_jobId; }
 
-private:
+public slots:
+    void process();
 
-    std::atomic_bool stop=false;
+signals:
+    void logMessage(const QString &message);
+    void progressChanged(qint64 bytesRead, qint64 totalBytes, qint64 statements, qint64 failed);
+    void finished(bool aborted, const QString &message, qint64 statements, qint64 failed);
 
+private:
+    bool executePending(QSqlDatabase &db, QString *errorMessage);
+    int executeBatch(QSqlDatabase &db, int from, int count, QString *errorMessage);
+    bool canBatch(const SqlStatement &statement) const;
+    void reportProgress(bool force = false);
+    bool stopRequested();
+
+    SqlFileRunOptions m_options;
+    quint64 m_jobId = 0;
+    QList<SqlStatement> m_pending;
+    int m_pendingChars = 0;
+    qint64 m_executed = 0;
+    qint64 m_failed = 0;
+    qint64 m_bytesRead = 0;
+    qint64 m_totalBytes = 0;
+    QElapsedTimer m_progressTimer;
+    std::atomic_bool m_cancelled{false};
 };
 
 #endif // RUNSQLDIALOG_H
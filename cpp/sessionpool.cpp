@@ -0,0 +1,368 @@
+#include "sessionpool.h"
+#include "jobscheduler.h"
+#include "languagemanager.h"
+#include "sqlsplitter.h"
+#include "sshtunnel.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QUuid>
+
+#include <mysql.h>
+
+namespace {
+
+// Sessions idle for longer than this are pinged before reuse
+const qint64 kValidateAfterMs = 60 * 1000;
+
+// Worker threads initialise the client library on first use and release it when they
+// exit; the main thread is covered by mysql_library_init
+struct MysqlThreadGuard
+{
+    MysqlThreadGuard() { mysql_thread_init(); }
+    ~MysqlThreadGuard() { mysql_thread_end(); }
+};
+
+void initMysqlThread()
+{
+    if(QThread::currentThread() == QCoreApplication::instance()->thread()){
+        return;
+    }
+    thread_local MysqlThreadGuard guard;
+    Q_UNUSED(guard)
+}
+
+QString escapeIdentifier(const QString &name)
+{
+    QString value = name;
+    value.replace(QLatin1Char('`'), QStringLiteral("``"));
+    return QStringLiteral("`%1`").arg(value);
+}
+
+}
+
+SessionPool *SessionPool::instance()
+{
+    static SessionPool *ins = new SessionPool;
+    return ins;
+}
+
+SessionPool::SessionPool(QObject *parent) : QObject(parent)
+{
+    connect(ConnectionManager::instance(), &ConnectionManager::connectionsChanged,
+            this, [this]() {
+        clear();
+        prewarmFavorites();
+    }, Qt::DirectConnection);
+    // Idle sessions opened through a tunnel are dead once it drops
+    connect(SshTunnelManager::instance(), &SshTunnelManager::tunnelClosed,
+            this, [this](const QStringList &connNames) {
+        for(const QString &name : connNames){
+            clear(name);
+        }
+    });
+}
+
+QSqlDatabase SessionPool::acquire(const ConnectionInfo &info,
+                                  const QString &dbName,
+                                  QString *errorMessage)
+{
+    const QString targetDb = dbName.isEmpty() ? info.defaultDb : dbName;
+    while(true){
+        IdleSession session;
+        {
+            QMutexLocker locker(&m_mutex);
+            auto it = m_idle.find(info.name);
+            if(it == m_idle.end() || it->isEmpty()){
+                break;
+            }
+            session = it->takeLast();
+        }
+        QSqlDatabase db = adopt(session);
+        if(!db.isValid() || !db.isOpen()){
+            discard(db);
+            continue;
+        }
+        if(QDateTime::currentMSecsSinceEpoch() - session.idleSince > kValidateAfterMs){
+            QSqlQuery ping(db);
+            if(!ping.exec(QStringLiteral("SELECT 1"))){
+                ping.clear();
+                discard(db);
+                continue;
+            }
+        }
+        if(!targetDb.isEmpty() && db.databaseName() != targetDb){
+            QSqlQuery use(db);
+            if(!use.exec(QStringLiteral("USE %1").arg(escapeIdentifier(targetDb)))){
+                if(errorMessage){
+                    *errorMessage = use.lastError().text();
+                }
+                use.clear();
+                release(db);
+                return QSqlDatabase();
+            }
+            db.setDatabaseName(targetDb);
+        }
+        return db;
+    }
+    return openSession(info, targetDb, errorMessage);
+}
+
+void SessionPool::release(QSqlDatabase &db)
+{
+    if(!db.isValid()){
+        return;
+    }
+    const QString handle = db.connectionName();
+    QString connName;
+    bool retired = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        connName = m_owners.value(handle);
+        retired = m_retired.contains(handle)
+                || m_idle.value(connName).size() >= m_maxIdle;
+    }
+    if(connName.isEmpty() || retired || !db.isOpen() || !resetSession(db, connName)){
+        discard(db);
+        return;
+    }
+    park(db, connName);
+}
+
+void SessionPool::park(QSqlDatabase &db, const QString &connName)
+{
+    const QString handle = db.connectionName();
+    IdleSession session;
+    session.handle = handle;
+    session.driver = db.driver();
+    session.idleSince = QDateTime::currentMSecsSinceEpoch();
+    db = QSqlDatabase();
+    // Drop the thread affinity so any thread can take it next
+    session.driver->moveToThread(nullptr);
+    QMutexLocker locker(&m_mutex);
+    m_idle[connName].append(session);
+}
+
+void SessionPool::discard(QSqlDatabase &db)
+{
+    const QString handle = db.connectionName();
+    if(db.isValid()){
+        db.close();
+    }
+    db = QSqlDatabase();
+    if(handle.isEmpty()){
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_owners.remove(handle);
+        m_retired.remove(handle);
+    }
+    QSqlDatabase::removeDatabase(handle);
+}
+
+void SessionPool::clear(const QString &connName)
+{
+    QList<IdleSession> sessions;
+    {
+        QMutexLocker locker(&m_mutex);
+        for(auto it = m_idle.begin(); it != m_idle.end(); ++it){
+            if(connName.isEmpty() || it.key() == connName){
+                sessions += it.value();
+                it->clear();
+            }
+        }
+        for(auto it = m_owners.cbegin(); it != m_owners.cend(); ++it){
+            if(connName.isEmpty() || it.value() == connName){
+                m_retired.insert(it.key());
+            }
+        }
+        for(const IdleSession &session : qAsConst(sessions)){
+            m_retired.remove(session.handle);
+        }
+    }
+    for(const IdleSession &session : qAsConst(sessions)){
+        QSqlDatabase db = adopt(session);
+        discard(db);
+    }
+}
+
+void SessionPool::prewarm(const ConnectionInfo &info, int count)
+{
+    if(count < 0){
+        count = info.warmSessions;
+    }
+    int missing = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        missing = qMin(count, m_maxIdle) - m_idle.value(info.name).size();
+        if(info.name.isEmpty() || missing <= 0 || m_warming.contains(info.name)){
+            return;
+        }
+        m_warming.insert(info.name);
+    }
+    // Open and set up sessions in the background and park them as idle for the first query
+    auto work = [this, info, missing](quint64 id) {
+        QString error;
+        for(int i = 0; i < missing && !JobScheduler::instance()->isCancelled(id); ++i){
+            QSqlDatabase db = openSession(info, info.defaultDb, &error);
+            if(!db.isValid()){
+                break;
+            }
+            // A fresh session needs no reset
+            bool full = false;
+            {
+                QMutexLocker locker(&m_mutex);
+                full = m_idle.value(info.name).size() >= m_maxIdle || m_retired.contains(db.connectionName());
+            }
+            if(full){
+                discard(db);
+            }else{
+                park(db, info.name);
+            }
+        }
+        {
+            QMutexLocker locker(&m_mutex);
+            m_warming.remove(info.name);
+        }
+        if(!error.isEmpty()){
+            JobScheduler::instance()->finish(id, false, error);
+        }
+    };
+    auto skipped = [this, info](quint64) {
+        QMutexLocker locker(&m_mutex);
+        m_warming.remove(info.name);
+    };
+    JobScheduler::instance()->submit(QStringLiteral("prewarm"),
+                                     trLang(QStringLiteral("预先建立 %1 个会话"),
+                                            QStringLiteral("Open %1 session(s) ahead")).arg(missing),
+                                     {info.name},
+                                     JobScheduler::Background,
+                                     work,
+                                     {},
+                                     skipped);
+}
+
+void SessionPool::prewarmFavorites()
+{
+    const auto connections = ConnectionManager::instance()->connections();
+    for(const auto &info : connections){
+        if(info.warmSessions > 0){
+            prewarm(info);
+        }
+    }
+}
+
+int SessionPool::idleCount(const QString &connName) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_idle.value(connName).size();
+}
+
+int SessionPool::maxIdlePerConnection() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxIdle;
+}
+
+void SessionPool::setMaxIdlePerConnection(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxIdle = qMax(0, count);
+}
+
+QSqlDatabase SessionPool::adopt(const IdleSession &session) const
+{
+    if(!session.driver){
+        return QSqlDatabase();
+    }
+    // Objects without thread affinity can be pulled to the current thread
+    session.driver->moveToThread(QThread::currentThread());
+    initMysqlThread();
+    return QSqlDatabase::database(session.handle, false);
+}
+
+QSqlDatabase SessionPool::openSession(const ConnectionInfo &info,
+                                      const QString &dbName,
+                                      QString *errorMessage)
+{
+    const QString handle = QStringLiteral("pool_%1_%2")
+            .arg(info.name, QUuid::createUuid().toString(QUuid::WithoutBraces));
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QMYSQL"), handle);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(handle);
+        return QSqlDatabase();
+    }
+    db.setUserName(info.user);
+    db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
+    if(!dbName.isEmpty()){
+        db.setDatabaseName(dbName);
+    }
+    if(!db.open()){
+        if(errorMessage){
+            *errorMessage = db.lastError().text();
+        }
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(handle);
+        return QSqlDatabase();
+    }
+    if(!setupSession(db, info, errorMessage)){
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(handle);
+        return QSqlDatabase();
+    }
+    QMutexLocker locker(&m_mutex);
+    m_owners.insert(handle, info.name);
+    m_infos.insert(info.name, info);
+    return db;
+}
+
+bool SessionPool::resetSession(QSqlDatabase &db, const QString &connName)
+{
+    // Clear the transaction, temporary tables, user variables and session variables the
+    // last user left, then run the connection setup again
+    bool ok = false;
+    QMetaObject::invokeMethod(db.driver(), "resetSession", Qt::DirectConnection, Q_RETURN_ARG(bool, ok));
+    if(!ok){
+        return false;
+    }
+    ConnectionInfo info;
+    {
+        QMutexLocker locker(&m_mutex);
+        info = m_infos.value(connName);
+    }
+    return setupSession(db, info, nullptr);
+}
+
+bool SessionPool::setupSession(QSqlDatabase &db, const ConnectionInfo &info, QString *errorMessage)
+{
+    // The driver negotiates utf8mb4 in the handshake and encodes with it, so no SET NAMES here
+    QSqlQuery query(db);
+    if(!info.serverTimeZone.isEmpty()){
+        QString zone = info.serverTimeZone;
+        zone.replace(QLatin1Char('\''), QStringLiteral("''"));
+        // Named time zones fail when the server has no time zone tables; keep the server
+        // default then
+        query.exec(QStringLiteral("SET time_zone = '%1'").arg(zone));
+    }
+    const auto statements = SqlSplitter::split(info.startupScript);
+    for(const SqlStatement &statement : statements){
+        if(!query.exec(statement.text)){
+            if(errorMessage){
+                *errorMessage = trLang(QStringLiteral("启动脚本执行失败：%1"),
+                                       QStringLiteral("Startup script failed: %1"))
+                        .arg(query.lastError().text());
+            }
+            return false;
+        }
+    }
+    return true;
+}
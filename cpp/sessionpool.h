@@ -0,0 +1,65 @@
+#ifndef SESSIONPOOL_H
+#define SESSIONPOOL_H
+
+#include "connectionmanager.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSqlDatabase>
+
+class QSqlDriver;
+
+// Idle MySQL sessions kept per connection so background jobs can reuse them
+// instead of reconnecting. acquire()/release() may be called from any thread.
+// Every new session runs the connection's setup (time zone, startup script),
+// release() resets a session and runs the setup again before pooling it, and
+// prewarm() opens sessions ahead of the first query.
+class SessionPool : public QObject
+{
+    Q_OBJECT
+public:
+    static SessionPool *instance();
+
+    QSqlDatabase acquire(const ConnectionInfo &info,
+                         const QString &dbName,
+                         QString *errorMessage = nullptr);
+    void release(QSqlDatabase &db);
+    void discard(QSqlDatabase &db);
+    void clear(const QString &connName = QString());
+    void prewarm(const ConnectionInfo &info, int count = -1);
+    void prewarmFavorites();
+
+    int idleCount(const QString &connName) const;
+    int maxIdlePerConnection() const;
+    void setMaxIdlePerConnection(int count);
+
+private:
+    explicit SessionPool(QObject *parent = nullptr);
+
+    struct IdleSession {
+        QString handle;
+        QSqlDriver *driver = nullptr;
+        qint64 idleSince = 0;
+    };
+
+    QSqlDatabase adopt(const IdleSession &session) const;
+    QSqlDatabase openSession(const ConnectionInfo &info,
+                             const QString &dbName,
+                             QString *errorMessage);
+    bool setupSession(QSqlDatabase &db, const ConnectionInfo &info, QString *errorMessage);
+    bool resetSession(QSqlDatabase &db, const QString &connName);
+    void park(QSqlDatabase &db, const QString &connName);
+
+    mutable QMutex m_mutex;
+    QHash<QString, QList<IdleSession>> m_idle;
+    QHash<QString, QString> m_owners;
+    QHash<QString, ConnectionInfo> m_infos;
+    QSet<QString> m_retired;
+    QSet<QString> m_warming;
+    int m_maxIdle = 4;
+};
+
+#endif // SESSIONPOOL_H
@@ -0,0 +1,300 @@
+#include "sqlsplitter.h"
+
+#include <algorithm>
+
+namespace {
+
+const QString kDelimiterKeyword = QStringLiteral("delimiter");
+
+bool matchesAt(const QString &text, int pos, const QString &token,
+               Qt::CaseSensitivity cs = Qt::CaseSensitive)
+{
+    if(token.isEmpty() || pos < 0 || pos + token.size() > text.size()){
+        return false;
+    }
+    return text.midRef(pos, token.size()).compare(token, cs) == 0;
+}
+
+}
+
+SqlSplitter::SqlSplitter(const QString &delimiter)
+{
+    reset(delimiter);
+}
+
+void SqlSplitter::setOrigin(qint64 offset, int line)
+{
+    m_base = offset - m_pos;
+    m_line = line;
+    m_stmtLine = line;
+}
+
+void SqlSplitter::reset(const QString &delimiter)
+{
+    m_buffer.clear();
+    m_ready.clear();
+    m_delimiter = delimiter.isEmpty() ? QStringLiteral(";") : delimiter;
+    m_state = Normal;
+    m_pos = 0;
+    m_base = 0;
+    m_line = 1;
+    m_stmtStart = -1;
+    m_stmtLine = 1;
+    m_hasCode = false;
+    m_finished = false;
+}
+
+void SqlSplitter::feed(const QString &chunk)
+{
+    if(chunk.isEmpty()){
+        return;
+    }
+    m_buffer.append(chunk);
+    scan();
+}
+
+void SqlSplitter::finish()
+{
+    m_finished = true;
+    scan();
+    emitStatement(m_buffer.size(), 0);
+    m_state = Normal;
+    compact();
+}
+
+bool SqlSplitter::hasStatement() const
+{
+    return !m_ready.isEmpty();
+}
+
+SqlStatement SqlSplitter::takeStatement()
+{
+    if(m_ready.isEmpty()){
+        return {};
+    }
+    return m_ready.takeFirst();
+}
+
+QString SqlSplitter::delimiter() const
+{
+    return m_delimiter;
+}
+
+qint64 SqlSplitter::position() const
+{
+    return m_base + m_pos;
+}
+
+int SqlSplitter::pendingSize() const
+{
+    return m_buffer.size();
+}
+
+QList<SqlStatement> SqlSplitter::split(const QString &script)
+{
+    SqlSplitter splitter;
+    splitter.feed(script);
+    splitter.finish();
+    QList<SqlStatement> statements;
+    while(splitter.hasStatement()){
+        statements << splitter.takeStatement();
+    }
+    return statements;
+}
+
+void SqlSplitter::scan()
+{
+    while(m_pos < m_buffer.size()){
+        if(!step()){
+            break;
+        }
+    }
+    compact();
+}
+
+bool SqlSplitter::step()
+{
+    const int remaining = m_buffer.size() - m_pos;
+    const QChar ch = m_buffer.at(m_pos);
+    const QChar next = remaining > 1 ? m_buffer.at(m_pos + 1) : QChar();
+
+    switch(m_state){
+    case LineComment:
+        if(ch == QLatin1Char('\n')){
+            m_state = Normal;
+        }
+        advance(1);
+        return true;
+    case BlockComment:
+        if(ch == QLatin1Char('*')){
+            if(remaining < 2 && !m_finished){
+                return false;
+            }
+            if(next == QLatin1Char('/')){
+                m_state = Normal;
+                advance(2);
+                return true;
+            }
+        }
+        advance(1);
+        return true;
+    case SingleQuote:
+    case DoubleQuote:
+    case Backtick: {
+        const QChar quote = m_state == SingleQuote ? QLatin1Char('\'')
+                          : m_state == DoubleQuote ? QLatin1Char('"')
+                                                   : QLatin1Char('`');
+        if(ch == QLatin1Char('\\') && m_state != Backtick){
+            if(remaining < 2 && !m_finished){
+                return false;
+            }
+            advance(std::min(2, remaining));
+            return true;
+        }
+        if(ch == quote){
+            m_state = Normal;
+        }
+        advance(1);
+        return true;
+    }
+    case Normal:
+        break;
+    }
+
+    // Enough lookahead to recognise delimiters and comments
+    if(!m_finished && remaining < std::max(3, m_delimiter.size())){
+        return false;
+    }
+    if(matchesAt(m_buffer, m_pos, m_delimiter)){
+        emitStatement(m_pos, m_delimiter.size());
+        return true;
+    }
+    if(!m_hasCode && (ch == QLatin1Char('d') || ch == QLatin1Char('D'))){
+        if(!m_finished && remaining <= kDelimiterKeyword.size()){
+            return false;
+        }
+        if(isDelimiterCommand()){
+            const int eol = m_buffer.indexOf(QLatin1Char('\n'), m_pos);
+            if(eol < 0 && !m_finished){
+                return false;
+            }
+            applyDelimiterCommand(eol < 0 ? m_buffer.size() : eol);
+            return true;
+        }
+    }
+
+    const QChar third = remaining > 2 ? m_buffer.at(m_pos + 2) : QChar();
+    if(ch == QLatin1Char('\'') || ch == QLatin1Char('"') || ch == QLatin1Char('`')){
+        markStart();
+        m_state = ch == QLatin1Char('\'') ? SingleQuote
+                : ch == QLatin1Char('"') ? DoubleQuote
+                                         : Backtick;
+        advance(1);
+        return true;
+    }
+    if(ch == QLatin1Char('#')){
+        m_state = LineComment;
+        advance(1);
+        return true;
+    }
+    if(ch == QLatin1Char('-') && next == QLatin1Char('-') && (remaining < 3 || third.isSpace())){
+        m_state = LineComment;
+        advance(2);
+        return true;
+    }
+    if(ch == QLatin1Char('/') && next == QLatin1Char('*')){
+        // /*! ... */ is a MySQL executable comment and belongs to the statement
+        if(third == QLatin1Char('!')){
+            markStart();
+        }
+        m_state = BlockComment;
+        advance(2);
+        return true;
+    }
+    if(!ch.isSpace()){
+        markStart();
+    }
+    advance(1);
+    return true;
+}
+
+void SqlSplitter::advance(int count)
+{
+    const int end = std::min(m_pos + count, m_buffer.size());
+    while(m_pos < end){
+        if(m_buffer.at(m_pos) == QLatin1Char('\n')){
+            ++m_line;
+        }
+        ++m_pos;
+    }
+}
+
+void SqlSplitter::markStart()
+{
+    if(m_stmtStart < 0){
+        m_stmtStart = m_pos;
+        m_stmtLine = m_line;
+    }
+    m_hasCode = true;
+}
+
+bool SqlSplitter::isDelimiterCommand() const
+{
+    const int keywordEnd = m_pos + kDelimiterKeyword.size();
+    if(keywordEnd >= m_buffer.size()){
+        return false;
+    }
+    const QChar after = m_buffer.at(keywordEnd);
+    return (after == QLatin1Char(' ') || after == QLatin1Char('\t'))
+            && matchesAt(m_buffer, m_pos, kDelimiterKeyword, Qt::CaseInsensitive);
+}
+
+void SqlSplitter::applyDelimiterCommand(int lineEnd)
+{
+    const int argStart = m_pos + kDelimiterKeyword.size();
+    const QString arg = m_buffer.mid(argStart, lineEnd - argStart).trimmed();
+    int tokenEnd = 0;
+    while(tokenEnd < arg.size() && !arg.at(tokenEnd).isSpace()){
+        ++tokenEnd;
+    }
+    if(tokenEnd > 0){
+        m_delimiter = arg.left(tokenEnd);
+    }
+    advance(lineEnd - m_pos + (lineEnd < m_buffer.size() ? 1 : 0));
+    m_stmtStart = -1;
+    m_hasCode = false;
+}
+
+void SqlSplitter::emitStatement(int endPos, int delimiterLength)
+{
+    if(m_hasCode && m_stmtStart >= 0){
+        int length = endPos - m_stmtStart;
+        while(length > 0 && m_buffer.at(m_stmtStart + length - 1).isSpace()){
+            --length;
+        }
+        SqlStatement statement;
+        statement.text = m_buffer.mid(m_stmtStart, length);
+        statement.delimiter = delimiterLength > 0 ? m_delimiter : QString();
+        statement.start = m_base + m_stmtStart;
+        statement.end = m_base + endPos + delimiterLength;
+        statement.line = m_stmtLine;
+        m_ready.append(statement);
+    }
+    m_stmtStart = -1;
+    m_hasCode = false;
+    advance(endPos + delimiterLength - m_pos);
+}
+
+void SqlSplitter::compact()
+{
+    const int keepFrom = m_stmtStart >= 0 ? m_stmtStart : m_pos;
+    if(keepFrom <= 0){
+        return;
+    }
+    m_buffer.remove(0, keepFrom);
+    m_base += keepFrom;
+    m_pos -= keepFrom;
+    if(m_stmtStart >= 0){
+        m_stmtStart -= keepFrom;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SQLSPLITTER_H
+#define SQLSPLITTER_H
+
+#include <QList>
+#include <QString>
+
+struct SqlStatement
+{
+    QString text;
+    QString delimiter;  // delimiter that terminated the statement
+    qint64 start = 0;   // offset of the first significant character
+    qint64 end = 0;     // offset just past the delimiter
+    int line = 1;       // line of the first significant character
+};
+
+// Splits MySQL scripts into statements. Understands DELIMITER, quotes,
+// backticks and comments, and can be fed chunk by chunk.
+class SqlSplitter
+{
+public:
+    explicit SqlSplitter(const QString &delimiter = QStringLiteral(";"));
+
+    void setOrigin(qint64 offset, int line);
+    void feed(const QString &chunk);
+    void finish();
+    void reset(const QString &delimiter = QStringLiteral(";"));
+
+    bool hasStatement() const;
+    SqlStatement takeStatement();
+    QString delimiter() const;
+    qint64 position() const;
+    int pendingSize() const;
+
+    static QList<SqlStatement> split(const QString &script);
+
+private:
+    enum State {
+        Normal,
+        SingleQuote,
+        DoubleQuote,
+        Backtick,
+        LineComment,
+        BlockComment
+    };
+
+    void scan();
+    bool step();
+    void advance(int count);
+    void markStart();
+    bool isDelimiterCommand() const;
+    void applyDelimiterCommand(int lineEnd);
+    void emitStatement(int endPos, int delimiterLength);
+    void compact();
+
+    QString m_buffer;
+    QString m_delimiter;
+    QList<SqlStatement> m_ready;
+    State m_state = Normal;
+    int m_pos = 0;
+    qint64 m_base = 0;
+    int m_line = 1;
+    int m_stmtStart = -1;
+    int m_stmtLine = 1;
+    bool m_hasCode = false;
+    bool m_finished = false;
+};
+
+#endif // SQLSPLITTER_H
@@ -0,0 +1,585 @@
+#include "sshtunnel.h"
+#include "languagemanager.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHostAddress>
+#include <QPointer>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTcpServer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstdio>
+
+namespace {
+
+const char kAskPassVar[] = "OPENDBKIT_SSH_ASKPASS";
+// Authentication timeout and keepalives: probe every 15 s, give up after 3 misses
+const int kConnectTimeoutSec = 15;
+const int kAliveIntervalSec = 15;
+const int kAliveCountMax = 3;
+const int kMaxLogBytes = 8 * 1024;
+// A freshly picked local port can be taken by another process before ssh binds it
+const int kForwardAttempts = 3;
+#ifdef Q_OS_WIN
+// Without a control socket the only sign of a live forward is ssh's -v output
+const char kReadyMarker[] = "Entering interactive session";
+const char kForwardFailedMarker[] = "Could not request local forwarding";
+#endif
+
+QString targetKey(const ConnectionInfo &info)
+{
+    // IPv6 addresses need brackets inside -L
+    const QString host = info.host.contains(QLatin1Char(':'))
+            ? QStringLiteral("[%1]").arg(info.host)
+            : info.host;
+    return QStringLiteral("%1:%2").arg(host).arg(info.port);
+}
+
+QString bastionKey(const SshSettings &ssh)
+{
+    return QStringLiteral("%1@%2:%3").arg(ssh.user, ssh.host).arg(ssh.port);
+}
+
+QString tunnelKey(const ConnectionInfo &info)
+{
+#ifdef Q_OS_WIN
+    return QStringLiteral("%1 -> %2").arg(bastionKey(info.ssh), targetKey(info));
+#else
+    return bastionKey(info.ssh);
+#endif
+}
+
+// How the bastion appears in known_hosts
+QString knownHostsPattern(const SshSettings &ssh)
+{
+    return ssh.port == 22 ? ssh.host : QStringLiteral("[%1]:%2").arg(ssh.host).arg(ssh.port);
+}
+
+quint16 freeLocalPort()
+{
+    QTcpServer server;
+    if(!server.listen(QHostAddress::LocalHost, 0)){
+        return 0;
+    }
+    return server.serverPort();
+}
+
+QString lastLogLines(const QByteArray &log)
+{
+    const QStringList lines = QString::fromLocal8Bit(log).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    QStringList errors;
+    for(const QString &line : lines){
+        if(!line.startsWith(QLatin1String("debug"))){
+            errors << line.trimmed();
+        }
+    }
+    return errors.mid(qMax(0, errors.size() - 3)).join(QLatin1Char('\n'));
+}
+
+// Runs a short OpenSSH helper to completion; returns its exit code, or -1 if it did not run
+int runTool(const QString &program, const QStringList &args, const QByteArray &input,
+            QByteArray *output, QByteArray *errors = nullptr)
+{
+    QProcess process;
+    process.start(program, args);
+    if(!process.waitForStarted()){
+        if(errors){
+            *errors = process.errorString().toLocal8Bit();
+        }
+        return -1;
+    }
+    if(!input.isEmpty()){
+        process.write(input);
+    }
+    process.closeWriteChannel();
+    if(!process.waitForFinished((kConnectTimeoutSec + 5) * 1000)){
+        process.kill();
+        process.waitForFinished(1000);
+        return -1;
+    }
+    if(output){
+        *output = process.readAllStandardOutput();
+    }
+    if(errors){
+        *errors = process.readAllStandardError();
+    }
+    return process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+}
+
+}
+
+SshTunnelManager *SshTunnelManager::instance()
+{
+    static SshTunnelManager *ins = new SshTunnelManager;
+    return ins;
+}
+
+SshTunnelManager::SshTunnelManager(QObject *parent) : QObject(parent)
+{
+    m_thread = new QThread(this);
+    m_host = new SshTunnelHost;
+    m_host->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_host, &QObject::deleteLater);
+    connect(m_host, &SshTunnelHost::tunnelClosed, this, &SshTunnelManager::tunnelClosed);
+    m_thread->start();
+}
+
+void SshTunnelManager::setHostKeyPrompt(HostKeyPrompt prompt)
+{
+    m_hostKeyPrompt = std::move(prompt);
+}
+
+void SshTunnelManager::runOnTunnelThread(const std::function<void()> &work)
+{
+    if(QThread::currentThread() != QCoreApplication::instance()->thread()){
+        QMetaObject::invokeMethod(m_host, work, Qt::BlockingQueuedConnection);
+        return;
+    }
+    // Keep painting and input going on the GUI thread while ssh authenticates
+    QEventLoop loop;
+    QPointer<QEventLoop> waiter(&loop);
+    QMetaObject::invokeMethod(m_host, [work, waiter]() {
+        work();
+        QMetaObject::invokeMethod(waiter, "quit", Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+}
+
+bool SshTunnelManager::endpoint(const ConnectionInfo &info,
+                                QString *host,
+                                int *port,
+                                QString *errorMessage)
+{
+    if(!info.ssh.enabled || info.ssh.host.isEmpty()){
+        *host = info.host;
+        *port = info.port;
+        return true;
+    }
+    bool ok = false;
+    quint16 localPort = 0;
+    QString error;
+    for(int attempt = 0; attempt < 2 && !ok; ++attempt){
+        if(!m_host || !m_thread->isRunning()){
+            error = trLang(QStringLiteral("SSH 隧道已关闭"), QStringLiteral("SSH tunnels are shut down"));
+            break;
+        }
+        QString fingerprints;
+        runOnTunnelThread([&]() {
+            ok = m_host->forward(info, &localPort, &error, &fingerprints);
+        });
+        if(ok || fingerprints.isEmpty() || attempt > 0){
+            break;
+        }
+        // Only the GUI thread may ask; background sessions wait until the user has decided
+        const QString bastion = knownHostsPattern(info.ssh);
+        if(QThread::currentThread() != QCoreApplication::instance()->thread() || !m_hostKeyPrompt){
+            error = trLang(QStringLiteral("跳板机 %1 的主机密钥尚未确认，请先在主窗口中打开该连接"),
+                           QStringLiteral("The host key of %1 has not been accepted yet; open the connection from the main window first"))
+                    .arg(bastion);
+            break;
+        }
+        if(!m_hostKeyPrompt(bastion, fingerprints)){
+            error = trLang(QStringLiteral("未接受跳板机 %1 的主机密钥"),
+                           QStringLiteral("The host key of %1 was not accepted"))
+                    .arg(bastion);
+            break;
+        }
+        bool trusted = false;
+        runOnTunnelThread([&]() {
+            trusted = m_host->trustHostKey(info.ssh, &error);
+        });
+        if(!trusted){
+            break;
+        }
+    }
+    if(!ok){
+        if(errorMessage){
+            *errorMessage = error;
+        }
+        return false;
+    }
+    *host = QStringLiteral("127.0.0.1");
+    *port = localPort;
+    return true;
+}
+
+void SshTunnelManager::shutdown()
+{
+    if(!m_host || !m_thread->isRunning()){
+        return;
+    }
+    QMetaObject::invokeMethod(m_host, "stop", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    m_host = nullptr;
+}
+
+bool SshTunnelManager::runAskPass()
+{
+    if(!qEnvironmentVariableIsSet(kAskPassVar)){
+        return false;
+    }
+    const QByteArray secret = qgetenv(kAskPassVar);
+    std::fwrite(secret.constData(), 1, size_t(secret.size()), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+    return true;
+}
+
+SshTunnelHost::SshTunnelHost(QObject *parent) : QObject(parent)
+{
+}
+
+SshTunnelHost::~SshTunnelHost()
+{
+    delete m_controlDir;
+}
+
+bool SshTunnelHost::forward(const ConnectionInfo &info,
+                            quint16 *localPort,
+                            QString *errorMessage,
+                            QString *unknownHostKey)
+{
+    const QString key = tunnelKey(info);
+    const QString target = targetKey(info);
+    {
+        Tunnel &tunnel = m_tunnels[key];
+        if(!tunnel.connNames.contains(info.name)){
+            tunnel.connNames << info.name;
+        }
+        if(tunnel.process && tunnel.process->state() == QProcess::Running && tunnel.ports.contains(target)){
+            *localPort = tunnel.ports.value(target);
+            return true;
+        }
+    }
+    if(!m_tunnels.value(key).process){
+        QString fingerprints;
+        if(!hostKeyKnown(info.ssh, &fingerprints, errorMessage)){
+            if(unknownHostKey){
+                *unknownHostKey = fingerprints;
+            }
+            return false;
+        }
+    }
+    Tunnel &tunnel = m_tunnels[key];
+#ifdef Q_OS_WIN
+    if(!startForwarder(info.ssh, key, tunnel, target, errorMessage)){
+        return false;
+    }
+#else
+    if(!tunnel.process && !startMaster(info.ssh, key, tunnel, errorMessage)){
+        return false;
+    }
+    if(!addForward(info.ssh, tunnel, target, errorMessage)){
+        return false;
+    }
+#endif
+    *localPort = tunnel.ports.value(target);
+    return true;
+}
+
+bool SshTunnelHost::hostKeyKnown(const SshSettings &ssh, QString *fingerprints, QString *errorMessage)
+{
+    const QString pattern = knownHostsPattern(ssh);
+    QByteArray found;
+    if(runTool(QStringLiteral("ssh-keygen"), {QStringLiteral("-F"), pattern}, QByteArray(), &found) == 0
+       && !found.trimmed().isEmpty()){
+        return true;
+    }
+    QByteArray scanned;
+    QByteArray scanErrors;
+    runTool(QStringLiteral("ssh-keyscan"),
+            {QStringLiteral("-T"), QString::number(kConnectTimeoutSec),
+             QStringLiteral("-p"), QString::number(ssh.port), ssh.host},
+            QByteArray(), &scanned, &scanErrors);
+    QByteArray listed;
+    if(scanned.trimmed().isEmpty()
+       || runTool(QStringLiteral("ssh-keygen"), {QStringLiteral("-l"), QStringLiteral("-f"), QStringLiteral("-")},
+                  scanned, &listed) != 0){
+        if(errorMessage){
+            const QString detail = lastLogLines(scanErrors);
+            *errorMessage = trLang(QStringLiteral("无法读取跳板机 %1 的主机密钥：%2"),
+                                   QStringLiteral("Unable to read the host key of %1: %2"))
+                    .arg(pattern, detail.isEmpty() ? trLang(QStringLiteral("超时"), QStringLiteral("timed out")) : detail);
+        }
+        return false;
+    }
+    m_scannedKeys.insert(pattern, scanned);
+    *fingerprints = QString::fromLocal8Bit(listed).trimmed();
+    return false;
+}
+
+bool SshTunnelHost::trustHostKey(const SshSettings &ssh, QString *errorMessage)
+{
+    const QString pattern = knownHostsPattern(ssh);
+    const QByteArray keys = m_scannedKeys.take(pattern);
+    const QString sshDir = QDir::home().filePath(QStringLiteral(".ssh"));
+    QFile knownHosts(QDir(sshDir).filePath(QStringLiteral("known_hosts")));
+    if(keys.isEmpty() || !QDir().mkpath(sshDir) || !knownHosts.open(QIODevice::Append)){
+        if(errorMessage){
+            *errorMessage = trLang(QStringLiteral("无法写入 %1"), QStringLiteral("Unable to write %1"))
+                    .arg(QDir::toNativeSeparators(knownHosts.fileName()));
+        }
+        return false;
+    }
+    QFile::setPermissions(sshDir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+    knownHosts.write(keys.endsWith('\n') ? keys : keys + '\n');
+    return true;
+}
+
+QProcess *SshTunnelHost::launch(const SshSettings &ssh, const QStringList &extraArgs, QString *errorMessage)
+{
+    QStringList args = {
+        QStringLiteral("-N"),
+        QStringLiteral("-T"),
+        QStringLiteral("-o"), QStringLiteral("ExitOnForwardFailure=yes"),
+        QStringLiteral("-o"), QStringLiteral("StrictHostKeyChecking=yes"),
+        QStringLiteral("-o"), QStringLiteral("ConnectTimeout=%1").arg(kConnectTimeoutSec),
+        QStringLiteral("-o"), QStringLiteral("ServerAliveInterval=%1").arg(kAliveIntervalSec),
+        QStringLiteral("-o"), QStringLiteral("ServerAliveCountMax=%1").arg(kAliveCountMax),
+        QStringLiteral("-p"), QString::number(ssh.port)
+    };
+    if(!ssh.user.isEmpty()){
+        args << QStringLiteral("-l") << ssh.user;
+    }
+    args << extraArgs;
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    if(ssh.password.isEmpty()){
+        // Keys or agent only; never prompt
+        args << QStringLiteral("-o") << QStringLiteral("BatchMode=yes");
+    }else{
+        // ssh takes no password on the command line: it starts this program as
+        // askpass, and the password reaches that child through the environment
+        env.insert(QStringLiteral("SSH_ASKPASS"), QCoreApplication::applicationFilePath());
+        env.insert(QStringLiteral("SSH_ASKPASS_REQUIRE"), QStringLiteral("force"));
+        if(!env.contains(QStringLiteral("DISPLAY"))){
+            env.insert(QStringLiteral("DISPLAY"), QStringLiteral(":0"));
+        }
+        env.insert(QLatin1String(kAskPassVar), ssh.password);
+        args << QStringLiteral("-o") << QStringLiteral("NumberOfPasswordPrompts=1");
+    }
+    args << ssh.host;
+
+    auto *process = new QProcess(this);
+    process->setProcessEnvironment(env);
+    process->setReadChannel(QProcess::StandardError);
+    process->setStandardInputFile(QProcess::nullDevice());
+    process->setStandardOutputFile(QProcess::nullDevice());
+    process->start(QStringLiteral("ssh"), args);
+    if(!process->waitForStarted()){
+        if(errorMessage){
+            *errorMessage = trLang(QStringLiteral("无法启动 ssh：%1"), QStringLiteral("Unable to start ssh: %1"))
+                    .arg(process->errorString());
+        }
+        delete process;
+        return nullptr;
+    }
+    return process;
+}
+
+bool SshTunnelHost::startMaster(const SshSettings &ssh, const QString &key, Tunnel &tunnel, QString *errorMessage)
+{
+    if(!m_controlDir){
+        // Private (0700) directory, so no other user can plant or reach the control sockets
+        m_controlDir = new QTemporaryDir(QDir::temp().filePath(QStringLiteral("OpenDBKit-XXXXXX")));
+    }
+    if(!m_controlDir->isValid()){
+        if(errorMessage){
+            *errorMessage = trLang(QStringLiteral("无法创建 SSH 控制目录"), QStringLiteral("Unable to create the SSH control directory"));
+        }
+        return false;
+    }
+    // Socket paths are limited to about 100 bytes; name them by a short hash of the bastion
+    tunnel.controlPath = m_controlDir->filePath(QString::fromLatin1(
+            QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(16)));
+    QFile::remove(tunnel.controlPath);
+    QProcess *process = launch(ssh, {QStringLiteral("-o"), QStringLiteral("ControlMaster=yes"),
+                                     QStringLiteral("-o"), QStringLiteral("ControlPersist=no"),
+                                     QStringLiteral("-o"), QStringLiteral("ControlPath=%1").arg(tunnel.controlPath)},
+                               errorMessage);
+    if(!process){
+        return false;
+    }
+
+    // The master opens its control socket only after authenticating, so
+    // "ssh -O check" succeeding means the transport is up
+    tunnel.log.clear();
+    bool ready = false;
+    QElapsedTimer timer;
+    timer.start();
+    while(!ready && process->state() == QProcess::Running && timer.elapsed() < (kConnectTimeoutSec + 15) * 1000){
+        if(process->waitForReadyRead(200)){
+            tunnel.log += process->readAllStandardError();
+        }
+        ready = QFile::exists(tunnel.controlPath)
+                && runTool(QStringLiteral("ssh"), {QStringLiteral("-o"), QStringLiteral("ControlPath=%1").arg(tunnel.controlPath),
+                                                   QStringLiteral("-O"), QStringLiteral("check"), ssh.host},
+                           QByteArray(), nullptr) == 0;
+    }
+    if(!ready){
+        tunnel.log += process->readAllStandardError();
+        if(errorMessage){
+            const QString detail = lastLogLines(tunnel.log);
+            *errorMessage = trLang(QStringLiteral("SSH 隧道建立失败：%1"), QStringLiteral("SSH tunnel failed: %1"))
+                    .arg(detail.isEmpty() ? trLang(QStringLiteral("超时"), QStringLiteral("timed out")) : detail);
+        }
+        process->kill();
+        process->waitForFinished(1000);
+        delete process;
+        return false;
+    }
+    tunnel.ports.clear();
+    watch(key, tunnel, process);
+    return true;
+}
+
+bool SshTunnelHost::addForward(const SshSettings &ssh, Tunnel &tunnel, const QString &target, QString *errorMessage)
+{
+    QByteArray errors;
+    for(int attempt = 0; attempt < kForwardAttempts; ++attempt){
+        const quint16 port = freeLocalPort();
+        if(port == 0){
+            break;
+        }
+        // The master binds the listener before replying, so success means the port is ours
+        const int status = runTool(QStringLiteral("ssh"),
+                                   {QStringLiteral("-o"), QStringLiteral("ControlPath=%1").arg(tunnel.controlPath),
+                                    QStringLiteral("-O"), QStringLiteral("forward"),
+                                    QStringLiteral("-L"), QStringLiteral("127.0.0.1:%1:%2").arg(port).arg(target),
+                                    ssh.host},
+                                   QByteArray(), nullptr, &errors);
+        if(status == 0){
+            tunnel.ports.insert(target, port);
+            return true;
+        }
+        if(!tunnel.process || tunnel.process->state() != QProcess::Running){
+            break;
+        }
+    }
+    if(errorMessage){
+        const QString detail = lastLogLines(errors);
+        *errorMessage = trLang(QStringLiteral("SSH 端口转发失败：%1"), QStringLiteral("SSH port forwarding failed: %1"))
+                .arg(detail.isEmpty() ? trLang(QStringLiteral("没有可用的本地端口"), QStringLiteral("No free local port")) : detail);
+    }
+    return false;
+}
+
+bool SshTunnelHost::startForwarder(const SshSettings &ssh, const QString &key, Tunnel &tunnel,
+                                   const QString &target, QString *errorMessage)
+{
+#ifdef Q_OS_WIN
+    for(int attempt = 0; attempt < kForwardAttempts; ++attempt){
+        const quint16 port = freeLocalPort();
+        if(port == 0){
+            break;
+        }
+        QProcess *process = launch(ssh, {QStringLiteral("-v"),
+                                         QStringLiteral("-L"), QStringLiteral("127.0.0.1:%1:%2").arg(port).arg(target)},
+                                   errorMessage);
+        if(!process){
+            return false;
+        }
+        // Wait until authentication is done and the forward is listening
+        tunnel.log.clear();
+        bool ready = false;
+        QElapsedTimer timer;
+        timer.start();
+        while(!ready && timer.elapsed() < (kConnectTimeoutSec + 15) * 1000){
+            if(!process->waitForReadyRead(200) && process->state() != QProcess::Running){
+                break;
+            }
+            tunnel.log += process->readAllStandardError();
+            ready = tunnel.log.contains(kReadyMarker);
+        }
+        if(ready){
+            tunnel.ports.clear();
+            tunnel.ports.insert(target, port);
+            watch(key, tunnel, process);
+            return true;
+        }
+        tunnel.log += process->readAllStandardError();
+        process->kill();
+        process->waitForFinished(1000);
+        delete process;
+        // Someone else took the port in between: pick another one
+        if(!tunnel.log.contains(kForwardFailedMarker)){
+            break;
+        }
+    }
+    if(errorMessage){
+        const QString detail = lastLogLines(tunnel.log);
+        *errorMessage = trLang(QStringLiteral("SSH 隧道建立失败：%1"), QStringLiteral("SSH tunnel failed: %1"))
+                .arg(detail.isEmpty() ? trLang(QStringLiteral("超时"), QStringLiteral("timed out")) : detail);
+    }
+    return false;
+#else
+    Q_UNUSED(ssh)
+    Q_UNUSED(key)
+    Q_UNUSED(tunnel)
+    Q_UNUSED(target)
+    Q_UNUSED(errorMessage)
+    return false;
+#endif
+}
+
+void SshTunnelHost::watch(const QString &key, Tunnel &tunnel, QProcess *process)
+{
+    // Keep only the tail of later output; it explains a drop
+    tunnel.process = process;
+    tunnel.log = tunnel.log.right(kMaxLogBytes);
+    connect(process, &QProcess::readyReadStandardError, this, [this, key]() {
+        auto it = m_tunnels.find(key);
+        if(it != m_tunnels.end() && it->process){
+            it->log += it->process->readAllStandardError();
+            if(it->log.size() > 2 * kMaxLogBytes){
+                it->log = it->log.right(kMaxLogBytes);
+            }
+        }
+    });
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, key]() {
+        handleFinished(key);
+    });
+}
+
+void SshTunnelHost::stop()
+{
+    for(auto it = m_tunnels.begin(); it != m_tunnels.end(); ++it){
+        stopProcess(it.value());
+    }
+    m_tunnels.clear();
+}
+
+void SshTunnelHost::stopProcess(Tunnel &tunnel)
+{
+    if(!tunnel.process){
+        return;
+    }
+    tunnel.process->disconnect(this);
+    tunnel.process->kill();
+    tunnel.process->waitForFinished(1000);
+    delete tunnel.process;
+    tunnel.process = nullptr;
+    tunnel.ports.clear();
+}
+
+void SshTunnelHost::handleFinished(const QString &key)
+{
+    auto it = m_tunnels.find(key);
+    if(it == m_tunnels.end() || !it->process){
+        return;
+    }
+    qWarning("SSH tunnel %s closed: %s", qPrintable(key), qPrintable(lastLogLines(it->log)));
+    it->process->disconnect(this);
+    it->process->deleteLater();
+    it->process = nullptr;
+    // Every forward went with the transport; they are set up again on next use
+    it->ports.clear();
+    emit tunnelClosed(it->connNames);
+}
@@ -0,0 +1,110 @@
+#ifndef SSHTUNNEL_H
+#define SSHTUNNEL_H
+
+#include "connectionmanager.h"
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <functional>
+
+class QProcess;
+class QTemporaryDir;
+class QThread;
+class SshTunnelHost;
+
+// Reaches MySQL servers behind SSH bastions through the system OpenSSH
+// client. One ssh master process (one SSH transport) runs per bastion and
+// every server behind it is added to that master with "ssh -O forward", so
+// a new session costs a direct-tcpip channel instead of an SSH handshake
+// and adding a server never disturbs the sessions already open. OpenSSH on
+// Windows has no connection multiplexing; there each server gets its own
+// ssh process instead. Unknown bastion host keys are never trusted
+// silently: their fingerprints go to the host key prompt and are written
+// to known_hosts only after the user accepts them. Tunnels send keepalives
+// and are restarted on next use after they drop. endpoint() may be called
+// from any thread except the tunnel thread; on the GUI thread it keeps the
+// event loop running while the tunnel comes up.
+class SshTunnelManager : public QObject
+{
+    Q_OBJECT
+public:
+    // Shows the fingerprints of an unknown bastion key; returns true to trust it
+    using HostKeyPrompt = std::function<bool(const QString &bastion, const QString &fingerprints)>;
+
+    static SshTunnelManager *instance();
+
+    bool endpoint(const ConnectionInfo &info,
+                  QString *host,
+                  int *port,
+                  QString *errorMessage = nullptr);
+    void shutdown();
+    // Called on the GUI thread only; without a prompt unknown host keys are refused
+    void setHostKeyPrompt(HostKeyPrompt prompt);
+
+    // When started by ssh as SSH_ASKPASS, prints the password and returns true;
+    // call before creating QApplication
+    static bool runAskPass();
+
+signals:
+    // A tunnel dropped; sessions opened through it are gone
+    void tunnelClosed(const QStringList &connNames);
+
+private:
+    explicit SshTunnelManager(QObject *parent = nullptr);
+
+    void runOnTunnelThread(const std::function<void()> &work);
+
+    QThread *m_thread = nullptr;
+    SshTunnelHost *m_host = nullptr;
+    HostKeyPrompt m_hostKeyPrompt;
+};
+
+// Owns the ssh processes; lives on the tunnel thread.
+class SshTunnelHost : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SshTunnelHost(QObject *parent = nullptr);
+    ~SshTunnelHost() override;
+
+    // On an unknown bastion key returns false with its fingerprints in *unknownHostKey
+    bool forward(const ConnectionInfo &info,
+                 quint16 *localPort,
+                 QString *errorMessage,
+                 QString *unknownHostKey);
+    // Adds the keys shown by the last forward() for this bastion to known_hosts
+    bool trustHostKey(const SshSettings &ssh, QString *errorMessage);
+
+public slots:
+    void stop();
+
+signals:
+    void tunnelClosed(const QStringList &connNames);
+
+private:
+    struct Tunnel {
+        QProcess *process = nullptr;
+        QString controlPath;            // master's control socket, empty without multiplexing
+        QHash<QString, quint16> ports;  // MySQL server "host:port" -> local forwarding port
+        QStringList connNames;
+        QByteArray log;
+    };
+
+    bool hostKeyKnown(const SshSettings &ssh, QString *fingerprints, QString *errorMessage);
+    bool startMaster(const SshSettings &ssh, const QString &key, Tunnel &tunnel, QString *errorMessage);
+    bool addForward(const SshSettings &ssh, Tunnel &tunnel, const QString &target, QString *errorMessage);
+    bool startForwarder(const SshSettings &ssh, const QString &key, Tunnel &tunnel,
+                        const QString &target, QString *errorMessage);
+    QProcess *launch(const SshSettings &ssh, const QStringList &extraArgs, QString *errorMessage);
+    void watch(const QString &key, Tunnel &tunnel, QProcess *process);
+    void stopProcess(Tunnel &tunnel);
+    void handleFinished(const QString &key);
+
+    QHash<QString, Tunnel> m_tunnels;
+    // ssh-keyscan output awaiting the user's decision, per known_hosts pattern
+    QHash<QString, QByteArray> m_scannedKeys;
+    QTemporaryDir *m_controlDir = nullptr;
+};
+
+#endif // SSHTUNNEL_H
@@ -46,10 +46,12 @@ bool configureDatabase(QSqlDatabase &db,
                        const QString &database,
                        QString *errorMessage)
 {
-    db.setHostName(info.host);
-    db.setPort(info.port);
+    if(!ConnectionManager::applyEndpoint(db, info, errorMessage)){
+        return false;
+    }
     db.setUserName(info.user);
     db.setPassword(info.password);
+    db.setConnectOptions(ConnectionManager::connectOptions(info));
     if(!database.isEmpty()){
         db.setDatabaseName(database);
     }
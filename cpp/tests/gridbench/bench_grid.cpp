@@ -0,0 +1,79 @@
+#include "resultform.h"
+
+#include <QFile>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QtTest>
+
+// Scrolls a screen-sized result grid over synthetic data and reports the
+// frame rate of QStyle painting and of the fast path.
+class BenchGrid : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void scrolling_data();
+    void scrolling();
+
+private:
+    QStringList m_headers;
+    QList<QVariantList> m_rows;
+};
+
+void BenchGrid::initTestCase()
+{
+    const int rowCount = 5000;
+    const int columnCount = 40;
+    for(int c = 0; c < columnCount; ++c){
+        m_headers << QStringLiteral("column_%1").arg(c);
+    }
+    m_rows.reserve(rowCount);
+    for(int r = 0; r < rowCount; ++r){
+        QVariantList row;
+        row.reserve(columnCount);
+        for(int c = 0; c < columnCount; ++c){
+            if((r + c) % 17 == 0){
+                row << QVariant();
+            }else if(c % 3 == 0){
+                row << qint64(r) * columnCount + c;
+            }else{
+                row << QStringLiteral("row %1 value %2 ").arg(r).arg(c).repeated(1 + c % 4);
+            }
+        }
+        m_rows << row;
+    }
+}
+
+void BenchGrid::scrolling_data()
+{
+    QTest::addColumn<bool>("fastRendering");
+    QTest::newRow("QStyle") << false;
+    QTest::newRow("fast") << true;
+}
+
+void BenchGrid::scrolling()
+{
+    QFETCH(bool, fastRendering);
+    const int frames = 300;
+
+    ResultForm form;
+    QFile qss(QStringLiteral(":/qss/mainwindow.qss"));
+    if(qss.open(QIODevice::ReadOnly)){
+        form.setStyleSheet(QString::fromUtf8(qss.readAll()));
+    }
+    form.showRows(m_headers, m_rows);
+    form.setGeometry(QGuiApplication::primaryScreen()->availableGeometry());
+    form.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&form));
+
+    const QSize size = form.tableWidget()->viewport()->size();
+    const double fps = form.benchmarkScrolling(frames, fastRendering);
+    QVERIFY(fps > 0);
+    qInfo("grid %dx%d, viewport %dx%d, %d frames: %.1f fps",
+          m_rows.size(), m_headers.size(), size.width(), size.height(), frames, fps);
+}
+
+QTEST_MAIN(BenchGrid)
+
+#include "bench_grid.moc"
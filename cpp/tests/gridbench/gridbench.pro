@@ -0,0 +1,22 @@
+QT       += core gui widgets testlib
+
+TARGET = bench_grid
+CONFIG += c++17
+
+SRC = $$PWD/../..
+INCLUDEPATH += $$SRC
+
+SOURCES += \
+        bench_grid.cpp \
+        $$SRC/exportdialog.cpp \
+        $$SRC/resultfile.cpp \
+        $$SRC/resultform.cpp \
+        $$SRC/resultspill.cpp
+
+HEADERS += \
+        $$SRC/exportdialog.h \
+        $$SRC/resultfile.h \
+        $$SRC/resultform.h \
+        $$SRC/resultspill.h
+
+RESOURCES = $$SRC/resources.qrc
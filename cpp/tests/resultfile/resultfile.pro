@@ -0,0 +1,16 @@
+QT       += core testlib
+QT       -= gui
+
+TARGET = tst_resultfile
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+SRC = $$PWD/../..
+INCLUDEPATH += $$SRC
+
+SOURCES += \
+        tst_resultfile.cpp \
+        $$SRC/resultfile.cpp
+
+HEADERS += \
+        $$SRC/resultfile.h
@@ -0,0 +1,273 @@
+#include "resultfile.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+
+namespace {
+
+const int kRowCount = 70000;
+
+QStringList typedHeaders()
+{
+    return {
+        QStringLiteral("int"), QStringLiteral("real"), QStringLiteral("date"), QStringLiteral("time"),
+        QStringLiteral("datetime"), QStringLiteral("text"), QStringLiteral("mixed")
+    };
+}
+
+// QMetaType ids of the typed columns as the grid reports them
+QVector<int> typedMetaTypes()
+{
+    return {
+        QMetaType::LongLong, QMetaType::Double, QMetaType::QDate, QMetaType::QTime,
+        QMetaType::QDateTime, QMetaType::QString, QMetaType::QString
+    };
+}
+
+// Every column type, NULL and empty text
+QString typedCell(int row, int col, bool *isNull)
+{
+    *isNull = row % 7 == col;
+    if(*isNull){
+        return QString();
+    }
+    const QString date = QDate(2021, 1, 1).addDays(row % 1000).toString(Qt::ISODate);
+    // 03-28 02:30 does not exist in many time zones; wall-clock values must still read back unchanged
+    const QString time = row == 100 ? QStringLiteral("02:30:00.000")
+                                    : QTime::fromMSecsSinceStartOfDay(row * 1237 % 86400000).toString(Qt::ISODateWithMs);
+    switch(col){
+    case 0: return QString::number(qint64(row) * 1000003 - 5000000);
+    case 1: return QString::number(row / 8.0 - 3, 'g', QLocale::FloatingPointShortest);
+    case 2: return date;
+    case 3: return time;
+    case 4: return row == 100 ? QStringLiteral("2021-03-28T02:30:00.000") : QString(date + QLatin1Char('T') + time);
+    case 5: return row % 3 == 0 ? QString() : QStringLiteral("text %1").arg(row);
+    default: return row % 2 == 0 ? QString::number(row) : QStringLiteral("value %1").arg(row);
+    }
+}
+
+}
+
+class TestResultFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void typedColumns();
+    void noRows();
+    void gridDateTimeFormat();
+    void valuesThatDoNotRoundTrip();
+    void compressedChunks();
+    void uncompressedChunks();
+    void wideText();
+    void rejectsDamagedFile_data();
+    void rejectsDamagedFile();
+
+private:
+    // Writes rowCount rows, reopens the file and compares headers, column types and every cell
+    void roundTrip(const QString &name,
+                   const QStringList &headers,
+                   const QVector<int> &metaTypes,
+                   int rowCount,
+                   const ResultFile::CellReader &cell,
+                   const QVector<ResultFile::ColumnType> &types);
+
+    QTemporaryDir m_dir;
+};
+
+void TestResultFile::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void TestResultFile::roundTrip(const QString &name,
+                               const QStringList &headers,
+                               const QVector<int> &metaTypes,
+                               int rowCount,
+                               const ResultFile::CellReader &cell,
+                               const QVector<ResultFile::ColumnType> &types)
+{
+    const QString path = m_dir.filePath(name);
+    QString error;
+    ResultFile file;
+    QVERIFY2(ResultFile::write(path, headers, metaTypes, rowCount, cell, &error), qPrintable(error));
+    QVERIFY2(file.open(path, &error), qPrintable(error));
+    QCOMPARE(file.headers(), headers);
+    QCOMPARE(file.rowCount(), rowCount);
+    for(int col = 0; col < headers.size(); ++col){
+        QCOMPARE(file.columnType(col), types.at(col));
+    }
+    for(int row = 0; row < rowCount; ++row){
+        for(int col = 0; col < headers.size(); ++col){
+            bool expectedNull = false;
+            bool isNull = false;
+            const QString expected = cell(row, col, &expectedNull);
+            const QString text = file.text(row, col, &isNull);
+            if(isNull != expectedNull || (!isNull && text != expected)){
+                QFAIL(qPrintable(QStringLiteral("row %1 column %2 reads back as \"%3\", expected \"%4\"")
+                                 .arg(row).arg(col).arg(text, expected)));
+            }
+        }
+    }
+}
+
+void TestResultFile::typedColumns()
+{
+    // More rows than fit in one row group
+    roundTrip(QStringLiteral("typed.odbr"), typedHeaders(), typedMetaTypes(), kRowCount, typedCell,
+              {ResultFile::Int64, ResultFile::Real, ResultFile::Date, ResultFile::Time,
+               ResultFile::DateTime, ResultFile::Text, ResultFile::Text});
+}
+
+void TestResultFile::noRows()
+{
+    // Without rows the column types come from the grid alone; unknown is Text
+    QVector<int> metaTypes = typedMetaTypes();
+    metaTypes.removeLast();
+    roundTrip(QStringLiteral("empty.odbr"), typedHeaders(), metaTypes, 0, typedCell,
+              {ResultFile::Int64, ResultFile::Real, ResultFile::Date, ResultFile::Time,
+               ResultFile::DateTime, ResultFile::Text, ResultFile::Text});
+}
+
+void TestResultFile::gridDateTimeFormat()
+{
+    // Date-times and times as the grid edits them: space separator, no milliseconds
+    auto cell = [](int row, int col, bool *isNull) {
+        *isNull = row % 5 == 4;
+        if(*isNull){
+            return QString();
+        }
+        const QDateTime value = QDateTime(QDate(2020, 2, 28), QTime(23, 59, 30)).addSecs(qint64(row) * 3601);
+        return value.toString(col == 0 ? QStringLiteral("yyyy-MM-dd HH:mm:ss") : QStringLiteral("HH:mm:ss"));
+    };
+    roundTrip(QStringLiteral("gridformat.odbr"), {QStringLiteral("datetime"), QStringLiteral("time")},
+              {QMetaType::QDateTime, QMetaType::QTime}, kRowCount, cell,
+              {ResultFile::DateTime, ResultFile::Time});
+}
+
+void TestResultFile::valuesThatDoNotRoundTrip()
+{
+    // Text that does not match the column's type keeps the column as Text
+    auto cell = [](int row, int col, bool *isNull) {
+        *isNull = false;
+        switch(col){
+        case 0: return row == 3 ? QStringLiteral("0042") : QString::number(row);
+        case 1: return row == 3 ? QStringLiteral("2021-01-01 10:00:00.5") : QStringLiteral("2021-01-01 10:00:00");
+        default: return row % 2 == 0 ? QStringLiteral("true") : QStringLiteral("false");
+        }
+    };
+    roundTrip(QStringLiteral("fallback.odbr"), {QStringLiteral("padded"), QStringLiteral("mixed"), QStringLiteral("bool")},
+              {QMetaType::Int, QMetaType::QDateTime, QMetaType::Bool}, 10, cell,
+              {ResultFile::Text, ResultFile::Text, ResultFile::Text});
+}
+
+void TestResultFile::compressedChunks()
+{
+    auto cell = [](int, int, bool *isNull) {
+        *isNull = false;
+        return QStringLiteral("the same text on every row");
+    };
+    roundTrip(QStringLiteral("repeated.odbr"), {QStringLiteral("text")}, {QMetaType::QString}, kRowCount, cell,
+              {ResultFile::Text});
+    QVERIFY(QFileInfo(m_dir.filePath(QStringLiteral("repeated.odbr"))).size() < kRowCount);
+}
+
+void TestResultFile::uncompressedChunks()
+{
+    // Random data does not compress and is stored as is
+    QVector<qint64> values(kRowCount);
+    QRandomGenerator random(20240501);
+    for(qint64 &value : values){
+        value = qint64(random.generate64());
+    }
+    auto cell = [&values](int row, int, bool *isNull) {
+        *isNull = false;
+        return QString::number(values.at(row));
+    };
+    roundTrip(QStringLiteral("random.odbr"), {QStringLiteral("int")}, {QMetaType::LongLong}, kRowCount, cell,
+              {ResultFile::Int64});
+    QVERIFY(QFileInfo(m_dir.filePath(QStringLiteral("random.odbr"))).size() >= qint64(kRowCount) * 8);
+}
+
+void TestResultFile::wideText()
+{
+    // 20 MB of text per row: row groups end early at the byte limit
+    const int wideChars = 20 * 1024 * 1024;
+    auto cell = [wideChars](int row, int col, bool *isNull) {
+        *isNull = false;
+        return col == 0 ? QString(wideChars, QChar(QLatin1Char(char('a' + row)))) : QString::number(row);
+    };
+    roundTrip(QStringLiteral("wide.odbr"), {QStringLiteral("blob"), QStringLiteral("id")},
+              {QMetaType::QString, QMetaType::Int}, 5, cell,
+              {ResultFile::Text, ResultFile::Int64});
+}
+
+void TestResultFile::rejectsDamagedFile_data()
+{
+    QTest::addColumn<int>("damage");
+    QTest::newRow("bad header magic") << 0;
+    QTest::newRow("bad trailer magic") << 1;
+    QTest::newRow("truncated file") << 2;
+    QTest::newRow("footer length past the end of the file") << 3;
+    QTest::newRow("footer offset inside the header") << 4;
+    QTest::newRow("footer shorter than its index") << 5;
+}
+
+void TestResultFile::rejectsDamagedFile()
+{
+    QFETCH(int, damage);
+    const QString validPath = m_dir.filePath(QStringLiteral("valid.odbr"));
+    QString error;
+    QVERIFY2(ResultFile::write(validPath, typedHeaders(), typedMetaTypes(), 100, typedCell, &error), qPrintable(error));
+    QFile validFile(validPath);
+    QVERIFY(validFile.open(QIODevice::ReadOnly));
+    QByteArray bytes = validFile.readAll();
+    validFile.close();
+    QVERIFY(bytes.size() > 32);
+
+    // The trailer holds the footer offset (8 bytes), its length (4) and the magic (4)
+    const int trailer = bytes.size() - 16;
+    switch(damage){
+    case 0:
+        bytes[0] = 'X';
+        break;
+    case 1:
+        bytes[bytes.size() - 1] = 'X';
+        break;
+    case 2:
+        bytes.chop(10);
+        break;
+    case 3:
+        qToLittleEndian<quint32>(0xFFFFFFF0u, bytes.data() + trailer + 8);
+        break;
+    case 4:
+        qToLittleEndian<quint64>(2, bytes.data() + trailer);
+        break;
+    case 5: {
+        // 8 bytes short: the index no longer matches the row group count
+        const quint32 length = qFromLittleEndian<quint32>(bytes.constData() + trailer + 8);
+        qToLittleEndian<quint32>(length - 8, bytes.data() + trailer + 8);
+        break;
+    }
+    }
+
+    const QString path = m_dir.filePath(QStringLiteral("damaged.odbr"));
+    QFile out(path);
+    QVERIFY(out.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QCOMPARE(out.write(bytes), qint64(bytes.size()));
+    out.close();
+    ResultFile file;
+    error.clear();
+    QVERIFY(!file.open(path, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestResultFile)
+
+#include "tst_resultfile.moc"
@@ -0,0 +1,18 @@
+QT       += core network testlib
+QT       -= gui
+
+TARGET = tst_sshtunnel
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+SRC = $$PWD/../..
+INCLUDEPATH += $$SRC
+
+SOURCES += \
+        tst_sshtunnel.cpp \
+        $$SRC/languagemanager.cpp \
+        $$SRC/sshtunnel.cpp
+
+HEADERS += \
+        $$SRC/languagemanager.h \
+        $$SRC/sshtunnel.h
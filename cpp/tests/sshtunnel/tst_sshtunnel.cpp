@@ -0,0 +1,102 @@
+#include "sshtunnel.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+
+// Needs a reachable sshd: set OPENDBKIT_TEST_SSH_BASTION to [user@]host[:port].
+// Only key or agent authentication is used and the bastion's host key must
+// already be in known_hosts; the test is skipped without the variable.
+class TestSshTunnel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void secondTargetSharesTheBastion();
+    void cleanupTestCase();
+
+private:
+    // Sends payload through the tunnel; peer (the target's end) echoes it back
+    static bool roundTrip(QTcpSocket &client, QTcpSocket *peer, const QByteArray &payload);
+
+    SshSettings m_ssh;
+};
+
+void TestSshTunnel::initTestCase()
+{
+    QString host = qEnvironmentVariable("OPENDBKIT_TEST_SSH_BASTION");
+    if(host.isEmpty()){
+        QSKIP("OPENDBKIT_TEST_SSH_BASTION is not set");
+    }
+    m_ssh.enabled = true;
+    const int at = host.indexOf(QLatin1Char('@'));
+    if(at >= 0){
+        m_ssh.user = host.left(at);
+        host = host.mid(at + 1);
+    }
+    const int colon = host.lastIndexOf(QLatin1Char(':'));
+    if(colon > 0 && host.count(QLatin1Char(':')) == 1){
+        m_ssh.port = quint16(host.mid(colon + 1).toUInt());
+        host = host.left(colon);
+    }
+    m_ssh.host = host;
+}
+
+bool TestSshTunnel::roundTrip(QTcpSocket &client, QTcpSocket *peer, const QByteArray &payload)
+{
+    client.write(payload);
+    if(!client.waitForBytesWritten(5000)){
+        return false;
+    }
+    QByteArray received;
+    while(received.size() < payload.size() && peer->waitForReadyRead(5000)){
+        received += peer->readAll();
+    }
+    peer->write(received);
+    if(received != payload || !peer->waitForBytesWritten(5000)){
+        return false;
+    }
+    QByteArray echoed;
+    while(echoed.size() < payload.size() && client.waitForReadyRead(5000)){
+        echoed += client.readAll();
+    }
+    return echoed == payload;
+}
+
+void TestSshTunnel::secondTargetSharesTheBastion()
+{
+    // Forward to two local ports through the same bastion; adding the second
+    // target must leave the first connection working
+    QTcpServer targets[2];
+    QTcpSocket clients[2];
+    QTcpSocket *peers[2] = {nullptr, nullptr};
+    for(int i = 0; i < 2; ++i){
+        QVERIFY(targets[i].listen(QHostAddress::LocalHost, 0));
+        ConnectionInfo info;
+        info.name = QStringLiteral("tunnel-test-%1").arg(i);
+        info.host = QStringLiteral("127.0.0.1");
+        info.port = targets[i].serverPort();
+        info.ssh = m_ssh;
+        QString localHost;
+        int localPort = 0;
+        QString error;
+        QVERIFY2(SshTunnelManager::instance()->endpoint(info, &localHost, &localPort, &error), qPrintable(error));
+        clients[i].connectToHost(localHost, quint16(localPort));
+        QVERIFY(clients[i].waitForConnected(5000));
+        QVERIFY(targets[i].waitForNewConnection(5000));
+        peers[i] = targets[i].nextPendingConnection();
+        QVERIFY(roundTrip(clients[i], peers[i], QByteArrayLiteral("ping")));
+    }
+    QCOMPARE(clients[0].state(), QAbstractSocket::ConnectedState);
+    QVERIFY(roundTrip(clients[0], peers[0], QByteArrayLiteral("still there")));
+}
+
+void TestSshTunnel::cleanupTestCase()
+{
+    SshTunnelManager::instance()->shutdown();
+}
+
+QTEST_GUILESS_MAIN(TestSshTunnel)
+
+#include "tst_sshtunnel.moc"